@@ -24,6 +24,7 @@
 #endif // HAVE_CONFIG_H
 
 #include <errno.h>
+#include <sched.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
@@ -31,32 +32,264 @@
 #include <glib.h>
 
 #include "path.h"
+#include "probes.h"
 #include "children.h"
 #include "trace.h"
 #include "sydbox-log.h"
 #include "sydbox-config.h"
 
-void tchild_new(GHashTable *children, pid_t pid)
+/* Children, sandbox data and filesystem contexts are allocated from slabs of
+ * TCHILD_SLAB_SIZE entries which are never returned to the system until
+ * tchild_pool_free(). Freed entries go to a free list and are reused last
+ * in, first out. The first word of a free entry links the list. Each thread
+ * has pools of its own, so sandboxes running in different threads don't
+ * share them.
+ */
+#define TCHILD_SLAB_SIZE 64
+
+struct tchild_pool
+{
+    const char *name;
+    gsize size;
+    gpointer free_list;
+    GSList *slabs;
+    struct tchild_pool_stats stats;
+};
+
+static __thread struct tchild_pool pools[TCHILD_POOL_MAX] = {
+    { "children",  sizeof(struct tchild), NULL, NULL, { 0, 0, 0, 0, 0 } },
+    { "sandboxes", sizeof(struct tdata),  NULL, NULL, { 0, 0, 0, 0, 0 } },
+    { "fs",        sizeof(struct tfs),    NULL, NULL, { 0, 0, 0, 0, 0 } },
+};
+
+static gpointer tchild_pool_alloc(guint which)
+{
+    struct tchild_pool *pool = &pools[which];
+    gpointer entry;
+
+    if (G_UNLIKELY(NULL == pool->free_list)) {
+        char *slab = g_malloc(pool->size * TCHILD_SLAB_SIZE);
+        for (int i = TCHILD_SLAB_SIZE - 1; i >= 0; i--) {
+            *(gpointer *) (slab + i * pool->size) = pool->free_list;
+            pool->free_list = slab + i * pool->size;
+        }
+        pool->slabs = g_slist_prepend(pool->slabs, slab);
+        pool->stats.free += TCHILD_SLAB_SIZE;
+        ++pool->stats.slabs;
+    }
+
+    entry = pool->free_list;
+    pool->free_list = *(gpointer *) entry;
+    --pool->stats.free;
+    ++pool->stats.allocs;
+    if (++pool->stats.in_use > pool->stats.peak)
+        pool->stats.peak = pool->stats.in_use;
+    return entry;
+}
+
+static void tchild_pool_release(guint which, gpointer entry)
+{
+    struct tchild_pool *pool = &pools[which];
+
+    *(gpointer *) entry = pool->free_list;
+    pool->free_list = entry;
+    ++pool->stats.free;
+    --pool->stats.in_use;
+}
+
+void tchild_pool_stats(guint which, struct tchild_pool_stats *stats)
+{
+    g_assert(which < TCHILD_POOL_MAX);
+    *stats = pools[which].stats;
+}
+
+const char *tchild_pool_name(guint which)
+{
+    g_assert(which < TCHILD_POOL_MAX);
+    return pools[which].name;
+}
+
+void tchild_pool_free(void)
+{
+    for (guint i = 0; i < TCHILD_POOL_MAX; i++) {
+        struct tchild_pool *pool = &pools[i];
+
+        g_assert(0 == pool->stats.in_use);
+        for (GSList *walk = pool->slabs; NULL != walk; walk = g_slist_next(walk))
+            g_free(walk->data);
+        g_slist_free(pool->slabs);
+        pool->slabs = NULL;
+        pool->free_list = NULL;
+        pool->stats.free = 0;
+        pool->stats.slabs = 0;
+    }
+}
+
+static struct tfs *tfs_new(void)
+{
+    struct tfs *fs = tchild_pool_alloc(TCHILD_POOL_FS);
+
+    fs->refs = 1;
+    fs->generation = 0;
+    fs->cwd_generation = 0;
+    fs->cwd = NULL;
+    return fs;
+}
+
+static inline void tfs_release_cwd(struct tfs *fs)
+{
+    if (fs->cwd != fs->cwd_inline)
+        g_free(fs->cwd);
+    fs->cwd = NULL;
+}
+
+static void tfs_unref(struct tfs *fs)
+{
+    if (0 == --fs->refs) {
+        tfs_release_cwd(fs);
+        tchild_pool_release(TCHILD_POOL_FS, fs);
+    }
+}
+
+static struct tdata *tdata_new(void)
+{
+    struct tdata *sandbox = tchild_pool_alloc(TCHILD_POOL_SANDBOX);
+
+    sandbox->refs = 1;
+    sandbox->path = true;
+    sandbox->exec = false;
+    sandbox->network = false;
+    sandbox->network_mode = SYDBOX_NETWORK_ALLOW;
+    sandbox->network_restrict_connect = false;
+    sandbox->lock = LOCK_UNSET;
+    sandbox->policy = 0;
+    sandbox->exec_policy = 0;
+    sandbox->write_prefixes = NULL;
+    sandbox->exec_prefixes = NULL;
+    return sandbox;
+}
+
+static void tdata_unref(struct tdata *sandbox)
+{
+    if (0 == --sandbox->refs) {
+        if (G_LIKELY(NULL != sandbox->write_prefixes))
+            pathnode_free(&(sandbox->write_prefixes));
+        if (G_LIKELY(NULL != sandbox->exec_prefixes))
+            pathnode_free(&(sandbox->exec_prefixes));
+        tchild_pool_release(TCHILD_POOL_SANDBOX, sandbox);
+    }
+}
+
+void tchild_set_cwd(struct tchild *child, const char *cwd)
+{
+    struct tfs *fs = child->fs;
+    size_t len;
+
+    tfs_release_cwd(fs);
+    fs->cwd_generation = fs->generation;
+    if (NULL == cwd)
+        return;
+
+    len = strlen(cwd);
+    if (len < TCHILD_CWD_INLINE) {
+        memcpy(fs->cwd_inline, cwd, len + 1);
+        fs->cwd = fs->cwd_inline;
+    }
+    else
+        fs->cwd = g_strdup(cwd);
+}
+
+void tchild_take_cwd(struct tchild *child, char *cwd)
+{
+    if (NULL != cwd && strlen(cwd) < TCHILD_CWD_INLINE) {
+        tchild_set_cwd(child, cwd);
+        g_free(cwd);
+    }
+    else {
+        tfs_release_cwd(child->fs);
+        child->fs->cwd_generation = child->fs->generation;
+        child->fs->cwd = cwd;
+    }
+}
+
+/* The table grows when it gets half full */
+#define TCHILD_TABLE_BITS 6
+
+static void tchild_table_alloc(tchild_table_t *children, guint bits)
+{
+    children->slots = g_new0(struct tchild_slot, 1U << bits);
+    children->mask = (1U << bits) - 1;
+    children->shift = 32 - bits;
+    children->size = 0;
+}
+
+static void tchild_table_insert(tchild_table_t *children, struct tchild *child)
+{
+    guint i = TCHILD_HASH(children, child->pid);
+
+    while (0 != children->slots[i].pid) {
+        g_assert(child->pid != children->slots[i].pid);
+        i = (i + 1) & children->mask;
+    }
+    children->slots[i].pid = child->pid;
+    children->slots[i].child = child;
+    ++children->size;
+}
+
+static void tchild_table_grow(tchild_table_t *children)
+{
+    struct tchild_slot *old = children->slots;
+    guint nslots = children->mask + 1;
+
+    tchild_table_alloc(children, 32 - children->shift + 1);
+    for (guint i = 0; i < nslots; i++) {
+        if (0 != old[i].pid)
+            tchild_table_insert(children, old[i].child);
+    }
+    g_free(old);
+}
+
+tchild_table_t *tchild_table_new(void)
+{
+    tchild_table_t *children = g_new(tchild_table_t, 1);
+
+    tchild_table_alloc(children, TCHILD_TABLE_BITS);
+    return children;
+}
+
+void tchild_table_foreach(tchild_table_t *children, tchild_func_t func, void *userdata)
+{
+    for (guint i = 0; i <= children->mask; i++) {
+        if (0 != children->slots[i].pid)
+            func(children->slots[i].child, userdata);
+    }
+}
+
+void tchild_table_free(tchild_table_t *children)
+{
+    for (guint i = 0; i <= children->mask; i++) {
+        if (0 != children->slots[i].pid)
+            tchild_free_one(children->slots[i].child);
+    }
+    g_free(children->slots);
+    g_free(children);
+}
+
+void tchild_new(tchild_table_t *children, pid_t pid)
 {
     gchar *proc_pid;
     struct tchild *child;
 
     g_debug("new child %i", pid);
-    child = (struct tchild *) g_malloc(sizeof(struct tchild));
+    SYDBOX_PROBE1(child__new, pid);
+    child = tchild_pool_alloc(TCHILD_POOL_CHILD);
     child->flags = TCHILD_NEEDSETUP | TCHILD_NEEDINHERIT;
     child->pid = pid;
+    child->tgid = pid;
     child->sno = 0xbadca11;
     child->retval = -1;
-    child->cwd = NULL;
-    child->sandbox = (struct tdata *) g_malloc(sizeof(struct tdata));
-    child->sandbox->path = true;
-    child->sandbox->exec = false;
-    child->sandbox->network = false;
-    child->sandbox->network_mode = SYDBOX_NETWORK_ALLOW;
-    child->sandbox->network_restrict_connect = false;
-    child->sandbox->lock = LOCK_UNSET;
-    child->sandbox->write_prefixes = NULL;
-    child->sandbox->exec_prefixes = NULL;
+    child->fs = tfs_new();
+    child->sandbox = tdata_new();
 
     if (sydbox_config_get_allow_proc_pid()) {
         /* Allow /proc/%d which is needed for processes to work reliably.
@@ -67,10 +300,27 @@ void tchild_new(GHashTable *children, pid_t pid)
         g_free(proc_pid);
     }
 
-    g_hash_table_insert(children, GINT_TO_POINTER(pid), child);
+    if (G_UNLIKELY(2 * (children->size + 1) > children->mask + 1))
+        tchild_table_grow(children);
+    tchild_table_insert(children, child);
+}
+
+void tchild_configure(struct tchild *child)
+{
+    child->sandbox->path = sydbox_config_get_sandbox_path();
+    child->sandbox->exec = sydbox_config_get_sandbox_exec();
+    child->sandbox->network = sydbox_config_get_sandbox_network();
+    child->sandbox->network_mode = sydbox_config_get_network_mode();
+    child->sandbox->network_restrict_connect = sydbox_config_get_network_restrict_connect();
+    child->sandbox->lock = sydbox_config_get_disallow_magic_commands() ? LOCK_SET : LOCK_UNSET;
+    /* The children own their prefixes, the configuration keeps its own. */
+    for (GSList *walk = sydbox_config_get_write_prefixes(); NULL != walk; walk = g_slist_next(walk))
+        pathnode_new(&(child->sandbox->write_prefixes), walk->data, 0);
+    for (GSList *walk = sydbox_config_get_exec_prefixes(); NULL != walk; walk = g_slist_next(walk))
+        pathnode_new(&(child->sandbox->exec_prefixes), walk->data, 0);
 }
 
-void tchild_inherit(struct tchild *child, struct tchild *parent)
+void tchild_inherit(struct tchild *child, struct tchild *parent, unsigned long clone_flags)
 {
     GSList *walk;
 
@@ -78,28 +328,48 @@ void tchild_inherit(struct tchild *child, struct tchild *parent)
     if (!(child->flags & TCHILD_NEEDINHERIT))
         return;
 
-    if (G_LIKELY(NULL != parent->cwd)) {
-        g_debug("child %i inherits parent %i's current working directory `%s'", child->pid, parent->pid, parent->cwd);
-        child->cwd = g_strdup(parent->cwd);
+    if (clone_flags & CLONE_FS) {
+        g_debug("child %i shares parent %i's filesystem context", child->pid, parent->pid);
+        tfs_unref(child->fs);
+        child->fs = parent->fs;
+        ++child->fs->refs;
+    }
+    else if (G_LIKELY(NULL != parent->fs->cwd)) {
+        g_debug("child %i inherits parent %i's current working directory `%s'", child->pid, parent->pid, parent->fs->cwd);
+        tchild_set_cwd(child, parent->fs->cwd);
+        // The parent's working directory is read on demand, so is the child's.
+        if (tchild_cwd_stale(parent))
+            tchild_cwd_changed(child);
     }
 
     child->personality = parent->personality;
-    child->sandbox->path = parent->sandbox->path;
-    child->sandbox->exec = parent->sandbox->exec;
-    child->sandbox->network = parent->sandbox->network;
-    child->sandbox->network_mode = parent->sandbox->network_mode;
-    child->sandbox->network_restrict_connect = parent->sandbox->network_restrict_connect;
-    child->sandbox->lock = parent->sandbox->lock;
-    // Copy path lists
-    walk = parent->sandbox->write_prefixes;
-    while (NULL != walk) {
-        pathnode_new(&(child->sandbox->write_prefixes), walk->data, 0);
-        walk = g_slist_next(walk);
+    if (clone_flags & CLONE_THREAD) {
+        g_debug("child %i joins thread group %i", child->pid, parent->tgid);
+        child->tgid = parent->tgid;
+        tdata_unref(child->sandbox);
+        child->sandbox = parent->sandbox;
+        ++child->sandbox->refs;
     }
-    walk = parent->sandbox->exec_prefixes;
-    while (NULL != walk) {
-        pathnode_new(&(child->sandbox->exec_prefixes), walk->data, 0);
-        walk = g_slist_next(walk);
+    else {
+        child->sandbox->path = parent->sandbox->path;
+        child->sandbox->exec = parent->sandbox->exec;
+        child->sandbox->network = parent->sandbox->network;
+        child->sandbox->network_mode = parent->sandbox->network_mode;
+        child->sandbox->network_restrict_connect = parent->sandbox->network_restrict_connect;
+        child->sandbox->lock = parent->sandbox->lock;
+        child->sandbox->policy = parent->sandbox->policy;
+        child->sandbox->exec_policy = parent->sandbox->exec_policy;
+        // Copy path lists
+        walk = parent->sandbox->write_prefixes;
+        while (NULL != walk) {
+            pathnode_new(&(child->sandbox->write_prefixes), walk->data, 0);
+            walk = g_slist_next(walk);
+        }
+        walk = parent->sandbox->exec_prefixes;
+        while (NULL != walk) {
+            pathnode_new(&(child->sandbox->exec_prefixes), walk->data, 0);
+            walk = g_slist_next(walk);
+        }
     }
 
     child->flags &= ~TCHILD_NEEDINHERIT;
@@ -109,37 +379,51 @@ void tchild_free_one(gpointer child_ptr)
 {
     struct tchild *child = (struct tchild *) child_ptr;
 
-    if (G_LIKELY(NULL != child->sandbox)) {
-        if (G_LIKELY(NULL != child->sandbox->write_prefixes))
-            pathnode_free(&(child->sandbox->write_prefixes));
-        if (G_LIKELY(NULL != child->sandbox->exec_prefixes))
-            pathnode_free(&(child->sandbox->exec_prefixes));
-        g_free(child->sandbox);
-    }
-    if (G_LIKELY(NULL != child->cwd))
-        g_free(child->cwd);
-    g_free(child);
+    tdata_unref(child->sandbox);
+    tfs_unref(child->fs);
+    tchild_pool_release(TCHILD_POOL_CHILD, child);
 }
 
-void tchild_kill_one(gpointer pid_ptr, gpointer child_ptr G_GNUC_UNUSED, void *userdata G_GNUC_UNUSED)
+void tchild_kill_one(struct tchild *child, void *userdata G_GNUC_UNUSED)
 {
-    pid_t pid = GPOINTER_TO_INT(pid_ptr);
-    trace_kill(pid);
+    trace_kill(child->pid);
 }
 
-void tchild_cont_one(gpointer pid_ptr, gpointer child_ptr G_GNUC_UNUSED, void *userdata G_GNUC_UNUSED)
+void tchild_cont_one(struct tchild *child, void *userdata G_GNUC_UNUSED)
 {
-    pid_t pid = GPOINTER_TO_INT(pid_ptr);
-    trace_cont(pid);
+    trace_cont(child->pid);
 }
 
-void tchild_delete(GHashTable *children, pid_t pid)
+void tchild_delete(tchild_table_t *children, pid_t pid)
 {
-    g_hash_table_remove(children, GINT_TO_POINTER(pid));
-}
+    struct tchild_slot *slots = children->slots;
+    guint i, j, k;
 
-struct tchild *tchild_find(GHashTable *children, pid_t pid)
-{
-    return g_hash_table_lookup(children, GINT_TO_POINTER(pid));
+    SYDBOX_PROBE1(child__delete, pid);
+
+    i = TCHILD_HASH(children, pid);
+    while (pid != slots[i].pid) {
+        if (0 == slots[i].pid)
+            return;
+        i = (i + 1) & children->mask;
+    }
+    tchild_free_one(slots[i].child);
+    --children->size;
+
+    /* Move the following entries of the probe sequence back so that no
+     * lookup stops at the hole.
+     */
+    for (j = i;;) {
+        j = (j + 1) & children->mask;
+        if (0 == slots[j].pid)
+            break;
+        k = TCHILD_HASH(children, slots[j].pid);
+        if ((i <= j) ? (i < k && k <= j) : (i < k || k <= j))
+            continue;
+        slots[i] = slots[j];
+        i = j;
+    }
+    slots[i].pid = 0;
+    slots[i].child = NULL;
 }
 
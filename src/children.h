@@ -31,6 +31,8 @@
 #define TCHILD_NEEDINHERIT (1 << 1)    /* child needs to inherit sandbox data from her parent. */
 #define TCHILD_INSYSCALL   (1 << 2)    /* child is in syscall. */
 #define TCHILD_DENYSYSCALL (1 << 3)    /* child has been denied access to the syscall. */
+#define TCHILD_LANDLOCK    (1 << 4)    /* child's syscall has been left to Landlock. */
+#define TCHILD_RESOLV      (1 << 5)    /* child's syscall may change what paths resolve to. */
 
 /* per process tracking data */
 enum lock_status
@@ -40,42 +42,261 @@ enum lock_status
     LOCK_PENDING,    // Magic commands will be locked when an execve() is encountered.
 };
 
+/* Sandbox data, shared by the threads of a thread group */
 struct tdata
 {
+    guint refs;                     // Number of children sharing the data.
     bool path;                      // Whether path sandboxing is enabled for child.
     bool exec;                      // Whether execve(2) sandboxing is enabled for child.
     bool network;                   // Whether network sandboxing is enabled for child.
     int network_mode;               // Mode of network sandboxing.
     bool network_restrict_connect;  // Whether connect() requests are restricted.
     int lock;                       // Whether magic commands are locked for the child.
+    guint policy;                   // Identifies the write prefixes, see verdict.h
+    guint exec_policy;              // Identifies the exec prefixes.
     GSList *write_prefixes;
     GSList *exec_prefixes;
 };
 
+/* Working directories shorter than this are kept inside struct tfs. */
+#define TCHILD_CWD_INLINE 64
+
+/* Filesystem context, shared by children created with CLONE_FS */
+struct tfs
+{
+    guint refs;              // Number of children sharing the context.
+    guint generation;        // Bumped when the working directory changes.
+    guint cwd_generation;    // Generation cwd was read at.
+    char *cwd;               // Current working directory, may point to cwd_inline.
+    char cwd_inline[TCHILD_CWD_INLINE];
+};
+
 struct tchild
 {
     int personality;         // Personality (0 = 32bit, 1 = 64bit etc.)
     int flags;               // TCHILD_ flags
     pid_t pid;               // Process ID of the child.
-    char *cwd;               // Child's current working directory.
+    pid_t tgid;              // Thread group ID of the child.
     unsigned long sno;       // Last system call called by child.
     long retval;             // Replaced system call will return this value.
-    struct tdata *sandbox;   // Sandbox data */
+    struct tfs *fs;          // Filesystem context.
+    struct tdata *sandbox;   // Sandbox data.
+};
+
+/* Pools the tracking data is allocated from */
+enum
+{
+    TCHILD_POOL_CHILD,       // struct tchild
+    TCHILD_POOL_SANDBOX,     // struct tdata
+    TCHILD_POOL_FS,          // struct tfs
+    TCHILD_POOL_MAX,
+};
+
+/* Occupancy of a pool */
+struct tchild_pool_stats
+{
+    gulong in_use;           // Entries currently allocated.
+    gulong peak;             // Highest number of entries allocated at once.
+    gulong free;             // Entries on the free list.
+    gulong slabs;            // Slabs allocated.
+    guint64 allocs;          // Entries allocated in total.
+};
+
+/* Children by process ID, an open addressing table with linear probing.
+ * Process IDs are stored next to the child pointers so a lookup only
+ * touches the slot array until it finds the child.
+ */
+struct tchild_slot
+{
+    pid_t pid;               // 0 if the slot is empty.
+    struct tchild *child;
 };
 
-void tchild_new(GHashTable *children, pid_t pid);
+typedef struct
+{
+    struct tchild_slot *slots;
+    guint mask;              // Number of slots - 1, the number of slots is a power of two.
+    guint shift;             // 32 - log2(number of slots)
+    guint size;              // Number of children in the table.
+} tchild_table_t;
 
-void tchild_inherit(struct tchild *child, struct tchild *parent);
+typedef void (*tchild_func_t) (struct tchild *child, void *userdata);
+
+/**
+ * tchild_table_new:
+ *
+ * Returns: a new empty table of children
+ *
+ * Since: 0.2_alpha4
+ **/
+tchild_table_t *tchild_table_new(void);
+
+/**
+ * tchild_table_free:
+ * @children: the table
+ *
+ * Frees @children and all the children in it.
+ *
+ * Since: 0.2_alpha4
+ **/
+void tchild_table_free(tchild_table_t *children);
+
+/**
+ * tchild_table_size:
+ * @children: the table
+ *
+ * Returns: the number of children in @children
+ *
+ * Since: 0.2_alpha4
+ **/
+static inline guint tchild_table_size(const tchild_table_t *children)
+{
+    return children->size;
+}
+
+/**
+ * tchild_table_foreach:
+ * @children: the table
+ * @func: the function to call
+ * @userdata: passed to @func
+ *
+ * Calls @func for every child in @children, @func must not add or remove
+ * children.
+ *
+ * Since: 0.2_alpha4
+ **/
+void tchild_table_foreach(tchild_table_t *children, tchild_func_t func, void *userdata);
+
+/* Fibonacci hashing, consecutive process IDs land in different slots */
+#define TCHILD_HASH(children, pid)  (((guint32) (pid) * 2654435769U) >> (children)->shift)
+
+void tchild_new(tchild_table_t *children, pid_t pid);
+
+/**
+ * tchild_set_cwd:
+ * @child: the child
+ * @cwd: the new current working directory, or %NULL
+ *
+ * Sets the current working directory of @child to a copy of @cwd. The
+ * change is seen by all children sharing the filesystem context of @child.
+ *
+ * Since: 0.2_alpha4
+ **/
+void tchild_set_cwd(struct tchild *child, const char *cwd);
+
+/**
+ * tchild_cwd_changed:
+ * @child: the child
+ *
+ * Notes that the current working directory of @child has changed, without
+ * reading the new one.
+ *
+ * Since: 0.2_alpha4
+ **/
+static inline void tchild_cwd_changed(struct tchild *child)
+{
+    ++child->fs->generation;
+}
+
+/**
+ * tchild_cwd_stale:
+ * @child: the child
+ *
+ * Returns: whether the working directory of @child changed after it was
+ * last set
+ *
+ * Since: 0.2_alpha4
+ **/
+static inline bool tchild_cwd_stale(const struct tchild *child)
+{
+    return child->fs->generation != child->fs->cwd_generation;
+}
+
+/**
+ * tchild_take_cwd:
+ * @child: the child
+ * @cwd: the new current working directory, allocated with g_malloc()
+ *
+ * Like tchild_set_cwd() but takes the ownership of @cwd.
+ *
+ * Since: 0.2_alpha4
+ **/
+void tchild_take_cwd(struct tchild *child, char *cwd);
+
+/**
+ * tchild_pool_stats:
+ * @pool: one of TCHILD_POOL_CHILD, TCHILD_POOL_SANDBOX, TCHILD_POOL_FS
+ * @stats: the structure to fill in
+ *
+ * Reports the occupancy of a pool.
+ *
+ * Since: 0.2_alpha4
+ **/
+void tchild_pool_stats(guint pool, struct tchild_pool_stats *stats);
+
+/**
+ * tchild_pool_name:
+ * @pool: one of TCHILD_POOL_CHILD, TCHILD_POOL_SANDBOX, TCHILD_POOL_FS
+ *
+ * Returns: the name of the pool for reports
+ *
+ * Since: 0.2_alpha4
+ **/
+const char *tchild_pool_name(guint pool);
+
+/**
+ * tchild_pool_free:
+ *
+ * Releases the slabs of the pools. All children must have been freed
+ * before.
+ *
+ * Since: 0.2_alpha4
+ **/
+void tchild_pool_free(void);
+
+/**
+ * tchild_configure:
+ * @child: the eldest child
+ *
+ * Sets up the sandbox data of @child from the configuration.
+ *
+ * Since: 0.2_alpha4
+ **/
+void tchild_configure(struct tchild *child);
+
+/**
+ * tchild_inherit:
+ * @child: the newborn child
+ * @parent: the parent
+ * @clone_flags: the flags @child was cloned with, 0 for fork(2) and vfork(2)
+ *
+ * Sets up @child from @parent. With CLONE_FS the children share the
+ * filesystem context and with CLONE_THREAD the sandbox data, otherwise
+ * @child gets a copy.
+ *
+ * Since: 0.2_alpha4
+ **/
+void tchild_inherit(struct tchild *child, struct tchild *parent, unsigned long clone_flags);
 
 void tchild_free_one(gpointer child_ptr);
 
-void tchild_kill_one(gpointer pid_ptr, gpointer child_ptr, void *userdata);
+void tchild_kill_one(struct tchild *child, void *userdata);
+
+void tchild_cont_one(struct tchild *child, void *userdata);
 
-void tchild_cont_one(gpointer pid_ptr, gpointer child_ptr, void *userdata);
+void tchild_delete(tchild_table_t *children, pid_t pid);
 
-void tchild_delete(GHashTable *children, pid_t pid);
+static inline struct tchild *tchild_find(tchild_table_t *children, pid_t pid)
+{
+    guint i = TCHILD_HASH(children, pid);
 
-struct tchild *tchild_find(GHashTable *children, pid_t pid);
+    while (0 != children->slots[i].pid) {
+        if (pid == children->slots[i].pid)
+            return children->slots[i].child;
+        i = (i + 1) & children->mask;
+    }
+    return NULL;
+}
 
 #endif // SYDBOX_GUARD_CHILDREN_H
 
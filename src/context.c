@@ -31,6 +31,7 @@
 #include "children.h"
 #include "context.h"
 #include "net.h"
+#include "verdict.h"
 #include "wrappers.h"
 #include "sydbox-log.h"
 
@@ -40,26 +41,35 @@ context_t *context_new (void)
 
     ctx = (context_t *) g_new0(context_t, 1);
 
+    ctx->retval = EXIT_SUCCESS;
     ctx->before_initial_execve = true;
-    ctx->children = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, tchild_free_one);
+    ctx->children = tchild_table_new();
+    ctx->verdicts = verdict_cache_new();
 
     return ctx;
 }
 
 void context_free(context_t *ctx)
 {
+    struct verdict_cache_stats stats;
+
     if (NULL != ctx->children) {
-        g_hash_table_destroy(ctx->children);
+        tchild_table_free(ctx->children);
         ctx->children = NULL;
     }
+    verdict_cache_get_stats(ctx->verdicts, &stats);
+    g_info("verdict cache: %" G_GUINT64_FORMAT " hits, %" G_GUINT64_FORMAT " misses, "
+            "%" G_GUINT64_FORMAT " exec hits, %" G_GUINT64_FORMAT " exec misses",
+            stats.hits, stats.misses, stats.exec_hits, stats.exec_misses);
+    verdict_cache_free(ctx->verdicts);
     g_free(ctx);
 }
 
 int context_remove_child(context_t * const ctx, pid_t pid)
 {
     g_info("removing child %d from context", pid);
-    g_hash_table_remove(ctx->children, GINT_TO_POINTER(pid));
+    tchild_delete(ctx->children, pid);
 
-    return (0 == g_hash_table_size(ctx->children)) ? -1 : 0;
+    return (0 == tchild_table_size(ctx->children)) ? -1 : 0;
 }
 
@@ -24,11 +24,29 @@
 #include <stdbool.h>
 #include <sys/types.h>
 
+#include "children.h"
+#include "trace.h"
+#include "verdict.h"
+
+#include <glib.h>
+
+struct context_stats
+{
+    guint64 events;             // events waited for
+    guint64 stops[E_UNKNOWN + 1]; // events by E_* event
+    guint64 syscalls;           // system calls children entered
+    guint64 checks;             // system calls checked for access
+    guint64 denied;             // system calls denied
+};
+
 typedef struct
 {
     pid_t eldest;               // first child's pid is kept to determine return code.
+    int retval;                 // return code of the eldest child
     bool before_initial_execve; // first execve() is noted here for execve(2) sandboxing.
-    GHashTable *children;       // list of children
+    tchild_table_t *children;   // children by process ID
+    verdict_cache_t *verdicts;  // decisions of path checks
+    struct context_stats stats; // counters of the trace loop
 } context_t;
 
 context_t *context_new(void);
@@ -32,8 +32,8 @@ static const struct syscall_def {
 #if defined(__NR_chown32)
     {__NR_chown32,      CHECK_PATH},
 #endif
-    {__NR_open,         CHECK_PATH | OPEN_MODE},
-    {__NR_creat,        CHECK_PATH | CAN_CREAT},
+    {__NR_open,         CHECK_PATH | OPEN_MODE | LANDLOCK_CALL},
+    {__NR_creat,        CHECK_PATH | CAN_CREAT | LANDLOCK_CALL},
     {__NR_stat,         MAGIC_STAT},
 #if defined(__NR_stat64)
     {__NR_stat64,       MAGIC_STAT},
@@ -46,23 +46,23 @@ static const struct syscall_def {
 #if defined(__NR_lchown32)
     {__NR_lchown32,     CHECK_PATH | DONT_RESOLV},
 #endif
-    {__NR_link,         CHECK_PATH | CHECK_PATH2 | MUST_CREAT2 | DONT_RESOLV},
-    {__NR_mkdir,        CHECK_PATH | MUST_CREAT},
-    {__NR_mknod,        CHECK_PATH | MUST_CREAT},
+    {__NR_link,         CHECK_PATH | CHECK_PATH2 | MUST_CREAT2 | DONT_RESOLV | LANDLOCK_CALL | RESOLV_CHANGE},
+    {__NR_mkdir,        CHECK_PATH | MUST_CREAT | LANDLOCK_CALL},
+    {__NR_mknod,        CHECK_PATH | MUST_CREAT | LANDLOCK_CALL},
     {__NR_access,       CHECK_PATH | ACCESS_MODE},
-    {__NR_rename,       CHECK_PATH | CHECK_PATH2 | CAN_CREAT2 | DONT_RESOLV},
-    {__NR_rmdir,        CHECK_PATH},
-    {__NR_symlink,      CHECK_PATH2 | MUST_CREAT2 | DONT_RESOLV},
+    {__NR_rename,       CHECK_PATH | CHECK_PATH2 | CAN_CREAT2 | DONT_RESOLV | LANDLOCK_CALL | RESOLV_CHANGE},
+    {__NR_rmdir,        CHECK_PATH | LANDLOCK_CALL | RESOLV_CHANGE},
+    {__NR_symlink,      CHECK_PATH2 | MUST_CREAT2 | DONT_RESOLV | LANDLOCK_CALL | RESOLV_CHANGE},
     {__NR_truncate,     CHECK_PATH},
 #if defined(__NR_truncate64)
     {__NR_truncate64,   CHECK_PATH},
 #endif
-    {__NR_mount,        CHECK_PATH2},
+    {__NR_mount,        CHECK_PATH2 | RESOLV_CHANGE},
 #if defined(__NR_umount)
-    {__NR_umount,       CHECK_PATH},
+    {__NR_umount,       CHECK_PATH | RESOLV_CHANGE},
 #endif
 #if defined(__NR_umount2)
-    {__NR_umount2,      CHECK_PATH},
+    {__NR_umount2,      CHECK_PATH | RESOLV_CHANGE},
 #endif
 #if defined(__NR_utime)
     {__NR_utime,        CHECK_PATH},
@@ -70,15 +70,18 @@ static const struct syscall_def {
 #if defined(__NR_utimes)
     {__NR_utimes,       CHECK_PATH},
 #endif
-    {__NR_unlink,       CHECK_PATH | DONT_RESOLV},
-    {__NR_openat,       CHECK_PATH_AT | OPEN_MODE_AT},
-    {__NR_mkdirat,      CHECK_PATH_AT | MUST_CREAT_AT},
-    {__NR_mknodat,      CHECK_PATH_AT | MUST_CREAT_AT},
+    {__NR_unlink,       CHECK_PATH | DONT_RESOLV | LANDLOCK_CALL | RESOLV_CHANGE},
+    {__NR_openat,       CHECK_PATH_AT | OPEN_MODE_AT | LANDLOCK_CALL},
+    {__NR_mkdirat,      CHECK_PATH_AT | MUST_CREAT_AT | LANDLOCK_CALL},
+    {__NR_mknodat,      CHECK_PATH_AT | MUST_CREAT_AT | LANDLOCK_CALL},
     {__NR_fchownat,     CHECK_PATH_AT | IF_AT_SYMLINK_NOFOLLOW4},
-    {__NR_unlinkat,     CHECK_PATH_AT | IF_AT_REMOVEDIR2},
-    {__NR_renameat,     CHECK_PATH_AT | CHECK_PATH_AT2 | CAN_CREAT_AT2 | DONT_RESOLV},
-    {__NR_linkat,       CHECK_PATH_AT | CHECK_PATH_AT2 | MUST_CREAT_AT2 | IF_AT_SYMLINK_FOLLOW4},
-    {__NR_symlinkat,    CHECK_PATH_AT1 | MUST_CREAT_AT1 | DONT_RESOLV},
+    {__NR_unlinkat,     CHECK_PATH_AT | IF_AT_REMOVEDIR2 | LANDLOCK_CALL | RESOLV_CHANGE},
+    {__NR_renameat,     CHECK_PATH_AT | CHECK_PATH_AT2 | CAN_CREAT_AT2 | DONT_RESOLV | LANDLOCK_CALL | RESOLV_CHANGE},
+#if defined(__NR_renameat2)
+    {__NR_renameat2,    CHECK_PATH_AT | CHECK_PATH_AT2 | CAN_CREAT_AT2 | DONT_RESOLV | LANDLOCK_CALL | RESOLV_CHANGE},
+#endif
+    {__NR_linkat,       CHECK_PATH_AT | CHECK_PATH_AT2 | MUST_CREAT_AT2 | IF_AT_SYMLINK_FOLLOW4 | LANDLOCK_CALL | RESOLV_CHANGE},
+    {__NR_symlinkat,    CHECK_PATH_AT1 | MUST_CREAT_AT1 | DONT_RESOLV | LANDLOCK_CALL | RESOLV_CHANGE},
     {__NR_fchmodat,     CHECK_PATH_AT | IF_AT_SYMLINK_NOFOLLOW3},
     {__NR_faccessat,    CHECK_PATH_AT | ACCESS_MODE_AT},
 #if defined(__NR_socketcall)
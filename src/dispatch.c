@@ -116,10 +116,13 @@ bool dispatch_maybind(int personality G_GNUC_UNUSED, int sno)
 #endif
 }
 
-#if defined(POWERPC)
 bool dispatch_clone(int personality G_GNUC_UNUSED, int sno)
 {
     return IS_CLONE(sno);
 }
-#endif // defined(POWERPC)
+
+bool dispatch_clone3(int personality G_GNUC_UNUSED, int sno)
+{
+    return IS_CLONE3(sno);
+}
 
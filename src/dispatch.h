@@ -28,6 +28,8 @@
 
 #define IS_CHDIR(_sno)      (__NR_chdir == (_sno) || __NR_fchdir == (_sno))
 #define IS_CLONE(_sno)      (__NR_clone == (_sno))
+/* clone3(2) has the same number on every architecture that has it. */
+#define IS_CLONE3(_sno)     (435 == (_sno))
 #define UNKNOWN_SYSCALL     "unknown"
 
 #if defined(I386) || defined(IA64) || defined(POWERPC)
@@ -38,6 +40,8 @@ const char *dispatch_name(int personality, int sno);
 const char *dispatch_mode(int personality);
 bool dispatch_chdir(int personality, int sno);
 bool dispatch_maybind(int personality, int sno);
+bool dispatch_clone(int personality, int sno);
+bool dispatch_clone3(int personality, int sno);
 #elif defined(X86_64)
 void dispatch_init32(void);
 void dispatch_init64(void);
@@ -51,6 +55,10 @@ bool dispatch_chdir32(int sno);
 bool dispatch_chdir64(int sno);
 bool dispatch_maybind32(int sno);
 bool dispatch_maybind64(int sno);
+bool dispatch_clone32(int sno);
+bool dispatch_clone64(int sno);
+bool dispatch_clone3_32(int sno);
+bool dispatch_clone3_64(int sno);
 
 #define dispatch_init()     \
     do {                    \
@@ -72,14 +80,14 @@ bool dispatch_maybind64(int sno);
     ((personality) == 0) ? dispatch_chdir32((sno)) : dispatch_chdir64((sno))
 #define dispatch_maybind(personality, sno) \
     ((personality) == 0) ? dispatch_maybind32((sno)) : dispatch_maybind64((sno))
+#define dispatch_clone(personality, sno) \
+    (((personality) == 0) ? dispatch_clone32((sno)) : dispatch_clone64((sno)))
+#define dispatch_clone3(personality, sno) \
+    (((personality) == 0) ? dispatch_clone3_32((sno)) : dispatch_clone3_64((sno)))
 
 #else
 #error unsupported architecture
 #endif
 
-#if defined(POWERPC)
-bool dispatch_clone(int personality, int sno);
-#endif // defined(POWERPC)
-
 #endif // SYDBOX_GUARD_DISPATCH_H
 
@@ -91,3 +91,13 @@ bool dispatch_maybind32(int sno)
     return (__NR_socketcall == sno);
 }
 
+bool dispatch_clone32(int sno)
+{
+    return IS_CLONE(sno);
+}
+
+bool dispatch_clone3_32(int sno)
+{
+    return IS_CLONE3(sno);
+}
+
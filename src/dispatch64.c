@@ -91,3 +91,13 @@ bool dispatch_maybind64(int sno)
     return (__NR_bind == sno);
 }
 
+bool dispatch_clone64(int sno)
+{
+    return IS_CLONE(sno);
+}
+
+bool dispatch_clone3_64(int sno)
+{
+    return IS_CLONE3(sno);
+}
+
@@ -0,0 +1,245 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "eventlog.h"
+#include "sydbox-utils.h"
+
+#define EVENTLOG_BUFSIZ     65536
+
+static int logfd = -1;
+static GHashTable *strings;
+static guint32 nstrings;
+
+static guchar buf[EVENTLOG_BUFSIZ];
+static gsize buflen;
+
+static void eventlog_write(const void *data, gsize len)
+{
+    const guchar *p = data;
+
+    while (0 < len) {
+        ssize_t n = write(logfd, p, len);
+        if (0 > n) {
+            if (EINTR == errno)
+                continue;
+            g_warning("failed to write trace: %s", g_strerror(errno));
+            return;
+        }
+        p += n;
+        len -= n;
+    }
+}
+
+void eventlog_flush(void)
+{
+    if (0 < buflen) {
+        eventlog_write(buf, buflen);
+        buflen = 0;
+    }
+}
+
+static inline void eventlog_reserve(gsize len)
+{
+    if (G_UNLIKELY(buflen + len > EVENTLOG_BUFSIZ))
+        eventlog_flush();
+}
+
+static inline void eventlog_put(const void *data, gsize len)
+{
+    memcpy(buf + buflen, data, len);
+    buflen += len;
+}
+
+static inline void eventlog_put_u8(guint8 val)
+{
+    eventlog_put(&val, sizeof(val));
+}
+
+static inline void eventlog_put_u32(guint32 val)
+{
+    eventlog_put(&val, sizeof(val));
+}
+
+static inline void eventlog_put_s32(gint32 val)
+{
+    eventlog_put(&val, sizeof(val));
+}
+
+static inline void eventlog_put_u64(guint64 val)
+{
+    eventlog_put(&val, sizeof(val));
+}
+
+static inline guint64 eventlog_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (guint64) ts.tv_sec * G_GUINT64_CONSTANT(1000000000) + ts.tv_nsec;
+}
+
+/* Returns the id of the string, writing a string record the first time the
+ * string is seen.
+ */
+static guint32 eventlog_intern(const gchar *str)
+{
+    gpointer id;
+    gsize len;
+
+    if (g_hash_table_lookup_extended(strings, str, NULL, &id))
+        return GPOINTER_TO_UINT(id);
+
+    id = GUINT_TO_POINTER(++nstrings);
+    g_hash_table_insert(strings, g_strdup(str), id);
+
+    len = strlen(str);
+    if (len + 9 > EVENTLOG_BUFSIZ) {
+        guint32 hdr = len + 5;
+        guint8 type = EVENTLOG_RECORD_STRING;
+        guint32 sid = nstrings;
+
+        eventlog_flush();
+        eventlog_write(&hdr, sizeof(hdr));
+        eventlog_write(&type, sizeof(type));
+        eventlog_write(&sid, sizeof(sid));
+        eventlog_write(str, len);
+    }
+    else {
+        eventlog_reserve(len + 9);
+        eventlog_put_u32(len + 5);
+        eventlog_put_u8(EVENTLOG_RECORD_STRING);
+        eventlog_put_u32(nstrings);
+        eventlog_put(str, len);
+    }
+    return nstrings;
+}
+
+bool eventlog_open(const gchar *path)
+{
+    guint32 version = EVENTLOG_VERSION;
+    guint32 byteorder = EVENTLOG_BYTEORDER;
+
+    g_assert(0 > logfd);
+
+    logfd = sydbox_open_output(path);
+    if (0 > logfd)
+        return false;
+
+    strings = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    nstrings = 0;
+    buflen = 0;
+
+    eventlog_put(EVENTLOG_MAGIC, EVENTLOG_MAGIC_LEN);
+    eventlog_put_u32(version);
+    eventlog_put_u32(byteorder);
+    return true;
+}
+
+void eventlog_close(void)
+{
+    if (0 > logfd)
+        return;
+
+    eventlog_flush();
+    close(logfd);
+    logfd = -1;
+
+    g_hash_table_destroy(strings);
+    strings = NULL;
+}
+
+bool eventlog_enabled(void)
+{
+    return 0 <= logfd;
+}
+
+void eventlog_syscall(pid_t pid, int personality, long sno, int result, int err,
+        gchar * const *paths, int family, int port, const gchar *addr)
+{
+    guint8 pathmask = 0;
+    guint32 ids[4], addrid = 0;
+    guint32 len;
+    guint npaths = 0;
+    bool has_addr;
+
+    if (0 > logfd)
+        return;
+
+    /* Intern the strings first, their records must precede this one. */
+    for (unsigned int i = 0; i < 4; i++) {
+        if (NULL != paths[i]) {
+            pathmask |= 1 << i;
+            ids[npaths++] = eventlog_intern(paths[i]);
+        }
+    }
+    has_addr = (-1 != family);
+    if (has_addr)
+        addrid = eventlog_intern(NULL != addr ? addr : "");
+
+    len = 1 + 8 + 4 + 4 + 4 * 3 + 4 * npaths + (has_addr ? 12 : 0);
+    eventlog_reserve(len + 4);
+    eventlog_put_u32(len);
+    eventlog_put_u8(EVENTLOG_RECORD_SYSCALL);
+    eventlog_put_u64(eventlog_now());
+    eventlog_put_s32(pid);
+    eventlog_put_u8(personality);
+    eventlog_put_u8(pathmask);
+    eventlog_put_u8(has_addr);
+    eventlog_put_u8(0);
+    eventlog_put_s32(sno);
+    eventlog_put_s32(result);
+    eventlog_put_s32(err);
+    for (unsigned int i = 0; i < npaths; i++)
+        eventlog_put_u32(ids[i]);
+    if (has_addr) {
+        eventlog_put_s32(family);
+        eventlog_put_s32(port);
+        eventlog_put_u32(addrid);
+    }
+}
+
+void eventlog_event(pid_t pid, unsigned int event, long value)
+{
+    const guint32 len = 1 + 8 + 4 + 4 + 8;
+    const guint8 pad[3] = { 0, 0, 0 };
+
+    if (0 > logfd)
+        return;
+
+    eventlog_reserve(len + 4);
+    eventlog_put_u32(len);
+    eventlog_put_u8(EVENTLOG_RECORD_EVENT);
+    eventlog_put_u64(eventlog_now());
+    eventlog_put_s32(pid);
+    eventlog_put_u8(event);
+    eventlog_put(pad, sizeof(pad));
+    eventlog_put_u64((guint64) (gint64) value);
+}
@@ -0,0 +1,148 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SYDBOX_GUARD_EVENTLOG_H
+#define SYDBOX_GUARD_EVENTLOG_H 1
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include <glib.h>
+
+/*
+ * Binary event trace format
+ *
+ * The file starts with a header:
+ *   char magic[8]          "SYDTRACE"
+ *   guint32 version        EVENTLOG_VERSION
+ *   guint32 byteorder      EVENTLOG_BYTEORDER, written in host byte order
+ *
+ * It's followed by records, each prefixed with its length:
+ *   guint32 len            length of the record following this field
+ *   guint8 type            one of EVENTLOG_RECORD_*
+ *   ...                    payload
+ *
+ * EVENTLOG_RECORD_STRING: defines an interned string, referred to by its id
+ *   guint32 id
+ *   char str[len - 5]      not zero terminated
+ *
+ * EVENTLOG_RECORD_SYSCALL: the decision about a checked system call
+ *   guint64 timestamp      nanoseconds since the epoch
+ *   gint32 pid
+ *   guint8 personality
+ *   guint8 pathmask        bit i is set if path argument i is recorded
+ *   guint8 has_addr        true if a destination address is recorded
+ *   guint8 pad
+ *   gint32 sno             system call number
+ *   gint32 result          RS_* result of the check
+ *   gint32 errno           errno set for the child, 0 if none
+ *   guint32 paths[]        string ids of the recorded path arguments
+ *   gint32 family          if has_addr is set
+ *   gint32 port            if has_addr is set
+ *   guint32 addr           if has_addr is set, string id of the address
+ *
+ * EVENTLOG_RECORD_EVENT: an event of the trace loop
+ *   guint64 timestamp
+ *   gint32 pid
+ *   guint8 event           E_* event
+ *   guint8 pad[3]
+ *   gint64 value           new pid, exit code or signal depending on event
+ */
+#define EVENTLOG_MAGIC              "SYDTRACE"
+#define EVENTLOG_MAGIC_LEN          8
+#define EVENTLOG_VERSION            1
+#define EVENTLOG_BYTEORDER          0x01020304U
+
+enum {
+    EVENTLOG_RECORD_STRING = 1,
+    EVENTLOG_RECORD_SYSCALL,
+    EVENTLOG_RECORD_EVENT,
+};
+
+/**
+ * eventlog_open:
+ * @path: path of the trace file
+ *
+ * Opens the trace file for writing and writes the header.
+ *
+ * Returns: true on success, false on failure and sets errno accordingly
+ *
+ * Since: 0.2_alpha4
+ **/
+bool eventlog_open(const gchar *path);
+
+/**
+ * eventlog_close:
+ *
+ * Flushes the buffered records and closes the trace file.
+ *
+ * Since: 0.2_alpha4
+ **/
+void eventlog_close(void);
+
+/**
+ * eventlog_enabled:
+ *
+ * Returns: true if a trace file is open
+ *
+ * Since: 0.2_alpha4
+ **/
+bool eventlog_enabled(void);
+
+/**
+ * eventlog_flush:
+ *
+ * Writes out the buffered records.
+ *
+ * Since: 0.2_alpha4
+ **/
+void eventlog_flush(void);
+
+/**
+ * eventlog_syscall:
+ * @pid: process id of the child
+ * @personality: personality of the child
+ * @sno: system call number
+ * @result: RS_* result of the check
+ * @err: errno set for the child or 0
+ * @paths: array of four path arguments, any of which may be %NULL
+ * @family: address family of the destination address, -1 if there's none
+ * @port: port of the destination address
+ * @addr: the destination address, may be %NULL
+ *
+ * Records the decision about a checked system call.
+ *
+ * Since: 0.2_alpha4
+ **/
+void eventlog_syscall(pid_t pid, int personality, long sno, int result, int err,
+        gchar * const *paths, int family, int port, const gchar *addr);
+
+/**
+ * eventlog_event:
+ * @pid: process id of the child
+ * @event: E_* event
+ * @value: new pid, exit code or signal depending on @event
+ *
+ * Records an event of the trace loop.
+ *
+ * Since: 0.2_alpha4
+ **/
+void eventlog_event(pid_t pid, unsigned int event, long value);
+
+#endif // SYDBOX_GUARD_EVENTLOG_H
@@ -50,6 +50,8 @@
 #define BIND_CALL               (1 << 26) // Check if the bind() call matches the accepted bind IPs
 #define SENDTO_CALL             (1 << 27) // Check if the sendto() call matches the accepted sendto IPs
 #define EXEC_CALL               (1 << 28) // Allowing the system call depends on the exec flag
+#define LANDLOCK_CALL           (1 << 29) // Landlock denies the system call for paths outside write prefixes
+#define RESOLV_CHANGE           (1 << 30) // The system call may change what paths resolve to
 
 #endif // SYDBOX_GUARD_FLAGS_H
 
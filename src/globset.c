@@ -0,0 +1,548 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "globset.h"
+
+#define WORD_BITS           64
+#define NWORDS(nstates)     (((nstates) + WORD_BITS - 1) / WORD_BITS)
+#define STACK_WORDS         16
+
+/* Pattern tokens */
+enum {
+    TOKEN_CHAR,     // A literal character
+    TOKEN_ANY,      // ? matches any character but /
+    TOKEN_CLASS,    // [...] bracket expression, never matches /
+    TOKEN_STAR,     // * matches any sequence of characters without /
+};
+
+struct token {
+    int type;
+    unsigned char ch;
+    guint32 cls[8];
+};
+
+struct trie {
+    unsigned char c;
+    bool terminal;
+    struct trie *child;
+    struct trie *next;
+};
+
+struct globset {
+    guint npatterns;
+
+    bool any_component;         // The pattern * is in the set
+    GHashTable *literals;       // Patterns without special characters
+    struct trie *prefixes;      // LITERAL* patterns
+    struct trie *suffixes;      // *LITERAL patterns, stored reversed
+
+    /* Combined automaton for the rest of the patterns.
+     * Each pattern with n tokens takes n + 1 states, state i meaning "token i
+     * is to be matched next" and state n meaning "the pattern has matched".
+     */
+    guint nstates;
+    guint nwords;
+    guint64 *advance;           // 256 * nwords, states whose token accepts the character
+    guint64 *star;              // states whose token is *
+    guint64 *start;             // initial states
+    guint64 *accept;            // final states
+};
+
+static inline void cls_set(guint32 *cls, unsigned char c)
+{
+    cls[c >> 5] |= (1U << (c & 31));
+}
+
+static inline bool cls_isset(const guint32 *cls, unsigned char c)
+{
+    return cls[c >> 5] & (1U << (c & 31));
+}
+
+static bool cls_named(guint32 *cls, const char *name, size_t len)
+{
+    int (*pred)(int);
+
+    if (5 == len && 0 == strncmp(name, "alnum", 5))
+        pred = isalnum;
+    else if (5 == len && 0 == strncmp(name, "alpha", 5))
+        pred = isalpha;
+    else if (5 == len && 0 == strncmp(name, "blank", 5))
+        pred = isblank;
+    else if (5 == len && 0 == strncmp(name, "cntrl", 5))
+        pred = iscntrl;
+    else if (5 == len && 0 == strncmp(name, "digit", 5))
+        pred = isdigit;
+    else if (5 == len && 0 == strncmp(name, "graph", 5))
+        pred = isgraph;
+    else if (5 == len && 0 == strncmp(name, "lower", 5))
+        pred = islower;
+    else if (5 == len && 0 == strncmp(name, "print", 5))
+        pred = isprint;
+    else if (5 == len && 0 == strncmp(name, "punct", 5))
+        pred = ispunct;
+    else if (5 == len && 0 == strncmp(name, "space", 5))
+        pred = isspace;
+    else if (5 == len && 0 == strncmp(name, "upper", 5))
+        pred = isupper;
+    else if (6 == len && 0 == strncmp(name, "xdigit", 6))
+        pred = isxdigit;
+    else
+        return false;
+
+    for (unsigned int c = 1; c < 256; c++) {
+        if (pred(c))
+            cls_set(cls, c);
+    }
+    return true;
+}
+
+/* Result of parsing a bracket expression */
+enum {
+    CLASS_OK,       // A valid bracket expression
+    CLASS_LITERAL,  // Not terminated, fnmatch() treats the [ literally
+    CLASS_INVALID,  // Malformed, fnmatch() never matches the pattern
+};
+
+/* Parses a bracket expression starting right after the opening [.
+ * On success, stores a pointer to the character after the closing ] in endp.
+ */
+static int parse_class(const char *p, struct token *tok, const char **endp)
+{
+    bool negate = false;
+    bool first = true;
+
+    memset(tok->cls, 0, sizeof(tok->cls));
+    if ('!' == *p || '^' == *p) {
+        negate = true;
+        ++p;
+    }
+
+    for (;;) {
+        unsigned char lo, hi;
+
+        if ('\0' == *p)
+            return CLASS_LITERAL;
+        else if (']' == *p && !first)
+            break;
+        first = false;
+
+        if ('[' == p[0] && ':' == p[1]) {
+            const char *end = strstr(p + 2, ":]");
+            if (NULL != end) {
+                if (!cls_named(tok->cls, p + 2, end - (p + 2)))
+                    return CLASS_INVALID;
+                p = end + 2;
+                continue;
+            }
+        }
+
+        if ('\\' == *p && '\0' == *++p)
+            return CLASS_INVALID;
+        lo = *p++;
+        hi = lo;
+        if ('-' == p[0] && ']' != p[1]) {
+            ++p;
+            if ('\0' == *p || ('\\' == *p && '\0' == *++p))
+                return CLASS_INVALID;
+            hi = *p++;
+        }
+        for (unsigned int c = lo; c <= hi; c++)
+            cls_set(tok->cls, c);
+    }
+
+    if (negate) {
+        for (unsigned int i = 0; i < 8; i++)
+            tok->cls[i] = ~tok->cls[i];
+    }
+    /* Bracket expressions never match slashes or the terminating zero. */
+    tok->cls[0] &= ~1U;
+    tok->cls['/' >> 5] &= ~(1U << ('/' & 31));
+    *endp = p + 1;
+    return CLASS_OK;
+}
+
+/* Splits the pattern into tokens, consecutive stars are merged.
+ * Returns the number of tokens or -1 if fnmatch() would never match the
+ * pattern.
+ */
+static int tokenize(const char *pattern, struct token *tokens)
+{
+    int n = 0;
+    const char *p = pattern;
+
+    while ('\0' != *p) {
+        struct token *tok = &tokens[n];
+
+        switch (*p) {
+            case '*':
+                ++p;
+                if (0 < n && TOKEN_STAR == tokens[n - 1].type)
+                    continue;
+                tok->type = TOKEN_STAR;
+                break;
+            case '?':
+                ++p;
+                tok->type = TOKEN_ANY;
+                break;
+            case '[':
+                switch (parse_class(p + 1, tok, &p)) {
+                    case CLASS_OK:
+                        tok->type = TOKEN_CLASS;
+                        break;
+                    case CLASS_LITERAL:
+                        tok->type = TOKEN_CHAR;
+                        tok->ch = *p++;
+                        break;
+                    case CLASS_INVALID:
+                    default:
+                        return -1;
+                }
+                break;
+            case '\\':
+                if ('\0' == *++p)
+                    return -1;
+                /* fall through */
+            default:
+                tok->type = TOKEN_CHAR;
+                tok->ch = *p++;
+                break;
+        }
+        ++n;
+    }
+    return n;
+}
+
+static void trie_insert(struct trie **root, const char *str, size_t len, bool reverse)
+{
+    struct trie **slot = root;
+    struct trie *node = NULL;
+
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = reverse ? str[len - i - 1] : str[i];
+
+        for (node = *slot; NULL != node; node = node->next) {
+            if (node->c == c)
+                break;
+        }
+        if (NULL == node) {
+            node = g_new0(struct trie, 1);
+            node->c = c;
+            node->next = *slot;
+            *slot = node;
+        }
+        slot = &node->child;
+    }
+    g_assert(NULL != node);
+    node->terminal = true;
+}
+
+static void trie_free(struct trie *node)
+{
+    while (NULL != node) {
+        struct trie *next = node->next;
+        trie_free(node->child);
+        g_free(node);
+        node = next;
+    }
+}
+
+static inline const struct trie *trie_step(const struct trie *level, unsigned char c)
+{
+    for (; NULL != level; level = level->next) {
+        if (level->c == c)
+            return level;
+    }
+    return NULL;
+}
+
+static void nfa_add(struct globset *gs, const struct token *tokens, guint ntokens)
+{
+    guint base = gs->nstates;
+    guint nwords = NWORDS(base + ntokens + 1);
+
+    if (nwords > gs->nwords) {
+        guint64 *advance = g_new0(guint64, 256 * nwords);
+        for (unsigned int c = 0; c < 256; c++)
+            memcpy(advance + c * nwords, gs->advance + c * gs->nwords, gs->nwords * sizeof(guint64));
+        g_free(gs->advance);
+        gs->advance = advance;
+
+        gs->star = g_renew(guint64, gs->star, nwords);
+        gs->start = g_renew(guint64, gs->start, nwords);
+        gs->accept = g_renew(guint64, gs->accept, nwords);
+        for (guint i = gs->nwords; i < nwords; i++)
+            gs->star[i] = gs->start[i] = gs->accept[i] = 0;
+        gs->nwords = nwords;
+    }
+
+#define BIT_SET(set, s) ((set)[(s) / WORD_BITS] |= (G_GUINT64_CONSTANT(1) << ((s) % WORD_BITS)))
+    BIT_SET(gs->start, base);
+    BIT_SET(gs->accept, base + ntokens);
+    for (guint i = 0; i < ntokens; i++) {
+        guint s = base + i;
+        switch (tokens[i].type) {
+            case TOKEN_STAR:
+                BIT_SET(gs->star, s);
+                break;
+            case TOKEN_CHAR:
+                BIT_SET(gs->advance + tokens[i].ch * nwords, s);
+                break;
+            case TOKEN_ANY:
+                for (unsigned int c = 1; c < 256; c++) {
+                    if ('/' != c)
+                        BIT_SET(gs->advance + c * nwords, s);
+                }
+                break;
+            case TOKEN_CLASS:
+                for (unsigned int c = 1; c < 256; c++) {
+                    if (cls_isset(tokens[i].cls, c))
+                        BIT_SET(gs->advance + c * nwords, s);
+                }
+                break;
+            default:
+                g_assert_not_reached();
+                break;
+        }
+    }
+#undef BIT_SET
+    gs->nstates = base + ntokens + 1;
+}
+
+static void globset_add(struct globset *gs, const char *pattern)
+{
+    int ntokens, i;
+    struct token *tokens;
+    GString *literal;
+
+    ++gs->npatterns;
+    tokens = g_new(struct token, strlen(pattern) + 1);
+    ntokens = tokenize(pattern, tokens);
+    if (0 > ntokens) {
+        g_debug("pattern `%s' is malformed and never matches", pattern);
+        g_free(tokens);
+        return;
+    }
+
+    literal = g_string_sized_new(ntokens);
+    for (i = 0; i < ntokens && TOKEN_CHAR == tokens[i].type; i++)
+        g_string_append_c(literal, tokens[i].ch);
+
+    if (i == ntokens) {
+        g_hash_table_insert(gs->literals, g_strdup(literal->str), GINT_TO_POINTER(1));
+        g_debug("pattern `%s' is a literal", pattern);
+    }
+    else if (i == ntokens - 1 && TOKEN_STAR == tokens[i].type) {
+        if (0 == literal->len)
+            gs->any_component = true;
+        else
+            trie_insert(&gs->prefixes, literal->str, literal->len, false);
+        g_debug("pattern `%s' is a prefix pattern", pattern);
+    }
+    else {
+        for (i = 1; i < ntokens && TOKEN_CHAR == tokens[i].type; i++)
+            ;
+        if (TOKEN_STAR == tokens[0].type && i == ntokens) {
+            g_string_truncate(literal, 0);
+            for (i = 1; i < ntokens; i++)
+                g_string_append_c(literal, tokens[i].ch);
+            trie_insert(&gs->suffixes, literal->str, literal->len, true);
+            g_debug("pattern `%s' is a suffix pattern", pattern);
+        }
+        else {
+            nfa_add(gs, tokens, ntokens);
+            g_debug("pattern `%s' is compiled into the automaton", pattern);
+        }
+    }
+
+    g_string_free(literal, TRUE);
+    g_free(tokens);
+}
+
+struct globset *globset_new(GSList *patterns)
+{
+    struct globset *gs;
+
+    gs = g_new0(struct globset, 1);
+    gs->literals = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    for (GSList *walk = patterns; NULL != walk; walk = g_slist_next(walk))
+        globset_add(gs, (const char *) walk->data);
+    return gs;
+}
+
+void globset_free(struct globset *gs)
+{
+    if (NULL == gs)
+        return;
+
+    g_hash_table_destroy(gs->literals);
+    trie_free(gs->prefixes);
+    trie_free(gs->suffixes);
+    g_free(gs->advance);
+    g_free(gs->star);
+    g_free(gs->start);
+    g_free(gs->accept);
+    g_free(gs);
+}
+
+guint globset_size(const struct globset *gs)
+{
+    return (NULL == gs) ? 0 : gs->npatterns;
+}
+
+/* Follows epsilon transitions out of star states. */
+static inline void nfa_closure(const struct globset *gs, guint64 *set)
+{
+    bool changed;
+
+    do {
+        guint64 carry = 0;
+
+        changed = false;
+        for (guint i = 0; i < gs->nwords; i++) {
+            guint64 s = set[i] & gs->star[i];
+            guint64 t = (s << 1) | carry;
+            carry = s >> (WORD_BITS - 1);
+            if (t & ~set[i]) {
+                set[i] |= t;
+                changed = true;
+            }
+        }
+    } while (changed);
+}
+
+static bool nfa_match(const struct globset *gs, const char *path)
+{
+    bool alive, ret;
+    guint64 stack[2 * STACK_WORDS];
+    guint64 *cur, *next;
+
+    if (G_LIKELY(gs->nwords <= STACK_WORDS))
+        cur = stack;
+    else
+        cur = g_new(guint64, 2 * gs->nwords);
+    next = cur + gs->nwords;
+
+    memcpy(cur, gs->start, gs->nwords * sizeof(guint64));
+    nfa_closure(gs, cur);
+
+    for (const unsigned char *p = (const unsigned char *) path; '\0' != *p; p++) {
+        const guint64 *adv = gs->advance + *p * gs->nwords;
+        guint64 carry = 0;
+
+        alive = false;
+        for (guint i = 0; i < gs->nwords; i++) {
+            guint64 s = cur[i] & adv[i];
+            next[i] = (s << 1) | carry;
+            carry = s >> (WORD_BITS - 1);
+            if ('/' != *p)
+                next[i] |= cur[i] & gs->star[i];
+            alive = alive || (0 != next[i]);
+        }
+        if (!alive) {
+            ret = false;
+            goto out;
+        }
+        nfa_closure(gs, next);
+
+        guint64 *tmp = cur;
+        cur = next;
+        next = tmp;
+    }
+
+    ret = false;
+    for (guint i = 0; i < gs->nwords; i++) {
+        if (cur[i] & gs->accept[i]) {
+            ret = true;
+            break;
+        }
+    }
+
+out:
+    if (G_UNLIKELY(gs->nwords > STACK_WORDS))
+        g_free(MIN(cur, next));
+    return ret;
+}
+
+bool globset_match(const struct globset *gs, const char *path)
+{
+    size_t len;
+    const char *first_slash, *last_slash;
+    const struct trie *node;
+
+    if (NULL == gs || 0 == gs->npatterns)
+        return false;
+
+    if (0 != g_hash_table_size(gs->literals) && NULL != g_hash_table_lookup(gs->literals, path))
+        return true;
+
+    len = strlen(path);
+    first_slash = strchr(path, '/');
+    last_slash = strrchr(path, '/');
+
+    if (gs->any_component && NULL == first_slash)
+        return true;
+
+    /* LITERAL* matches if the path starts with LITERAL and the rest doesn't
+     * contain a slash.
+     */
+    if (NULL != gs->prefixes) {
+        size_t tail = (NULL == last_slash) ? 0 : (size_t) (last_slash - path) + 1;
+
+        node = gs->prefixes;
+        for (size_t i = 0; i < len; i++) {
+            node = trie_step(node, path[i]);
+            if (NULL == node)
+                break;
+            if (node->terminal && i + 1 >= tail)
+                return true;
+            node = node->child;
+        }
+    }
+
+    /* *LITERAL matches if the path ends with LITERAL and the rest doesn't
+     * contain a slash.
+     */
+    if (NULL != gs->suffixes) {
+        size_t head = (NULL == first_slash) ? len : (size_t) (first_slash - path);
+
+        node = gs->suffixes;
+        for (size_t i = 0; i < len; i++) {
+            node = trie_step(node, path[len - i - 1]);
+            if (NULL == node)
+                break;
+            if (node->terminal && len - i - 1 <= head)
+                return true;
+            node = node->child;
+        }
+    }
+
+    if (0 != gs->nstates)
+        return nfa_match(gs, path);
+    return false;
+}
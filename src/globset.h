@@ -0,0 +1,76 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SYDBOX_GUARD_GLOBSET_H
+#define SYDBOX_GUARD_GLOBSET_H 1
+
+#include <stdbool.h>
+
+#include <glib.h>
+
+/**
+ * globset:
+ *
+ * A set of shell patterns compiled into a single matcher.
+ * Matching is equivalent to calling fnmatch(pattern, path, FNM_PATHNAME) for
+ * every pattern in the set and returning true if any of them matches:
+ *  - Literal patterns are kept in a hash table.
+ *  - Patterns of the form LITERAL* go into a prefix trie.
+ *  - Patterns of the form *LITERAL go into a suffix trie.
+ *  - The rest are compiled into one bit-parallel automaton which is run over
+ *    the path once for all patterns.
+ *
+ * Since: 0.2_alpha4
+ **/
+struct globset;
+
+/**
+ * globset_new:
+ * @patterns: a #GSList of patterns, may be %NULL
+ *
+ * Compiles the given list of patterns.
+ *
+ * Returns: a newly allocated #globset, free with globset_free()
+ **/
+struct globset *globset_new(GSList *patterns);
+
+/**
+ * globset_free:
+ * @gs: the #globset to free, may be %NULL
+ **/
+void globset_free(struct globset *gs);
+
+/**
+ * globset_size:
+ * @gs: a #globset
+ *
+ * Returns: the number of patterns compiled into @gs
+ **/
+guint globset_size(const struct globset *gs);
+
+/**
+ * globset_match:
+ * @gs: a #globset, may be %NULL
+ * @path: the path to match
+ *
+ * Returns: true if any of the patterns in @gs matches @path
+ **/
+bool globset_match(const struct globset *gs, const char *path);
+
+#endif // SYDBOX_GUARD_GLOBSET_H
@@ -0,0 +1,189 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+
+#include <glib.h>
+
+#ifdef HAVE_LINUX_LANDLOCK_H
+#include <linux/landlock.h>
+#endif // HAVE_LINUX_LANDLOCK_H
+
+#include "landlock.h"
+
+__thread bool landlock_enabled = false;
+
+#if defined(HAVE_LINUX_LANDLOCK_H) && defined(__NR_landlock_create_ruleset)
+
+#ifndef LANDLOCK_ACCESS_FS_TRUNCATE
+#define LANDLOCK_ACCESS_FS_TRUNCATE (1ULL << 14)
+#endif
+
+/* Everything a write prefix allows, see systemcall_check_path() */
+#define LANDLOCK_ACCESS_WRITE           \
+    (LANDLOCK_ACCESS_FS_WRITE_FILE |    \
+     LANDLOCK_ACCESS_FS_REMOVE_DIR |    \
+     LANDLOCK_ACCESS_FS_REMOVE_FILE |   \
+     LANDLOCK_ACCESS_FS_MAKE_CHAR |     \
+     LANDLOCK_ACCESS_FS_MAKE_DIR |      \
+     LANDLOCK_ACCESS_FS_MAKE_REG |      \
+     LANDLOCK_ACCESS_FS_MAKE_SOCK |     \
+     LANDLOCK_ACCESS_FS_MAKE_FIFO |     \
+     LANDLOCK_ACCESS_FS_MAKE_BLOCK |    \
+     LANDLOCK_ACCESS_FS_MAKE_SYM |      \
+     LANDLOCK_ACCESS_FS_REFER)
+
+/* Checks whether the directory opened as fd is the one dir names without
+ * following a symbolic link or going through dot or dot-dot. */
+static bool landlock_canonical(int fd, const char *dir)
+{
+    bool canonical;
+    gsize len;
+    gchar *link, *target;
+
+    link = g_strdup_printf("/proc/self/fd/%d", fd);
+    target = g_file_read_link(link, NULL);
+    g_free(link);
+    if (NULL == target)
+        return false;
+
+    len = strlen(dir);
+    while (len > 1 && '/' == dir[len - 1])
+        --len;
+    canonical = strlen(target) == len && 0 == strncmp(target, dir, len);
+    g_free(target);
+    return canonical;
+}
+
+static int landlock_add_prefix(int ruleset_fd, const char *prefix, __u64 access, bool *exact)
+{
+    struct landlock_path_beneath_attr attr;
+    gchar *dir, *parent;
+    int fd, ret, save_errno;
+
+    dir = g_strdup(prefix);
+    while (0 > (fd = open(dir, O_PATH | O_DIRECTORY | O_CLOEXEC))) {
+        if (0 == strcmp(dir, "/")) {
+            save_errno = errno;
+            g_free(dir);
+            errno = save_errno;
+            return -1;
+        }
+        /* Files, and directories which don't exist yet, can't be granted
+         * without the directory they're created and removed in.
+         */
+        *exact = false;
+        parent = g_path_get_dirname(dir);
+        g_free(dir);
+        dir = parent;
+    }
+    /* Write prefixes are matched against canonicalized paths, a prefix
+     * which isn't canonical itself, like a symbolic link to another
+     * directory, would grant writes beneath a directory it doesn't match.
+     */
+    if (*exact && !landlock_canonical(fd, dir))
+        *exact = false;
+    g_debug("allowing writes beneath `%s' with Landlock", dir);
+
+    memset(&attr, 0, sizeof(struct landlock_path_beneath_attr));
+    attr.allowed_access = access;
+    attr.parent_fd = fd;
+    ret = syscall(__NR_landlock_add_rule, ruleset_fd, LANDLOCK_RULE_PATH_BENEATH, &attr, 0);
+    save_errno = errno;
+    close(fd);
+    g_free(dir);
+    errno = save_errno;
+    return ret;
+}
+
+int landlock_ruleset_new(GSList *write_prefixes, bool proc, bool *exact)
+{
+    int abi, fd, save_errno;
+    struct landlock_ruleset_attr attr;
+
+    abi = syscall(__NR_landlock_create_ruleset, NULL, 0, LANDLOCK_CREATE_RULESET_VERSION);
+    if (0 > abi)
+        return -1;
+    else if (2 > abi) {
+        /* Without LANDLOCK_ACCESS_FS_REFER files can't be renamed or linked
+         * to another directory at all.
+         */
+        errno = EOPNOTSUPP;
+        return -1;
+    }
+    g_debug("kernel supports Landlock ABI %d", abi);
+
+    memset(&attr, 0, sizeof(struct landlock_ruleset_attr));
+    attr.handled_access_fs = LANDLOCK_ACCESS_WRITE;
+    if (3 <= abi)
+        attr.handled_access_fs |= LANDLOCK_ACCESS_FS_TRUNCATE;
+    fd = syscall(__NR_landlock_create_ruleset, &attr, sizeof(struct landlock_ruleset_attr), 0);
+    if (0 > fd)
+        return -1;
+
+    *exact = true;
+    for (GSList *walk = write_prefixes; NULL != walk; walk = g_slist_next(walk)) {
+        if (0 > landlock_add_prefix(fd, walk->data, attr.handled_access_fs, exact))
+            goto fail;
+    }
+    if (proc) {
+        *exact = false;
+        if (0 > landlock_add_prefix(fd, "/proc", attr.handled_access_fs, exact))
+            goto fail;
+    }
+    return fd;
+fail:
+    save_errno = errno;
+    close(fd);
+    errno = save_errno;
+    return -1;
+}
+
+int landlock_restrict(int ruleset_fd)
+{
+    if (0 > prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0))
+        return -1;
+    return syscall(__NR_landlock_restrict_self, ruleset_fd, 0);
+}
+
+#else
+
+int landlock_ruleset_new(GSList *write_prefixes G_GNUC_UNUSED, bool proc G_GNUC_UNUSED,
+        bool *exact G_GNUC_UNUSED)
+{
+    errno = ENOSYS;
+    return -1;
+}
+
+int landlock_restrict(int ruleset_fd G_GNUC_UNUSED)
+{
+    errno = ENOSYS;
+    return -1;
+}
+
+#endif // defined(HAVE_LINUX_LANDLOCK_H) && defined(__NR_landlock_create_ruleset)
@@ -0,0 +1,73 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SYDBOX_GUARD_LANDLOCK_H
+#define SYDBOX_GUARD_LANDLOCK_H 1
+
+#include <stdbool.h>
+
+#include <glib.h>
+
+/* Whether the kernel denies writes outside the write prefixes exactly like
+ * the tracer would, so system calls marked LANDLOCK_CALL need only be
+ * checked by the tracer when they fail with EACCES.  Set for the thread
+ * running the sandbox.
+ */
+extern __thread bool landlock_enabled;
+
+/**
+ * landlock_ruleset_new:
+ * @write_prefixes: list of write prefixes
+ * @proc: whether children may write to their /proc/PID directories
+ * @exact: location to store whether the ruleset allows no more than
+ * @write_prefixes
+ *
+ * Creates a Landlock ruleset which allows writing, creating, removing,
+ * renaming and linking files only beneath @write_prefixes.  Landlock grants
+ * access beneath directories, so prefixes which aren't existing directories
+ * are granted the nearest directory above them, as is the whole of /proc if
+ * @proc is true; @exact is set to false in that case.  So is it if a prefix
+ * isn't canonical, e.g. a symbolic link, since Landlock grants the directory
+ * it resolves to while prefixes only match canonicalized paths.
+ *
+ * Returns: a file descriptor referring to the ruleset, or -1 with errno set
+ * on failure.  errno is ENOSYS or EOPNOTSUPP if the kernel doesn't support
+ * Landlock or only an ABI which can't rename or link files across
+ * directories.
+ *
+ * Since: 0.2_alpha4
+ **/
+int landlock_ruleset_new(GSList *write_prefixes, bool proc, bool *exact);
+
+/**
+ * landlock_restrict:
+ * @ruleset_fd: a ruleset returned by landlock_ruleset_new()
+ *
+ * Restricts the calling thread and the processes it creates from now on to
+ * the ruleset.  This sets the no_new_privs bit of the thread as well, so
+ * set-user-ID and file capability binaries executed afterwards don't gain
+ * privileges.
+ *
+ * Returns: 0 on success, -1 with errno set on failure
+ *
+ * Since: 0.2_alpha4
+ **/
+int landlock_restrict(int ruleset_fd);
+
+#endif // SYDBOX_GUARD_LANDLOCK_H
@@ -0,0 +1,175 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gprintf.h>
+
+#include "latency.h"
+#include "syscall.h"
+
+struct latency_histogram {
+    guint64 count;
+    guint64 sum;
+    guint64 min;
+    guint64 max;
+    guint64 buckets[LATENCY_BUCKETS];
+};
+
+bool latency_enabled = false;
+int latency_result = -1;
+volatile sig_atomic_t latency_dump_requested = 0;
+
+static struct latency_histogram histograms[LATENCY_MAX];
+
+static const char * const latency_names[LATENCY_MAX] = {
+    "syscall-entry",
+    "syscall-exit",
+    "fork",
+    "exec",
+    "signal",
+    "allow",
+    "nowrite",
+    "magic",
+    "deny",
+    "error",
+};
+
+/* Returns the largest value falling into the given bucket. */
+static guint64 latency_bucket_max(unsigned int bucket)
+{
+    unsigned int shift;
+    guint64 mantissa;
+
+    if (bucket < LATENCY_SUB_BUCKETS)
+        return bucket;
+    shift = bucket / LATENCY_SUB_BUCKETS - 1;
+    mantissa = bucket % LATENCY_SUB_BUCKETS + LATENCY_SUB_BUCKETS;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void latency_init(void)
+{
+    latency_reset();
+    latency_enabled = true;
+}
+
+void latency_reset(void)
+{
+    memset(histograms, 0, sizeof(histograms));
+    latency_result = -1;
+}
+
+void latency_add(int type, guint64 value)
+{
+    struct latency_histogram *h = &histograms[type];
+
+    if (0 == h->count || value < h->min)
+        h->min = value;
+    if (value > h->max)
+        h->max = value;
+    ++h->count;
+    h->sum += value;
+    ++h->buckets[latency_bucket(value)];
+}
+
+void latency_add_syscall(bool entering, guint64 value)
+{
+    latency_add(entering ? LATENCY_SYSCALL_ENTER : LATENCY_SYSCALL_EXIT, value);
+
+    switch (latency_result) {
+        case -1:
+            return;
+        case RS_ALLOW:
+            latency_add(LATENCY_ALLOW, value);
+            break;
+        case RS_NOWRITE:
+            latency_add(LATENCY_NOWRITE, value);
+            break;
+        case RS_MAGIC:
+            latency_add(LATENCY_MAGIC, value);
+            break;
+        case RS_DENY:
+            latency_add(LATENCY_DENY, value);
+            break;
+        case RS_ERROR:
+        default:
+            latency_add(LATENCY_ERROR, value);
+            break;
+    }
+    latency_result = -1;
+}
+
+guint64 latency_count(int type)
+{
+    return histograms[type].count;
+}
+
+guint64 latency_percentile(int type, double percentile)
+{
+    const struct latency_histogram *h = &histograms[type];
+    guint64 rank, seen = 0;
+
+    if (0 == h->count)
+        return 0;
+
+    /* The rank of the value we're looking for, counting from one. */
+    rank = (guint64) (percentile / 100.0 * h->count + 0.5);
+    if (rank < 1)
+        rank = 1;
+    else if (rank > h->count)
+        rank = h->count;
+
+    for (unsigned int i = latency_bucket(h->min); i <= latency_bucket(h->max); i++) {
+        seen += h->buckets[i];
+        if (seen >= rank)
+            return MIN(latency_bucket_max(i), h->max);
+    }
+    return h->max;
+}
+
+void latency_dump(void)
+{
+    latency_dump_requested = 0;
+
+    g_fprintf(stderr, "latency (usecs)     count        min       mean        p50        p90"
+            "        p99       p999        max\n");
+    for (int i = 0; i < LATENCY_MAX; i++) {
+        const struct latency_histogram *h = &histograms[i];
+
+        if (0 == h->count)
+            continue;
+        g_fprintf(stderr, "%-13s %11" G_GUINT64_FORMAT " %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+                latency_names[i], h->count,
+                h->min / 1e3,
+                (double) h->sum / h->count / 1e3,
+                latency_percentile(i, 50) / 1e3,
+                latency_percentile(i, 90) / 1e3,
+                latency_percentile(i, 99) / 1e3,
+                latency_percentile(i, 99.9) / 1e3,
+                h->max / 1e3);
+    }
+}
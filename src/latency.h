@@ -0,0 +1,182 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SYDBOX_GUARD_LATENCY_H
+#define SYDBOX_GUARD_LATENCY_H 1
+
+#include <signal.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include <glib.h>
+
+/* Histograms, the time a child spends stopped from the moment waitpid()
+ * returns until it is resumed.
+ */
+enum {
+    LATENCY_SYSCALL_ENTER = 0,
+    LATENCY_SYSCALL_EXIT,
+    LATENCY_FORK,
+    LATENCY_EXEC,
+    LATENCY_SIGNAL,
+    /* System call entries by the result of the checks */
+    LATENCY_ALLOW,
+    LATENCY_NOWRITE,
+    LATENCY_MAGIC,
+    LATENCY_DENY,
+    LATENCY_ERROR,
+    LATENCY_MAX,
+};
+
+/* Every power of two is split into 2^LATENCY_SUB_BITS buckets, so the value
+ * reported for a bucket is off by at most 1/16th.
+ */
+#define LATENCY_SUB_BITS        4
+#define LATENCY_SUB_BUCKETS     (1 << LATENCY_SUB_BITS)
+#define LATENCY_BUCKETS         ((64 - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS)
+
+extern bool latency_enabled;
+extern int latency_result;
+extern volatile sig_atomic_t latency_dump_requested;
+
+/**
+ * latency_now:
+ *
+ * Returns: a monotonic timestamp in nanoseconds
+ *
+ * Since: 0.2_alpha4
+ **/
+static inline guint64 latency_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (guint64) ts.tv_sec * G_GUINT64_CONSTANT(1000000000) + ts.tv_nsec;
+}
+
+/**
+ * latency_bucket:
+ * @value: the value to look up
+ *
+ * Returns: index of the histogram bucket @value falls into
+ *
+ * Since: 0.2_alpha4
+ **/
+static inline unsigned int latency_bucket(guint64 value)
+{
+    unsigned int shift;
+
+    if (value < LATENCY_SUB_BUCKETS)
+        return value;
+    shift = 63 - __builtin_clzll(value) - LATENCY_SUB_BITS;
+    return (shift + 1) * LATENCY_SUB_BUCKETS + (value >> shift) - LATENCY_SUB_BUCKETS;
+}
+
+/**
+ * latency_init:
+ *
+ * Starts collecting latency histograms.
+ *
+ * Since: 0.2_alpha4
+ **/
+void latency_init(void);
+
+/**
+ * latency_add:
+ * @type: one of LATENCY_*
+ * @value: the measured latency in nanoseconds
+ *
+ * Adds a value to the given histogram.
+ *
+ * Since: 0.2_alpha4
+ **/
+void latency_add(int type, guint64 value);
+
+/**
+ * latency_count:
+ * @type: one of LATENCY_*
+ *
+ * Returns: the number of values added to the given histogram
+ *
+ * Since: 0.2_alpha4
+ **/
+guint64 latency_count(int type);
+
+/**
+ * latency_percentile:
+ * @type: one of LATENCY_*
+ * @percentile: the percentile, between 0 and 100
+ *
+ * Returns: the upper bound of the bucket the percentile falls into, capped
+ * at the largest value seen
+ *
+ * Since: 0.2_alpha4
+ **/
+guint64 latency_percentile(int type, double percentile);
+
+/**
+ * latency_dump:
+ *
+ * Prints count, minimum, maximum, mean and tail percentiles of every
+ * non-empty histogram to standard error. Collecting goes on afterwards.
+ *
+ * Since: 0.2_alpha4
+ **/
+void latency_dump(void);
+
+/**
+ * latency_reset:
+ *
+ * Empties all histograms.
+ *
+ * Since: 0.2_alpha4
+ **/
+void latency_reset(void);
+
+static inline void latency_record(int type, guint64 start)
+{
+    if (G_UNLIKELY(latency_enabled))
+        latency_add(type, latency_now() - start);
+}
+
+static inline void latency_note_result(int result)
+{
+    if (G_UNLIKELY(latency_enabled))
+        latency_result = result;
+}
+
+/**
+ * latency_add_syscall:
+ * @entering: whether the stop was a system call entry
+ * @value: the measured latency in nanoseconds
+ *
+ * Adds a system call stop, and the result of the checks if
+ * latency_note_result() was called while handling it.
+ *
+ * Since: 0.2_alpha4
+ **/
+void latency_add_syscall(bool entering, guint64 value);
+
+static inline void latency_record_syscall(bool entering, guint64 start)
+{
+    if (G_UNLIKELY(latency_enabled))
+        latency_add_syscall(entering, latency_now() - start);
+}
+
+#endif // SYDBOX_GUARD_LATENCY_H
@@ -28,10 +28,16 @@
 #include <glib.h>
 
 #include "dispatch.h"
+#include "eventlog.h"
+#include "latency.h"
 #include "loop.h"
+#include "monitor.h"
+#include "probes.h"
 #include "proc.h"
 #include "trace.h"
+#include "trace-util.h"
 #include "syscall.h"
+#include "violation.h"
 #include "children.h"
 #include "sydbox-config.h"
 #include "sydbox-log.h"
@@ -66,9 +72,31 @@ static int xsyscall(context_t *ctx, struct tchild *child)
     return 0;
 }
 
-static int xfork(context_t *ctx, struct tchild *child)
+/* Gets the flags of the clone(2) or clone3(2) call child is stopped in.
+ * Returns 0 on success, -1 on failure and sets errno accordingly.
+ */
+static int xclone_flags(struct tchild *child, bool clone3, long *flags)
+{
+    long addr;
+    guint64 args_flags;
+
+    if (!clone3)
+        return trace_get_arg(child->pid, child->personality, 0, flags);
+
+    // The flags are the first member of struct clone_args.
+    if (0 > trace_get_arg(child->pid, child->personality, 0, &addr))
+        return -1;
+    if (0 > umoven(child->pid, addr, (char *) &args_flags, sizeof(guint64)))
+        return -1;
+    *flags = (long) args_flags;
+    return 0;
+}
+
+static int xfork(context_t *ctx, struct tchild *child, unsigned int event)
 {
+    bool clone3;
     pid_t childpid;
+    long clone_flags = 0;
     struct tchild *newchild;
 
     // Get new child's pid
@@ -93,6 +121,24 @@ static int xfork(context_t *ctx, struct tchild *child)
 #endif // defined(POWERPC)
         g_debug("the newborn child's pid is %i", childpid);
     }
+    eventlog_event(child->pid, event, childpid);
+
+    /* Threads and CLONE_FS children share state with their parent.  The
+     * event depends on the exit signal rather than the flags, clone() with
+     * SIGCHLD is reported as a fork, so decode the flags of any clone.
+     */
+    clone3 = dispatch_clone3(child->personality, child->sno);
+    if (clone3 || dispatch_clone(child->personality, child->sno)) {
+        if (G_UNLIKELY(0 > xclone_flags(child, clone3, &clone_flags))) {
+            if (G_UNLIKELY(ESRCH != errno)) {
+                g_critical("failed to get clone flags of child %i: %s", child->pid, g_strerror(errno));
+                g_printerr("failed to get clone flags of child %i: %s", child->pid, g_strerror(errno));
+                exit(-1);
+            }
+            return context_remove_child(ctx, child->pid);
+        }
+        g_debug("child %i called clone with flags %#lx", child->pid, clone_flags);
+    }
 
     newchild = tchild_find(ctx->children, childpid);
     if (NULL == newchild) {
@@ -101,14 +147,14 @@ static int xfork(context_t *ctx, struct tchild *child)
          */
         tchild_new(ctx->children, childpid);
         newchild = tchild_find(ctx->children, childpid);
-        tchild_inherit(newchild, child);
+        tchild_inherit(newchild, child, clone_flags);
     }
     else if (newchild->flags & TCHILD_NEEDINHERIT) {
         /* Child has already been born but hasn't inherited parent's sandbox data
          * yet. Inherit parent's sandbox data and resume the child.
          */
         g_debug("prematurely born child %i inherits sandbox data from her parent %i", newchild->pid, child->pid);
-        tchild_inherit(newchild, child);
+        tchild_inherit(newchild, child, clone_flags);
         xsyscall(ctx, newchild);
     }
     return 0;
@@ -144,142 +190,219 @@ static int xunknown(context_t *ctx, struct tchild *child, int status)
     return 0;
 }
 
-int trace_loop(context_t *ctx)
+/* Waits for the next event of a child traced by this thread, writing out
+ * buffered log records and access violations when there is nothing else to
+ * do.  Returns 0 if block
+ * is false and no child has changed state.
+ */
+static inline pid_t trace_wait(int *status, bool block)
 {
+    pid_t pid;
+
+    if (!block || sydbox_log_pending() || violation_pending()) {
+        pid = waitpid(-1, status, __WALL | __WNOTHREAD | WNOHANG);
+        if (0 != pid)
+            return pid;
+        if (sydbox_log_pending())
+            sydbox_log_flush();
+        violation_idle();
+        if (!block)
+            return 0;
+    }
+    return waitpid(-1, status, __WALL | __WNOTHREAD);
+}
+
+/* Stops tracing once the eldest child has exited, letting the remaining
+ * children go.
+ */
+static void trace_abandon(context_t *ctx)
+{
+    tchild_table_foreach(ctx->children, tchild_cont_one, NULL);
+    tchild_table_free(ctx->children);
+    ctx->children = NULL;
+}
+
+static bool trace_handle(context_t *ctx, bool block)
+{
+    bool entering;
     int status, ret;
     unsigned int event;
     pid_t pid;
+    guint64 start = 0;
     struct tchild *child;
 
-    ret = EXIT_SUCCESS;
-    while (NULL != ctx->children) {
-        pid = waitpid(-1, &status, __WALL);
-        if (G_UNLIKELY(0 > pid)) {
-            if (ECHILD == errno)
-                break;
-            else {
-                g_critical("waitpid failed: %s", g_strerror(errno));
-                g_printerr("waitpid failed: %s", g_strerror(errno));
-                exit (-1);
-            }
+    if (NULL == ctx->children)
+        return false;
+
+    if (G_UNLIKELY(latency_dump_requested))
+        latency_dump();
+    pid = trace_wait(&status, block);
+    if (0 == pid)
+        return true;
+    else if (G_UNLIKELY(0 > pid)) {
+        if (ECHILD == errno) {
+            tchild_table_free(ctx->children);
+            ctx->children = NULL;
+            return false;
+        }
+        else if (EINTR == errno)
+            return true;
+        else {
+            g_critical("waitpid failed: %s", g_strerror(errno));
+            g_printerr("waitpid failed: %s", g_strerror(errno));
+            exit (-1);
         }
-        child = tchild_find(ctx->children, pid);
-        event = trace_event(status);
-        g_assert(NULL != child || E_STOP == event || E_EXIT == event || E_EXIT_SIGNAL == event);
+    }
+    ctx->stats.events++;
+    if (G_UNLIKELY(latency_enabled))
+        start = latency_now();
+    child = tchild_find(ctx->children, pid);
+    event = trace_event(status);
+    ctx->stats.stops[event]++;
+    SYDBOX_PROBE3(event, pid, event, status);
+    g_assert(NULL != child || E_STOP == event || E_EXIT == event || E_EXIT_SIGNAL == event);
 
-        switch(event) {
-            case E_STOP:
-                g_debug("latest event for child %i is E_STOP, calling event handler", pid);
-                if (NULL == child) {
-                    /* Child is born before PTRACE_EVENT_FORK.
-                     * Set her up but don't resume her until we receive the
-                     * event.
-                     */
-                    g_debug("setting up prematurely born child %i", pid);
-                    tchild_new(ctx->children, pid);
-                    child = tchild_find(ctx->children, pid);
-                    ret = xsetup(ctx, child);
-                    if (0 != ret)
-                        return ret;
-                }
-                else {
-                    g_debug("setting up child %i", child->pid);
-                    ret = xsetup(ctx, child);
-                    if (0 != ret)
-                        return ret;
-                    ret = xsyscall(ctx, child);
-                    if (0 != ret)
-                        return ret;
-                }
-                break;
-            case E_SYSCALL:
-                ret = syscall_handle(ctx, child);
-                if (0 != ret)
-                    return ret;
-                ret = xsyscall(ctx, child);
+    switch(event) {
+        case E_STOP:
+            g_debug("latest event for child %i is E_STOP, calling event handler", pid);
+            eventlog_event(pid, event, 0);
+            if (NULL == child) {
+                /* Child is born before PTRACE_EVENT_FORK.
+                 * Set her up but don't resume her until we receive the
+                 * event.
+                 */
+                g_debug("setting up prematurely born child %i", pid);
+                tchild_new(ctx->children, pid);
+                child = tchild_find(ctx->children, pid);
+                ret = xsetup(ctx, child);
                 if (0 != ret)
-                    return ret;
-                break;
-            case E_FORK:
-            case E_VFORK:
-            case E_CLONE:
-                g_debug("latest event for child %i is E_FORK, calling event handler", pid);
-                ret = xfork(ctx, child);
-                if (0 != ret)
-                    return ret;
-                ret = xsyscall(ctx, child);
+                    goto gone;
+            }
+            else {
+                g_debug("setting up child %i", child->pid);
+                ret = xsetup(ctx, child);
                 if (0 != ret)
-                    return ret;
-                break;
-            case E_EXEC:
-                g_debug("latest event for child %i is E_EXEC, calling event handler", pid);
-                // Check for exec_lock
-                if (G_UNLIKELY(LOCK_PENDING == child->sandbox->lock)) {
-                    g_info("access to magic commands is now denied for child %i", child->pid);
-                    child->sandbox->lock = LOCK_SET;
-                }
-                // Update child's personality
-                child->personality = trace_personality(child->pid);
-                if (0 > child->personality) {
-                    g_critical("failed to determine personality of child %i: %s", child->pid, g_strerror(errno));
-                    g_printerr("failed to determine personality of child %i: %s", child->pid, g_strerror(errno));
-                    exit(-1);
-                }
-                g_debug("updated child %i's personality to %s mode", child->pid, dispatch_mode(child->personality));
+                    goto gone;
                 ret = xsyscall(ctx, child);
                 if (0 != ret)
-                    return ret;
-                break;
-            case E_GENUINE:
-                g_debug("latest event for child %i is E_GENUINE, calling event handler", pid);
-                ret = xgenuine(ctx, child, status);
-                if (0 != ret)
-                    return ret;
-                break;
-            case E_EXIT:
-                if (G_UNLIKELY(ctx->eldest == pid)) {
-                    // Eldest child, keep return value.
-                    ret = WEXITSTATUS(status);
-                    if (0 != ret)
-                        g_message("eldest child %i exited with return code %d", pid, ret);
-                    else
-                        g_info("eldest child %i exited with return code %d", pid, ret);
-                    if (!sydbox_config_get_wait_all()) {
-                        g_hash_table_foreach(ctx->children, tchild_cont_one, NULL);
-                        g_hash_table_destroy(ctx->children);
-                        ctx->children = NULL;
-                        return ret;
-                    }
-                }
+                    goto gone;
+            }
+            break;
+        case E_SYSCALL:
+            entering = !(child->flags & TCHILD_INSYSCALL);
+            ret = syscall_handle(ctx, child);
+            if (0 != ret)
+                goto gone;
+            ret = xsyscall(ctx, child);
+            if (0 != ret)
+                goto gone;
+            latency_record_syscall(entering, start);
+            break;
+        case E_FORK:
+        case E_VFORK:
+        case E_CLONE:
+            g_debug("latest event for child %i is E_FORK, calling event handler", pid);
+            ret = xfork(ctx, child, event);
+            if (0 != ret)
+                goto gone;
+            ret = xsyscall(ctx, child);
+            if (0 != ret)
+                goto gone;
+            latency_record(LATENCY_FORK, start);
+            break;
+        case E_EXEC:
+            g_debug("latest event for child %i is E_EXEC, calling event handler", pid);
+            // Check for exec_lock
+            if (G_UNLIKELY(LOCK_PENDING == child->sandbox->lock)) {
+                g_info("access to magic commands is now denied for child %i", child->pid);
+                child->sandbox->lock = LOCK_SET;
+            }
+            // Update child's personality
+            child->personality = trace_personality(child->pid);
+            if (0 > child->personality) {
+                g_critical("failed to determine personality of child %i: %s", child->pid, g_strerror(errno));
+                g_printerr("failed to determine personality of child %i: %s", child->pid, g_strerror(errno));
+                exit(-1);
+            }
+            g_debug("updated child %i's personality to %s mode", child->pid, dispatch_mode(child->personality));
+            eventlog_event(pid, event, child->personality);
+            ret = xsyscall(ctx, child);
+            if (0 != ret)
+                goto gone;
+            latency_record(LATENCY_EXEC, start);
+            break;
+        case E_GENUINE:
+            g_debug("latest event for child %i is E_GENUINE, calling event handler", pid);
+            eventlog_event(pid, event, WSTOPSIG(status));
+            ret = xgenuine(ctx, child, status);
+            if (0 != ret)
+                goto gone;
+            latency_record(LATENCY_SIGNAL, start);
+            break;
+        case E_EXIT:
+            eventlog_event(pid, event, WEXITSTATUS(status));
+            if (G_UNLIKELY(ctx->eldest == pid)) {
+                // Eldest child, keep return value.
+                ctx->retval = WEXITSTATUS(status);
+                if (0 != ctx->retval)
+                    g_message("eldest child %i exited with return code %d", pid, ctx->retval);
                 else
-                    g_debug("child %i exited with return code: %d", pid, ret);
-                tchild_delete(ctx->children, pid);
-                break;
-            case E_EXIT_SIGNAL:
-                if (G_UNLIKELY(ctx->eldest == pid)) {
-                    ret = 128 + WTERMSIG(status);
-                    g_message("eldest child %i exited with signal %d", pid, WTERMSIG(status));
-                    if (!sydbox_config_get_wait_all()) {
-                        g_hash_table_foreach(ctx->children, tchild_cont_one, NULL);
-                        g_hash_table_destroy(ctx->children);
-                        ctx->children = NULL;
-                        return ret;
-                    }
+                    g_info("eldest child %i exited with return code %d", pid, ctx->retval);
+                if (!sydbox_config_get_wait_all()) {
+                    trace_abandon(ctx);
+                    return false;
                 }
-                else
-                    g_info("child %i exited with signal %d", pid, WTERMSIG(status));
-                tchild_delete(ctx->children, pid);
-                break;
-            case E_UNKNOWN:
-                g_info("unknown signal %#x received from child %i", WSTOPSIG(status), pid);
-                ret = xunknown(ctx, child, status);
-                if (0 != ret)
-                    return ret;
-                break;
-            default:
-                g_assert_not_reached();
-        }
+            }
+            else
+                g_debug("child %i exited with return code: %d", pid, WEXITSTATUS(status));
+            tchild_delete(ctx->children, pid);
+            break;
+        case E_EXIT_SIGNAL:
+            eventlog_event(pid, event, WTERMSIG(status));
+            if (G_UNLIKELY(ctx->eldest == pid)) {
+                ctx->retval = 128 + WTERMSIG(status);
+                g_message("eldest child %i exited with signal %d", pid, WTERMSIG(status));
+                if (!sydbox_config_get_wait_all()) {
+                    trace_abandon(ctx);
+                    return false;
+                }
+            }
+            else
+                g_info("child %i exited with signal %d", pid, WTERMSIG(status));
+            tchild_delete(ctx->children, pid);
+            break;
+        case E_UNKNOWN:
+            g_info("unknown signal %#x received from child %i", WSTOPSIG(status), pid);
+            eventlog_event(pid, event, WSTOPSIG(status));
+            ret = xunknown(ctx, child, status);
+            if (0 != ret)
+                goto gone;
+            latency_record(LATENCY_SIGNAL, start);
+            break;
+        default:
+            g_assert_not_reached();
     }
-    return ret;
+    return true;
+gone:
+    /* The last child vanished while it was being handled. */
+    ctx->retval = ret;
+    tchild_table_free(ctx->children);
+    ctx->children = NULL;
+    return false;
 }
 
+bool trace_step(context_t *ctx, bool block)
+{
+    bool more;
+
+    more = trace_handle(ctx, block);
+    monitor_update(ctx);
+    return more;
+}
+
+int trace_loop(context_t *ctx)
+{
+    while (trace_step(ctx, true))
+        ;
+    return ctx->retval;
+}
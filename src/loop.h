@@ -20,8 +20,17 @@
 #ifndef SYDBOX_GUARD_LOOP_H
 #define SYDBOX_GUARD_LOOP_H 1
 
+#include <stdbool.h>
+
 #include "context.h"
 
+/* Handles the next event of the children traced by the calling thread,
+ * waiting for one if block is true.  Returns false once tracing is finished,
+ * ctx->retval is the return code then.  The counters of ctx are published
+ * to monitors after each step, see monitor.h.
+ */
+bool trace_step(context_t *ctx, bool block);
+
 int trace_loop(context_t *ctx);
 
 #endif // SYDBOX_GUARD_CONTEXT_H
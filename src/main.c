@@ -30,6 +30,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/socket.h>
 #include <sys/wait.h>
 
 #include <glib.h>
@@ -39,48 +40,36 @@
 #include "sydbox-utils.h"
 #include "sydbox-config.h"
 
-#include "dispatch.h"
-#include "loop.h"
-#include "path.h"
-#include "trace.h"
-#include "children.h"
-#include "syscall.h"
+#include "eventlog.h"
+#include "latency.h"
+#include "monitor.h"
+#include "profile.h"
+#include "replay.h"
+#include "serve.h"
+#include "session.h"
+#include "violation.h"
 #include "wrappers.h"
 
-/* pink floyd */
-#define PINK_FLOYD  "       ..uu.                               \n" \
-                    "       ?$\"\"`?i           z'              \n" \
-                    "       `M  .@\"          x\"               \n" \
-                    "       'Z :#\"  .   .    f 8M              \n" \
-                    "       '&H?`  :$f U8   <  MP   x#'         \n" \
-                    "       d#`    XM  $5.  $  M' xM\"          \n" \
-                    "     .!\">     @  'f`$L:M  R.@!`           \n" \
-                    "    +`  >     R  X  \"NXF  R\"*L           \n" \
-                    "        k    'f  M   \"$$ :E  5.           \n" \
-                    "        %%    `~  \"    `  'K  'M          \n" \
-                    "            .uH          'E   `h           \n" \
-                    "         .x*`             X     `          \n" \
-                    "      .uf`                *                \n" \
-                    "    .@8     .                              \n" \
-                    "   'E9F  uf\"          ,     ,             \n" \
-                    "     9h+\"   $M    eH. 8b. .8    .....     \n" \
-                    "    .8`     $'   M 'E  `R;'   d?\"\"\"`\"# \n" \
-                    "   ` E      @    b  d   9R    ?*     @     \n" \
-                    "     >      K.zM `%%M'   9'    Xf   .f     \n" \
-                    "    ;       R'          9     M  .=`       \n" \
-                    "    t                   M     Mx~          \n" \
-                    "    @                  lR    z\"           \n" \
-                    "    @                  `   ;\"             \n" \
-                    "                          `                \n"
-
-
-static context_t *ctx = NULL;
+static sydbox_session_t *session = NULL;
+static volatile sig_atomic_t serve_quit;
+static volatile sig_atomic_t caught_signal;
 
 static gint verbosity = -1;
 
 static gchar *logfile;
+static gchar *tracefile;
+static gchar *violationfile;
+static gchar *monitorfile;
+static gboolean profile;
+static gboolean profile_json;
+static gboolean latency;
 static gchar *config_file;
 static gchar *config_profile;
+static gchar *policy_file;
+static gchar *compile_policy;
+static gchar *serve_socket;
+static gchar *connect_socket;
+static gchar *replay_file;
 static gchar *sandbox_net_mode;
 
 static gboolean dump;
@@ -93,6 +82,8 @@ static gboolean colour;
 static gboolean version;
 static gboolean nowait;
 static gboolean nowrap_lstat;
+static gboolean lazy_cwd;
+static gboolean landlock;
 
 static GOptionEntry entries[] =
 {
@@ -102,12 +93,34 @@ static GOptionEntry entries[] =
         "Path to the configuration file", NULL },
     { "profile",                'p', 0, G_OPTION_ARG_STRING,                       &config_profile,
         "Profile name of the configuration file", NULL },
+    { "policy",                 'Y', 0, G_OPTION_ARG_FILENAME,                     &policy_file,
+        "Path to a compiled policy to load instead of the configuration file", NULL },
+    { "compile-policy",         'O', 0, G_OPTION_ARG_FILENAME,                     &compile_policy,
+        "Compile the configuration file into a policy and exit", "FILE" },
+    { "serve",                  'S', 0, G_OPTION_ARG_FILENAME,                     &serve_socket,
+        "Run sandboxed jobs sent by clients over the Unix socket", "SOCKET" },
+    { "connect",                'U', 0, G_OPTION_ARG_FILENAME,                     &connect_socket,
+        "Run the command as a job of the server listening on the Unix socket", "SOCKET" },
+    { "replay",                 'r', 0, G_OPTION_ARG_FILENAME,                     &replay_file,
+        "Decide the system calls of a trace file again under the configuration and print the differences", "TRACE" },
     { "dump",                   'D', 0, G_OPTION_ARG_NONE,                         &dump,
         "Dump configuration and exit",    NULL },
     { "log-level",              '0', 0, G_OPTION_ARG_INT,                          &verbosity,
         "Logging verbosity",              NULL },
     { "log-file",               'l', 0, G_OPTION_ARG_FILENAME,                     &logfile,
         "Path to the log file",           NULL },
+    { "trace-file",             'T', 0, G_OPTION_ARG_FILENAME,                     &tracefile,
+        "Path to the binary event trace file", NULL },
+    { "violation-file",         'v', 0, G_OPTION_ARG_FILENAME,                     &violationfile,
+        "Path to the file access violations are written to as JSON lines", NULL },
+    { "syscall-profile",        'f', 0, G_OPTION_ARG_NONE,                         &profile,
+        "Print per system call statistics at exit", NULL },
+    { "syscall-profile-json",   'J', 0, G_OPTION_ARG_NONE,                         &profile_json,
+        "Print per system call statistics at exit as JSON", NULL },
+    { "latency",                'H', 0, G_OPTION_ARG_NONE,                         &latency,
+        "Print latency histograms of stopped children at exit and on SIGUSR1", NULL },
+    { "monitor",                'm', 0, G_OPTION_ARG_FILENAME,                     &monitorfile,
+        "Publish live counters in the file for sydbox-top, e.g. /dev/shm/sydbox-PID", "FILE" },
     { "no-colour",              'C', 0, G_OPTION_ARG_NONE | G_OPTION_FLAG_REVERSE, &colour,
         "Disable colouring of messages",  NULL },
     { "lock",                   'L', 0, G_OPTION_ARG_NONE,                         &lock,
@@ -126,35 +139,63 @@ static GOptionEntry entries[] =
         "Finish tracing when eldest child exits", NULL},
     { "nowrap-lstat",           'W', 0, G_OPTION_ARG_NONE,                         &nowrap_lstat,
         "Disable wrapping of lstat() calls for too long paths", NULL},
+    { "lazy-cwd",               'K', 0, G_OPTION_ARG_NONE,                         &lazy_cwd,
+        "Read working directories of children only when they're needed", NULL},
+    { "landlock",               'A', 0, G_OPTION_ARG_NONE,                         &landlock,
+        "Deny writes outside write prefixes with Landlock as well, if magic commands are disallowed", NULL},
     { NULL, -1, 0, 0, NULL, NULL, NULL },
 };
 
 // Cleanup functions
 static void cleanup(void)
 {
-    dispatch_free();
-    syscall_free();
-    sydbox_config_rmfilter_all();
-    if (NULL != ctx) {
-        if (NULL != ctx->children)
-            g_hash_table_foreach(ctx->children, tchild_kill_one, NULL);
-        context_free(ctx);
-        ctx = NULL;
+    profile_report();
+    profile_free();
+    if (latency_enabled)
+        latency_dump();
+    if (NULL != session) {
+        sydbox_session_free(session);
+        session = NULL;
     }
+    sydbox_config_rmfilter_all();
+    eventlog_close();
+    violation_close();
+    monitor_close();
     sydbox_log_fini();
 }
 
-static void sig_cleanup(int signum)
+static void sig_reraise(int signum)
 {
     struct sigaction action;
-    g_fprintf(stderr, "Caught signal %d, exiting\n", signum);
-    cleanup();
     sigaction(signum, NULL, &action);
     action.sa_handler = SIG_DFL;
     sigaction(signum, &action, NULL);
     raise(signum);
 }
 
+/* The signal may interrupt the tracer while it holds the lock of the log
+ * ring, so the loop cleans up once waitpid() is interrupted.
+ */
+static void sig_quit(int signum)
+{
+    caught_signal = signum;
+}
+
+/* Crashes can't wait for the loop, the log ring is written out unlocked. */
+static void sig_cleanup(int signum)
+{
+    g_fprintf(stderr, "Caught signal %d, exiting\n", signum);
+    sydbox_log_abort();
+    cleanup();
+    sig_reraise(signum);
+}
+
+static void sig_latency(int signum G_GNUC_UNUSED)
+{
+    /* trace_step() dumps the histograms once waitpid() is interrupted */
+    latency_dump_requested = 1;
+}
+
 
 static gchar *get_username(void)
 {
@@ -186,135 +227,18 @@ static gchar *get_groupname (void)
     return g_strdup(grp->gr_name);
 }
 
-static void G_GNUC_NORETURN sydbox_execute_child(int argc G_GNUC_UNUSED, char **argv)
+/* Overrides the configuration with the environment and the command line. */
+static bool sydbox_config_override(void)
 {
-    if (trace_me() < 0) {
-        g_printerr("failed to set tracing: %s", g_strerror(errno));
-        _exit(-1);
-    }
-
-    /* stop and wait for the parent to resume us with trace_syscall */
-    if (kill(getpid(), SIGSTOP) < 0) {
-        g_printerr("failed to send SIGSTOP: %s", g_strerror(errno));
-        _exit(-1);
-    }
+    if (tracefile)
+        sydbox_config_set_trace_file(tracefile);
+    else if (g_getenv(ENV_TRACE))
+        sydbox_config_set_trace_file(g_getenv(ENV_TRACE));
 
-    if (strncmp(argv[0], "/bin/sh", 8) == 0)
-        g_fprintf(stderr, ANSI_DARK_MAGENTA PINK_FLOYD ANSI_NORMAL);
-
-    execvp(argv[0], argv);
-
-    g_printerr("execvp() failed: %s\n", g_strerror (errno));
-    _exit(-1);
-}
-
-static int sydbox_execute_parent(int argc G_GNUC_UNUSED, char **argv G_GNUC_UNUSED, pid_t pid)
-{
-    int status, retval;
-    struct sigaction new_action, old_action;
-    struct tchild *eldest;
-
-    new_action.sa_handler = sig_cleanup;
-    sigemptyset(&new_action.sa_mask);
-    new_action.sa_flags = 0;
-
-#define HANDLE_SIGNAL(sig)                          \
-    do {                                            \
-        sigaction ((sig), NULL, &old_action);       \
-        if (old_action.sa_handler != SIG_IGN)       \
-            sigaction ((sig), &new_action, NULL);   \
-    } while (0)
-
-    HANDLE_SIGNAL(SIGABRT);
-    HANDLE_SIGNAL(SIGSEGV);
-    HANDLE_SIGNAL(SIGINT);
-    HANDLE_SIGNAL(SIGTERM);
-
-#undef HANDLE_SIGNAL
-
-    /* wait for SIGSTOP */
-    wait (&status);
-    if (WIFEXITED (status)) {
-        g_critical("wtf? child died before sending SIGSTOP");
-        g_printerr("wtf? child died before sending SIGSTOP");
-        exit(WEXITSTATUS(status));
-    }
-    g_assert(WIFSTOPPED(status) && SIGSTOP == WSTOPSIG(status));
-
-    if (0 > trace_setup(pid)) {
-        g_critical("failed to setup tracing options: %s", g_strerror(errno));
-        g_printerr("failed to setup tracing options: %s", g_strerror(errno));
-        exit(-1);
-    }
-
-    tchild_new(ctx->children, pid);
-    ctx->eldest = pid;
-    eldest = tchild_find(ctx->children, pid);
-    eldest->personality = trace_personality(pid);
-    if (0 > eldest->personality) {
-        g_critical("failed to determine personality of eldest child %i: %s", eldest->pid, g_strerror(errno));
-        g_printerr("failed to determine personality of eldest child %i: %s", eldest->pid, g_strerror(errno));
-        exit(-1);
-    }
-    g_debug("eldest child %i runs in %s mode", eldest->pid, dispatch_mode(eldest->personality));
-    eldest->sandbox->path = sydbox_config_get_sandbox_path();
-    eldest->sandbox->exec = sydbox_config_get_sandbox_exec();
-    eldest->sandbox->network = sydbox_config_get_sandbox_network();
-    eldest->sandbox->network_mode = sydbox_config_get_network_mode();
-    eldest->sandbox->network_restrict_connect = sydbox_config_get_network_restrict_connect();
-    eldest->sandbox->lock = sydbox_config_get_disallow_magic_commands() ? LOCK_SET : LOCK_UNSET;
-    eldest->sandbox->write_prefixes = sydbox_config_get_write_prefixes();
-    eldest->sandbox->exec_prefixes = sydbox_config_get_exec_prefixes();
-    eldest->cwd = egetcwd();
-    if (NULL == eldest->cwd) {
-        g_critical("failed to get current working directory: %s", g_strerror(errno));
-        g_printerr("failed to get current working directory: %s", g_strerror(errno));
-        exit(-1);
-    }
-    eldest->flags &= ~TCHILD_NEEDINHERIT;
-
-    g_info ("child %i is ready to go, resuming", pid);
-    if (0 > trace_syscall(pid, 0)) {
-        trace_kill(pid);
-        g_critical("failed to resume eldest child %i: %s", pid, g_strerror(errno));
-        g_printerr("failed to resume eldest child %i: %s", pid, g_strerror(errno));
-        exit(-1);
-    }
-
-    g_info("entering loop");
-    retval = trace_loop (ctx);
-    g_info("exited loop with return value: %d", retval);
-
-    return retval;
-}
-
-static int sydbox_internal_main(int argc, char **argv)
-{
-    pid_t pid;
-
-    dispatch_init();
-    syscall_init();
-    ctx = context_new();
-
-    g_atexit(cleanup);
-
-    /*
-     * options are loaded from config file, updated from the environment, and
-     * then overridden by the user passed parameters.
-     */
-    if (!sydbox_config_load(config_file, config_profile))
-        return EXIT_FAILURE;
-
-    if (verbosity >= 0)
-        sydbox_config_set_verbosity(verbosity);
-
-    if (logfile)
-        sydbox_config_set_log_file(logfile);
-    else if (g_getenv(ENV_LOG))
-        sydbox_config_set_log_file(g_getenv(ENV_LOG));
-
-    /* initialize logging as early as possible */
-    sydbox_log_init();
+    if (violationfile)
+        sydbox_config_set_violation_file(violationfile);
+    else if (g_getenv(ENV_VIOLATIONS))
+        sydbox_config_set_violation_file(g_getenv(ENV_VIOLATIONS));
 
     sydbox_config_update_from_environment();
 
@@ -347,7 +271,7 @@ static int sydbox_internal_main(int argc, char **argv)
             sydbox_config_set_network_mode(SYDBOX_NETWORK_LOCAL);
         else {
             g_printerr("error: invalid mode for --network-mode `%s'\n", sandbox_net_mode);
-            return EXIT_FAILURE;
+            return false;
         }
     }
     else if (g_getenv(ENV_NET_MODE)) {
@@ -360,7 +284,7 @@ static int sydbox_internal_main(int argc, char **argv)
             sydbox_config_set_network_mode(SYDBOX_NETWORK_LOCAL);
         else {
             g_printerr("error: invalid value for "ENV_NET_MODE" `%s'\n", netdefault);
-            return EXIT_FAILURE;
+            return false;
         }
     }
 
@@ -384,10 +308,24 @@ static int sydbox_internal_main(int argc, char **argv)
     else if (g_getenv(ENV_NOWRAP_LSTAT))
         sydbox_config_set_wrap_lstat(false);
 
-    if (dump) {
-        sydbox_config_write_to_stderr();
-        return EXIT_SUCCESS;
-    }
+    if (lazy_cwd)
+        sydbox_config_set_lazy_cwd(true);
+    else if (g_getenv(ENV_LAZY_CWD))
+        sydbox_config_set_lazy_cwd(true);
+
+    if (landlock)
+        sydbox_config_set_landlock(true);
+    else if (g_getenv(ENV_LANDLOCK))
+        sydbox_config_set_landlock(true);
+
+    return true;
+}
+
+/* Runs the command given by argv under the sandbox */
+static int sydbox_run(int argc, char **argv)
+{
+    int retval;
+    struct sigaction new_action, old_action;
 
     if (sydbox_config_get_verbosity() > 1) {
         gchar *username = NULL, *groupname = NULL;
@@ -416,21 +354,307 @@ static int sydbox_internal_main(int argc, char **argv)
         g_string_free(command, TRUE);
     }
 
-    /* Set some environment variables so the children can check.
-     */
-    g_setenv("SYDBOX_ACTIVE", "1", 1);
-    g_setenv("SYDBOX_VERSION", VERSION, 1);
-    g_setenv("SYDBOX_GITHEAD", GIT_HEAD, 1);
+    if (profile_json)
+        profile_init(PROFILE_JSON);
+    else if (profile)
+        profile_init(PROFILE_TEXT);
+    if (latency)
+        latency_init();
+
+    if (NULL != sydbox_config_get_trace_file() && !eventlog_open(sydbox_config_get_trace_file())) {
+        g_printerr("failed to open trace file `%s': %s\n", sydbox_config_get_trace_file(), g_strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    if (NULL != monitorfile && !monitor_open(monitorfile)) {
+        g_printerr("failed to open monitor file `%s': %s\n", monitorfile, g_strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    if (NULL != sydbox_config_get_violation_file() && !violation_open(sydbox_config_get_violation_file())) {
+        g_printerr("failed to open violation file `%s': %s\n", sydbox_config_get_violation_file(),
+                g_strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    session = sydbox_session_new(NULL);
+    if (!sydbox_session_spawn(session, argv, NULL, NULL)) {
+        g_printerr("failed to execute `%s': %s\n", argv[0], g_strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    sigemptyset(&new_action.sa_mask);
+    new_action.sa_flags = 0;
+
+#define HANDLE_SIGNAL(sig, handler)                 \
+    do {                                            \
+        new_action.sa_handler = (handler);          \
+        sigaction ((sig), NULL, &old_action);       \
+        if (old_action.sa_handler != SIG_IGN)       \
+            sigaction ((sig), &new_action, NULL);   \
+    } while (0)
+
+    HANDLE_SIGNAL(SIGABRT, sig_cleanup);
+    HANDLE_SIGNAL(SIGSEGV, sig_cleanup);
+    /* no SA_RESTART, so that waitpid() is interrupted */
+    HANDLE_SIGNAL(SIGINT, sig_quit);
+    HANDLE_SIGNAL(SIGTERM, sig_quit);
+
+#undef HANDLE_SIGNAL
+
+    if (latency_enabled) {
+        /* no SA_RESTART, so that the dump isn't delayed until the next event */
+        new_action.sa_handler = sig_latency;
+        sigaction(SIGUSR1, &new_action, NULL);
+    }
+
+    g_info("entering loop");
+    while (!caught_signal && sydbox_session_step(session, true))
+        ;
+    if (caught_signal) {
+        g_fprintf(stderr, "Caught signal %d, exiting\n", caught_signal);
+        cleanup();
+        sig_reraise(caught_signal);
+    }
+    retval = sydbox_session_get_exit_code(session);
+    g_info("exited loop with return value: %d", retval);
+
+    return retval;
+}
+
+static void sig_serve_quit(int signum G_GNUC_UNUSED)
+{
+    serve_quit = 1;
+}
+
+/* Jobs run at the same time, so each writes its trace, access violations and
+ * counters to files of its own, suffixed with the process ID of the job.
+ */
+static void sydbox_serve_job_files(void)
+{
+    pid_t pid = getpid();
+    gchar *path;
+
+    if (NULL != sydbox_config_get_trace_file()) {
+        path = g_strdup_printf("%s.%i", sydbox_config_get_trace_file(), pid);
+        sydbox_config_set_trace_file(path);
+        g_free(path);
+    }
+    if (NULL != sydbox_config_get_violation_file()) {
+        path = g_strdup_printf("%s.%i", sydbox_config_get_violation_file(), pid);
+        sydbox_config_set_violation_file(path);
+        g_free(path);
+    }
+    if (NULL != monitorfile) {
+        path = g_strdup_printf("%s.%i", monitorfile, pid);
+        g_free(monitorfile);
+        monitorfile = path;
+    }
+}
+
+/* Runs a job sent by a client, in a process forked off the server. */
+static int sydbox_serve_job(int fd)
+{
+    struct serve_job job;
+    struct sigaction action;
+    int retval;
 
-    if ((pid = fork()) < 0) {
-        g_printerr("failed to fork: %s", g_strerror(errno));
+    action.sa_handler = SIG_DFL;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = 0;
+    sigaction(SIGCHLD, &action, NULL);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    if (!serve_job_receive(fd, &job)) {
+        g_warning("failed to receive job: %s", g_strerror(errno));
+        return EXIT_FAILURE;
+    }
+    g_info("received job `%s' in `%s'", job.argv[0], job.cwd);
+
+    /* The job and the access violations it causes write to the client. */
+    for (int i = 0; i < 3; i++) {
+        if (0 > dup2(job.fds[i], i)) {
+            g_warning("failed to take over descriptor %d of the client: %s", i, g_strerror(errno));
+            serve_status_send(fd, EXIT_FAILURE);
+            serve_job_free(&job);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (0 > chdir(job.cwd)) {
+        g_printerr("failed to change directory to `%s': %s\n", job.cwd, g_strerror(errno));
+        serve_status_send(fd, EXIT_FAILURE);
+        serve_job_free(&job);
         return EXIT_FAILURE;
     }
 
-    if (pid == 0)
-        sydbox_execute_child(argc, argv);
+    /* The environment of the job overrides the configuration like the
+     * environment of sydbox does.
+     */
+    clearenv();
+    for (unsigned int i = 0; NULL != job.envp[i]; i++)
+        putenv(g_strdup(job.envp[i]));
+
+    if (sydbox_config_override()) {
+        sydbox_serve_job_files();
+        retval = sydbox_run(job.argc, job.argv);
+    }
     else
-        return sydbox_execute_parent(argc, argv, pid);
+        retval = EXIT_FAILURE;
+
+    serve_status_send(fd, retval);
+    serve_job_free(&job);
+    return retval;
+}
+
+/* Loads the configuration once and runs jobs sent by clients on socket_path,
+ * each in a process forked off the server.
+ */
+static int sydbox_serve(const gchar *socket_path)
+{
+    int lfd, fd;
+    pid_t pid;
+    struct sigaction action;
+
+    lfd = serve_listen(socket_path);
+    if (0 > lfd) {
+        g_critical("failed to listen on `%s': %s", socket_path, g_strerror(errno));
+        g_printerr("failed to listen on `%s': %s\n", socket_path, g_strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    /* Let the kernel reap finished jobs, no SA_RESTART so that accept() is
+     * interrupted when the server is asked to stop.
+     */
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = 0;
+    action.sa_handler = SIG_IGN;
+    sigaction(SIGCHLD, &action, NULL);
+    action.sa_handler = sig_serve_quit;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    g_info("serving on `%s'", socket_path);
+    while (!serve_quit) {
+        fd = accept4(lfd, NULL, NULL, SOCK_CLOEXEC);
+        if (0 > fd) {
+            if (EINTR == errno || ECONNABORTED == errno)
+                continue;
+            g_critical("failed to accept connection: %s", g_strerror(errno));
+            break;
+        }
+
+        /* the job must not inherit unwritten log records */
+        sydbox_log_flush();
+        pid = fork();
+        if (0 > pid)
+            g_warning("failed to fork for job: %s", g_strerror(errno));
+        else if (0 == pid) {
+            close(lfd);
+            exit(sydbox_serve_job(fd));
+        }
+        close(fd);
+    }
+
+    close(lfd);
+    unlink(socket_path);
+    g_info("stopped serving on `%s'", socket_path);
+    return EXIT_SUCCESS;
+}
+
+/* Sends the command to the server listening on socket_path and waits for it */
+static int sydbox_connect(const gchar *socket_path, char **argv)
+{
+    int fd, status;
+    gchar *cwd;
+
+    fd = serve_connect(socket_path);
+    if (0 > fd) {
+        g_printerr("failed to connect to `%s': %s\n", socket_path, g_strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    cwd = g_get_current_dir();
+    if (!serve_job_send(fd, argv, environ, cwd)) {
+        g_printerr("failed to send job to `%s': %s\n", socket_path, g_strerror(errno));
+        g_free(cwd);
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    g_free(cwd);
+
+    if (!serve_status_receive(fd, &status)) {
+        g_printerr("server at `%s' didn't report the exit status of the job\n", socket_path);
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    close(fd);
+    return status;
+}
+
+/* Replays the trace against the configuration, exits like diff(1): 0 if no
+ * decision changed, 1 if some did and 2 if the trace can't be read.
+ */
+static int sydbox_replay(const gchar *trace_path)
+{
+    struct replay_stats stats;
+
+    if (!replay_run(trace_path, stdout, &stats))
+        return 2;
+    return (0 == stats.denied && 0 == stats.allowed && 0 == stats.filtered) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int sydbox_internal_main(int argc, char **argv)
+{
+    gchar *policy_source = NULL;
+
+    g_atexit(cleanup);
+
+    /*
+     * options are loaded from config file, updated from the environment, and
+     * then overridden by the user passed parameters.
+     */
+    if (NULL == policy_file && NULL != g_getenv(ENV_POLICY))
+        policy_file = g_strdup(g_getenv(ENV_POLICY));
+    if (NULL != compile_policy || NULL == policy_file
+            || !sydbox_config_load_compiled(policy_file, &policy_source)) {
+        /* A stale policy falls back to the file it was compiled from */
+        bool loaded = sydbox_config_load(NULL != policy_source ? policy_source : config_file, config_profile);
+        g_free(policy_source);
+        if (!loaded)
+            return EXIT_FAILURE;
+    }
+
+    if (NULL != compile_policy)
+        return sydbox_config_compile(compile_policy) ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    if (verbosity >= 0)
+        sydbox_config_set_verbosity(verbosity);
+
+    if (logfile)
+        sydbox_config_set_log_file(logfile);
+    else if (g_getenv(ENV_LOG))
+        sydbox_config_set_log_file(g_getenv(ENV_LOG));
+
+    /* initialize logging as early as possible */
+    sydbox_log_init();
+
+    if (!sydbox_config_override())
+        return EXIT_FAILURE;
+
+    if (dump) {
+        sydbox_config_write_to_stderr();
+        return EXIT_SUCCESS;
+    }
+
+    if (NULL != serve_socket)
+        return sydbox_serve(serve_socket);
+
+    if (NULL != replay_file)
+        return sydbox_replay(replay_file);
+
+    return sydbox_run(argc, argv);
 }
 
 int main(int argc, char **argv)
@@ -455,7 +679,7 @@ int main(int argc, char **argv)
         return EXIT_SUCCESS;
     }
 
-    if (!dump) {
+    if (!dump && NULL == compile_policy && NULL == serve_socket && NULL == replay_file) {
         argc--;
         argv++;
 
@@ -470,6 +694,9 @@ int main(int argc, char **argv)
         }
     }
 
+    if (NULL != connect_socket)
+        return sydbox_connect(connect_socket, argv);
+
     return sydbox_internal_main(argc, argv);
 }
 
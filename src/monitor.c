@@ -0,0 +1,163 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <glib.h>
+
+#include "children.h"
+#include "context.h"
+#include "monitor.h"
+#include "trace.h"
+#include "verdict.h"
+
+bool monitor_enabled = false;
+
+static struct monitor_segment *segment;
+static gchar *segment_path;
+static guint64 start_ns;
+static guint steps;
+
+static inline guint64 monitor_clock(clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return (guint64) ts.tv_sec * G_GUINT64_CONSTANT(1000000000) + ts.tv_nsec;
+}
+
+static inline void monitor_write_begin(void)
+{
+    ++segment->sequence;
+    __sync_synchronize();
+}
+
+static inline void monitor_write_end(void)
+{
+    __sync_synchronize();
+    ++segment->sequence;
+}
+
+/* Samples the CPU time, reading it is a system call unlike the wall clock. */
+static void monitor_sample_cpu(void)
+{
+    segment->counters.cpu_ns = monitor_clock(CLOCK_PROCESS_CPUTIME_ID);
+    segment->counters.wall_ns = monitor_clock(CLOCK_MONOTONIC) - start_ns;
+}
+
+bool monitor_open(const gchar *path)
+{
+    int fd, save_errno;
+    void *map;
+
+    g_assert(NULL == segment);
+
+    /* The file usually lives in a world writable directory.  A file left
+     * over by an earlier run is replaced, anything which can't be removed,
+     * like a symbolic link somebody else planted, makes this fail rather
+     * than be followed. */
+    if (0 > unlink(path) && ENOENT != errno)
+        g_debug("failed to remove `%s': %s", path, g_strerror(errno));
+    fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0644);
+    if (0 > fd)
+        return false;
+    if (0 > ftruncate(fd, sizeof(struct monitor_segment))) {
+        save_errno = errno;
+        close(fd);
+        unlink(path);
+        errno = save_errno;
+        return false;
+    }
+    map = mmap(NULL, sizeof(struct monitor_segment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    save_errno = errno;
+    close(fd);
+    if (MAP_FAILED == map) {
+        unlink(path);
+        errno = save_errno;
+        return false;
+    }
+
+    segment = map;
+    segment_path = g_strdup(path);
+    start_ns = monitor_clock(CLOCK_MONOTONIC);
+    steps = 0;
+
+    /* The file is zeroed, the magic goes last so readers don't take it up
+     * half written. */
+    segment->version = MONITOR_VERSION;
+    segment->size = sizeof(struct monitor_segment);
+    segment->pid = getpid();
+    segment->running = 1;
+    __sync_synchronize();
+    memcpy(segment->magic, MONITOR_MAGIC, MONITOR_MAGIC_LEN);
+    monitor_enabled = true;
+    return true;
+}
+
+void monitor_close(void)
+{
+    if (NULL == segment)
+        return;
+
+    monitor_write_begin();
+    monitor_sample_cpu();
+    segment->running = 0;
+    monitor_write_end();
+
+    monitor_enabled = false;
+    munmap(segment, sizeof(struct monitor_segment));
+    segment = NULL;
+    unlink(segment_path);
+    g_free(segment_path);
+    segment_path = NULL;
+}
+
+void monitor_publish(const context_t *ctx)
+{
+    struct verdict_cache_stats verdicts;
+    struct monitor_counters *counters = &segment->counters;
+
+    verdict_cache_get_stats(ctx->verdicts, &verdicts);
+
+    monitor_write_begin();
+    counters->children = (NULL != ctx->children) ? tchild_table_size(ctx->children) : 0;
+    counters->events = ctx->stats.events;
+    memcpy(counters->stops, ctx->stats.stops, sizeof(counters->stops));
+    counters->syscalls = ctx->stats.syscalls;
+    counters->checks = ctx->stats.checks;
+    counters->denied = ctx->stats.denied;
+    counters->cache_hits = verdicts.hits;
+    counters->cache_misses = verdicts.misses;
+    counters->exec_hits = verdicts.exec_hits;
+    counters->exec_misses = verdicts.exec_misses;
+    counters->ptrace_calls = trace_ptrace_calls;
+    if (0 == steps++ % MONITOR_CPU_INTERVAL)
+        monitor_sample_cpu();
+    monitor_write_end();
+}
@@ -0,0 +1,145 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SYDBOX_GUARD_MONITOR_H
+#define SYDBOX_GUARD_MONITOR_H 1
+
+#include <stdbool.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include <glib.h>
+
+#include "context.h"
+#include "trace.h"
+
+/* Live counters of the trace loop in a file, /dev/shm/sydbox-PID usually,
+ * which monitors map read only, see sydbox-top.  The counters are written
+ * after every step of the trace loop under a sequence number which is odd
+ * while they're being written, so readers retry instead of locking.  Only
+ * one session publishes, the one of the sydbox command.
+ */
+#define MONITOR_MAGIC           "SYDSTATS"
+#define MONITOR_MAGIC_LEN       8
+#define MONITOR_VERSION         1
+
+/* The CPU time of sydbox is sampled every this many steps */
+#define MONITOR_CPU_INTERVAL    64
+
+#define MONITOR_EVENTS          (E_UNKNOWN + 1)
+
+struct monitor_counters
+{
+    guint64 children;                   // Children traced now.
+    guint64 events;                     // Stops waited for.
+    guint64 stops[MONITOR_EVENTS];      // Stops by E_* event.
+    guint64 syscalls;                   // System calls children entered.
+    guint64 checks;                     // System calls checked for access.
+    guint64 denied;                     // System calls denied.
+    guint64 cache_hits;                 // Lookups of the verdict cache, see verdict.h.
+    guint64 cache_misses;
+    guint64 exec_hits;
+    guint64 exec_misses;
+    guint64 ptrace_calls;               // ptrace() calls of sydbox.
+    guint64 cpu_ns;                     // CPU time of sydbox, sampled.
+    guint64 wall_ns;                    // Time since the file was opened, when cpu_ns was sampled.
+};
+
+struct monitor_segment
+{
+    char magic[MONITOR_MAGIC_LEN];
+    guint32 version;
+    guint32 size;                       // sizeof(struct monitor_segment)
+    gint32 pid;                         // Process ID of sydbox.
+    guint32 running;                    // Cleared when sydbox exits.
+    guint64 sequence;                   // Odd while the counters are written.
+    struct monitor_counters counters;
+};
+
+extern bool monitor_enabled;
+
+/**
+ * monitor_read:
+ * @segment: the mapped file
+ * @counters: location to store a consistent copy of the counters
+ *
+ * Returns: true on success, false if the counters were being written each
+ * time they were read, as when sydbox died while writing them
+ *
+ * Since: 0.2_alpha4
+ **/
+static inline bool monitor_read(const struct monitor_segment *segment, struct monitor_counters *counters)
+{
+    const volatile guint64 *sequence = &segment->sequence;
+
+    for (unsigned int i = 0; i < 1000; i++) {
+        guint64 before = *sequence;
+
+        __sync_synchronize();
+        if (before & 1)
+            continue;
+        memcpy(counters, &segment->counters, sizeof(struct monitor_counters));
+        __sync_synchronize();
+        if (before == *sequence)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * monitor_open:
+ * @path: path of the file
+ *
+ * Creates the file, maps it and enables publishing of the counters.  An
+ * existing file is removed first and the file is created exclusively, so
+ * symbolic links aren't followed.
+ *
+ * Returns: true on success, false on failure and sets errno accordingly
+ *
+ * Since: 0.2_alpha4
+ **/
+bool monitor_open(const gchar *path);
+
+/**
+ * monitor_close:
+ *
+ * Marks sydbox as exited and removes the file, monitors which have it mapped
+ * keep the last counters.
+ *
+ * Since: 0.2_alpha4
+ **/
+void monitor_close(void);
+
+/**
+ * monitor_publish:
+ * @ctx: the context of the trace loop
+ *
+ * Writes the counters of @ctx to the file.
+ *
+ * Since: 0.2_alpha4
+ **/
+void monitor_publish(const context_t *ctx);
+
+static inline void monitor_update(const context_t *ctx)
+{
+    if (G_UNLIKELY(monitor_enabled))
+        monitor_publish(ctx);
+}
+
+#endif // SYDBOX_GUARD_MONITOR_H
@@ -86,6 +86,24 @@ int netlist_new_from_string(GSList **netlist, const gchar *addr_str, bool canlog
     return -1;
 }
 
+bool netlist_check(GSList *netlist, int family, int port, const char *addr)
+{
+    GSList *walk;
+    struct sydbox_addr *saddr;
+
+    for (walk = netlist; NULL != walk; walk = g_slist_next(walk)) {
+        saddr = (struct sydbox_addr *) walk->data;
+        g_debug("Checking whitelisted address {family=%d addr=%s port=%d} for equality",
+                saddr->family, saddr->addr, saddr->port);
+        if (family == saddr->family && port == saddr->port &&
+                0 == strncmp(addr, saddr->addr, strlen(saddr->addr) + 1)) {
+            g_debug("Whitelisted connection {family:%d addr:%s port:%d}", saddr->family, saddr->addr, saddr->port);
+            return true;
+        }
+    }
+    return false;
+}
+
 static void netlist_free_one(struct sydbox_addr *saddr, void *userdata G_GNUC_UNUSED)
 {
     g_free(saddr->addr);
@@ -36,6 +36,8 @@ void netlist_new(GSList **netlist, int family, int port, const char *addr);
 
 int netlist_new_from_string(GSList **netlist, const gchar *addr, bool canlog);
 
+bool netlist_check(GSList *netlist, int family, int port, const char *addr);
+
 void netlist_free(GSList **netlist);
 
 #endif // SYDBOX_GUARD_NET_H
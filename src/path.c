@@ -25,6 +25,7 @@
 #include <glib.h>
 
 #include "path.h"
+#include "probes.h"
 #include "sydbox-log.h"
 #include "sydbox-utils.h"
 
@@ -59,134 +60,244 @@ inline bool path_magic_dir(const char *path)
     return (0 == strncmp(path, CMD_PATH, CMD_PATH_LEN - 1));
 }
 
+struct magic_node
+{
+    char c;
+    enum magic_command command;     // Command whose name ends here.
+    struct magic_node *child;
+    struct magic_node *sibling;
+};
+
+static const struct
+{
+    const char *name;
+    enum magic_command command;
+} magic_commands[] = {
+    { CMD_ON, MAGIC_CMD_ON },
+    { CMD_OFF, MAGIC_CMD_OFF },
+    { CMD_TOGGLE, MAGIC_CMD_TOGGLE },
+    { CMD_ENABLED, MAGIC_CMD_ENABLED },
+    { CMD_LOCK, MAGIC_CMD_LOCK },
+    { CMD_EXEC_LOCK, MAGIC_CMD_EXEC_LOCK },
+    { CMD_WAIT_ALL, MAGIC_CMD_WAIT_ALL },
+    { CMD_WAIT_ELDEST, MAGIC_CMD_WAIT_ELDEST },
+    { CMD_WRAP_LSTAT, MAGIC_CMD_WRAP_LSTAT },
+    { CMD_NOWRAP_LSTAT, MAGIC_CMD_NOWRAP_LSTAT },
+    { CMD_WRITE, MAGIC_CMD_WRITE },
+    { CMD_RMWRITE, MAGIC_CMD_RMWRITE },
+    { CMD_SANDBOX_EXEC, MAGIC_CMD_SANDBOX_EXEC },
+    { CMD_SANDUNBOX_EXEC, MAGIC_CMD_SANDUNBOX_EXEC },
+    { CMD_ADDEXEC, MAGIC_CMD_ADDEXEC },
+    { CMD_RMEXEC, MAGIC_CMD_RMEXEC },
+    { CMD_SANDBOX_NET, MAGIC_CMD_SANDBOX_NET },
+    { CMD_SANDUNBOX_NET, MAGIC_CMD_SANDUNBOX_NET },
+    { CMD_ADDFILTER, MAGIC_CMD_ADDFILTER },
+    { CMD_RMFILTER, MAGIC_CMD_RMFILTER },
+    { CMD_NET_ALLOW, MAGIC_CMD_NET_ALLOW },
+    { CMD_NET_DENY, MAGIC_CMD_NET_DENY },
+    { CMD_NET_LOCAL, MAGIC_CMD_NET_LOCAL },
+    { CMD_NET_RESTRICT_CONNECT, MAGIC_CMD_NET_RESTRICT_CONNECT },
+    { CMD_NET_UNRESTRICT_CONNECT, MAGIC_CMD_NET_UNRESTRICT_CONNECT },
+    { CMD_NET_WHITELIST, MAGIC_CMD_NET_WHITELIST },
+    { CMD_BATCH, MAGIC_CMD_BATCH },
+};
+
+static struct magic_node *magic_trie;
+static gsize magic_trie_built;
+
+static struct magic_node *magic_trie_build(void)
+{
+    const char *name;
+    struct magic_node *root, *node, **next;
+
+    root = g_new0(struct magic_node, 1);
+    for (unsigned int i = 0; i < G_N_ELEMENTS(magic_commands); i++) {
+        node = root;
+        for (name = magic_commands[i].name + CMD_PATH_LEN; '\0' != *name; name++) {
+            for (next = &(node->child); NULL != *next && (*next)->c != *name; next = &((*next)->sibling))
+                ;
+            if (NULL == *next) {
+                *next = g_new0(struct magic_node, 1);
+                (*next)->c = *name;
+            }
+            node = *next;
+        }
+        node->command = magic_commands[i].command;
+    }
+    return root;
+}
+
+enum magic_command path_magic_lookup(const char *path, const char **param)
+{
+    const struct magic_node *node, *child;
+
+    if (g_once_init_enter(&magic_trie_built)) {
+        magic_trie = magic_trie_build();
+        g_once_init_leave(&magic_trie_built, 1);
+    }
+
+    if (0 != strncmp(path, CMD_PATH, CMD_PATH_LEN))
+        return MAGIC_CMD_NONE;
+
+    node = magic_trie;
+    for (path += CMD_PATH_LEN; '\0' != *path; path++) {
+        for (child = node->child; NULL != child && child->c != *path; child = child->sibling)
+            ;
+        if (NULL == child)
+            return MAGIC_CMD_NONE;
+        node = child;
+        /* No name of a command taking a parameter is the prefix of another. */
+        if ('/' == node->c && MAGIC_CMD_NONE != node->command) {
+            if (NULL != param)
+                *param = path + 1;
+            return node->command;
+        }
+    }
+    if (NULL != param)
+        *param = path;
+    return node->command;
+}
+
 inline bool path_magic_on(const char *path)
 {
-    return (0 == strncmp(path, CMD_ON, CMD_ON_LEN));
+    return (MAGIC_CMD_ON == path_magic_lookup(path, NULL));
 }
 
 inline bool path_magic_off(const char *path)
 {
-    return  (0 == strncmp(path, CMD_OFF, CMD_OFF_LEN));
+    return (MAGIC_CMD_OFF == path_magic_lookup(path, NULL));
 }
 
 inline bool path_magic_toggle(const char *path)
 {
-    return (0 == strncmp(path, CMD_TOGGLE, CMD_TOGGLE_LEN));
+    return (MAGIC_CMD_TOGGLE == path_magic_lookup(path, NULL));
 }
 
 inline bool path_magic_enabled(const char *path)
 {
-    return (0 == strncmp(path, CMD_ENABLED, CMD_ENABLED_LEN));
+    return (MAGIC_CMD_ENABLED == path_magic_lookup(path, NULL));
 }
 
 inline bool path_magic_lock(const char *path)
 {
-    return (0 == strncmp(path, CMD_LOCK, CMD_LOCK_LEN));
+    return (MAGIC_CMD_LOCK == path_magic_lookup(path, NULL));
 }
 
 inline bool path_magic_exec_lock(const char *path)
 {
-    return (0 == strncmp(path, CMD_EXEC_LOCK, CMD_EXEC_LOCK_LEN));
+    return (MAGIC_CMD_EXEC_LOCK == path_magic_lookup(path, NULL));
 }
 
 inline bool path_magic_wait_all(const char *path)
 {
-    return (0 == strncmp(path, CMD_WAIT_ALL, CMD_WAIT_ALL_LEN));
+    return (MAGIC_CMD_WAIT_ALL == path_magic_lookup(path, NULL));
 }
 
 inline bool path_magic_wait_eldest(const char *path)
 {
-    return (0 == strncmp(path, CMD_WAIT_ELDEST, CMD_WAIT_ELDEST_LEN));
+    return (MAGIC_CMD_WAIT_ELDEST == path_magic_lookup(path, NULL));
 }
 
 inline bool path_magic_wrap_lstat(const char *path)
 {
-    return (0 == strncmp(path, CMD_WRAP_LSTAT, CMD_WRAP_LSTAT_LEN));
+    return (MAGIC_CMD_WRAP_LSTAT == path_magic_lookup(path, NULL));
 }
 
 inline bool path_magic_nowrap_lstat(const char *path)
 {
-    return (0 == strncmp(path, CMD_NOWRAP_LSTAT, CMD_NOWRAP_LSTAT_LEN));
+    return (MAGIC_CMD_NOWRAP_LSTAT == path_magic_lookup(path, NULL));
 }
 
 inline bool path_magic_write(const char *path)
 {
-    return (0 == strncmp(path, CMD_WRITE, CMD_WRITE_LEN));
+    return (MAGIC_CMD_WRITE == path_magic_lookup(path, NULL));
 }
 
 inline bool path_magic_rmwrite(const char *path)
 {
-    return (0 == strncmp(path, CMD_RMWRITE, CMD_RMWRITE_LEN));
+    return (MAGIC_CMD_RMWRITE == path_magic_lookup(path, NULL));
 }
 
 inline bool path_magic_sandbox_exec(const char *path)
 {
-    return (0 == strncmp(path, CMD_SANDBOX_EXEC, CMD_SANDBOX_EXEC_LEN));
+    return (MAGIC_CMD_SANDBOX_EXEC == path_magic_lookup(path, NULL));
 }
 
 inline bool path_magic_sandunbox_exec(const char *path)
 {
-    return (0 == strncmp(path, CMD_SANDUNBOX_EXEC, CMD_SANDUNBOX_EXEC_LEN));
+    return (MAGIC_CMD_SANDUNBOX_EXEC == path_magic_lookup(path, NULL));
 }
 
 inline bool path_magic_addexec(const char *path)
 {
-    return (0 == strncmp(path, CMD_ADDEXEC, CMD_ADDEXEC_LEN));
+    return (MAGIC_CMD_ADDEXEC == path_magic_lookup(path, NULL));
 }
 
 inline bool path_magic_rmexec(const char *path)
 {
-    return (0 == strncmp(path, CMD_RMEXEC, CMD_RMEXEC_LEN));
+    return (MAGIC_CMD_RMEXEC == path_magic_lookup(path, NULL));
 }
 
 inline bool path_magic_sandbox_net(const char *path)
 {
-    return (0 == strncmp(path, CMD_SANDBOX_NET, CMD_SANDBOX_NET_LEN));
+    return (MAGIC_CMD_SANDBOX_NET == path_magic_lookup(path, NULL));
 }
 
 inline bool path_magic_sandunbox_net(const char *path)
 {
-    return (0 == strncmp(path, CMD_SANDUNBOX_NET, CMD_SANDUNBOX_NET_LEN));
+    return (MAGIC_CMD_SANDUNBOX_NET == path_magic_lookup(path, NULL));
 }
 
 inline bool path_magic_addfilter(const char *path)
 {
-    return (0 == strncmp(path, CMD_ADDFILTER, CMD_ADDFILTER_LEN));
+    return (MAGIC_CMD_ADDFILTER == path_magic_lookup(path, NULL));
 }
 
 inline bool path_magic_rmfilter(const char *path)
 {
-    return (0 == strncmp(path, CMD_RMFILTER, CMD_RMFILTER_LEN));
+    return (MAGIC_CMD_RMFILTER == path_magic_lookup(path, NULL));
 }
 
 inline bool path_magic_net_allow(const char *path)
 {
-    return (0 == strncmp(path, CMD_NET_ALLOW, CMD_NET_ALLOW_LEN));
+    return (MAGIC_CMD_NET_ALLOW == path_magic_lookup(path, NULL));
 }
 
 inline bool path_magic_net_deny(const char *path)
 {
-    return (0 == strncmp(path, CMD_NET_DENY, CMD_NET_DENY_LEN));
+    return (MAGIC_CMD_NET_DENY == path_magic_lookup(path, NULL));
 }
 
 inline bool path_magic_net_local(const char *path)
 {
-    return (0 == strncmp(path, CMD_NET_LOCAL, CMD_NET_LOCAL_LEN));
+    return (MAGIC_CMD_NET_LOCAL == path_magic_lookup(path, NULL));
 }
 
 inline bool path_magic_net_restrict_connect(const char *path)
 {
-    return (0 == strncmp(path, CMD_NET_RESTRICT_CONNECT, CMD_NET_RESTRICT_CONNECT_LEN));
+    return (MAGIC_CMD_NET_RESTRICT_CONNECT == path_magic_lookup(path, NULL));
 }
 
 inline bool path_magic_net_unrestrict_connect(const char *path)
 {
-    return (0 == strncmp(path, CMD_NET_UNRESTRICT_CONNECT, CMD_NET_UNRESTRICT_CONNECT_LEN));
+    return (MAGIC_CMD_NET_UNRESTRICT_CONNECT == path_magic_lookup(path, NULL));
 }
 
 inline bool path_magic_net_whitelist(const char *path)
 {
-    return (0 == strncmp(path, CMD_NET_WHITELIST, CMD_NET_WHITELIST_LEN));
+    return (MAGIC_CMD_NET_WHITELIST == path_magic_lookup(path, NULL));
+}
+
+inline bool path_magic_batch(const char *path)
+{
+    return (MAGIC_CMD_BATCH == path_magic_lookup(path, NULL));
+}
+
+bool path_magic_command(const char *path)
+{
+    enum magic_command command = path_magic_lookup(path, NULL);
+
+    return MAGIC_CMD_NONE != command && MAGIC_CMD_ENABLED != command && MAGIC_CMD_BATCH != command;
 }
 
 int pathnode_new(GSList **pathlist, const char *path, int sanitize)
@@ -244,6 +355,60 @@ int pathnode_new_early(GSList **pathlist, const char *path, int sanitize)
     return 0;
 }
 
+static void expand_input_add(GSList **names, const char *name, gsize len)
+{
+    for (GSList *walk = *names; NULL != walk; walk = g_slist_next(walk)) {
+        if (0 == strncmp(walk->data, name, len) && '\0' == ((char *) walk->data)[len])
+            return;
+    }
+    *names = g_slist_append(*names, g_strndup(name, len));
+}
+
+bool pathnode_expand_inputs(const char *path, GSList **names)
+{
+    const char *name;
+    gsize len;
+
+    for (const char *p = path; '\0' != *p; p++) {
+        switch (*p) {
+            case '`':
+            case '*':
+            case '?':
+            case '[':
+                /* Command substitutions and patterns */
+                return false;
+            case '~':
+                /* A tilde is only expanded at the start of a word. */
+                if (p != path && !g_ascii_isspace(p[-1]))
+                    break;
+                if ('\0' != p[1] && '/' != p[1] && !g_ascii_isspace(p[1]))
+                    return false;
+                expand_input_add(names, "HOME", 4);
+                break;
+            case '$':
+                name = ('{' == p[1]) ? p + 2 : p + 1;
+                if (!g_ascii_isalpha(*name) && '_' != *name) {
+                    /* Special parameters, command and arithmetic
+                     * substitutions; a lone $ is kept as it is. */
+                    if (name != p + 1 || ('\0' != *name && NULL != strchr("(0123456789?!#@*-$", *name)))
+                        return false;
+                    break;
+                }
+                for (len = 1; g_ascii_isalnum(name[len]) || '_' == name[len]; len++)
+                    ;
+                /* Parameter expansions with operators, like ${VAR:-x} */
+                if (name != p + 1 && '}' != name[len])
+                    return false;
+                expand_input_add(names, name, len);
+                p = name + len - 1;
+                break;
+            default:
+                break;
+        }
+    }
+    return true;
+}
+
 void pathnode_free(GSList **pathlist)
 {
     g_slist_foreach(*pathlist, (GFunc) g_free, NULL);
@@ -339,6 +504,7 @@ int pathlist_check(GSList *pathlist, const char *path_sanitized)
         g_debug("path list check succeeded for `%s'", path_sanitized);
     else
         g_debug("path list check failed for `%s'", path_sanitized);
+    SYDBOX_PROBE2(pathlist__check, path_sanitized, ret);
     return ret;
 }
 
@@ -79,6 +79,60 @@
 #define CMD_NET_UNRESTRICT_CONNECT_LEN  (CMD_PATH_LEN + 23)
 #define CMD_NET_WHITELIST               CMD_PATH"net/whitelist/"
 #define CMD_NET_WHITELIST_LEN           (CMD_PATH_LEN + 14)
+#define CMD_BATCH                       CMD_PATH"batch/"
+#define CMD_BATCH_LEN                   (CMD_PATH_LEN + 6)
+#define CMD_BATCH_SEP                   ";"
+
+/* Magic commands, commands whose name ends with a slash take the rest of the
+ * path as their parameter. */
+enum magic_command
+{
+    MAGIC_CMD_NONE = 0,
+    MAGIC_CMD_ON,
+    MAGIC_CMD_OFF,
+    MAGIC_CMD_TOGGLE,
+    MAGIC_CMD_ENABLED,
+    MAGIC_CMD_LOCK,
+    MAGIC_CMD_EXEC_LOCK,
+    MAGIC_CMD_WAIT_ALL,
+    MAGIC_CMD_WAIT_ELDEST,
+    MAGIC_CMD_WRAP_LSTAT,
+    MAGIC_CMD_NOWRAP_LSTAT,
+    MAGIC_CMD_WRITE,
+    MAGIC_CMD_RMWRITE,
+    MAGIC_CMD_SANDBOX_EXEC,
+    MAGIC_CMD_SANDUNBOX_EXEC,
+    MAGIC_CMD_ADDEXEC,
+    MAGIC_CMD_RMEXEC,
+    MAGIC_CMD_SANDBOX_NET,
+    MAGIC_CMD_SANDUNBOX_NET,
+    MAGIC_CMD_ADDFILTER,
+    MAGIC_CMD_RMFILTER,
+    MAGIC_CMD_NET_ALLOW,
+    MAGIC_CMD_NET_DENY,
+    MAGIC_CMD_NET_LOCAL,
+    MAGIC_CMD_NET_RESTRICT_CONNECT,
+    MAGIC_CMD_NET_UNRESTRICT_CONNECT,
+    MAGIC_CMD_NET_WHITELIST,
+    MAGIC_CMD_BATCH,
+    MAGIC_CMD_MAX,
+};
+
+/**
+ * path_magic_lookup:
+ * @path: path to look up
+ * @param: location to store the parameter of the command, or %NULL
+ *
+ * Recognizes the magic command @path names and its parameter in a single pass
+ * over @path, walking a trie of the command names.  The parameter is the rest
+ * of @path after the command name for commands which take one, and the empty
+ * string for the others.
+ *
+ * Returns: the command, or %MAGIC_CMD_NONE if @path isn't one
+ *
+ * Since: 0.2_alpha4
+ **/
+enum magic_command path_magic_lookup(const char *path, const char **param);
 
 bool path_magic_dir(const char *path);
 
@@ -134,10 +188,42 @@ bool path_magic_net_unrestrict_connect(const char *path);
 
 bool path_magic_net_whitelist(const char *path);
 
+bool path_magic_batch(const char *path);
+
+/**
+ * path_magic_command:
+ * @path: path to check
+ *
+ * Checks whether @path is a magic command which changes the state of sydbox,
+ * as opposed to /dev/sydbox/enabled which queries it and /dev/sydbox/batch/
+ * which combines other commands.
+ *
+ * Returns: true if @path is such a command
+ *
+ * Since: 0.2_alpha4
+ **/
+bool path_magic_command(const char *path);
+
 int pathnode_new(GSList **pathlist, const char *path, int sanitize);
 
 int pathnode_new_early(GSList **pathlist, const char *path, int sanitize);
 
+/**
+ * pathnode_expand_inputs:
+ * @path: prefix as given in the configuration file
+ * @names: list of environment variable names
+ *
+ * Appends the names of the environment variables the shell expansion of @path
+ * depends on to @names, unless they are listed already. A tilde at the start
+ * of a word stands for HOME.
+ *
+ * Returns: false if the expansion depends on more than environment variables,
+ * e.g. on a command substitution, a special parameter or a pattern
+ *
+ * Since: 0.2_alpha4
+ **/
+bool pathnode_expand_inputs(const char *path, GSList **names);
+
 void pathnode_free(GSList **pathlist);
 
 void pathnode_delete(GSList **pathlist, const char *path_sanitized);
@@ -0,0 +1,58 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SYDBOX_GUARD_PROBES_H
+#define SYDBOX_GUARD_PROBES_H 1
+
+/* Static probes for perf, SystemTap and bpftrace, provider `sydbox'.
+ * A probe site is a single nop until a tracer attaches to it.
+ *
+ *   event(pid, event, status)              trace_loop() got an event
+ *   syscall__entry(pid, sno, entering)     syscall_handle() started
+ *   syscall__return(pid, sno, result)      syscall_handle() done, result is
+ *                                          an RS_* code, RS_ALLOW if the
+ *                                          system call wasn't checked
+ *   canonicalize__start(pid, path)         canonicalize_filename_mode()
+ *   canonicalize__done(pid, resolved)      resolved is NULL on failure
+ *   pathlist__check(path, result)          pathlist_check() returned result
+ *   access__violation(pid, path, filtered) path is NULL for network
+ *   child__new(pid)                        tchild_new()
+ *   child__delete(pid)                     tchild_delete()
+ *
+ * syscall__return isn't fired when the child dies while being handled.
+ * See data/bpftrace for example scripts.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#if defined(HAVE_SYS_SDT_H)
+#include <sys/sdt.h>
+
+#define SYDBOX_PROBE1(name, a1)                 DTRACE_PROBE1(sydbox, name, a1)
+#define SYDBOX_PROBE2(name, a1, a2)             DTRACE_PROBE2(sydbox, name, a1, a2)
+#define SYDBOX_PROBE3(name, a1, a2, a3)         DTRACE_PROBE3(sydbox, name, a1, a2, a3)
+#else
+#define SYDBOX_PROBE1(name, a1)                 do { (void) (a1); } while (0)
+#define SYDBOX_PROBE2(name, a1, a2)             do { (void) (a1); (void) (a2); } while (0)
+#define SYDBOX_PROBE3(name, a1, a2, a3)         do { (void) (a1); (void) (a2); (void) (a3); } while (0)
+#endif // defined(HAVE_SYS_SDT_H)
+
+#endif // SYDBOX_GUARD_PROBES_H
@@ -0,0 +1,236 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gprintf.h>
+
+#include "children.h"
+#include "dispatch.h"
+#include "profile.h"
+#include "trace.h"
+
+struct profile_entry {
+    int personality;
+    long sno;
+
+    guint64 stops;
+    guint64 checks;
+    guint64 denials;
+    guint64 handle_ns;
+    guint64 canon_ns;
+    guint64 ptrace_calls;
+};
+
+int profile_mode = PROFILE_OFF;
+struct profile_sample profile_current;
+struct profile_cache profile_caches[PROFILE_CACHE_MAX];
+
+static const char * const profile_cache_names[PROFILE_CACHE_MAX] = {
+    "verdict-cache",
+    "exec-cache",
+};
+
+static GHashTable *entries;
+
+#define PROFILE_KEY(personality, sno)   GINT_TO_POINTER(((personality) << 16) | ((sno) & 0xffff))
+
+void profile_init(int mode)
+{
+    profile_mode = mode;
+    if (NULL == entries)
+        entries = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+}
+
+void profile_free(void)
+{
+    profile_mode = PROFILE_OFF;
+    memset(profile_caches, 0, sizeof(profile_caches));
+    if (NULL != entries) {
+        g_hash_table_destroy(entries);
+        entries = NULL;
+    }
+}
+
+void profile_begin(void)
+{
+    profile_current.sno = -1;
+    profile_current.checked = false;
+    profile_current.denied = false;
+    profile_current.canon_ns = 0;
+    profile_current.ptrace_calls = trace_ptrace_calls;
+    profile_current.start = profile_now();
+}
+
+void profile_end(int personality)
+{
+    struct profile_entry *entry;
+    guint64 elapsed = profile_now() - profile_current.start;
+
+    if (0 > profile_current.sno)
+        return;
+
+    entry = g_hash_table_lookup(entries, PROFILE_KEY(personality, profile_current.sno));
+    if (NULL == entry) {
+        entry = g_new0(struct profile_entry, 1);
+        entry->personality = personality;
+        entry->sno = profile_current.sno;
+        g_hash_table_insert(entries, PROFILE_KEY(personality, profile_current.sno), entry);
+    }
+
+    ++entry->stops;
+    if (profile_current.checked)
+        ++entry->checks;
+    if (profile_current.denied)
+        ++entry->denials;
+    entry->handle_ns += elapsed;
+    entry->canon_ns += profile_current.canon_ns;
+    entry->ptrace_calls += trace_ptrace_calls - profile_current.ptrace_calls;
+}
+
+static void profile_collect(gpointer key G_GNUC_UNUSED, gpointer value, gpointer userdata)
+{
+    g_ptr_array_add((GPtrArray *) userdata, value);
+}
+
+static gint profile_compare(gconstpointer a, gconstpointer b)
+{
+    const struct profile_entry *ea = *(struct profile_entry * const *) a;
+    const struct profile_entry *eb = *(struct profile_entry * const *) b;
+
+    if (ea->handle_ns != eb->handle_ns)
+        return (ea->handle_ns < eb->handle_ns) ? 1 : -1;
+    return (ea->stops < eb->stops) ? 1 : (ea->stops > eb->stops) ? -1 : 0;
+}
+
+static void profile_report_text(GPtrArray *sorted, const struct profile_entry *total)
+{
+    struct tchild_pool_stats pool;
+
+    g_fprintf(stderr, "%% time     seconds  usecs/call     stops    checks   denials  canon(s)    ptrace mode   syscall\n");
+    g_fprintf(stderr, "------ ----------- ----------- --------- --------- --------- --------- --------- ------ ----------------\n");
+    for (guint i = 0; i < sorted->len; i++) {
+        const struct profile_entry *e = g_ptr_array_index(sorted, i);
+        const char *name = dispatch_name(e->personality, e->sno);
+        const char *mode = dispatch_mode(e->personality);
+
+        g_fprintf(stderr, "%6.2f %11.6f %11.2f %9" G_GUINT64_FORMAT " %9" G_GUINT64_FORMAT
+                " %9" G_GUINT64_FORMAT " %9.6f %9" G_GUINT64_FORMAT " %-6s %s\n",
+                total->handle_ns ? 100.0 * e->handle_ns / total->handle_ns : 0.0,
+                e->handle_ns / 1e9,
+                e->stops ? e->handle_ns / 1e3 / e->stops : 0.0,
+                e->stops, e->checks, e->denials,
+                e->canon_ns / 1e9,
+                e->ptrace_calls,
+                mode, name);
+    }
+    g_fprintf(stderr, "------ ----------- ----------- --------- --------- --------- --------- --------- ------ ----------------\n");
+    g_fprintf(stderr, "100.00 %11.6f %11.2f %9" G_GUINT64_FORMAT " %9" G_GUINT64_FORMAT
+            " %9" G_GUINT64_FORMAT " %9.6f %9" G_GUINT64_FORMAT "        total\n",
+            total->handle_ns / 1e9,
+            total->stops ? total->handle_ns / 1e3 / total->stops : 0.0,
+            total->stops, total->checks, total->denials,
+            total->canon_ns / 1e9,
+            total->ptrace_calls);
+    for (guint i = 0; i < PROFILE_CACHE_MAX; i++) {
+        const struct profile_cache *c = &profile_caches[i];
+        guint64 lookups = c->hits + c->misses;
+
+        g_fprintf(stderr, "%s: %" G_GUINT64_FORMAT " hits, %" G_GUINT64_FORMAT " misses, %.2f%% hit rate\n",
+                profile_cache_names[i], c->hits, c->misses, lookups ? 100.0 * c->hits / lookups : 0.0);
+    }
+    for (guint i = 0; i < TCHILD_POOL_MAX; i++) {
+        tchild_pool_stats(i, &pool);
+        g_fprintf(stderr, "%s: %" G_GUINT64_FORMAT " allocated, %lu peak, %lu in use, %lu free, %lu slabs\n",
+                tchild_pool_name(i), pool.allocs, pool.peak, pool.in_use, pool.free, pool.slabs);
+    }
+}
+
+static void profile_report_json(GPtrArray *sorted, const struct profile_entry *total)
+{
+    struct tchild_pool_stats pool;
+
+    g_fprintf(stderr, "{\"syscalls\":[");
+    for (guint i = 0; i < sorted->len; i++) {
+        const struct profile_entry *e = g_ptr_array_index(sorted, i);
+        const char *name = dispatch_name(e->personality, e->sno);
+        const char *mode = dispatch_mode(e->personality);
+
+        g_fprintf(stderr, "%s\n{\"personality\":%d,\"mode\":\"%s\",\"sno\":%ld,\"name\":\"%s\","
+                "\"stops\":%" G_GUINT64_FORMAT ",\"checks\":%" G_GUINT64_FORMAT
+                ",\"denials\":%" G_GUINT64_FORMAT ",\"handle_ns\":%" G_GUINT64_FORMAT
+                ",\"canonicalize_ns\":%" G_GUINT64_FORMAT ",\"ptrace_calls\":%" G_GUINT64_FORMAT "}",
+                i ? "," : "", e->personality, mode, e->sno, name,
+                e->stops, e->checks, e->denials, e->handle_ns, e->canon_ns, e->ptrace_calls);
+    }
+    g_fprintf(stderr, "],\n\"total\":{\"stops\":%" G_GUINT64_FORMAT ",\"checks\":%" G_GUINT64_FORMAT
+            ",\"denials\":%" G_GUINT64_FORMAT ",\"handle_ns\":%" G_GUINT64_FORMAT
+            ",\"canonicalize_ns\":%" G_GUINT64_FORMAT ",\"ptrace_calls\":%" G_GUINT64_FORMAT "},\n",
+            total->stops, total->checks, total->denials, total->handle_ns, total->canon_ns,
+            total->ptrace_calls);
+    for (guint i = 0; i < PROFILE_CACHE_MAX; i++) {
+        g_fprintf(stderr, "\"%s\":{\"hits\":%" G_GUINT64_FORMAT ",\"misses\":%" G_GUINT64_FORMAT "},\n",
+                profile_cache_names[i], profile_caches[i].hits, profile_caches[i].misses);
+    }
+    for (guint i = 0; i < TCHILD_POOL_MAX; i++) {
+        tchild_pool_stats(i, &pool);
+        g_fprintf(stderr, "%s\"%s\":{\"allocated\":%" G_GUINT64_FORMAT ",\"peak\":%lu,\"in_use\":%lu"
+                ",\"free\":%lu,\"slabs\":%lu}",
+                i ? ",\n" : "", tchild_pool_name(i), pool.allocs, pool.peak, pool.in_use, pool.free, pool.slabs);
+    }
+    g_fprintf(stderr, "}\n");
+}
+
+void profile_report(void)
+{
+    GPtrArray *sorted;
+    struct profile_entry total = { 0, 0, 0, 0, 0, 0, 0, 0 };
+
+    if (PROFILE_OFF == profile_mode || NULL == entries)
+        return;
+
+    sorted = g_ptr_array_sized_new(g_hash_table_size(entries));
+    g_hash_table_foreach(entries, profile_collect, sorted);
+    g_ptr_array_sort(sorted, profile_compare);
+
+    for (guint i = 0; i < sorted->len; i++) {
+        const struct profile_entry *e = g_ptr_array_index(sorted, i);
+        total.stops += e->stops;
+        total.checks += e->checks;
+        total.denials += e->denials;
+        total.handle_ns += e->handle_ns;
+        total.canon_ns += e->canon_ns;
+        total.ptrace_calls += e->ptrace_calls;
+    }
+
+    if (PROFILE_JSON == profile_mode)
+        profile_report_json(sorted, &total);
+    else
+        profile_report_text(sorted, &total);
+
+    g_ptr_array_free(sorted, TRUE);
+}
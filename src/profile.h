@@ -0,0 +1,165 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SYDBOX_GUARD_PROFILE_H
+#define SYDBOX_GUARD_PROFILE_H 1
+
+#include <stdbool.h>
+#include <time.h>
+
+#include <glib.h>
+
+enum {
+    PROFILE_OFF = 0,
+    PROFILE_TEXT,
+    PROFILE_JSON,
+};
+
+/* The system call stop being profiled */
+struct profile_sample {
+    long sno;
+    bool checked;
+    bool denied;
+    guint64 start;
+    guint64 canon_start;
+    guint64 canon_ns;
+    gulong ptrace_calls;
+};
+
+/* Lookups of the verdict cache, see verdict.h */
+enum {
+    PROFILE_CACHE_PATH = 0,
+    PROFILE_CACHE_EXEC,
+    PROFILE_CACHE_MAX,
+};
+
+struct profile_cache {
+    guint64 hits;
+    guint64 misses;
+};
+
+extern int profile_mode;
+extern struct profile_sample profile_current;
+extern struct profile_cache profile_caches[PROFILE_CACHE_MAX];
+
+/**
+ * profile_now:
+ *
+ * Returns: a monotonic timestamp in nanoseconds
+ *
+ * Since: 0.2_alpha4
+ **/
+static inline guint64 profile_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (guint64) ts.tv_sec * G_GUINT64_CONSTANT(1000000000) + ts.tv_nsec;
+}
+
+/**
+ * profile_init:
+ * @mode: one of PROFILE_TEXT, PROFILE_JSON
+ *
+ * Starts collecting per system call statistics.
+ *
+ * Since: 0.2_alpha4
+ **/
+void profile_init(int mode);
+
+/**
+ * profile_free:
+ *
+ * Frees the collected statistics.
+ *
+ * Since: 0.2_alpha4
+ **/
+void profile_free(void);
+
+/**
+ * profile_report:
+ *
+ * Prints the collected statistics to standard error, as a table like
+ * strace -c does or as JSON depending on the mode.
+ *
+ * Since: 0.2_alpha4
+ **/
+void profile_report(void);
+
+/**
+ * profile_begin:
+ *
+ * Marks the start of handling a system call stop.
+ *
+ * Since: 0.2_alpha4
+ **/
+void profile_begin(void);
+
+/**
+ * profile_end:
+ * @personality: personality of the child
+ *
+ * Marks the end of handling a system call stop and accounts the sample to
+ * the system call noted with profile_note_syscall().
+ *
+ * Since: 0.2_alpha4
+ **/
+void profile_end(int personality);
+
+static inline void profile_note_syscall(long sno)
+{
+    if (G_UNLIKELY(PROFILE_OFF != profile_mode))
+        profile_current.sno = sno;
+}
+
+static inline void profile_note_check(void)
+{
+    if (G_UNLIKELY(PROFILE_OFF != profile_mode))
+        profile_current.checked = true;
+}
+
+static inline void profile_note_deny(void)
+{
+    if (G_UNLIKELY(PROFILE_OFF != profile_mode))
+        profile_current.denied = true;
+}
+
+static inline void profile_note_cache(int cache, bool hit)
+{
+    if (G_UNLIKELY(PROFILE_OFF != profile_mode)) {
+        if (hit)
+            ++profile_caches[cache].hits;
+        else
+            ++profile_caches[cache].misses;
+    }
+}
+
+static inline void profile_canonicalize_begin(void)
+{
+    if (G_UNLIKELY(PROFILE_OFF != profile_mode))
+        profile_current.canon_start = profile_now();
+}
+
+static inline void profile_canonicalize_end(void)
+{
+    if (G_UNLIKELY(PROFILE_OFF != profile_mode))
+        profile_current.canon_ns += profile_now() - profile_current.canon_start;
+}
+
+#endif // SYDBOX_GUARD_PROFILE_H
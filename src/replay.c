@@ -0,0 +1,515 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include <glib.h>
+
+#include "children.h"
+#include "context.h"
+#include "dispatch.h"
+#include "eventlog.h"
+#include "flags.h"
+#include "path.h"
+#include "replay.h"
+#include "syscall.h"
+#include "trace.h"
+#include "verdict.h"
+
+#include "sydbox-config.h"
+
+enum
+{
+    REPLAY_DENIED,
+    REPLAY_ALLOWED,
+    REPLAY_FILTERED,
+};
+
+static const char * const replay_kinds[] = {
+    [REPLAY_DENIED]     = "newly denied",
+    [REPLAY_ALLOWED]    = "newly allowed",
+    [REPLAY_FILTERED]   = "filtered",
+};
+
+/* Path arguments checked for write access, in the order systemcall_check()
+ * checks them.
+ */
+static const struct
+{
+    guint flag;
+    unsigned int narg;
+} replay_path_args[] = {
+    { CHECK_PATH,       0 },
+    { CHECK_PATH2,      1 },
+    { CHECK_PATH_AT,    1 },
+    { CHECK_PATH_AT1,   2 },
+    { CHECK_PATH_AT2,   3 },
+};
+
+/* Recorded paths are canonical already, so all of them are decided under the
+ * same operation in the verdict cache.
+ */
+#define REPLAY_VERDICT_OP   0
+
+struct replay_record
+{
+    gint32 pid;
+    guint8 personality;
+    gint32 sno;
+    gint32 result;
+    gint32 err;
+    const gchar *paths[4];
+    gint32 family;          // -1 if no address is recorded
+    gint32 port;
+    const gchar *addr;
+};
+
+struct replay_diff
+{
+    int kind;
+    guint64 count;
+    gchar *what;
+};
+
+struct replay
+{
+    context_t *ctx;
+    GPtrArray *strings;     // Interned strings by id
+    GHashTable *diffs;      // Distinct differences by kind and system call
+    GPtrArray *order;       // Distinct differences in the order they were seen
+    struct replay_stats *stats;
+};
+
+/* Reads a value out of the record, returns false if the record is short. */
+static inline bool replay_get(const guchar **p, const guchar *end, void *val, gsize len)
+{
+    if ((gsize) (end - *p) < len)
+        return false;
+    memcpy(val, *p, len);
+    *p += len;
+    return true;
+}
+
+static const gchar *replay_string(struct replay *r, guint32 id)
+{
+    if (id >= r->strings->len)
+        return NULL;
+    return g_ptr_array_index(r->strings, id);
+}
+
+/* Returns the child with the given pid, children which weren't seen fork
+ * start out like the eldest child.
+ */
+static struct tchild *replay_child(struct replay *r, pid_t pid)
+{
+    struct tchild *child;
+
+    child = tchild_find(r->ctx->children, pid);
+    if (NULL == child) {
+        tchild_new(r->ctx->children, pid);
+        child = tchild_find(r->ctx->children, pid);
+        if (0 == r->ctx->eldest)
+            r->ctx->eldest = pid;
+        tchild_configure(child);
+        child->flags &= ~TCHILD_NEEDINHERIT;
+    }
+    return child;
+}
+
+static void replay_note(struct replay *r, int kind, const struct replay_record *rec,
+        const char *sname, const char *path)
+{
+    gchar *what, *key;
+    struct replay_diff *diff;
+
+    switch (kind) {
+        case REPLAY_DENIED:
+            ++r->stats->denied;
+            break;
+        case REPLAY_ALLOWED:
+            ++r->stats->allowed;
+            break;
+        case REPLAY_FILTERED:
+            ++r->stats->filtered;
+            break;
+        default:
+            g_assert_not_reached();
+    }
+
+    if (NULL != path)
+        what = g_strdup_printf("%s(\"%s\")", sname, path);
+    else if (-1 != rec->family)
+        what = g_strdup_printf("%s{family=%s addr=%s port=%d}", sname,
+                (AF_UNIX == rec->family) ? "AF_UNIX" : (AF_INET == rec->family) ? "AF_INET" : "AF_INET6",
+                (NULL != rec->addr) ? rec->addr : "?", rec->port);
+    else
+        what = g_strdup(sname);
+
+    key = g_strdup_printf("%d %s", kind, what);
+    diff = g_hash_table_lookup(r->diffs, key);
+    if (NULL != diff) {
+        ++diff->count;
+        g_free(key);
+        g_free(what);
+        return;
+    }
+    diff = g_new(struct replay_diff, 1);
+    diff->kind = kind;
+    diff->count = 1;
+    diff->what = what;
+    g_hash_table_insert(r->diffs, key, diff);
+    g_ptr_array_add(r->order, diff);
+}
+
+/* Decides the system call under the sandbox data of the child the way
+ * systemcall_check() does.  Returns RS_ALLOW or RS_DENY, setting path to the
+ * path which was denied if any, or -1 if the record lacks what's needed.
+ */
+static int replay_decide(struct replay *r, struct tchild *child, guint flags,
+        const struct replay_record *rec, const char **path)
+{
+    bool allow;
+    const char *arg;
+    const struct verdict *verdict;
+
+    *path = NULL;
+    if (syscall_network_sandboxed(child->sandbox, flags, rec->family))
+        return syscall_network_violation(child->sandbox, flags, -1, rec->family, rec->port, rec->addr)
+            ? RS_DENY : RS_ALLOW;
+
+    if (!r->ctx->before_initial_execve && child->sandbox->exec && flags & EXEC_CALL) {
+        arg = rec->paths[0];
+        if (NULL == arg || !g_path_is_absolute(arg))
+            return -1;
+        if (pathlist_check(child->sandbox->exec_prefixes, arg))
+            return RS_ALLOW;
+        *path = arg;
+        return RS_DENY;
+    }
+
+    if (!child->sandbox->path)
+        return RS_ALLOW;
+    for (unsigned int i = 0; i < G_N_ELEMENTS(replay_path_args); i++) {
+        if (!(flags & replay_path_args[i].flag))
+            continue;
+        arg = rec->paths[replay_path_args[i].narg];
+        /* Paths weren't canonicalized without path sandboxing. */
+        if (NULL == arg || !g_path_is_absolute(arg))
+            return -1;
+        verdict = verdict_cache_lookup(r->ctx->verdicts, child->sandbox->policy, NULL, arg, REPLAY_VERDICT_OP);
+        if (NULL != verdict)
+            allow = verdict->allow;
+        else {
+            allow = pathlist_check(child->sandbox->write_prefixes, arg);
+            verdict_cache_insert(r->ctx->verdicts, child->sandbox->policy, NULL, arg, REPLAY_VERDICT_OP,
+                    arg, allow);
+        }
+        if (!allow) {
+            *path = arg;
+            return RS_DENY;
+        }
+    }
+    return RS_ALLOW;
+}
+
+/* Returns the first path argument recorded, the one shown for decisions which
+ * were reversed to allow. */
+static const char *replay_first_path(const struct replay_record *rec)
+{
+    for (unsigned int i = 0; i < 4; i++) {
+        if (NULL != rec->paths[i])
+            return rec->paths[i];
+    }
+    return NULL;
+}
+
+static void replay_check(struct replay *r, struct tchild *child, int flags, const struct replay_record *rec)
+{
+    bool denied;
+    int decision;
+    const char *path, *sname;
+
+    switch (rec->result) {
+        case RS_MAGIC:
+            if (flags & MAGIC_STAT && NULL != rec->paths[0] && LOCK_SET != child->sandbox->lock)
+                syscall_magic_apply(r->ctx, child, rec->paths[0]);
+            ++r->stats->skipped;
+            return;
+        case RS_NOWRITE:
+            /* Read only, the policy has no say. */
+            ++r->stats->unchanged;
+            return;
+        case RS_ALLOW:
+            denied = false;
+            break;
+        case RS_DENY:
+            /* Other errors, EEXIST of MUST_CREAT* calls among them, aren't
+             * up to the policy. */
+            if (EPERM != rec->err && EACCES != rec->err && ECONNREFUSED != rec->err) {
+                ++r->stats->skipped;
+                return;
+            }
+            denied = true;
+            break;
+        default:
+            ++r->stats->skipped;
+            return;
+    }
+
+    decision = replay_decide(r, child, flags, rec, &path);
+    sname = dispatch_name(rec->personality, rec->sno);
+    if (RS_ALLOW == decision) {
+        if (denied)
+            replay_note(r, REPLAY_ALLOWED, rec, sname, replay_first_path(rec));
+        else
+            ++r->stats->unchanged;
+    }
+    else if (RS_DENY == decision) {
+        if (!denied)
+            replay_note(r, REPLAY_DENIED, rec, sname, path);
+        else if (NULL != path && sydbox_config_match_filters(path))
+            replay_note(r, REPLAY_FILTERED, rec, sname, path);
+        else
+            ++r->stats->unchanged;
+    }
+    else
+        ++r->stats->skipped;
+}
+
+static bool replay_syscall(struct replay *r, const guchar *p, const guchar *end)
+{
+    guint64 ts;
+    guint8 pathmask, has_addr, pad;
+    guint32 id;
+    int flags;
+    struct tchild *child;
+    struct replay_record rec;
+
+    if (!replay_get(&p, end, &ts, 8) || !replay_get(&p, end, &rec.pid, 4) ||
+            !replay_get(&p, end, &rec.personality, 1) || !replay_get(&p, end, &pathmask, 1) ||
+            !replay_get(&p, end, &has_addr, 1) || !replay_get(&p, end, &pad, 1) ||
+            !replay_get(&p, end, &rec.sno, 4) || !replay_get(&p, end, &rec.result, 4) ||
+            !replay_get(&p, end, &rec.err, 4))
+        return false;
+    for (unsigned int i = 0; i < 4; i++) {
+        rec.paths[i] = NULL;
+        if (pathmask & (1 << i)) {
+            if (!replay_get(&p, end, &id, 4))
+                return false;
+            rec.paths[i] = replay_string(r, id);
+        }
+    }
+    rec.family = -1;
+    rec.port = 0;
+    rec.addr = NULL;
+    if (has_addr) {
+        if (!replay_get(&p, end, &rec.family, 4) || !replay_get(&p, end, &rec.port, 4) ||
+                !replay_get(&p, end, &id, 4))
+            return false;
+        rec.addr = replay_string(r, id);
+    }
+
+    ++r->stats->syscalls;
+    flags = dispatch_lookup(rec.personality, rec.sno);
+    if (0 > flags) {
+        ++r->stats->skipped;
+        return true;
+    }
+
+    child = replay_child(r, rec.pid);
+    replay_check(r, child, flags, &rec);
+    if (flags & EXEC_CALL)
+        r->ctx->before_initial_execve = false;
+    return true;
+}
+
+static bool replay_event(struct replay *r, const guchar *p, const guchar *end)
+{
+    guint64 ts;
+    gint64 value;
+    gint32 pid;
+    guint8 event, pad[3];
+    struct tchild *child, *parent;
+
+    if (!replay_get(&p, end, &ts, 8) || !replay_get(&p, end, &pid, 4) || !replay_get(&p, end, &event, 1) ||
+            !replay_get(&p, end, pad, 3) || !replay_get(&p, end, &value, 8))
+        return false;
+
+    switch (event) {
+        case E_FORK:
+        case E_VFORK:
+        case E_CLONE:
+            /* Clone flags aren't recorded, threads get a copy of the sandbox
+             * data instead of sharing it. */
+            parent = replay_child(r, pid);
+            child = tchild_find(r->ctx->children, value);
+            if (NULL == child) {
+                tchild_new(r->ctx->children, value);
+                child = tchild_find(r->ctx->children, value);
+            }
+            tchild_inherit(child, parent, 0);
+            break;
+        case E_EXEC:
+            child = replay_child(r, pid);
+            if (LOCK_PENDING == child->sandbox->lock)
+                child->sandbox->lock = LOCK_SET;
+            break;
+        case E_EXIT:
+        case E_EXIT_SIGNAL:
+            tchild_delete(r->ctx->children, pid);
+            break;
+        default:
+            break;
+    }
+    return true;
+}
+
+static void replay_diff_free(gpointer diff_ptr, gpointer userdata G_GNUC_UNUSED)
+{
+    struct replay_diff *diff = (struct replay_diff *) diff_ptr;
+
+    g_free(diff->what);
+    g_free(diff);
+}
+
+bool replay_run(const gchar *path, FILE *out, struct replay_stats *stats)
+{
+    gchar *contents;
+    gsize length;
+    const guchar *p, *end, *rec;
+    guint32 version, byteorder, len, id;
+    bool damaged = false;
+    GError *error = NULL;
+    struct replay r;
+
+    /* The whole trace is read in at once, records are decided in place. */
+    if (!g_file_get_contents(path, &contents, &length, &error)) {
+        g_printerr("%s\n", error->message);
+        g_error_free(error);
+        return false;
+    }
+    p = (const guchar *) contents;
+    end = p + length;
+
+    if (length < EVENTLOG_MAGIC_LEN + 8 || 0 != memcmp(p, EVENTLOG_MAGIC, EVENTLOG_MAGIC_LEN)) {
+        g_printerr("%s: not a sydbox trace file\n", path);
+        g_free(contents);
+        return false;
+    }
+    memcpy(&version, p + EVENTLOG_MAGIC_LEN, 4);
+    memcpy(&byteorder, p + EVENTLOG_MAGIC_LEN + 4, 4);
+    if (EVENTLOG_BYTEORDER != byteorder) {
+        g_printerr("%s: trace was written on a host with different byte order\n", path);
+        g_free(contents);
+        return false;
+    }
+    if (EVENTLOG_VERSION != version) {
+        g_printerr("%s: unsupported trace version %u\n", path, version);
+        g_free(contents);
+        return false;
+    }
+    p += EVENTLOG_MAGIC_LEN + 8;
+
+    memset(stats, 0, sizeof(struct replay_stats));
+    dispatch_init();
+    r.ctx = context_new();
+    r.strings = g_ptr_array_new();
+    r.diffs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    r.order = g_ptr_array_new();
+    r.stats = stats;
+
+    while (4 <= end - p) {
+        memcpy(&len, p, 4);
+        p += 4;
+        if (0 == len)
+            break;
+        if (len > (gsize) (end - p)) {
+            g_printerr("%s: truncated record\n", path);
+            damaged = true;
+            break;
+        }
+        rec = p;
+        p += len;
+
+        switch (rec[0]) {
+            case EVENTLOG_RECORD_STRING:
+                if (5 > len)
+                    goto corrupt;
+                memcpy(&id, rec + 1, 4);
+                /* Ids are given out one after another, so they can't exceed
+                 * the number of string records the trace has room for. */
+                if (id > length / 9)
+                    goto corrupt;
+                if (id >= r.strings->len)
+                    g_ptr_array_set_size(r.strings, id + 1);
+                g_free(g_ptr_array_index(r.strings, id));
+                g_ptr_array_index(r.strings, id) = g_strndup((const gchar *) rec + 5, len - 5);
+                break;
+            case EVENTLOG_RECORD_SYSCALL:
+                if (!replay_syscall(&r, rec + 1, rec + len))
+                    goto corrupt;
+                break;
+            case EVENTLOG_RECORD_EVENT:
+                if (!replay_event(&r, rec + 1, rec + len))
+                    goto corrupt;
+                break;
+            default:
+                /* Skip unknown records so newer writers stay readable. */
+                break;
+        }
+        continue;
+corrupt:
+        g_printerr("%s: corrupt record of type %u\n", path, rec[0]);
+        damaged = true;
+        break;
+    }
+
+    if (NULL != out) {
+        for (unsigned int i = 0; i < r.order->len; i++) {
+            struct replay_diff *diff = g_ptr_array_index(r.order, i);
+
+            fprintf(out, "%s: %s", replay_kinds[diff->kind], diff->what);
+            if (1 < diff->count)
+                fprintf(out, " (%" G_GUINT64_FORMAT " times)", diff->count);
+            fputc('\n', out);
+        }
+        fprintf(out, "%" G_GUINT64_FORMAT " system calls replayed: %" G_GUINT64_FORMAT " unchanged, %"
+                G_GUINT64_FORMAT " newly denied, %" G_GUINT64_FORMAT " newly allowed, %"
+                G_GUINT64_FORMAT " filtered, %" G_GUINT64_FORMAT " skipped\n",
+                stats->syscalls, stats->unchanged, stats->denied, stats->allowed,
+                stats->filtered, stats->skipped);
+    }
+
+    g_ptr_array_foreach(r.order, replay_diff_free, NULL);
+    g_ptr_array_free(r.order, TRUE);
+    g_hash_table_destroy(r.diffs);
+    g_ptr_array_foreach(r.strings, (GFunc) g_free, NULL);
+    g_ptr_array_free(r.strings, TRUE);
+    context_free(r.ctx);
+    g_free(contents);
+    return !damaged;
+}
@@ -0,0 +1,62 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SYDBOX_GUARD_REPLAY_H
+#define SYDBOX_GUARD_REPLAY_H 1
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include <glib.h>
+
+/* Replays the decisions of a trace written with --trace-file against the
+ * configuration loaded now, without running the traced command again.  The
+ * children are followed through the fork and exit events of the trace, so
+ * each is checked against its own sandbox data, and the magic commands they
+ * issued are applied again.  Paths are decided as recorded: canonicalized
+ * when path sandboxing was on, so a trace recorded without it has little to
+ * replay.
+ */
+struct replay_stats
+{
+    guint64 syscalls;       // System call records replayed.
+    guint64 unchanged;      // Decided as recorded.
+    guint64 denied;         // Allowed when recorded, denied now.
+    guint64 allowed;        // Denied when recorded, allowed now.
+    guint64 filtered;       // Denied as recorded, but a filter keeps the access violation quiet now.
+    guint64 skipped;        // Not up to the policy: magic commands, errors, relative paths etc.
+};
+
+/**
+ * replay_run:
+ * @path: path of the trace file
+ * @out: stream the differences are printed to, or %NULL
+ * @stats: location to store the counters of the replay
+ *
+ * Decides each checked system call of the trace again, printing every
+ * distinct difference once with the number of times it was seen.  A damaged
+ * trace is replayed up to the first truncated or corrupt record.
+ *
+ * Returns: true on success, false if the trace can't be read or is damaged
+ *
+ * Since: 0.2_alpha4
+ **/
+bool replay_run(const gchar *path, FILE *out, struct replay_stats *stats);
+
+#endif // SYDBOX_GUARD_REPLAY_H
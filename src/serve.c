@@ -0,0 +1,357 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include <glib.h>
+
+#include "serve.h"
+
+static int serve_address(const gchar *path, struct sockaddr_un *addr)
+{
+    if (strlen(path) >= sizeof(addr->sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memset(addr, 0, sizeof(struct sockaddr_un));
+    addr->sun_family = AF_UNIX;
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+
+int serve_connect(const gchar *path)
+{
+    int fd, save_errno;
+    struct sockaddr_un addr;
+
+    if (0 > serve_address(path, &addr))
+        return -1;
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (0 > fd)
+        return -1;
+    if (0 > connect(fd, (struct sockaddr *) &addr, sizeof(struct sockaddr_un))) {
+        save_errno = errno;
+        close(fd);
+        errno = save_errno;
+        return -1;
+    }
+    return fd;
+}
+
+int serve_listen(const gchar *path)
+{
+    int fd, save_errno;
+    mode_t old_umask;
+    struct sockaddr_un addr;
+
+    if (0 > serve_address(path, &addr))
+        return -1;
+
+    /* Don't take the socket away from a running server. */
+    fd = serve_connect(path);
+    if (0 <= fd) {
+        close(fd);
+        errno = EADDRINUSE;
+        return -1;
+    }
+    else if (ECONNREFUSED == errno)
+        unlink(path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (0 > fd)
+        return -1;
+    old_umask = umask(0077);
+    if (0 > bind(fd, (struct sockaddr *) &addr, sizeof(struct sockaddr_un))
+            || 0 > listen(fd, SOMAXCONN)) {
+        save_errno = errno;
+        umask(old_umask);
+        close(fd);
+        errno = save_errno;
+        return -1;
+    }
+    umask(old_umask);
+    return fd;
+}
+
+static void serve_add_record(GString *request, char type, const gchar *value)
+{
+    g_string_append_c(request, type);
+    g_string_append_len(request, value, strlen(value) + 1);
+}
+
+bool serve_job_send(int fd, char * const *argv, char * const *envp, const gchar *cwd)
+{
+    GString *request;
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    char control[CMSG_SPACE(3 * sizeof(int))];
+    int fds[3] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+    gsize sent;
+    ssize_t n;
+    bool ret = false;
+
+    request = g_string_sized_new(4096);
+    serve_add_record(request, SERVE_RECORD_VERSION, SERVE_VERSION);
+    serve_add_record(request, SERVE_RECORD_CWD, cwd);
+    for (unsigned int i = 0; NULL != argv[i]; i++)
+        serve_add_record(request, SERVE_RECORD_ARG, argv[i]);
+    for (unsigned int i = 0; NULL != envp[i]; i++)
+        serve_add_record(request, SERVE_RECORD_ENV, envp[i]);
+    g_string_append_c(request, '\0');
+
+    if (request->len > SERVE_REQUEST_MAX) {
+        errno = E2BIG;
+        goto out;
+    }
+
+    /* The descriptors go with the first byte of the request. */
+    memset(&msg, 0, sizeof(struct msghdr));
+    memset(control, 0, sizeof(control));
+    iov.iov_base = request->str;
+    iov.iov_len = request->len;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+
+    do {
+        n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    } while (0 > n && EINTR == errno);
+    if (0 > n)
+        goto out;
+    for (sent = n; sent < request->len; sent += n) {
+        n = send(fd, request->str + sent, request->len - sent, MSG_NOSIGNAL);
+        if (0 > n) {
+            if (EINTR == errno) {
+                n = 0;
+                continue;
+            }
+            goto out;
+        }
+    }
+    ret = true;
+out:
+    g_string_free(request, TRUE);
+    return ret;
+}
+
+static bool serve_peer_allowed(int fd)
+{
+    struct ucred cred;
+    socklen_t len = sizeof(struct ucred);
+
+    if (0 > getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len))
+        return false;
+    if (cred.uid != geteuid()) {
+        errno = EPERM;
+        return false;
+    }
+    return true;
+}
+
+static void serve_take_fds(struct serve_job *job, struct msghdr *msg)
+{
+    struct cmsghdr *cmsg;
+
+    for (cmsg = CMSG_FIRSTHDR(msg); NULL != cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        int *fds;
+        unsigned int nfds;
+
+        if (SOL_SOCKET != cmsg->cmsg_level || SCM_RIGHTS != cmsg->cmsg_type)
+            continue;
+        fds = (int *) CMSG_DATA(cmsg);
+        nfds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (unsigned int i = 0; i < nfds; i++) {
+            if (i < 3 && -1 == job->fds[i])
+                job->fds[i] = fds[i];
+            else
+                close(fds[i]);
+        }
+    }
+}
+
+/* An empty record ends the request, records themselves are never empty. */
+static inline bool serve_request_complete(const GString *request)
+{
+    return (1 == request->len && '\0' == request->str[0])
+        || (2 <= request->len && '\0' == request->str[request->len - 1]
+                && '\0' == request->str[request->len - 2]);
+}
+
+static bool serve_parse(struct serve_job *job, const GString *request)
+{
+    GPtrArray *argv, *envp;
+    const gchar *record, *end = request->str + request->len - 1;
+    bool version = false;
+
+    argv = g_ptr_array_new();
+    envp = g_ptr_array_new();
+    for (record = request->str; record < end; record += strlen(record) + 1) {
+        switch (record[0]) {
+            case SERVE_RECORD_VERSION:
+                version = (0 == strcmp(record + 1, SERVE_VERSION));
+                break;
+            case SERVE_RECORD_CWD:
+                g_free(job->cwd);
+                job->cwd = g_strdup(record + 1);
+                break;
+            case SERVE_RECORD_ARG:
+                g_ptr_array_add(argv, g_strdup(record + 1));
+                break;
+            case SERVE_RECORD_ENV:
+                g_ptr_array_add(envp, g_strdup(record + 1));
+                break;
+            default:
+                /* Unknown records are ignored so that newer clients work. */
+                break;
+        }
+    }
+    job->argc = argv->len;
+    g_ptr_array_add(argv, NULL);
+    g_ptr_array_add(envp, NULL);
+    job->argv = (gchar **) g_ptr_array_free(argv, FALSE);
+    job->envp = (gchar **) g_ptr_array_free(envp, FALSE);
+
+    if (!version || NULL == job->cwd || 0 == job->argc) {
+        errno = EPROTO;
+        return false;
+    }
+    return true;
+}
+
+bool serve_job_receive(int fd, struct serve_job *job)
+{
+    GString *request;
+    struct msghdr msg;
+    struct iovec iov;
+    char control[CMSG_SPACE(3 * sizeof(int))];
+    char buf[4096];
+    ssize_t n;
+    bool ret = false;
+
+    memset(job, 0, sizeof(struct serve_job));
+    job->fds[0] = job->fds[1] = job->fds[2] = -1;
+
+    if (!serve_peer_allowed(fd))
+        return false;
+
+    request = g_string_sized_new(sizeof(buf));
+    while (!serve_request_complete(request)) {
+        memset(&msg, 0, sizeof(struct msghdr));
+        iov.iov_base = buf;
+        iov.iov_len = sizeof(buf);
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        n = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+        if (0 > n) {
+            if (EINTR == errno)
+                continue;
+            goto out;
+        }
+        serve_take_fds(job, &msg);
+        if (0 == n || request->len + n > SERVE_REQUEST_MAX) {
+            errno = (0 == n) ? EPROTO : E2BIG;
+            goto out;
+        }
+        g_string_append_len(request, buf, n);
+    }
+
+    if (-1 == job->fds[0] || -1 == job->fds[1] || -1 == job->fds[2]) {
+        errno = EPROTO;
+        goto out;
+    }
+    ret = serve_parse(job, request);
+out:
+    g_string_free(request, TRUE);
+    if (!ret) {
+        int save_errno = errno;
+        serve_job_free(job);
+        errno = save_errno;
+    }
+    return ret;
+}
+
+void serve_job_free(struct serve_job *job)
+{
+    g_strfreev(job->argv);
+    g_strfreev(job->envp);
+    g_free(job->cwd);
+    for (unsigned int i = 0; i < 3; i++) {
+        if (-1 != job->fds[i])
+            close(job->fds[i]);
+    }
+    memset(job, 0, sizeof(struct serve_job));
+    job->fds[0] = job->fds[1] = job->fds[2] = -1;
+}
+
+bool serve_status_send(int fd, int status)
+{
+    char line[32];
+    int len;
+    ssize_t n;
+
+    len = snprintf(line, sizeof(line), "exit %d\n", status);
+    do {
+        n = send(fd, line, len, MSG_NOSIGNAL);
+    } while (0 > n && EINTR == errno);
+    return n == len;
+}
+
+bool serve_status_receive(int fd, int *status)
+{
+    char line[32];
+    gsize len = 0;
+    ssize_t n;
+
+    while (len < sizeof(line) - 1) {
+        n = read(fd, line + len, sizeof(line) - 1 - len);
+        if (0 > n) {
+            if (EINTR == errno)
+                continue;
+            return false;
+        }
+        else if (0 == n)
+            break;
+        len += n;
+        if ('\n' == line[len - 1])
+            break;
+    }
+    line[len] = '\0';
+    return 1 == sscanf(line, "exit %d\n", status);
+}
@@ -0,0 +1,141 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SYDBOX_GUARD_SERVE_H
+#define SYDBOX_GUARD_SERVE_H 1
+
+#include <stdbool.h>
+
+#include <glib.h>
+
+/* A job request is a sequence of nul terminated records, each starting with
+ * its type, and an empty record at the end.  The standard input, output and
+ * error of the client are passed along with the request, so the job and the
+ * access violations it causes write to the terminal of the client.  The
+ * server answers with a line "exit STATUS" once the job has finished.
+ */
+#define SERVE_VERSION           "1"
+#define SERVE_RECORD_VERSION    'v'
+#define SERVE_RECORD_CWD        'c'
+#define SERVE_RECORD_ARG        'a'
+#define SERVE_RECORD_ENV        'e'
+
+/* Requests larger than this are refused. */
+#define SERVE_REQUEST_MAX       (8 << 20)
+
+struct serve_job {
+    int argc;
+    gchar **argv;
+    gchar **envp;
+    gchar *cwd;
+    int fds[3];
+};
+
+/**
+ * serve_listen:
+ * @path: path of the socket
+ *
+ * Creates a Unix socket at @path, only accessible by the user, and listens
+ * on it.  A stale socket at @path is removed, one a server still listens on
+ * isn't.
+ *
+ * Returns: the listening socket, or -1 with errno set on failure
+ *
+ * Since: 0.2_alpha4
+ **/
+int serve_listen(const gchar *path);
+
+/**
+ * serve_connect:
+ * @path: path of the socket
+ *
+ * Returns: a socket connected to the server listening on @path, or -1 with
+ * errno set on failure
+ *
+ * Since: 0.2_alpha4
+ **/
+int serve_connect(const gchar *path);
+
+/**
+ * serve_job_send:
+ * @fd: connected socket
+ * @argv: command line of the job
+ * @envp: environment of the job
+ * @cwd: working directory of the job
+ *
+ * Sends a job request along with the standard input, output and error of the
+ * calling process.
+ *
+ * Returns: true on success, false with errno set on failure
+ *
+ * Since: 0.2_alpha4
+ **/
+bool serve_job_send(int fd, char * const *argv, char * const *envp, const gchar *cwd);
+
+/**
+ * serve_job_receive:
+ * @fd: accepted socket
+ * @job: location to store the job
+ *
+ * Receives a job request.  Requests from other users than the one the server
+ * runs as are refused with EPERM.  On success @job should be freed with
+ * serve_job_free() when no longer in use.
+ *
+ * Returns: true on success, false with errno set on failure
+ *
+ * Since: 0.2_alpha4
+ **/
+bool serve_job_receive(int fd, struct serve_job *job);
+
+/**
+ * serve_job_free:
+ * @job: the job
+ *
+ * Frees the members of @job and closes the file descriptors it still holds.
+ *
+ * Since: 0.2_alpha4
+ **/
+void serve_job_free(struct serve_job *job);
+
+/**
+ * serve_status_send:
+ * @fd: accepted socket
+ * @status: exit status of the job
+ *
+ * Returns: true on success, false with errno set on failure
+ *
+ * Since: 0.2_alpha4
+ **/
+bool serve_status_send(int fd, int status);
+
+/**
+ * serve_status_receive:
+ * @fd: connected socket
+ * @status: location to store the exit status of the job
+ *
+ * Waits for the job to finish.
+ *
+ * Returns: true on success, false if the server closed the connection
+ * without an exit status
+ *
+ * Since: 0.2_alpha4
+ **/
+bool serve_status_receive(int fd, int *status);
+
+#endif // SYDBOX_GUARD_SERVE_H
@@ -0,0 +1,428 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <glib.h>
+#include <glib/gprintf.h>
+
+#include "sydbox-log.h"
+#include "sydbox-utils.h"
+#include "sydbox-config.h"
+
+#include "children.h"
+#include "context.h"
+#include "dispatch.h"
+#include "eventlog.h"
+#include "landlock.h"
+#include "latency.h"
+#include "loop.h"
+#include "monitor.h"
+#include "path.h"
+#include "proc.h"
+#include "profile.h"
+#include "session.h"
+#include "syscall.h"
+#include "trace.h"
+#include "violation.h"
+
+/* pink floyd */
+#define PINK_FLOYD  "       ..uu.                               \n" \
+                    "       ?$\"\"`?i           z'              \n" \
+                    "       `M  .@\"          x\"               \n" \
+                    "       'Z :#\"  .   .    f 8M              \n" \
+                    "       '&H?`  :$f U8   <  MP   x#'         \n" \
+                    "       d#`    XM  $5.  $  M' xM\"          \n" \
+                    "     .!\">     @  'f`$L:M  R.@!`           \n" \
+                    "    +`  >     R  X  \"NXF  R\"*L           \n" \
+                    "        k    'f  M   \"$$ :E  5.           \n" \
+                    "        %%    `~  \"    `  'K  'M          \n" \
+                    "            .uH          'E   `h           \n" \
+                    "         .x*`             X     `          \n" \
+                    "      .uf`                *                \n" \
+                    "    .@8     .                              \n" \
+                    "   'E9F  uf\"          ,     ,             \n" \
+                    "     9h+\"   $M    eH. 8b. .8    .....     \n" \
+                    "    .8`     $'   M 'E  `R;'   d?\"\"\"`\"# \n" \
+                    "   ` E      @    b  d   9R    ?*     @     \n" \
+                    "     >      K.zM `%%M'   9'    Xf   .f     \n" \
+                    "    ;       R'          9     M  .=`       \n" \
+                    "    t                   M     Mx~          \n" \
+                    "    @                  lR    z\"           \n" \
+                    "    @                  `   ;\"             \n" \
+                    "                          `                \n"
+
+struct sydbox_session {
+    sydbox_config_t *config;    // private copy of the configuration
+    context_t *ctx;             // children and their state
+    bool spawned;               // whether the eldest child has been spawned
+    bool stepping;              // whether the configuration is swapped in
+    sydbox_config_t *previous;  // the configuration swapped out meanwhile
+};
+
+/* The session the calling thread traces the children of */
+static __thread sydbox_session_t *running;
+
+/* Sessions starting in different threads share the system call tables. */
+G_LOCK_DEFINE_STATIC(dispatch);
+
+sydbox_session_t *sydbox_session_new(sydbox_config_t *config)
+{
+    sydbox_session_t *session;
+    sydbox_config_t *previous = NULL;
+
+    G_LOCK(dispatch);
+    dispatch_init();
+    G_UNLOCK(dispatch);
+
+    session = g_new0(sydbox_session_t, 1);
+    if (NULL != config)
+        previous = sydbox_config_use(config);
+    session->config = sydbox_config_copy();
+    if (NULL != config)
+        sydbox_config_use(previous);
+    session->ctx = context_new();
+    return session;
+}
+
+/* Creates the Landlock ruleset the child restricts itself to before running
+ * the command.  Landlock can't allow more once the child is restricted, so
+ * it's only used if magic commands can't add write prefixes.  Returns -1 if
+ * writes are checked by the tracer alone.
+ */
+static int session_landlock_ruleset(void)
+{
+    int fd;
+    bool exact;
+
+    if (!sydbox_config_get_landlock() || !sydbox_config_get_sandbox_path())
+        return -1;
+    else if (!sydbox_config_get_disallow_magic_commands()) {
+        g_info("magic commands are allowed, not using Landlock");
+        return -1;
+    }
+
+    fd = landlock_ruleset_new(sydbox_config_get_write_prefixes(), sydbox_config_get_allow_proc_pid(), &exact);
+    if (0 > fd) {
+        if (ENOSYS == errno || EOPNOTSUPP == errno)
+            g_info("Landlock isn't supported, checking writes with ptrace only");
+        else
+            g_warning("failed to create Landlock ruleset: %s", g_strerror(errno));
+        return -1;
+    }
+
+    /* Every checked system call goes to the trace file, and the tracer has
+     * the last word on paths Landlock allows but the write prefixes don't.
+     */
+    landlock_enabled = exact && !eventlog_enabled();
+    g_info("denying writes outside write prefixes with Landlock%s",
+            landlock_enabled ? "" : ", checking them with ptrace as well");
+    return fd;
+}
+
+/* Returns the environment of the eldest child, with variables set so the
+ * children can check whether they run under sydbox.
+ */
+static gchar **session_environ(char * const *envp)
+{
+    GPtrArray *env;
+
+    env = g_ptr_array_new();
+    for (char * const *walk = (NULL != envp) ? envp : environ; NULL != *walk; walk++) {
+        if (0 == strncmp(*walk, "SYDBOX_ACTIVE=", 14) ||
+                0 == strncmp(*walk, "SYDBOX_VERSION=", 15) ||
+                0 == strncmp(*walk, "SYDBOX_GITHEAD=", 15))
+            continue;
+        g_ptr_array_add(env, g_strdup(*walk));
+    }
+    g_ptr_array_add(env, g_strdup("SYDBOX_ACTIVE=1"));
+    g_ptr_array_add(env, g_strdup("SYDBOX_VERSION=" VERSION));
+    g_ptr_array_add(env, g_strdup("SYDBOX_GITHEAD=" GIT_HEAD));
+    g_ptr_array_add(env, NULL);
+    return (gchar **) g_ptr_array_free(env, FALSE);
+}
+
+static void G_GNUC_NORETURN session_execute_child(char * const *argv, gchar **env, const gchar *cwd,
+        int landlock_fd)
+{
+    if (trace_me() < 0) {
+        g_printerr("failed to set tracing: %s", g_strerror(errno));
+        _exit(-1);
+    }
+
+    /* The parent reads the working directory of the eldest child once it
+     * has stopped.
+     */
+    if (NULL != cwd && 0 > chdir(cwd)) {
+        g_printerr("failed to change directory to `%s': %s\n", cwd, g_strerror(errno));
+        _exit(-1);
+    }
+
+    /* stop and wait for the parent to resume us with trace_syscall */
+    if (kill(getpid(), SIGSTOP) < 0) {
+        g_printerr("failed to send SIGSTOP: %s", g_strerror(errno));
+        _exit(-1);
+    }
+
+    if (strncmp(argv[0], "/bin/sh", 8) == 0)
+        g_fprintf(stderr, ANSI_DARK_MAGENTA PINK_FLOYD ANSI_NORMAL);
+
+    if (0 <= landlock_fd && 0 > landlock_restrict(landlock_fd)) {
+        g_printerr("failed to restrict with Landlock: %s\n", g_strerror(errno));
+        _exit(-1);
+    }
+
+    environ = env;
+    execvp(argv[0], argv);
+
+    g_printerr("execvp() failed: %s\n", g_strerror (errno));
+    _exit(-1);
+}
+
+/* Sets up tracing of the eldest child, which has stopped itself. */
+static bool session_execute_parent(sydbox_session_t *session, pid_t pid)
+{
+    int status;
+    char *cwd;
+    struct tchild *eldest;
+
+    if (0 > waitpid(pid, &status, 0))
+        return false;
+    if (!WIFSTOPPED(status)) {
+        g_warning("child %i died before sending SIGSTOP", pid);
+        errno = ECHILD;
+        return false;
+    }
+    g_assert(SIGSTOP == WSTOPSIG(status));
+
+    if (0 > trace_setup(pid)) {
+        g_critical("failed to setup tracing options: %s", g_strerror(errno));
+        g_printerr("failed to setup tracing options: %s", g_strerror(errno));
+        exit(-1);
+    }
+
+    tchild_new(session->ctx->children, pid);
+    session->ctx->eldest = pid;
+    eldest = tchild_find(session->ctx->children, pid);
+    eldest->personality = trace_personality(pid);
+    if (0 > eldest->personality) {
+        g_critical("failed to determine personality of eldest child %i: %s", eldest->pid, g_strerror(errno));
+        g_printerr("failed to determine personality of eldest child %i: %s", eldest->pid, g_strerror(errno));
+        exit(-1);
+    }
+    g_debug("eldest child %i runs in %s mode", eldest->pid, dispatch_mode(eldest->personality));
+    tchild_configure(eldest);
+    cwd = pgetcwd(pid);
+    if (NULL == cwd) {
+        g_critical("failed to get current working directory: %s", g_strerror(errno));
+        g_printerr("failed to get current working directory: %s", g_strerror(errno));
+        exit(-1);
+    }
+    tchild_take_cwd(eldest, cwd);
+    eldest->flags &= ~TCHILD_NEEDINHERIT;
+
+    g_info ("child %i is ready to go, resuming", pid);
+    if (0 > trace_syscall(pid, 0)) {
+        trace_kill(pid);
+        g_critical("failed to resume eldest child %i: %s", pid, g_strerror(errno));
+        g_printerr("failed to resume eldest child %i: %s", pid, g_strerror(errno));
+        exit(-1);
+    }
+    return true;
+}
+
+/* Sessions spawned and not finished yet, in all threads.  Counted without a
+ * lock since a session may be freed from a signal handler. */
+static volatile gint live;
+
+/* The trace file, violation file, monitor file, system call profile and
+ * latency histograms are process wide and not locked, see session.h */
+static bool session_enter(void)
+{
+    gint n;
+    bool shared = eventlog_enabled() || violation_enabled() || monitor_enabled
+        || PROFILE_OFF != profile_mode || latency_enabled;
+
+    do {
+        n = g_atomic_int_get(&live);
+        if (0 != n && shared)
+            return false;
+    } while (!g_atomic_int_compare_and_exchange(&live, n, n + 1));
+    return true;
+}
+
+static void session_leave(void)
+{
+    g_atomic_int_add(&live, -1);
+}
+
+bool sydbox_session_spawn(sydbox_session_t *session, char * const *argv, char * const *envp, const gchar *cwd)
+{
+    bool spawned;
+    int landlock_fd, save_errno;
+    gchar **env;
+    pid_t pid;
+    sydbox_config_t *previous;
+
+    g_assert(!session->spawned);
+
+    if (NULL != running) {
+        errno = EBUSY;
+        return false;
+    }
+    else if (NULL != cwd && !g_path_is_absolute(cwd)) {
+        errno = EINVAL;
+        return false;
+    }
+    else if (!session_enter()) {
+        errno = EBUSY;
+        return false;
+    }
+
+    previous = sydbox_config_use(session->config);
+    syscall_init();
+    session->spawned = true;
+    landlock_fd = session_landlock_ruleset();
+    env = session_environ(envp);
+
+    /* the child must not inherit unwritten log records */
+    sydbox_log_flush();
+    eventlog_flush();
+    violation_flush();
+
+    if ((pid = fork()) < 0) {
+        save_errno = errno;
+        g_printerr("failed to fork: %s", g_strerror(errno));
+        spawned = false;
+    }
+    else if (0 == pid)
+        session_execute_child(argv, env, cwd, landlock_fd);
+    else {
+        spawned = session_execute_parent(session, pid);
+        save_errno = errno;
+    }
+
+    if (0 <= landlock_fd)
+        close(landlock_fd);
+    g_strfreev(env);
+    sydbox_config_use(previous);
+    if (spawned)
+        running = session;
+    else {
+        landlock_enabled = false;
+        session_leave();
+    }
+    errno = save_errno;
+    return spawned;
+}
+
+bool sydbox_session_step(sydbox_session_t *session, bool block)
+{
+    bool more;
+
+    if (NULL == session->ctx->children || !session->spawned)
+        return false;
+    g_assert(running == session);
+
+    session->previous = sydbox_config_use(session->config);
+    session->stepping = true;
+    more = trace_step(session->ctx, block);
+    session->stepping = false;
+    sydbox_config_use(session->previous);
+
+    if (!more) {
+        running = NULL;
+        landlock_enabled = false;
+        session_leave();
+    }
+    return more;
+}
+
+int sydbox_session_run(sydbox_session_t *session)
+{
+    while (sydbox_session_step(session, true))
+        ;
+    return session->ctx->retval;
+}
+
+int sydbox_session_get_exit_code(sydbox_session_t *session)
+{
+    return session->ctx->retval;
+}
+
+void sydbox_session_get_stats(sydbox_session_t *session, struct sydbox_session_stats *stats)
+{
+    struct verdict_cache_stats verdicts;
+
+    verdict_cache_get_stats(session->ctx->verdicts, &verdicts);
+    stats->events = session->ctx->stats.events;
+    stats->syscalls = session->ctx->stats.syscalls;
+    stats->checks = session->ctx->stats.checks;
+    stats->denied = session->ctx->stats.denied;
+    stats->verdict_hits = verdicts.hits;
+    stats->verdict_misses = verdicts.misses;
+    stats->exec_hits = verdicts.exec_hits;
+    stats->exec_misses = verdicts.exec_misses;
+    stats->children = (NULL != session->ctx->children) ? tchild_table_size(session->ctx->children) : 0;
+}
+
+/* Kills a child and waits for it to go, so no zombies are left behind. */
+static void session_kill_one(struct tchild *child, void *userdata G_GNUC_UNUSED)
+{
+    int status;
+
+    tchild_kill_one(child, NULL);
+    kill(child->pid, SIGKILL);
+    while (child->pid == waitpid(child->pid, &status, __WALL | __WNOTHREAD))
+        if (WIFEXITED(status) || WIFSIGNALED(status))
+            break;
+}
+
+void sydbox_session_free(sydbox_session_t *session)
+{
+    if (running == session) {
+        if (NULL != session->ctx->children)
+            tchild_table_foreach(session->ctx->children, session_kill_one, NULL);
+        running = NULL;
+        landlock_enabled = false;
+        session_leave();
+    }
+    /* Freed from a signal handler which interrupted a step */
+    if (session->stepping)
+        sydbox_config_use(session->previous);
+    context_free(session->ctx);
+
+    /* The last session of the thread takes the per thread state along. */
+    if (session->spawned && NULL == running) {
+        syscall_free();
+        tchild_pool_free();
+    }
+    sydbox_config_free(session->config);
+    g_free(session);
+}
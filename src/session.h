@@ -0,0 +1,143 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SYDBOX_GUARD_SESSION_H
+#define SYDBOX_GUARD_SESSION_H 1
+
+#include <stdbool.h>
+
+#include <glib.h>
+
+#include "sydbox-config.h"
+
+/* A session is one sandbox: a private copy of the configuration, the traced
+ * children and their state.  ptrace ties the children to the thread which
+ * spawned them, so a session is driven by a single thread from spawning to
+ * freeing it, and each thread runs at most one session at a time.  Sessions
+ * in different threads run concurrently; the system call tables and compiled
+ * policies are shared between them.  The trace file, violation file, monitor
+ * file, system call profile and latency histograms are process wide and meant
+ * for a single session: while one of them is enabled, a session can't be
+ * spawned as long as another one runs.
+ */
+typedef struct sydbox_session sydbox_session_t;
+
+struct sydbox_session_stats {
+    guint64 events;         // events of children waited for
+    guint64 syscalls;       // system calls children entered
+    guint64 checks;         // system calls checked for access
+    guint64 denied;         // system calls denied
+    guint64 verdict_hits;   // path checks decided by the verdict cache
+    guint64 verdict_misses; // path checks which had to resolve the path
+    guint64 exec_hits;      // likewise, for execve(2) checks
+    guint64 exec_misses;
+    guint children;         // children traced at the moment
+};
+
+/**
+ * sydbox_session_new:
+ * @config: configuration of the sandbox, or %NULL
+ *
+ * Creates a session with a copy of @config, or of the configuration of the
+ * calling thread if @config is %NULL.  Changes made by magic commands stay
+ * within the session.
+ *
+ * Returns: the session, which should be freed with sydbox_session_free()
+ *
+ * Since: 0.2_alpha4
+ **/
+sydbox_session_t *sydbox_session_new(sydbox_config_t *config);
+
+/**
+ * sydbox_session_spawn:
+ * @session: the session
+ * @argv: command line of the eldest child
+ * @envp: environment of the eldest child, or %NULL for the environment of
+ * the calling process
+ * @cwd: working directory of the eldest child, or %NULL for the one of the
+ * calling process
+ *
+ * Starts the command under the sandbox.  The eldest child is stopped before
+ * it runs the command and resumed by the first call to sydbox_session_step().
+ *
+ * Returns: true on success, false with errno set on failure; errno is EBUSY
+ * if the calling thread already runs a session, or if another thread does and
+ * one of the process wide outputs, like the violation file, is enabled
+ *
+ * Since: 0.2_alpha4
+ **/
+bool sydbox_session_spawn(sydbox_session_t *session, char * const *argv, char * const *envp, const gchar *cwd);
+
+/**
+ * sydbox_session_step:
+ * @session: the session
+ * @block: whether to wait for an event
+ *
+ * Handles the next event of the children of @session.  If @block is false
+ * and no child has changed state, returns right away.
+ *
+ * Returns: true while there are children left to trace
+ *
+ * Since: 0.2_alpha4
+ **/
+bool sydbox_session_step(sydbox_session_t *session, bool block);
+
+/**
+ * sydbox_session_run:
+ * @session: the session
+ *
+ * Traces the children of @session until they've finished.
+ *
+ * Returns: the exit code, see sydbox_session_get_exit_code()
+ *
+ * Since: 0.2_alpha4
+ **/
+int sydbox_session_run(sydbox_session_t *session);
+
+/**
+ * sydbox_session_get_exit_code:
+ * @session: the session
+ *
+ * Returns: the exit code of the eldest child, or 128 plus the number of the
+ * signal which killed it, once tracing is finished
+ *
+ * Since: 0.2_alpha4
+ **/
+int sydbox_session_get_exit_code(sydbox_session_t *session);
+
+/**
+ * sydbox_session_get_stats:
+ * @session: the session
+ * @stats: location to store the counters of @session
+ *
+ * Since: 0.2_alpha4
+ **/
+void sydbox_session_get_stats(sydbox_session_t *session, struct sydbox_session_stats *stats);
+
+/**
+ * sydbox_session_free:
+ * @session: the session
+ *
+ * Kills the children @session still traces and frees it.
+ *
+ * Since: 0.2_alpha4
+ **/
+void sydbox_session_free(sydbox_session_t *session);
+
+#endif // SYDBOX_GUARD_SESSION_H
@@ -18,15 +18,22 @@
  * Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <errno.h>
+#include <fcntl.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/un.h>
 
 #include <glib.h>
 #include <glib/gstdio.h>
 
+#include "globset.h"
 #include "net.h"
 #include "path.h"
 #include "sydbox-log.h"
@@ -34,7 +41,17 @@
 
 struct sydbox_config
 {
+    gchar *source;
+    bool source_found;
+
+    /* The environment variables the shell expansion of the prefixes refers
+     * to, and the first prefix whose expansion depends on more than those. */
+    GSList *expand_names;
+    gchar *expand_opaque;
+
     gchar *logfile;
+    gchar *tracefile;
+    gchar *violationfile;
 
     gint verbosity;
 
@@ -50,12 +67,18 @@ struct sydbox_config
     bool wait_all;
     bool allow_proc_pid;
     bool wrap_lstat;
+    bool lazy_cwd;
+    bool landlock;
 
     GSList *filters;
+    struct globset *filterset;
     GSList *write_prefixes;
     GSList *exec_prefixes;
     GSList *network_whitelist;
-} *config;
+};
+
+/* Every thread has its own configuration, see sydbox_config_use(). */
+static __thread struct sydbox_config *config;
 
 
 static void sydbox_config_set_defaults(void)
@@ -73,6 +96,16 @@ static void sydbox_config_set_defaults(void)
     config->wait_all = true;
     config->allow_proc_pid = true;
     config->wrap_lstat = true;
+    config->lazy_cwd = false;
+    config->landlock = false;
+}
+
+/* A compiled policy is stale once the environment variables its prefixes were
+ * expanded with change, see sydbox_config_compile(). */
+static void sydbox_config_note_prefix(const gchar *prefix)
+{
+    if (!pathnode_expand_inputs(prefix, &config->expand_names) && NULL == config->expand_opaque)
+        config->expand_opaque = g_strdup(prefix);
 }
 
 bool sydbox_config_load(const gchar * const file, const gchar * const profile)
@@ -114,7 +147,8 @@ bool sydbox_config_load(const gchar * const file, const gchar * const profile)
                  */
                 g_error_free(config_error);
                 g_key_file_free(config_fd);
-                g_free(config_file);
+                config->source = config_file;
+                config->source_found = false;
                 sydbox_config_set_defaults();
                 return true;
             default:
@@ -129,7 +163,7 @@ bool sydbox_config_load(const gchar * const file, const gchar * const profile)
 
     // Get main.colour
     config->colourise_output = g_key_file_get_boolean(config_fd, "main", "colour", &config_error);
-    if (!config->colourise_output) {
+    if (!config->colourise_output && config_error) {
         switch (config_error->code) {
             case G_KEY_FILE_ERROR_INVALID_VALUE:
                 g_printerr("main.colour not a boolean: %s", config_error->message);
@@ -241,6 +275,52 @@ bool sydbox_config_load(const gchar * const file, const gchar * const profile)
         }
     }
 
+    // Get main.lazy_cwd
+    config->lazy_cwd = g_key_file_get_boolean(config_fd, "main", "lazy_cwd", &config_error);
+    if (!config->lazy_cwd && config_error) {
+        switch (config_error->code) {
+            case G_KEY_FILE_ERROR_INVALID_VALUE:
+                g_printerr("main.lazy_cwd not a boolean: %s", config_error->message);
+                g_error_free(config_error);
+                g_key_file_free(config_fd);
+                g_free(config_file);
+                g_free(config);
+                return false;
+            case G_KEY_FILE_ERROR_GROUP_NOT_FOUND:
+            case G_KEY_FILE_ERROR_KEY_NOT_FOUND:
+                g_error_free(config_error);
+                config_error = NULL;
+                config->lazy_cwd = false;
+                break;
+            default:
+                g_assert_not_reached();
+                break;
+        }
+    }
+
+    // Get main.landlock
+    config->landlock = g_key_file_get_boolean(config_fd, "main", "landlock", &config_error);
+    if (!config->landlock && config_error) {
+        switch (config_error->code) {
+            case G_KEY_FILE_ERROR_INVALID_VALUE:
+                g_printerr("main.landlock not a boolean: %s", config_error->message);
+                g_error_free(config_error);
+                g_key_file_free(config_fd);
+                g_free(config_file);
+                g_free(config);
+                return false;
+            case G_KEY_FILE_ERROR_GROUP_NOT_FOUND:
+            case G_KEY_FILE_ERROR_KEY_NOT_FOUND:
+                g_error_free(config_error);
+                config_error = NULL;
+                config->landlock = false;
+                break;
+            default:
+                g_assert_not_reached();
+                break;
+        }
+    }
+
     // Get main.filters
     char **filterlist = g_key_file_get_string_list(config_fd, "main", "filters", NULL, NULL);
     if (NULL != filterlist) {
@@ -252,6 +332,12 @@ bool sydbox_config_load(const gchar * const file, const gchar * const profile)
     // Get log.file
     config->logfile = g_key_file_get_string(config_fd, "log", "file", NULL);
 
+    // Get log.trace
+    config->tracefile = g_key_file_get_string(config_fd, "log", "trace", NULL);
+
+    // Get log.violations
+    config->violationfile = g_key_file_get_string(config_fd, "log", "violations", NULL);
+
     // Get log.level
     config->verbosity = g_key_file_get_integer(config_fd, "log", "level", &config_error);
     if (config_error) {
@@ -347,16 +433,20 @@ bool sydbox_config_load(const gchar * const file, const gchar * const profile)
     // Get prefix.write
     char **write_prefixes = g_key_file_get_string_list(config_fd, "prefix", "write", NULL, NULL);
     if (NULL != write_prefixes) {
-        for (unsigned int i = 0; NULL != write_prefixes[i]; i++)
+        for (unsigned int i = 0; NULL != write_prefixes[i]; i++) {
+            sydbox_config_note_prefix(write_prefixes[i]);
             pathnode_new_early(&config->write_prefixes, write_prefixes[i], 1);
+        }
         g_strfreev(write_prefixes);
     }
 
     // Get prefix.exec
     char **exec_prefixes = g_key_file_get_string_list(config_fd, "prefix", "exec", NULL, NULL);
     if (NULL != exec_prefixes) {
-        for (unsigned int i = 0; NULL != exec_prefixes[i]; i++)
+        for (unsigned int i = 0; NULL != exec_prefixes[i]; i++) {
+            sydbox_config_note_prefix(exec_prefixes[i]);
             pathnode_new_early(&config->exec_prefixes, exec_prefixes[i], 1);
+        }
         g_strfreev(exec_prefixes);
     }
 
@@ -421,10 +511,80 @@ bool sydbox_config_load(const gchar * const file, const gchar * const profile)
 
     // Cleanup and return
     g_key_file_free(config_fd);
-    g_free(config_file);
+    config->source = config_file;
+    config->source_found = true;
     return true;
 }
 
+static GSList *sydbox_config_copy_strings(GSList *list)
+{
+    GSList *copy = NULL;
+
+    for (GSList *walk = list; NULL != walk; walk = g_slist_next(walk))
+        copy = g_slist_prepend(copy, g_strdup(walk->data));
+    return g_slist_reverse(copy);
+}
+
+static void sydbox_config_compile_filters(void);
+
+sydbox_config_t *sydbox_config_copy(void)
+{
+    struct sydbox_config *copy, *current;
+
+    g_assert(config != NULL);
+
+    copy = g_new(struct sydbox_config, 1);
+    *copy = *config;
+    copy->source = g_strdup(config->source);
+    copy->logfile = g_strdup(config->logfile);
+    copy->tracefile = g_strdup(config->tracefile);
+    copy->violationfile = g_strdup(config->violationfile);
+    copy->filters = sydbox_config_copy_strings(config->filters);
+    copy->write_prefixes = sydbox_config_copy_strings(config->write_prefixes);
+    copy->exec_prefixes = sydbox_config_copy_strings(config->exec_prefixes);
+    copy->network_whitelist = NULL;
+    for (GSList *walk = config->network_whitelist; NULL != walk; walk = g_slist_next(walk)) {
+        struct sydbox_addr *saddr = walk->data;
+        netlist_new(&copy->network_whitelist, saddr->family, saddr->port, saddr->addr);
+    }
+    copy->network_whitelist = g_slist_reverse(copy->network_whitelist);
+
+    copy->filterset = NULL;
+    current = config;
+    config = copy;
+    sydbox_config_compile_filters();
+    config = current;
+    return copy;
+}
+
+sydbox_config_t *sydbox_config_use(sydbox_config_t *use)
+{
+    struct sydbox_config *previous = config;
+
+    config = use;
+    return previous;
+}
+
+void sydbox_config_free(sydbox_config_t *free_config)
+{
+    g_assert(free_config != config);
+
+    g_free(free_config->source);
+    g_slist_foreach(free_config->expand_names, (GFunc) g_free, NULL);
+    g_slist_free(free_config->expand_names);
+    g_free(free_config->expand_opaque);
+    g_free(free_config->logfile);
+    g_free(free_config->tracefile);
+    g_free(free_config->violationfile);
+    g_slist_foreach(free_config->filters, (GFunc) g_free, NULL);
+    g_slist_free(free_config->filters);
+    globset_free(free_config->filterset);
+    pathnode_free(&free_config->write_prefixes);
+    pathnode_free(&free_config->exec_prefixes);
+    netlist_free(&free_config->network_whitelist);
+    g_free(free_config);
+}
+
 void sydbox_config_update_from_environment(void)
 {
     g_info("extending path list using environment variable " ENV_WRITE);
@@ -486,9 +646,13 @@ void sydbox_config_write_to_stderr (void)
     g_fprintf(stderr, "main.wait_all = %s\n", config->wait_all ? "yes" : "no");
     g_fprintf(stderr, "main.allow_proc_pid = %s\n", config->allow_proc_pid ? "yes" : "no");
     g_fprintf(stderr, "main.wrap_lstat = %s\n", config->wrap_lstat ? "yes" : "no");
+    g_fprintf(stderr, "main.lazy_cwd = %s\n", config->lazy_cwd ? "yes" : "no");
+    g_fprintf(stderr, "main.landlock = %s\n", config->landlock ? "yes" : "no");
     g_fprintf(stderr, "main.filters:\n");
     g_slist_foreach(config->filters, print_slist_entry, NULL);
     g_fprintf(stderr, "log.file = %s\n", config->logfile ? config->logfile : "stderr");
+    g_fprintf(stderr, "log.trace = %s\n", config->tracefile ? config->tracefile : "none");
+    g_fprintf(stderr, "log.violations = %s\n", config->violationfile ? config->violationfile : "stderr");
     g_fprintf(stderr, "log.level = %d\n", config->verbosity);
     g_fprintf(stderr, "sandbox.path = %s\n", config->sandbox_path ? "yes" : "no");
     g_fprintf(stderr, "sandbox.exec = %s\n", config->sandbox_exec ? "yes" : "no");
@@ -524,6 +688,32 @@ void sydbox_config_set_log_file(const gchar * const logfile)
     config->logfile = g_strdup(logfile);
 }
 
+const gchar *sydbox_config_get_trace_file(void)
+{
+    return config->tracefile;
+}
+
+void sydbox_config_set_trace_file(const gchar * const tracefile)
+{
+    if (config->tracefile)
+        g_free(config->tracefile);
+
+    config->tracefile = g_strdup(tracefile);
+}
+
+const gchar *sydbox_config_get_violation_file(void)
+{
+    return config->violationfile;
+}
+
+void sydbox_config_set_violation_file(const gchar * const violationfile)
+{
+    if (config->violationfile)
+        g_free(config->violationfile);
+
+    config->violationfile = g_strdup(violationfile);
+}
+
 gint sydbox_config_get_verbosity(void)
 {
     return config->verbosity;
@@ -634,6 +824,26 @@ void sydbox_config_set_wrap_lstat(bool wrap)
     config->wrap_lstat = wrap;
 }
 
+bool sydbox_config_get_lazy_cwd(void)
+{
+    return config->lazy_cwd;
+}
+
+void sydbox_config_set_lazy_cwd(bool lazy)
+{
+    config->lazy_cwd = lazy;
+}
+
+bool sydbox_config_get_landlock(void)
+{
+    return config->landlock;
+}
+
+void sydbox_config_set_landlock(bool landlock)
+{
+    config->landlock = landlock;
+}
+
 GSList *sydbox_config_get_write_prefixes(void)
 {
     return config->write_prefixes;
@@ -649,6 +859,17 @@ GSList *sydbox_config_get_filters(void)
     return config->filters;
 }
 
+bool sydbox_config_match_filters(const gchar *path)
+{
+    return globset_match(config->filterset, path);
+}
+
+static void sydbox_config_compile_filters(void)
+{
+    globset_free(config->filterset);
+    config->filterset = (NULL == config->filters) ? NULL : globset_new(config->filters);
+}
+
 GSList *sydbox_config_get_network_whitelist(void)
 {
     return config->network_whitelist;
@@ -662,6 +883,7 @@ void sydbox_config_set_network_whitelist(GSList *whitelist)
 void sydbox_config_addfilter(const gchar *filter)
 {
     config->filters = g_slist_append(config->filters, g_strdup(filter));
+    sydbox_config_compile_filters();
 }
 
 int sydbox_config_rmfilter(const gchar *filter)
@@ -674,6 +896,7 @@ int sydbox_config_rmfilter(const gchar *filter)
             config->filters = g_slist_remove_link(config->filters, walk);
             g_free(walk->data);
             g_slist_free(walk);
+            sydbox_config_compile_filters();
             return 1;
         }
         walk = g_slist_next(walk);
@@ -686,5 +909,430 @@ void sydbox_config_rmfilter_all(void)
     g_slist_foreach(config->filters, (GFunc) g_free, NULL);
     g_slist_free(config->filters);
     config->filters = NULL;
+    sydbox_config_compile_filters();
+}
+
+
+/* A compiled policy is the loaded configuration written out by
+ * sydbox --compile-policy, with prefixes already shell expanded and network
+ * addresses already parsed.  References are offsets from the start of the
+ * file so that it can be mapped anywhere.  Layout:
+ *   struct policy_header
+ *   guint32 string offsets of filters, write prefixes and exec prefixes
+ *   struct policy_addr entries of the network whitelist
+ *   nul terminated strings
+ */
+#define POLICY_MAGIC        "SYDPLCY"
+#define POLICY_VERSION      3
+
+enum {
+    POLICY_COLOUR               = 1 << 0,
+    POLICY_LOCK                 = 1 << 1,
+    POLICY_WAIT_ALL             = 1 << 2,
+    POLICY_ALLOW_PROC_PID       = 1 << 3,
+    POLICY_WRAP_LSTAT           = 1 << 4,
+    POLICY_LAZY_CWD             = 1 << 5,
+    POLICY_SANDBOX_PATH         = 1 << 6,
+    POLICY_SANDBOX_EXEC         = 1 << 7,
+    POLICY_SANDBOX_NETWORK      = 1 << 8,
+    POLICY_RESTRICT_CONNECT     = 1 << 9,
+    POLICY_LANDLOCK             = 1 << 10,
+};
+
+struct policy_header {
+    char magic[8];
+    guint32 version;
+    guint32 size;
+    guint64 checksum;
+
+    /* The configuration file the policy was compiled from */
+    guint64 source_dev;
+    guint64 source_ino;
+    gint64 source_size;
+    gint64 source_mtime;
+    gint64 source_mtime_nsec;
+    guint32 source;
+    guint32 source_found;
+
+    /* The environment variables the prefixes were expanded with, their
+     * names separated by colons and a digest of their values */
+    guint64 environ_digest;
+    guint32 environ_names;
+
+    guint32 flags;
+    gint32 verbosity;
+    gint32 network_mode;
+    guint32 logfile;
+    guint32 tracefile;
+    guint32 violationfile;
+
+    guint32 nfilters, filters;
+    guint32 nwrite, write;
+    guint32 nexec, exec;
+    guint32 nwhitelist, whitelist;
+};
+
+struct policy_addr {
+    gint32 family;
+    gint32 port;
+    guint32 addr;
+};
+
+/* The checksum covers everything after the checksum field. */
+#define POLICY_CHECKSUM_START   G_STRUCT_OFFSET(struct policy_header, source_dev)
+
+/* 64-bit FNV-1a */
+static guint64 policy_checksum(const guint8 *data, gsize len)
+{
+    guint64 hash = G_GUINT64_CONSTANT(14695981039346656037);
+
+    for (gsize i = 0; i < len; i++) {
+        hash ^= data[i];
+        hash *= G_GUINT64_CONSTANT(1099511628211);
+    }
+    return hash;
+}
+
+/* Digests the values of the colon separated environment variables, an unset
+ * variable doesn't digest like an empty one. */
+static guint64 policy_environ_digest(const gchar *names)
+{
+    gchar **split;
+    const gchar *value;
+    GString *values;
+    guint64 digest;
+
+    values = g_string_new(NULL);
+    split = g_strsplit(NULL != names ? names : "", ":", -1);
+    for (unsigned int i = 0; NULL != split[i]; i++) {
+        if ('\0' == split[i][0])
+            continue;
+        g_string_append(values, split[i]);
+        value = g_getenv(split[i]);
+        if (NULL != value) {
+            g_string_append_c(values, '=');
+            g_string_append(values, value);
+        }
+        g_string_append_c(values, '\0');
+    }
+    g_strfreev(split);
+    digest = policy_checksum((const guint8 *) values->str, values->len);
+    g_string_free(values, TRUE);
+    return digest;
 }
 
+static guint32 policy_add_string(GString *strings, guint32 base, const gchar *str)
+{
+    guint32 offset;
+
+    if (NULL == str)
+        return 0;
+    offset = base + strings->len;
+    g_string_append_len(strings, str, strlen(str) + 1);
+    return offset;
+}
+
+static guint32 policy_add_list(guint32 *table, guint32 *index, GSList *list, GString *strings, guint32 base)
+{
+    guint32 count = 0;
+
+    for (GSList *walk = list; NULL != walk; walk = g_slist_next(walk), count++)
+        table[(*index)++] = policy_add_string(strings, base, walk->data);
+    return count;
+}
+
+bool sydbox_config_compile(const gchar * const file)
+{
+    struct policy_header header;
+    struct policy_addr *addrs;
+    struct stat buf;
+    GString *strings, *policy;
+    GError *write_error = NULL;
+    guint32 *table, ntable, nwhitelist, base, index = 0;
+    GString *joined;
+    bool ret;
+
+    if (NULL != config->expand_opaque) {
+        g_printerr("error: can't compile prefix `%s', its expansion depends on more than"
+                " environment variables\n", config->expand_opaque);
+        return false;
+    }
+
+    memset(&header, 0, sizeof(struct policy_header));
+    memcpy(header.magic, POLICY_MAGIC, sizeof(header.magic));
+    header.version = POLICY_VERSION;
+
+    ntable = g_slist_length(config->filters) + g_slist_length(config->write_prefixes)
+        + g_slist_length(config->exec_prefixes);
+    nwhitelist = g_slist_length(config->network_whitelist);
+    table = g_new0(guint32, ntable + 1);
+    addrs = g_new0(struct policy_addr, nwhitelist + 1);
+    base = sizeof(struct policy_header) + ntable * sizeof(guint32) + nwhitelist * sizeof(struct policy_addr);
+    strings = g_string_sized_new(1024);
+
+    if (NULL != config->source) {
+        /* The policy may be used from another directory. */
+        if (g_path_is_absolute(config->source))
+            header.source = policy_add_string(strings, base, config->source);
+        else {
+            gchar *cwd = g_get_current_dir();
+            gchar *source = g_build_filename(cwd, config->source, NULL);
+            header.source = policy_add_string(strings, base, source);
+            g_free(source);
+            g_free(cwd);
+        }
+        if (config->source_found) {
+            if (0 > stat(config->source, &buf)) {
+                g_printerr("error: failed to stat `%s': %s\n", config->source, g_strerror(errno));
+                g_string_free(strings, TRUE);
+                g_free(table);
+                g_free(addrs);
+                return false;
+            }
+            header.source_found = 1;
+            header.source_dev = buf.st_dev;
+            header.source_ino = buf.st_ino;
+            header.source_size = buf.st_size;
+            header.source_mtime = buf.st_mtim.tv_sec;
+            header.source_mtime_nsec = buf.st_mtim.tv_nsec;
+        }
+    }
+
+    joined = g_string_new(NULL);
+    for (GSList *walk = config->expand_names; NULL != walk; walk = g_slist_next(walk))
+        g_string_append_printf(joined, "%s%s", joined->len ? ":" : "", (const gchar *) walk->data);
+    if (0 != joined->len)
+        header.environ_names = policy_add_string(strings, base, joined->str);
+    header.environ_digest = policy_environ_digest(joined->str);
+    g_string_free(joined, TRUE);
+
+    header.flags = (config->colourise_output ? POLICY_COLOUR : 0)
+        | (config->disallow_magic_commands ? POLICY_LOCK : 0)
+        | (config->wait_all ? POLICY_WAIT_ALL : 0)
+        | (config->allow_proc_pid ? POLICY_ALLOW_PROC_PID : 0)
+        | (config->wrap_lstat ? POLICY_WRAP_LSTAT : 0)
+        | (config->lazy_cwd ? POLICY_LAZY_CWD : 0)
+        | (config->sandbox_path ? POLICY_SANDBOX_PATH : 0)
+        | (config->sandbox_exec ? POLICY_SANDBOX_EXEC : 0)
+        | (config->sandbox_network ? POLICY_SANDBOX_NETWORK : 0)
+        | (config->network_restrict_connect ? POLICY_RESTRICT_CONNECT : 0)
+        | (config->landlock ? POLICY_LANDLOCK : 0);
+    header.verbosity = config->verbosity;
+    header.network_mode = config->network_mode;
+    header.logfile = policy_add_string(strings, base, config->logfile);
+    header.tracefile = policy_add_string(strings, base, config->tracefile);
+    header.violationfile = policy_add_string(strings, base, config->violationfile);
+
+    header.filters = sizeof(struct policy_header) + index * sizeof(guint32);
+    header.nfilters = policy_add_list(table, &index, config->filters, strings, base);
+    header.write = sizeof(struct policy_header) + index * sizeof(guint32);
+    header.nwrite = policy_add_list(table, &index, config->write_prefixes, strings, base);
+    header.exec = sizeof(struct policy_header) + index * sizeof(guint32);
+    header.nexec = policy_add_list(table, &index, config->exec_prefixes, strings, base);
+
+    header.whitelist = sizeof(struct policy_header) + ntable * sizeof(guint32);
+    header.nwhitelist = nwhitelist;
+    index = 0;
+    for (GSList *walk = config->network_whitelist; NULL != walk; walk = g_slist_next(walk), index++) {
+        struct sydbox_addr *saddr = walk->data;
+        addrs[index].family = saddr->family;
+        addrs[index].port = saddr->port;
+        addrs[index].addr = policy_add_string(strings, base, saddr->addr);
+    }
+
+    header.size = base + strings->len;
+    policy = g_string_sized_new(header.size);
+    g_string_append_len(policy, (const gchar *) &header, sizeof(struct policy_header));
+    g_string_append_len(policy, (const gchar *) table, ntable * sizeof(guint32));
+    g_string_append_len(policy, (const gchar *) addrs, nwhitelist * sizeof(struct policy_addr));
+    g_string_append_len(policy, strings->str, strings->len);
+    ((struct policy_header *) policy->str)->checksum = policy_checksum((const guint8 *) policy->str
+            + POLICY_CHECKSUM_START, policy->len - POLICY_CHECKSUM_START);
+
+    /* g_file_set_contents() renames a temporary file over the old policy so
+     * that running instances keep their mapping of it.
+     */
+    ret = g_file_set_contents(file, policy->str, policy->len, &write_error);
+    if (!ret) {
+        g_printerr("error: failed to write compiled policy: %s\n", write_error->message);
+        g_error_free(write_error);
+    }
+
+    g_string_free(policy, TRUE);
+    g_string_free(strings, TRUE);
+    g_free(table);
+    g_free(addrs);
+    return ret;
+}
+
+static bool policy_string_valid(const guint8 *data, gsize size, guint32 offset)
+{
+    if (0 == offset)
+        return true;
+    return offset >= sizeof(struct policy_header) && offset < size
+        && NULL != memchr(data + offset, '\0', size - offset);
+}
+
+static bool policy_array_valid(gsize size, guint32 offset, guint32 count, gsize elem)
+{
+    return 0 == offset % sizeof(guint32) && offset >= sizeof(struct policy_header)
+        && offset <= size && count <= (size - offset) / elem;
+}
+
+static bool policy_valid(const guint8 *data, gsize size)
+{
+    const struct policy_header *header = (const struct policy_header *) data;
+    const guint32 *table;
+    const struct policy_addr *addrs;
+    guint32 ntable;
+
+    if (size < sizeof(struct policy_header)
+            || 0 != memcmp(header->magic, POLICY_MAGIC, sizeof(header->magic))
+            || POLICY_VERSION != header->version
+            || size != header->size
+            || header->checksum != policy_checksum(data + POLICY_CHECKSUM_START, size - POLICY_CHECKSUM_START))
+        return false;
+
+    if (!policy_string_valid(data, size, header->source)
+            || !policy_string_valid(data, size, header->environ_names)
+            || !policy_string_valid(data, size, header->logfile)
+            || !policy_string_valid(data, size, header->tracefile)
+            || !policy_string_valid(data, size, header->violationfile))
+        return false;
+
+    /* The prefix tables are laid out one after the other. */
+    ntable = header->nfilters + header->nwrite + header->nexec;
+    if (header->write != header->filters + header->nfilters * sizeof(guint32)
+            || header->exec != header->write + header->nwrite * sizeof(guint32)
+            || !policy_array_valid(size, header->filters, ntable, sizeof(guint32)))
+        return false;
+    table = (const guint32 *) (data + header->filters);
+    for (guint32 i = 0; i < ntable; i++) {
+        if (0 == table[i] || !policy_string_valid(data, size, table[i]))
+            return false;
+    }
+
+    if (!policy_array_valid(size, header->whitelist, header->nwhitelist, sizeof(struct policy_addr)))
+        return false;
+    addrs = (const struct policy_addr *) (data + header->whitelist);
+    for (guint32 i = 0; i < header->nwhitelist; i++) {
+        if (!policy_string_valid(data, size, addrs[i].addr))
+            return false;
+    }
+    return true;
+}
+
+static bool policy_fresh(const struct policy_header *header, const gchar *source)
+{
+    struct stat buf;
+
+    if (NULL == source)
+        return true;
+    if (0 > stat(source, &buf))
+        return !header->source_found && ENOENT == errno;
+    return header->source_found
+        && header->source_dev == (guint64) buf.st_dev
+        && header->source_ino == (guint64) buf.st_ino
+        && header->source_size == (gint64) buf.st_size
+        && header->source_mtime == (gint64) buf.st_mtim.tv_sec
+        && header->source_mtime_nsec == (gint64) buf.st_mtim.tv_nsec;
+}
+
+static GSList *policy_list(const guint8 *data, guint32 offset, guint32 count)
+{
+    const guint32 *table = (const guint32 *) (data + offset);
+    GSList *list = NULL;
+
+    for (guint32 i = 0; i < count; i++)
+        list = g_slist_prepend(list, g_strdup((const gchar *) data + table[i]));
+    return g_slist_reverse(list);
+}
+
+#define POLICY_STRING(data, offset) (0 == (offset) ? NULL : (const gchar *) (data) + (offset))
+
+bool sydbox_config_load_compiled(const gchar * const file, gchar **source)
+{
+    int fd;
+    struct stat buf;
+    void *map;
+    const guint8 *data;
+    const struct policy_header *header;
+    const struct policy_addr *addrs;
+
+    g_return_val_if_fail(!config, true);
+
+    *source = NULL;
+    fd = open(file, O_RDONLY | O_CLOEXEC);
+    if (0 > fd) {
+        g_printerr("warning: failed to open compiled policy `%s': %s\n", file, g_strerror(errno));
+        return false;
+    }
+    if (0 > fstat(fd, &buf) || (gsize) buf.st_size < sizeof(struct policy_header)) {
+        g_printerr("warning: ignoring compiled policy `%s': file too short\n", file);
+        close(fd);
+        return false;
+    }
+    map = mmap(NULL, buf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == map) {
+        g_printerr("warning: failed to map compiled policy `%s': %s\n", file, g_strerror(errno));
+        return false;
+    }
+    data = map;
+    header = map;
+
+    if (!policy_valid(data, buf.st_size)) {
+        g_printerr("warning: ignoring compiled policy `%s': invalid or corrupt\n", file);
+        munmap(map, buf.st_size);
+        return false;
+    }
+    if (!policy_fresh(header, POLICY_STRING(data, header->source))) {
+        g_printerr("warning: ignoring compiled policy `%s': `%s' has changed\n", file,
+                POLICY_STRING(data, header->source));
+        *source = g_strdup(POLICY_STRING(data, header->source));
+        munmap(map, buf.st_size);
+        return false;
+    }
+    if (header->environ_digest != policy_environ_digest(POLICY_STRING(data, header->environ_names))) {
+        g_printerr("warning: ignoring compiled policy `%s': the environment variables `%s' have changed\n",
+                file, POLICY_STRING(data, header->environ_names));
+        *source = g_strdup(POLICY_STRING(data, header->source));
+        munmap(map, buf.st_size);
+        return false;
+    }
+
+    config = g_new0(struct sydbox_config, 1);
+    config->source = g_strdup(POLICY_STRING(data, header->source));
+    config->source_found = header->source_found;
+
+    config->colourise_output = header->flags & POLICY_COLOUR;
+    config->disallow_magic_commands = header->flags & POLICY_LOCK;
+    config->wait_all = header->flags & POLICY_WAIT_ALL;
+    config->allow_proc_pid = header->flags & POLICY_ALLOW_PROC_PID;
+    config->wrap_lstat = header->flags & POLICY_WRAP_LSTAT;
+    config->lazy_cwd = header->flags & POLICY_LAZY_CWD;
+    config->landlock = header->flags & POLICY_LANDLOCK;
+    config->sandbox_path = header->flags & POLICY_SANDBOX_PATH;
+    config->sandbox_exec = header->flags & POLICY_SANDBOX_EXEC;
+    config->sandbox_network = header->flags & POLICY_SANDBOX_NETWORK;
+    config->network_restrict_connect = header->flags & POLICY_RESTRICT_CONNECT;
+    config->verbosity = header->verbosity;
+    config->network_mode = header->network_mode;
+    config->logfile = g_strdup(POLICY_STRING(data, header->logfile));
+    config->tracefile = g_strdup(POLICY_STRING(data, header->tracefile));
+    config->violationfile = g_strdup(POLICY_STRING(data, header->violationfile));
+
+    config->filters = policy_list(data, header->filters, header->nfilters);
+    sydbox_config_compile_filters();
+    config->write_prefixes = policy_list(data, header->write, header->nwrite);
+    config->exec_prefixes = policy_list(data, header->exec, header->nexec);
+
+    /* netlist_new() prepends */
+    addrs = (const struct policy_addr *) (data + header->whitelist);
+    for (guint32 i = header->nwhitelist; i > 0; i--)
+        netlist_new(&config->network_whitelist, addrs[i - 1].family, addrs[i - 1].port,
+                POLICY_STRING(data, addrs[i - 1].addr));
+
+    munmap(map, buf.st_size);
+    return true;
+}
@@ -28,6 +28,8 @@
 
 // Environment variables
 #define ENV_LOG                     "SYDBOX_LOG"
+#define ENV_TRACE                   "SYDBOX_TRACE"
+#define ENV_VIOLATIONS              "SYDBOX_VIOLATIONS"
 #define ENV_CONFIG                  "SYDBOX_CONFIG"
 #define ENV_WRITE                   "SYDBOX_WRITE"
 #define ENV_EXEC_ALLOW              "SYDBOX_EXEC_ALLOW"
@@ -42,6 +44,11 @@
 #define ENV_LOCK                    "SYDBOX_LOCK"
 #define ENV_NO_WAIT                 "SYDBOX_EXIT_WITH_ELDEST"
 #define ENV_NOWRAP_LSTAT            "SYDBOX_NOWRAP_LSTAT"
+#define ENV_LAZY_CWD                "SYDBOX_LAZY_CWD"
+#define ENV_LANDLOCK                "SYDBOX_LANDLOCK"
+#define ENV_POLICY                  "SYDBOX_POLICY"
+
+typedef struct sydbox_config sydbox_config_t;
 
 enum {
     SYDBOX_NETWORK_ALLOW,
@@ -64,6 +71,78 @@ enum {
  **/
 bool sydbox_config_load(const gchar * const config, const gchar * const profile);
 
+/**
+ * sydbox_config_compile:
+ * @file: path to write the compiled policy to
+ *
+ * Writes the loaded configuration to @file as a compiled policy, which
+ * sydbox_config_load_compiled() can load without parsing the configuration
+ * file again.  Prefixes are stored shell expanded, along with a digest of the
+ * environment variables their expansion refers to.  Prefixes whose expansion
+ * depends on anything else, like a command substitution, can't be compiled.
+ *
+ * Returns: true if the policy was written, false otherwise
+ *
+ * Since: 0.2_alpha4
+ **/
+bool sydbox_config_compile(const gchar * const file);
+
+/**
+ * sydbox_config_load_compiled:
+ * @file: path to the compiled policy
+ * @source: location to store the configuration file the policy was compiled
+ *          from if the policy is stale
+ *
+ * Loads the configuration from the compiled policy @file, which is mapped
+ * read-only.  If the policy is invalid or stale, nothing is loaded.  A policy
+ * is stale if the configuration file it was compiled from has changed, or if
+ * one of the environment variables its prefixes were expanded with has.  In
+ * that case @source is set to the path of the configuration file, which should
+ * be freed with g_free when no longer in use.
+ *
+ * Returns: true if the policy was loaded, false otherwise
+ *
+ * Since: 0.2_alpha4
+ **/
+bool sydbox_config_load_compiled(const gchar * const file, gchar **source);
+
+/**
+ * sydbox_config_copy:
+ *
+ * Copies the configuration of the calling thread, so that it can be used by
+ * a sandbox of its own.  The copy should be freed with sydbox_config_free()
+ * when no longer in use.
+ *
+ * Returns: the copy
+ *
+ * Since: 0.2_alpha4
+ **/
+sydbox_config_t *sydbox_config_copy(void);
+
+/**
+ * sydbox_config_use:
+ * @config: configuration to use
+ *
+ * Makes @config the configuration the sydbox_config_* functions of the
+ * calling thread access.  Each thread starts without a configuration until
+ * it loads one or uses one.
+ *
+ * Returns: the configuration used by the calling thread until now
+ *
+ * Since: 0.2_alpha4
+ **/
+sydbox_config_t *sydbox_config_use(sydbox_config_t *config);
+
+/**
+ * sydbox_config_free:
+ * @config: configuration returned by sydbox_config_copy()
+ *
+ * Frees @config, which mustn't be in use by the calling thread.
+ *
+ * Since: 0.2_alpha4
+ **/
+void sydbox_config_free(sydbox_config_t *config);
+
 /**
  * sydbox_config_update_from_environment:
  *
@@ -103,6 +182,49 @@ const gchar *sydbox_config_get_log_file(void);
  **/
 void sydbox_config_set_log_file(const gchar * const logfile);
 
+/**
+ * sydbox_config_get_trace_file:
+ *
+ * Accessor for the binary event trace file.
+ *
+ * Returns: the path to the trace file or %NULL if tracing is disabled
+ *
+ * Since: 0.2_alpha4
+ **/
+const gchar *sydbox_config_get_trace_file(void);
+
+/**
+ * sydbox_config_set_trace_file:
+ * @tracefile: path to the trace file
+ *
+ * Sets the file the binary event trace is written to.
+ *
+ * Since: 0.2_alpha4
+ **/
+void sydbox_config_set_trace_file(const gchar * const tracefile);
+
+/**
+ * sydbox_config_get_violation_file:
+ *
+ * Accessor for the file access violations are written to as JSON lines.
+ *
+ * Returns: the path to the violation file or %NULL if access violations are
+ * written to standard error
+ *
+ * Since: 0.2_alpha4
+ **/
+const gchar *sydbox_config_get_violation_file(void);
+
+/**
+ * sydbox_config_set_violation_file:
+ * @violationfile: path to the violation file
+ *
+ * Sets the file access violations are written to.
+ *
+ * Since: 0.2_alpha4
+ **/
+void sydbox_config_set_violation_file(const gchar * const violationfile);
+
 /**
  * sydbox_config_get_verbosity:
  *
@@ -188,6 +310,46 @@ bool sydbox_config_get_wrap_lstat(void);
 
 void sydbox_config_set_wrap_lstat(bool wrap);
 
+/**
+ * sydbox_config_get_lazy_cwd:
+ *
+ * Returns: whether working directories are read only when they're needed
+ *
+ * Since: 0.2_alpha4
+ **/
+bool sydbox_config_get_lazy_cwd(void);
+
+/**
+ * sydbox_config_set_lazy_cwd:
+ * @lazy: whether working directories are read only when they're needed
+ *
+ * Sets whether chdir(2) and fchdir(2) only mark the working directory of
+ * the child as changed instead of reading the new one.
+ *
+ * Since: 0.2_alpha4
+ **/
+void sydbox_config_set_lazy_cwd(bool lazy);
+
+/**
+ * sydbox_config_get_landlock:
+ *
+ * Returns: whether write prefixes are also enforced with Landlock
+ *
+ * Since: 0.2_alpha4
+ **/
+bool sydbox_config_get_landlock(void);
+
+/**
+ * sydbox_config_set_landlock:
+ * @landlock: whether write prefixes are also enforced with Landlock
+ *
+ * Sets whether the kernel is asked to deny writes outside the write prefixes
+ * when it supports Landlock and magic commands are disallowed.
+ *
+ * Since: 0.2_alpha4
+ **/
+void sydbox_config_set_landlock(bool landlock);
+
 /**
  * sydbox_config_get_write_prefixes:
  *
@@ -203,6 +365,18 @@ GSList *sydbox_config_get_exec_prefixes(void);
 
 GSList *sydbox_config_get_filters(void);
 
+/**
+ * sydbox_config_match_filters:
+ * @path: path to match
+ *
+ * Matches @path against the compiled set of filters.
+ *
+ * Returns: true if any of the filters matches @path
+ *
+ * Since: 0.2_alpha4
+ **/
+bool sydbox_config_match_filters(const gchar *path);
+
 GSList *sydbox_config_get_network_whitelist(void);
 
 void sydbox_config_set_network_whitelist(GSList *whitelist);
@@ -27,73 +27,210 @@
 #include <glib/gstdio.h>
 
 #include <errno.h>
+#include <stdarg.h>
+#include <string.h>
 #include <time.h>
 #include <unistd.h>
+#include <sys/uio.h>
+
+/* Log records are formatted into a fixed number of fixed-size slots and
+ * written out in batches at idle points of the event loop.
+ */
+#define LOG_RING_SIZE       256
+#define LOG_RECORD_SIZE     512
+
+struct log_record {
+    gsize len;
+    gchar buf[LOG_RECORD_SIZE];
+};
+
+guint sydbox_log_mask = ~0U;
 
 static FILE *fd;
+static int logfd = STDERR_FILENO;
 static bool initialized;
 
-static inline void sydbox_log_output (const gchar *log_domain,
-        GLogLevelFlags log_level, const gchar *message)
-{
-    gchar *output;
-    const gchar *prefix;
-
-    g_return_if_fail(initialized);
-    g_return_if_fail(message != NULL && message[0] != '\0');
+/* Sandboxes running in different threads share the ring. */
+G_LOCK_DEFINE_STATIC(ring);
+static struct log_record ring[LOG_RING_SIZE];
+static guint ring_head, ring_tail;
 
-    switch (log_level)
+static inline const gchar *sydbox_log_prefix(GLogLevelFlags log_level)
+{
+    switch (log_level & G_LOG_LEVEL_MASK)
     {
+        case G_LOG_LEVEL_ERROR:
+            return "ERROR";
         case G_LOG_LEVEL_CRITICAL:
-            prefix = "CRITICAL";
-            break;
+            return "CRITICAL";
         case G_LOG_LEVEL_WARNING:
-            prefix = "WARNING";
-            break;
+            return "WARNING";
         case G_LOG_LEVEL_MESSAGE:
-            prefix = "Message";
-            break;
+            return "Message";
         case G_LOG_LEVEL_INFO:
-            prefix = "INFO";
-            break;
+            return "INFO";
         case G_LOG_LEVEL_DEBUG:
-            prefix = "DEBUG";
-            break;
+            return "DEBUG";
         case LOG_LEVEL_DEBUG_TRACE:
-            prefix = "TRACE";
-            break;
+            return "TRACE";
         default:
-            prefix = "";
-            break;
+            return "";
+    }
+}
+
+static void sydbox_log_writev(struct iovec *iov, int iovcnt)
+{
+    while (0 < iovcnt) {
+        ssize_t n = writev(logfd, iov, iovcnt);
+        if (0 > n) {
+            if (EINTR == errno)
+                continue;
+            return;
+        }
+        while (0 < iovcnt && (size_t) n >= iov->iov_len) {
+            n -= iov->iov_len;
+            ++iov;
+            --iovcnt;
+        }
+        if (0 < iovcnt) {
+            iov->iov_base = (gchar *) iov->iov_base + n;
+            iov->iov_len -= n;
+        }
     }
+}
 
+bool sydbox_log_pending(void)
+{
+    bool pending;
 
-    output = g_strdup_printf("%s (%s%i@%lu) %s: %s\n",
-                             log_domain ? log_domain : "**",
-                             fd ? "" : PACKAGE":",
-                             getpid(), (gulong) time(NULL),
-                             prefix, message);
+    G_LOCK(ring);
+    pending = ring_head != ring_tail;
+    G_UNLOCK(ring);
+    return pending;
+}
 
-    g_fprintf(fd ? fd : stderr, "%s", output);
-    fflush(fd ? fd : stderr);
+static void sydbox_log_flush_ring(void)
+{
+    struct iovec iov[LOG_RING_SIZE];
+    int iovcnt = 0;
 
-    g_free(output);
+    while (ring_tail != ring_head) {
+        struct log_record *rec = &ring[ring_tail % LOG_RING_SIZE];
+        iov[iovcnt].iov_base = rec->buf;
+        iov[iovcnt].iov_len = rec->len;
+        ++iovcnt;
+        ++ring_tail;
+    }
+    if (0 < iovcnt)
+        sydbox_log_writev(iov, iovcnt);
+}
+
+void sydbox_log_flush(void)
+{
+    G_LOCK(ring);
+    sydbox_log_flush_ring();
+    G_UNLOCK(ring);
+}
+
+static void sydbox_log_record(const gchar *log_domain, GLogLevelFlags log_level,
+        const gchar *format, va_list args) G_GNUC_PRINTF(3, 0);
+/* Called with the ring locked */
+static void sydbox_log_record(const gchar *log_domain, GLogLevelFlags log_level,
+        const gchar *format, va_list args)
+{
+    int hlen, mlen;
+    va_list copy;
+    struct log_record *rec;
+
+    if (ring_head - ring_tail == LOG_RING_SIZE)
+        sydbox_log_flush_ring();
+
+    rec = &ring[ring_head % LOG_RING_SIZE];
+    hlen = g_snprintf(rec->buf, LOG_RECORD_SIZE, "%s (%s%i@%lu) %s: ",
+                      log_domain ? log_domain : "**",
+                      fd ? "" : PACKAGE":",
+                      getpid(), (gulong) time(NULL),
+                      sydbox_log_prefix(log_level));
+    if (G_UNLIKELY(hlen >= LOG_RECORD_SIZE - 1))
+        return;
+
+    va_copy(copy, args);
+    mlen = g_vsnprintf(rec->buf + hlen, LOG_RECORD_SIZE - hlen - 1, format, copy);
+    va_end(copy);
+
+    if (G_UNLIKELY(0 >= mlen))
+        return;
+    else if (G_LIKELY(hlen + mlen < LOG_RECORD_SIZE - 1)) {
+        rec->buf[hlen + mlen] = '\n';
+        rec->len = hlen + mlen + 1;
+        ++ring_head;
+    }
+    else {
+        /* Too long for a record, keep the order and write it directly. */
+        struct iovec iov[3];
+        gchar *message = g_strdup_vprintf(format, args);
+
+        sydbox_log_flush_ring();
+        iov[0].iov_base = rec->buf;
+        iov[0].iov_len = hlen;
+        iov[1].iov_base = message;
+        iov[1].iov_len = strlen(message);
+        iov[2].iov_base = (gchar *) "\n";
+        iov[2].iov_len = 1;
+        sydbox_log_writev(iov, 3);
+        g_free(message);
+    }
+}
+
+void sydbox_log(const gchar *log_domain, GLogLevelFlags log_level, const gchar *format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    if (initialized) {
+        G_LOCK(ring);
+        sydbox_log_record(log_domain, log_level, format, args);
+        G_UNLOCK(ring);
+    }
+    else
+        g_logv(log_domain, log_level, format, args);
+    va_end(args);
+}
+
+static void sydbox_log_output (const gchar *log_domain,
+        GLogLevelFlags log_level, const gchar *format, ...) G_GNUC_PRINTF(3, 4);
+static void sydbox_log_output (const gchar *log_domain,
+        GLogLevelFlags log_level, const gchar *format, ...)
+{
+    va_list args;
+
+    G_LOCK(ring);
+    va_start(args, format);
+    sydbox_log_record(log_domain, log_level, format, args);
+    va_end(args);
+
+    /* Don't hold back important messages */
+    if (log_level & (G_LOG_LEVEL_ERROR | G_LOG_LEVEL_CRITICAL | G_LOG_LEVEL_WARNING))
+        sydbox_log_flush_ring();
+    G_UNLOCK(ring);
 }
 
 static void sydbox_log_handler(const gchar *log_domain, GLogLevelFlags log_level,
         const gchar *message, gpointer user_data G_GNUC_UNUSED)
 {
-    if ( ((log_level & G_LOG_LEVEL_MESSAGE)   && sydbox_config_get_verbosity() < 1) ||
-         ((log_level & G_LOG_LEVEL_INFO)      && sydbox_config_get_verbosity() < 2) ||
-         ((log_level & G_LOG_LEVEL_DEBUG)     && sydbox_config_get_verbosity() < 3) ||
-         ((log_level & LOG_LEVEL_DEBUG_TRACE) && sydbox_config_get_verbosity() < 4) )
+    g_return_if_fail(initialized);
+    g_return_if_fail(message != NULL && message[0] != '\0');
+
+    if (!(log_level & sydbox_log_mask))
         return;
 
-    sydbox_log_output(log_domain, log_level, message);
+    sydbox_log_output(log_domain, log_level, "%s", message);
 }
 
 void sydbox_log_init(void)
 {
+    gint verbosity;
+
     if (initialized)
         return;
 
@@ -104,20 +241,47 @@ void sydbox_log_init(void)
             g_printerr("warning: all logging will go to stderr\n");
         }
     }
+    logfd = fd ? fileno(fd) : STDERR_FILENO;
+
+    verbosity = sydbox_config_get_verbosity();
+    sydbox_log_mask = G_LOG_LEVEL_ERROR | G_LOG_LEVEL_CRITICAL | G_LOG_LEVEL_WARNING;
+    if (verbosity >= 1)
+        sydbox_log_mask |= G_LOG_LEVEL_MESSAGE;
+    if (verbosity >= 2)
+        sydbox_log_mask |= G_LOG_LEVEL_INFO;
+    if (verbosity >= 3)
+        sydbox_log_mask |= G_LOG_LEVEL_DEBUG;
+    if (verbosity >= 4)
+        sydbox_log_mask |= LOG_LEVEL_DEBUG_TRACE;
 
     g_log_set_default_handler(sydbox_log_handler, NULL);
 
     initialized = true;
 }
 
+void sydbox_log_abort(void)
+{
+    if (!initialized)
+        return;
+
+    /* Records are complete once the head is moved past them. */
+    sydbox_log_flush_ring();
+    g_log_set_default_handler(g_log_default_handler, NULL);
+    sydbox_log_mask = 0;
+    initialized = false;
+}
+
 void sydbox_log_fini(void)
 {
     if (!initialized)
         return;
 
+    sydbox_log_flush();
     if (fd)
         fclose(fd);
+    fd = NULL;
+    logfd = STDERR_FILENO;
+    sydbox_log_mask = ~0U;
 
     initialized = false;
 }
-
@@ -20,6 +20,8 @@
 #ifndef SYDBOX_GUARD_LOG_H
 #define SYDBOX_GUARD_LOG_H 1
 
+#include <stdbool.h>
+
 #include <glib.h>
 
 /**
@@ -31,6 +33,33 @@
  **/
 #define LOG_LEVEL_DEBUG_TRACE       (1 << (G_LOG_LEVEL_USER_SHIFT + 0))
 
+/**
+ * sydbox_log_mask:
+ *
+ * Mask of log levels which are currently enabled. The logging macros below
+ * check it before evaluating their arguments so that disabled messages cost
+ * a single test at the call site.
+ *
+ * Since: 0.2_alpha4
+ **/
+extern guint sydbox_log_mask;
+
+/**
+ * sydbox_log_enabled:
+ * @level: a #GLogLevelFlags
+ *
+ * Returns: true if messages of the given level are logged
+ *
+ * Since: 0.2_alpha4
+ **/
+#define sydbox_log_enabled(level)   (0 != (sydbox_log_mask & (level)))
+
+#define sydbox_log_gated(level, ...)                                \
+    do {                                                            \
+        if (sydbox_log_enabled(level))                              \
+            sydbox_log(G_LOG_DOMAIN, (level), __VA_ARGS__);         \
+    } while (0)
+
 /**
  * g_info:
  * @varargs: format string, followed by parameters to insert into the format
@@ -40,13 +69,52 @@
  *
  * Since: 0.1_alpha
  **/
-#ifndef g_info
-#define g_info(...)                 g_log(G_LOG_DOMAIN, G_LOG_LEVEL_INFO, __VA_ARGS__)
-#endif
+#undef g_info
+#define g_info(...)                 sydbox_log_gated(G_LOG_LEVEL_INFO, __VA_ARGS__)
+
+#undef g_message
+#define g_message(...)              sydbox_log_gated(G_LOG_LEVEL_MESSAGE, __VA_ARGS__)
+
+#undef g_debug
+#define g_debug(...)                sydbox_log_gated(G_LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+#undef g_debug_trace
+#define g_debug_trace(...)          sydbox_log_gated(LOG_LEVEL_DEBUG_TRACE, __VA_ARGS__)
+
+/**
+ * sydbox_log:
+ * @log_domain: the log domain
+ * @log_level: the log level
+ * @format: the message format
+ * @varargs: the parameters to insert into the format string
+ *
+ * Formats the message directly into a record of the log ring buffer. The ring
+ * buffer is written out in batches by sydbox_log_flush().
+ * Before sydbox_log_init() is called, the message is passed to g_logv().
+ *
+ * Since: 0.2_alpha4
+ **/
+void sydbox_log(const gchar *log_domain, GLogLevelFlags log_level, const gchar *format, ...)
+    G_GNUC_PRINTF(3, 4);
 
-#ifndef g_debug_trace
-#define g_debug_trace(...)          g_log(G_LOG_DOMAIN, LOG_LEVEL_DEBUG_TRACE, __VA_ARGS__)
-#endif
+/**
+ * sydbox_log_pending:
+ *
+ * Returns: true if there are log records waiting to be written
+ *
+ * Since: 0.2_alpha4
+ **/
+bool sydbox_log_pending(void);
+
+/**
+ * sydbox_log_flush:
+ *
+ * Writes out the buffered log records with as few writev() calls as possible.
+ * Call this at idle points and before forking.
+ *
+ * Since: 0.2_alpha4
+ **/
+void sydbox_log_flush(void);
 
 /**
  * sydbox_log_init:
@@ -66,5 +134,16 @@ void sydbox_log_init(void);
  **/
 void sydbox_log_fini(void);
 
+/**
+ * sydbox_log_abort:
+ *
+ * Writes out the buffered log records without taking the lock of the ring
+ * buffer and stops logging, messages go to the default GLib handler from now
+ * on.  For signal handlers, which may interrupt a thread holding the lock.
+ *
+ * Since: 0.2_alpha4
+ **/
+void sydbox_log_abort(void);
+
 #endif // SYDBOX_GUARD_LOG_H
 
@@ -0,0 +1,302 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* Shows the live counters sydbox --monitor publishes */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+
+#include "monitor.h"
+
+#define MONITOR_DIR     "/dev/shm"
+#define MONITOR_PREFIX  "sydbox-"
+
+struct top_entry
+{
+    gchar *path;
+    struct monitor_segment *segment;
+    struct monitor_counters last;   // Counters of the previous refresh
+    guint64 last_ns;                // When they were read
+    bool exited;
+};
+
+static gint interval = 1;
+static gint count;
+static gboolean json;
+
+static GOptionEntry entries[] = {
+    { "interval",   'i', 0, G_OPTION_ARG_INT,  &interval,
+        "Seconds between refreshes, defaults to 1", "SECONDS" },
+    { "count",      'n', 0, G_OPTION_ARG_INT,  &count,
+        "Exit after this many refreshes, 0 to go on until interrupted", "N" },
+    { "json",       'j', 0, G_OPTION_ARG_NONE, &json,
+        "Output the counters as JSON, one object per sandbox and refresh", NULL },
+    { NULL, -1, 0, 0, NULL, NULL, NULL },
+};
+
+static const char * const event_names[MONITOR_EVENTS] = {
+    [E_STOP]        = "stop",
+    [E_SYSCALL]     = "syscall",
+    [E_FORK]        = "fork",
+    [E_VFORK]       = "vfork",
+    [E_CLONE]       = "clone",
+    [E_EXEC]        = "exec",
+    [E_GENUINE]     = "signal",
+    [E_EXIT]        = "exit",
+    [E_EXIT_SIGNAL] = "exit_signal",
+    [E_UNKNOWN]     = "unknown",
+};
+
+static inline guint64 top_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (guint64) ts.tv_sec * G_GUINT64_CONSTANT(1000000000) + ts.tv_nsec;
+}
+
+/* Maps the file read only, returns NULL if it isn't a monitor file. */
+static struct monitor_segment *top_map(const gchar *path, bool verbose)
+{
+    int fd;
+    void *map;
+    struct stat buf;
+    struct monitor_segment *segment;
+
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (0 > fd) {
+        if (verbose)
+            g_printerr("failed to open `%s': %s\n", path, g_strerror(errno));
+        return NULL;
+    }
+    if (0 > fstat(fd, &buf) || (gsize) buf.st_size < sizeof(struct monitor_segment)) {
+        if (verbose)
+            g_printerr("%s: not a sydbox monitor file\n", path);
+        close(fd);
+        return NULL;
+    }
+    map = mmap(NULL, sizeof(struct monitor_segment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (MAP_FAILED == map) {
+        if (verbose)
+            g_printerr("failed to map `%s': %s\n", path, g_strerror(errno));
+        return NULL;
+    }
+
+    segment = map;
+    if (0 != memcmp(segment->magic, MONITOR_MAGIC, MONITOR_MAGIC_LEN)
+            || MONITOR_VERSION != segment->version
+            || sizeof(struct monitor_segment) != segment->size) {
+        if (verbose)
+            g_printerr("%s: not a sydbox monitor file of version %d\n", path, MONITOR_VERSION);
+        munmap(map, sizeof(struct monitor_segment));
+        return NULL;
+    }
+    return segment;
+}
+
+static void top_add(GPtrArray *sandboxes, const gchar *path, bool verbose)
+{
+    struct top_entry *entry;
+    struct monitor_segment *segment;
+
+    for (unsigned int i = 0; i < sandboxes->len; i++) {
+        entry = g_ptr_array_index(sandboxes, i);
+        if (0 == strcmp(entry->path, path))
+            return;
+    }
+    segment = top_map(path, verbose);
+    if (NULL == segment)
+        return;
+
+    entry = g_new0(struct top_entry, 1);
+    entry->path = g_strdup(path);
+    entry->segment = segment;
+    g_ptr_array_add(sandboxes, entry);
+}
+
+static void top_free(struct top_entry *entry)
+{
+    munmap(entry->segment, sizeof(struct monitor_segment));
+    g_free(entry->path);
+    g_free(entry);
+}
+
+/* Looks for the files of sandboxes started since the last refresh */
+static void top_scan(GPtrArray *sandboxes)
+{
+    DIR *dir;
+    struct dirent *dent;
+    gchar *path;
+
+    dir = opendir(MONITOR_DIR);
+    if (NULL == dir)
+        return;
+    while (NULL != (dent = readdir(dir))) {
+        if (!g_str_has_prefix(dent->d_name, MONITOR_PREFIX))
+            continue;
+        path = g_build_filename(MONITOR_DIR, dent->d_name, NULL);
+        top_add(sandboxes, path, false);
+        g_free(path);
+    }
+    closedir(dir);
+}
+
+static inline double top_rate(guint64 now, guint64 last, guint64 ns)
+{
+    return ns ? (now - last) * 1e9 / ns : 0.0;
+}
+
+static void top_print_json(const struct top_entry *entry, const struct monitor_counters *c)
+{
+    printf("{\"pid\":%d,\"running\":%s,\"children\":%" G_GUINT64_FORMAT ",\"events\":%" G_GUINT64_FORMAT
+            ",\"stops\":{", entry->segment->pid, entry->segment->running ? "true" : "false",
+            c->children, c->events);
+    for (unsigned int i = 0; i < MONITOR_EVENTS; i++)
+        printf("%s\"%s\":%" G_GUINT64_FORMAT, i ? "," : "", event_names[i], c->stops[i]);
+    printf("},\"syscalls\":%" G_GUINT64_FORMAT ",\"checks\":%" G_GUINT64_FORMAT ",\"denied\":%" G_GUINT64_FORMAT
+            ",\"cache_hits\":%" G_GUINT64_FORMAT ",\"cache_misses\":%" G_GUINT64_FORMAT
+            ",\"exec_hits\":%" G_GUINT64_FORMAT ",\"exec_misses\":%" G_GUINT64_FORMAT
+            ",\"ptrace_calls\":%" G_GUINT64_FORMAT ",\"cpu_ns\":%" G_GUINT64_FORMAT ",\"wall_ns\":%" G_GUINT64_FORMAT "}\n",
+            c->syscalls, c->checks, c->denied, c->cache_hits, c->cache_misses,
+            c->exec_hits, c->exec_misses, c->ptrace_calls, c->cpu_ns, c->wall_ns);
+}
+
+/* Prints the rates since the previous refresh, or since sydbox started */
+static void top_print_text(const struct top_entry *entry, const struct monitor_counters *c, guint64 ns)
+{
+    const struct monitor_counters *l = &entry->last;
+    guint64 lookups = (c->cache_hits - l->cache_hits) + (c->cache_misses - l->cache_misses);
+    guint64 forks = c->stops[E_FORK] + c->stops[E_VFORK] + c->stops[E_CLONE];
+    guint64 last_forks = l->stops[E_FORK] + l->stops[E_VFORK] + l->stops[E_CLONE];
+
+    printf("%7d %-7s %8" G_GUINT64_FORMAT " %9.0f %10.0f %7.0f %7.0f %9.0f %8" G_GUINT64_FORMAT
+            " %6.1f %9.0f %6.1f\n",
+            entry->segment->pid, entry->segment->running ? "running" : "exited", c->children,
+            top_rate(c->events, l->events, ns),
+            top_rate(c->stops[E_SYSCALL], l->stops[E_SYSCALL], ns),
+            top_rate(forks, last_forks, ns),
+            top_rate(c->stops[E_EXEC], l->stops[E_EXEC], ns),
+            top_rate(c->checks, l->checks, ns),
+            c->denied,
+            lookups ? 100.0 * (c->cache_hits - l->cache_hits) / lookups : 0.0,
+            top_rate(c->ptrace_calls, l->ptrace_calls, ns),
+            (c->wall_ns > l->wall_ns) ? 100.0 * (c->cpu_ns - l->cpu_ns) / (c->wall_ns - l->wall_ns) : 0.0);
+}
+
+static void top_refresh(GPtrArray *sandboxes)
+{
+    guint64 now, ns;
+    struct monitor_counters counters;
+
+    if (!json)
+        printf("    PID STATE   CHILDREN   STOPS/s SYSCALLS/s  FORK/s  EXEC/s  CHECKS/s   DENIED   HIT%%"
+                "  PTRACE/s   CPU%%\n");
+
+    now = top_now();
+    for (unsigned int i = 0; i < sandboxes->len; ) {
+        struct top_entry *entry = g_ptr_array_index(sandboxes, i);
+
+        if (!monitor_read(entry->segment, &counters)) {
+            g_printerr("%s: counters are being written for too long\n", entry->path);
+            ++i;
+            continue;
+        }
+        /* The first rates are averages since sydbox started. */
+        ns = entry->last_ns ? now - entry->last_ns : counters.wall_ns;
+        if (json)
+            top_print_json(entry, &counters);
+        else
+            top_print_text(entry, &counters, ns);
+        entry->last = counters;
+        entry->last_ns = now;
+
+        /* Sandboxes which exited are shown once more. */
+        if (!entry->segment->running) {
+            top_free(entry);
+            g_ptr_array_index(sandboxes, i) = g_ptr_array_index(sandboxes, sandboxes->len - 1);
+            g_ptr_array_set_size(sandboxes, sandboxes->len - 1);
+        }
+        else
+            ++i;
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    bool scan;
+    GError *parse_error = NULL;
+    GOptionContext *context;
+    GPtrArray *sandboxes;
+
+    context = g_option_context_new("[FILE...]");
+    g_option_context_add_main_entries(context, entries, PACKAGE);
+    g_option_context_set_summary(context, "Show the live counters of sandboxes started with sydbox --monitor, "
+            "looks for " MONITOR_DIR "/" MONITOR_PREFIX "* if no files are given");
+    if (!g_option_context_parse(context, &argc, &argv, &parse_error)) {
+        g_printerr("fatal: option parsing failed: %s\n", parse_error->message);
+        g_option_context_free(context);
+        g_error_free(parse_error);
+        return EXIT_FAILURE;
+    }
+    g_option_context_free(context);
+
+    if (0 >= interval) {
+        g_printerr("fatal: interval must be positive\n");
+        return EXIT_FAILURE;
+    }
+
+    sandboxes = g_ptr_array_new();
+    scan = (1 == argc);
+    for (int i = 1; i < argc; i++)
+        top_add(sandboxes, argv[i], true);
+    if (!scan && 0 == sandboxes->len)
+        return EXIT_FAILURE;
+
+    for (int n = 0; 0 == count || n < count; n++) {
+        if (0 < n)
+            g_usleep((gulong) interval * 1000000);
+        if (scan)
+            top_scan(sandboxes);
+        else if (0 == sandboxes->len)
+            break;
+        top_refresh(sandboxes);
+    }
+
+    for (unsigned int i = 0; i < sandboxes->len; i++)
+        top_free(g_ptr_array_index(sandboxes, i));
+    g_ptr_array_free(sandboxes, TRUE);
+    return EXIT_SUCCESS;
+}
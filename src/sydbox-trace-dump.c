@@ -0,0 +1,317 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* Decodes binary event traces written by sydbox --trace-file */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gprintf.h>
+
+#include "dispatch.h"
+#include "eventlog.h"
+#include "syscall.h"
+#include "trace.h"
+
+#define NSEC_PER_SEC    G_GUINT64_CONSTANT(1000000000)
+
+static gboolean json;
+static GPtrArray *strings;
+
+static GOptionEntry entries[] = {
+    { "json",   'j', 0, G_OPTION_ARG_NONE, &json,
+        "Output JSON, one object per line", NULL },
+    { NULL, -1, 0, 0, NULL, NULL, NULL },
+};
+
+static const char *result_name(gint32 result)
+{
+    switch (result) {
+        case RS_ALLOW:
+            return "allow";
+        case RS_NOWRITE:
+            return "nowrite";
+        case RS_MAGIC:
+            return "magic";
+        case RS_DENY:
+            return "deny";
+        case RS_ERROR:
+            return "error";
+        default:
+            return "unknown";
+    }
+}
+
+static const char *event_name(guint8 event)
+{
+    switch (event) {
+        case E_STOP:
+            return "stop";
+        case E_SYSCALL:
+            return "syscall";
+        case E_FORK:
+            return "fork";
+        case E_VFORK:
+            return "vfork";
+        case E_CLONE:
+            return "clone";
+        case E_EXEC:
+            return "exec";
+        case E_GENUINE:
+            return "signal";
+        case E_EXIT:
+            return "exit";
+        case E_EXIT_SIGNAL:
+            return "exit_signal";
+        case E_UNKNOWN:
+        default:
+            return "unknown";
+    }
+}
+
+static const gchar *string_get(guint32 id)
+{
+    if (id >= strings->len || NULL == g_ptr_array_index(strings, id))
+        return "?";
+    return g_ptr_array_index(strings, id);
+}
+
+static void json_string(const gchar *str)
+{
+    putchar('"');
+    for (const guchar *p = (const guchar *) str; '\0' != *p; p++) {
+        if ('"' == *p || '\\' == *p)
+            printf("\\%c", *p);
+        else if (0x20 > *p || 0x7f == *p)
+            printf("\\u%04x", *p);
+        else
+            putchar(*p);
+    }
+    putchar('"');
+}
+
+/* Reads a value out of the record, returns false if the record is short. */
+static inline bool get(const guchar **p, const guchar *end, void *val, gsize len)
+{
+    if ((gsize) (end - *p) < len)
+        return false;
+    memcpy(val, *p, len);
+    *p += len;
+    return true;
+}
+
+static bool dump_syscall(const guchar *p, const guchar *end)
+{
+    guint64 ts;
+    gint32 pid, sno, result, err, family = 0, port = 0;
+    guint8 personality, pathmask, has_addr, pad;
+    guint32 ids[4], addr = 0;
+    guint npaths = 0;
+    const char *sname;
+
+    if (!get(&p, end, &ts, 8) || !get(&p, end, &pid, 4) ||
+            !get(&p, end, &personality, 1) || !get(&p, end, &pathmask, 1) ||
+            !get(&p, end, &has_addr, 1) || !get(&p, end, &pad, 1) ||
+            !get(&p, end, &sno, 4) || !get(&p, end, &result, 4) || !get(&p, end, &err, 4))
+        return false;
+    for (unsigned int i = 0; i < 4; i++) {
+        if (pathmask & (1 << i) && !get(&p, end, &ids[npaths++], 4))
+            return false;
+    }
+    if (has_addr && (!get(&p, end, &family, 4) || !get(&p, end, &port, 4) || !get(&p, end, &addr, 4)))
+        return false;
+
+    sname = dispatch_name(personality, sno);
+    if (json) {
+        printf("{\"type\":\"syscall\",\"time\":%" G_GUINT64_FORMAT ".%09" G_GUINT64_FORMAT
+                ",\"pid\":%d,\"personality\":%u,\"sno\":%d,\"name\":\"%s\",\"result\":\"%s\",\"errno\":%d",
+                ts / NSEC_PER_SEC, ts % NSEC_PER_SEC, pid, personality, sno, sname, result_name(result), err);
+        printf(",\"paths\":[");
+        for (unsigned int i = 0, n = 0; i < 4; i++) {
+            if (pathmask & (1 << i)) {
+                printf("%s{\"arg\":%u,\"path\":", n ? "," : "", i);
+                json_string(string_get(ids[n++]));
+                putchar('}');
+            }
+        }
+        putchar(']');
+        if (has_addr) {
+            printf(",\"family\":%d,\"port\":%d,\"addr\":", family, port);
+            json_string(string_get(addr));
+        }
+        printf("}\n");
+    }
+    else {
+        printf("%" G_GUINT64_FORMAT ".%09" G_GUINT64_FORMAT " %d %s %s(%d) %s",
+                ts / NSEC_PER_SEC, ts % NSEC_PER_SEC, pid, dispatch_mode(personality),
+                sname, sno, result_name(result));
+        if (0 != err)
+            printf(" errno=%d(%s)", err, g_strerror(err));
+        for (unsigned int i = 0, n = 0; i < 4; i++) {
+            if (pathmask & (1 << i))
+                printf(" arg%u=`%s'", i, string_get(ids[n++]));
+        }
+        if (has_addr)
+            printf(" family=%d addr=`%s' port=%d", family, string_get(addr), port);
+        putchar('\n');
+    }
+    return true;
+}
+
+static bool dump_event(const guchar *p, const guchar *end)
+{
+    guint64 ts;
+    gint64 value;
+    gint32 pid;
+    guint8 event, pad[3];
+
+    if (!get(&p, end, &ts, 8) || !get(&p, end, &pid, 4) || !get(&p, end, &event, 1) ||
+            !get(&p, end, pad, 3) || !get(&p, end, &value, 8))
+        return false;
+
+    if (json)
+        printf("{\"type\":\"event\",\"time\":%" G_GUINT64_FORMAT ".%09" G_GUINT64_FORMAT
+                ",\"pid\":%d,\"event\":\"%s\",\"value\":%" G_GINT64_FORMAT "}\n",
+                ts / NSEC_PER_SEC, ts % NSEC_PER_SEC, pid, event_name(event), value);
+    else
+        printf("%" G_GUINT64_FORMAT ".%09" G_GUINT64_FORMAT " %d %s %" G_GINT64_FORMAT "\n",
+                ts / NSEC_PER_SEC, ts % NSEC_PER_SEC, pid, event_name(event), value);
+    return true;
+}
+
+static int dump(FILE *fp, const char *name)
+{
+    char magic[EVENTLOG_MAGIC_LEN];
+    guint32 version, byteorder, len;
+    guint8 type;
+    guchar *rec = NULL;
+    gsize recsize = 0;
+
+    if (1 != fread(magic, sizeof(magic), 1, fp) || 0 != memcmp(magic, EVENTLOG_MAGIC, EVENTLOG_MAGIC_LEN) ||
+            1 != fread(&version, sizeof(version), 1, fp) || 1 != fread(&byteorder, sizeof(byteorder), 1, fp)) {
+        g_printerr("%s: not a sydbox trace file\n", name);
+        return EXIT_FAILURE;
+    }
+    if (EVENTLOG_BYTEORDER != byteorder) {
+        g_printerr("%s: trace was written on a host with different byte order\n", name);
+        return EXIT_FAILURE;
+    }
+    if (EVENTLOG_VERSION != version) {
+        g_printerr("%s: unsupported trace version %u\n", name, version);
+        return EXIT_FAILURE;
+    }
+
+    strings = g_ptr_array_new();
+    while (1 == fread(&len, sizeof(len), 1, fp)) {
+        if (0 == len)
+            break;
+        if (len > recsize) {
+            recsize = len;
+            rec = g_realloc(rec, recsize);
+        }
+        if (1 != fread(rec, len, 1, fp)) {
+            g_printerr("%s: truncated record\n", name);
+            break;
+        }
+
+        type = rec[0];
+        switch (type) {
+            case EVENTLOG_RECORD_STRING:
+                {
+                    guint32 id;
+
+                    if (5 > len)
+                        goto corrupt;
+                    memcpy(&id, rec + 1, 4);
+                    if (id >= strings->len)
+                        g_ptr_array_set_size(strings, id + 1);
+                    g_free(g_ptr_array_index(strings, id));
+                    g_ptr_array_index(strings, id) = g_strndup((const gchar *) rec + 5, len - 5);
+                }
+                break;
+            case EVENTLOG_RECORD_SYSCALL:
+                if (!dump_syscall(rec + 1, rec + len))
+                    goto corrupt;
+                break;
+            case EVENTLOG_RECORD_EVENT:
+                if (!dump_event(rec + 1, rec + len))
+                    goto corrupt;
+                break;
+            default:
+                /* Skip unknown records so newer writers stay readable. */
+                break;
+        }
+        continue;
+corrupt:
+        g_printerr("%s: corrupt record of type %u\n", name, type);
+        break;
+    }
+
+    g_free(rec);
+    g_ptr_array_foreach(strings, (GFunc) g_free, NULL);
+    g_ptr_array_free(strings, TRUE);
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+    FILE *fp;
+    GError *parse_error = NULL;
+    GOptionContext *context;
+
+    context = g_option_context_new("FILE");
+    g_option_context_add_main_entries(context, entries, PACKAGE);
+    g_option_context_set_summary(context, "Decode sydbox binary event traces");
+    if (!g_option_context_parse(context, &argc, &argv, &parse_error)) {
+        g_printerr("fatal: option parsing failed: %s\n", parse_error->message);
+        g_option_context_free(context);
+        g_error_free(parse_error);
+        return EXIT_FAILURE;
+    }
+    g_option_context_free(context);
+
+    if (2 != argc) {
+        g_printerr("usage: %s [--json] FILE\n", g_get_prgname());
+        return EXIT_FAILURE;
+    }
+
+    if (0 == strcmp(argv[1], "-"))
+        fp = stdin;
+    else if (NULL == (fp = fopen(argv[1], "r"))) {
+        g_printerr("failed to open `%s': %s\n", argv[1], g_strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    dispatch_init();
+    ret = dump(fp, argv[1]);
+    dispatch_free();
+
+    if (stdin != fp)
+        fclose(fp);
+    return ret;
+}
@@ -21,79 +21,192 @@
 #include "config.h"
 #endif // HAVE_CONFIG_H
 
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-#include <fnmatch.h>
+#include <time.h>
+#include <unistd.h>
 
 #include <glib.h>
 #include <glib/gstdio.h>
 
+#include "probes.h"
 #include "sydbox-log.h"
 #include "sydbox-utils.h"
 #include "sydbox-config.h"
+#include "violation.h"
 
-void sydbox_access_violation(const pid_t pid, const gchar *path, const gchar *fmt, ...)
+void sydbox_access_violation(const pid_t pid, const gchar *sname, const gchar *path, const gchar *fmt, ...)
 {
     va_list args;
-    time_t now = time(NULL);
-
-    if (NULL != path) {
-        GSList *walk = sydbox_config_get_filters();
-        while (NULL != walk) {
-            gchar *pattern = (gchar *)walk->data;
-            if (0 == fnmatch(pattern, path, FNM_PATHNAME)) {
-                g_debug("pattern `%s' matches path `%s', ignoring the access violation", pattern, path);
-                return;
-            }
-            else
-                g_debug("pattern `%s' doesn't match path `%s'", pattern, path);
-            walk = g_slist_next(walk);
-        }
+    gchar *reason;
+    GString *msg;
+    bool colour;
+    time_t now;
+
+    if (NULL != path && sydbox_config_match_filters(path)) {
+        SYDBOX_PROBE3(access__violation, pid, path, 1);
+        g_debug("a filter matches path `%s', ignoring the access violation", path);
+        return;
     }
-
-    g_fprintf(stderr, PACKAGE "@%lu: %sAccess Violation!%s\n", now,
-              sydbox_config_get_colourise_output() ? ANSI_MAGENTA : "",
-              sydbox_config_get_colourise_output() ? ANSI_NORMAL : "");
-    g_fprintf(stderr, PACKAGE "@%lu: %sChild Process ID: %s%i%s\n", now,
-              sydbox_config_get_colourise_output() ? ANSI_MAGENTA : "",
-              sydbox_config_get_colourise_output() ? ANSI_DARK_MAGENTA : "",
-              pid,
-              sydbox_config_get_colourise_output() ? ANSI_NORMAL : "");
-    g_fprintf(stderr, PACKAGE "@%lu: %sReason: %s", now,
-              sydbox_config_get_colourise_output() ? ANSI_MAGENTA : "",
-              sydbox_config_get_colourise_output() ? ANSI_DARK_MAGENTA : "");
+    SYDBOX_PROBE3(access__violation, pid, path, 0);
 
     va_start(args, fmt);
-    g_vfprintf(stderr, fmt, args);
+    reason = g_strdup_vprintf(fmt, args);
     va_end(args);
 
-    g_fprintf(stderr, "%s\n", sydbox_config_get_colourise_output() ? ANSI_NORMAL : "");
+    if (violation_enabled()) {
+        violation_report(pid, sname, path, reason);
+        g_free(reason);
+        return;
+    }
+
+    /* One write per violation, standard error is unbuffered. */
+    now = time(NULL);
+    colour = sydbox_config_get_colourise_output();
+    msg = g_string_sized_new(256);
+    g_string_append_printf(msg, PACKAGE "@%lu: %sAccess Violation!%s\n", now,
+            colour ? ANSI_MAGENTA : "",
+            colour ? ANSI_NORMAL : "");
+    g_string_append_printf(msg, PACKAGE "@%lu: %sChild Process ID: %s%i%s\n", now,
+            colour ? ANSI_MAGENTA : "",
+            colour ? ANSI_DARK_MAGENTA : "",
+            pid,
+            colour ? ANSI_NORMAL : "");
+    g_string_append_printf(msg, PACKAGE "@%lu: %sReason: %s%s%s\n", now,
+            colour ? ANSI_MAGENTA : "",
+            colour ? ANSI_DARK_MAGENTA : "",
+            reason,
+            colour ? ANSI_NORMAL : "");
+    fputs(msg->str, stderr);
+    g_string_free(msg, TRUE);
+    g_free(reason);
 }
 
 gchar *sydbox_compress_path(const gchar * const path)
 {
     bool skip_slashes = false;
-    gchar *retval;
-    GString *compressed;
-    guint i;
+    gchar *compressed;
+    const gchar *p;
+    gsize len = 0;
 
-    compressed = g_string_sized_new(strlen(path));
+    compressed = g_malloc(strlen(path) + 1);
 
-    for (i = 0; i < strlen(path); i++) {
-        if (path[i] == '/' && skip_slashes)
+    for (p = path; '\0' != *p; p++) {
+        if (*p == '/' && skip_slashes)
             continue;
-        skip_slashes = (path[i] == '/');
+        skip_slashes = (*p == '/');
 
-        g_string_append_c(compressed, path[i]);
+        compressed[len++] = *p;
     }
 
     /* truncate trailing slashes on paths other than '/' */
-    if (compressed->len > 1 && compressed->str[compressed->len - 1] == '/')
-        g_string_truncate(compressed, compressed->len - 1);
+    if (len > 1 && compressed[len - 1] == '/')
+        --len;
+    compressed[len] = '\0';
 
-    retval = compressed->str;
-    g_string_free(compressed, FALSE);
+    return compressed;
+}
 
-    return retval;
+gssize sydbox_normalize_path(gchar *buf, gsize size, const gchar *dir, const gchar *path, pid_t pid)
+{
+    const gchar *src[2], *p, *end, *next;
+    guint nsrc, s, depth = 0;
+    gsize len = 0, n;
+    int r;
+
+    if (g_path_is_absolute(path)) {
+        src[0] = path;
+        nsrc = 1;
+    }
+    else {
+        src[0] = dir;
+        src[1] = path;
+        nsrc = 2;
+    }
+
+    if (G_UNLIKELY(size < 2))
+        goto toolong;
+    buf[len++] = '/';
+
+    for (s = 0; s < nsrc; s++) {
+        p = src[s];
+        for (;;) {
+            while ('/' == *p)
+                p++;
+            if ('\0' == *p)
+                break;
+            /* strchrnul() scans a word or a vector at a time */
+            end = strchrnul(p, '/');
+            n = end - p;
+
+            if (1 == n && '.' == p[0]) {
+                /* A trailing . stays, link/. isn't the same as link */
+                for (next = end; '/' == *next; next++)
+                    ;
+                if (1 == len || '\0' != *next || s + 1 < nsrc) {
+                    p = end;
+                    continue;
+                }
+            }
+            else if (2 == n && 1 == len && '.' == p[0] && '.' == p[1]) {
+                /* /.. is / */
+                p = end;
+                continue;
+            }
+
+            if (G_UNLIKELY(len + n + 1 >= size))
+                goto toolong;
+            if (1 < len)
+                buf[len++] = '/';
+            memcpy(buf + len, p, n);
+            len += n;
+            p = end;
+
+            if (2 == ++depth && 0 != pid && 10 == len && 0 == memcmp(buf, "/proc/self", 10)) {
+                r = snprintf(buf + 6, size - 6, "%i", pid);
+                if (G_UNLIKELY(0 > r || (gsize) r >= size - 6))
+                    goto toolong;
+                len = 6 + r;
+            }
+        }
+    }
+    buf[len] = '\0';
+    return len;
+
+toolong:
+    errno = ENAMETOOLONG;
+    return -1;
 }
 
+int sydbox_open_output(const gchar *path)
+{
+    long fd = -1;
+    gchar *end;
+    const gchar *num = NULL;
+
+    if (0 == strcmp(path, "/dev/stdout"))
+        fd = STDOUT_FILENO;
+    else if (0 == strcmp(path, "/dev/stderr"))
+        fd = STDERR_FILENO;
+    else if (g_str_has_prefix(path, "/dev/fd/"))
+        num = path + 8;
+    else if (g_str_has_prefix(path, "/proc/self/fd/"))
+        num = path + 14;
+
+    if (NULL != num && g_ascii_isdigit(*num)) {
+        errno = 0;
+        fd = strtol(num, &end, 10);
+        if (0 != errno || '\0' != *end || fd > INT_MAX)
+            fd = -1;
+    }
+    if (0 <= fd)
+        return fcntl(fd, F_DUPFD_CLOEXEC, 0);
+
+    /* These files are often created in world writable directories. */
+    return open(path, O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0644);
+}
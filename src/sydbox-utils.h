@@ -39,15 +39,18 @@
 /**
  * sydbox_access_violation:
  * @pid: process id of the process being traced
+ * @sname: name of the system call
  * @path: path that caused the access violation if any.
  * @fmt: format string (as with printf())
  * @varargs: parameters to be used with @fmt
  *
- * Raise an access violation.
+ * Raise an access violation.  It's written to the violation file if one is
+ * open, see violation.h, and to standard error otherwise.
  *
  * Since: 0.1_alpha
  **/
-void sydbox_access_violation(const pid_t pid, const gchar *path, const gchar *fmt, ...) G_GNUC_PRINTF (3, 4);
+void sydbox_access_violation(const pid_t pid, const gchar *sname, const gchar *path,
+        const gchar *fmt, ...) G_GNUC_PRINTF (4, 5);
 
 /**
  * sydbox_compress_path:
@@ -63,5 +66,42 @@ void sydbox_access_violation(const pid_t pid, const gchar *path, const gchar *fm
  **/
 gchar *sydbox_compress_path(const gchar * const path);
 
+/**
+ * sydbox_normalize_path:
+ * @buf: buffer to write the normalized path to
+ * @size: size of @buf
+ * @dir: absolute directory @path is relative to, ignored if @path is absolute
+ * @path: the path to normalize
+ * @pid: process id to substitute /proc/self with, 0 to leave it alone
+ *
+ * Joins @dir and @path, replaces runs of forward slashes with a single slash
+ * and drops trailing slashes, @c . components other than the last one and
+ * @c .. components at the root, in a single pass over both strings.  Other
+ * @c .. components are kept because a symbolic link before them may change
+ * their meaning.  This does not canonicalise the path!
+ *
+ * Returns: the length of the normalized path, or -1 with errno set to
+ * ENAMETOOLONG if it doesn't fit into @buf.
+ *
+ * Since: 0.2_alpha4
+ **/
+gssize sydbox_normalize_path(gchar *buf, gsize size, const gchar *dir, const gchar *path, pid_t pid);
+
+/**
+ * sydbox_open_output:
+ * @path: path of the file
+ *
+ * Opens a file sydbox writes its output to for writing, creating or
+ * truncating it.  A symbolic link at @path isn't followed, except for
+ * /dev/stdout, /dev/stderr, /dev/fd/N and /proc/self/fd/N which refer to a
+ * file descriptor sydbox inherited; it is duplicated instead.
+ *
+ * Returns: a file descriptor with the close-on-exec flag set, or -1 with
+ * errno set on failure; errno is ELOOP if @path is another symbolic link
+ *
+ * Since: 0.2_alpha4
+ **/
+int sydbox_open_output(const gchar *path);
+
 #endif // SYDBOX_GUARD_UTILS_H
 
@@ -27,6 +27,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -39,10 +40,16 @@
 #include <glib.h>
 #include <glib-object.h>
 
+#include "eventlog.h"
+#include "landlock.h"
 #include "net.h"
+#include "latency.h"
 #include "path.h"
+#include "probes.h"
 #include "proc.h"
+#include "profile.h"
 #include "trace.h"
+#include "verdict.h"
 #include "wrappers.h"
 #include "syscall_marshaller.h"
 #include "syscall.h"
@@ -69,8 +76,11 @@ enum {
     PROP_SYSTEMCALL_FLAGS,
 };
 
-static SystemCall *SystemCallHandler;
-static const char *sname;
+/* Each thread has a handler of its own, as lookups change it, see
+ * syscall_get_handler().
+ */
+static __thread SystemCall *SystemCallHandler;
+static __thread const char *sname;
 
 static void systemcall_set_property(GObject *obj,
                                     guint prop_id,
@@ -136,13 +146,33 @@ static bool systemcall_get_path(pid_t pid, int personality, int narg, struct che
     return true;
 }
 
+/* Returns the current working directory of the given child, reading it
+ * first if it has changed since it was last read.
+ * Returns NULL on failure and sets errno accordingly.
+ */
+static const char *systemcall_get_cwd(struct tchild *child)
+{
+    char *cwd;
+
+    if (G_LIKELY(!tchild_cwd_stale(child)))
+        return child->fs->cwd;
+
+    cwd = pgetcwd(child->pid);
+    if (NULL == cwd)
+        return NULL;
+    tchild_take_cwd(child, cwd);
+    g_debug("read current working directory `%s' of child %i", child->fs->cwd, child->pid);
+    return child->fs->cwd;
+}
+
 /* Receive dirfd argument at position narg of the given child and update data.
  * Returns FALSE and sets data->result to RS_ERROR and data->save_errno to
  * errno on failure.
- * If dirfd is AT_FDCWD it copies child->cwd to data->dirfdlist[narg].
+ * If dirfd is AT_FDCWD it copies the current working directory of the child
+ * to data->dirfdlist[narg].
  * Otherwise tries to determine the directory using pgetdir().
- * If pgetdir() fails it sets data->result to RS_DENY and child->retval to
- * -errno and returns FALSE.
+ * If pgetdir() or pgetcwd() fails it sets data->result to RS_DENY and
+ * child->retval to -errno and returns FALSE.
  * On success TRUE is returned and data->dirfdlist[narg] contains the directory
  * information about dirfd. This string should be freed after use.
  */
@@ -171,8 +201,17 @@ static bool systemcall_get_dirfd(SystemCall *self,
             return false;
         }
     }
-    else
-        data->dirfdlist[narg] = g_strdup(child->cwd);
+    else {
+        const char *cwd = systemcall_get_cwd(child);
+        if (NULL == cwd) {
+            data->result = RS_DENY;
+            child->retval = -errno;
+            g_debug("pgetcwd() failed: %s", g_strerror(errno));
+            g_debug("denying access to system call %d(%s)", self->no, sname);
+            return false;
+        }
+        data->dirfdlist[narg] = g_strdup(cwd);
+    }
     return true;
 }
 
@@ -328,19 +367,296 @@ static void systemcall_flags(SystemCall *self, gpointer ctx_ptr G_GNUC_UNUSED,
     }
 }
 
+static void magic_handle_on(context_t *ctx G_GNUC_UNUSED, struct tchild *child, const char *param G_GNUC_UNUSED)
+{
+    child->sandbox->path = true;
+    g_info("path sandboxing is now enabled for child %i", child->pid);
+}
+
+static void magic_handle_off(context_t *ctx G_GNUC_UNUSED, struct tchild *child, const char *param G_GNUC_UNUSED)
+{
+    child->sandbox->path = false;
+    g_info("path sandboxing is now disabled for child %i", child->pid);
+}
+
+static void magic_handle_toggle(context_t *ctx G_GNUC_UNUSED, struct tchild *child, const char *param G_GNUC_UNUSED)
+{
+    child->sandbox->path = !(child->sandbox->path);
+    g_info("path sandboxing is now %sabled for child %i", child->sandbox->path ? "en" : "dis", child->pid);
+}
+
+static void magic_handle_lock(context_t *ctx G_GNUC_UNUSED, struct tchild *child, const char *param G_GNUC_UNUSED)
+{
+    child->sandbox->lock = LOCK_SET;
+    g_info("access to magic commands is now denied for child %i", child->pid);
+}
+
+static void magic_handle_exec_lock(context_t *ctx G_GNUC_UNUSED, struct tchild *child, const char *param G_GNUC_UNUSED)
+{
+    child->sandbox->lock = LOCK_PENDING;
+    g_info("access to magic commands will be denied on execve() for child %i", child->pid);
+}
+
+static void magic_handle_wait_all(context_t *ctx G_GNUC_UNUSED, struct tchild *child G_GNUC_UNUSED,
+        const char *param G_GNUC_UNUSED)
+{
+    sydbox_config_set_wait_all(true);
+    g_info("tracing will be finished when all children exit");
+}
+
+static void magic_handle_wait_eldest(context_t *ctx G_GNUC_UNUSED, struct tchild *child G_GNUC_UNUSED,
+        const char *param G_GNUC_UNUSED)
+{
+    sydbox_config_set_wait_all(false);
+    g_info("tracing will be finished when the eldest child exits");
+}
+
+static void magic_handle_wrap_lstat(context_t *ctx G_GNUC_UNUSED, struct tchild *child G_GNUC_UNUSED,
+        const char *param G_GNUC_UNUSED)
+{
+    sydbox_config_set_wrap_lstat(true);
+    g_info("lstat() calls will now be wrapped");
+}
+
+static void magic_handle_nowrap_lstat(context_t *ctx G_GNUC_UNUSED, struct tchild *child G_GNUC_UNUSED,
+        const char *param G_GNUC_UNUSED)
+{
+    sydbox_config_set_wrap_lstat(false);
+    g_info("lstat() calls will now not be wrapped");
+}
+
+static void magic_handle_write(context_t *ctx, struct tchild *child, const char *param)
+{
+    pathnode_new(&(child->sandbox->write_prefixes), param, 1);
+    child->sandbox->policy = verdict_cache_policy_new(ctx->verdicts);
+    g_info("approved addwrite(\"%s\") for child %i", param, child->pid);
+}
+
+static void magic_handle_rmwrite(context_t *ctx, struct tchild *child, const char *param)
+{
+    char *rpath_sanitized;
+
+    rpath_sanitized = sydbox_compress_path(param);
+    if (NULL != child->sandbox->write_prefixes)
+        pathnode_delete(&(child->sandbox->write_prefixes), rpath_sanitized);
+    child->sandbox->policy = verdict_cache_policy_new(ctx->verdicts);
+    g_info("approved rmwrite(\"%s\") for child %i", rpath_sanitized, child->pid);
+    g_free(rpath_sanitized);
+}
+
+static void magic_handle_sandbox_exec(context_t *ctx G_GNUC_UNUSED, struct tchild *child,
+        const char *param G_GNUC_UNUSED)
+{
+    child->sandbox->exec = true;
+    g_info("execve(2) sandboxing is now enabled for child %i", child->pid);
+}
+
+static void magic_handle_sandunbox_exec(context_t *ctx G_GNUC_UNUSED, struct tchild *child,
+        const char *param G_GNUC_UNUSED)
+{
+    child->sandbox->exec = false;
+    g_info("execve(2) sandboxing is now disabled for child %i", child->pid);
+}
+
+static void magic_handle_addexec(context_t *ctx, struct tchild *child, const char *param)
+{
+    pathnode_new(&(child->sandbox->exec_prefixes), param, 1);
+    child->sandbox->exec_policy = verdict_cache_policy_new(ctx->verdicts);
+    g_info("approved addexec(\"%s\") for child %i", param, child->pid);
+}
+
+static void magic_handle_rmexec(context_t *ctx, struct tchild *child, const char *param)
+{
+    char *rpath_sanitized;
+
+    rpath_sanitized = sydbox_compress_path(param);
+    if (NULL != child->sandbox->exec_prefixes)
+        pathnode_delete(&(child->sandbox->exec_prefixes), rpath_sanitized);
+    child->sandbox->exec_policy = verdict_cache_policy_new(ctx->verdicts);
+    g_info("approved rmexec(\"%s\") for child %i", rpath_sanitized, child->pid);
+    g_free(rpath_sanitized);
+}
+
+static void magic_handle_sandbox_net(context_t *ctx G_GNUC_UNUSED, struct tchild *child,
+        const char *param G_GNUC_UNUSED)
+{
+    child->sandbox->network = true;
+    g_info("network sandboxing is now enabled for child %i", child->pid);
+}
+
+static void magic_handle_sandunbox_net(context_t *ctx G_GNUC_UNUSED, struct tchild *child,
+        const char *param G_GNUC_UNUSED)
+{
+    child->sandbox->network = false;
+    g_info("network sandboxing is now disabled for child %i", child->pid);
+}
+
+static void magic_handle_addfilter(context_t *ctx G_GNUC_UNUSED, struct tchild *child, const char *param)
+{
+    sydbox_config_addfilter(param);
+    g_info("approved addfilter(\"%s\") for child %i", param, child->pid);
+}
+
+static void magic_handle_rmfilter(context_t *ctx G_GNUC_UNUSED, struct tchild *child, const char *param)
+{
+    sydbox_config_rmfilter(param);
+    g_info("approved rmfilter(\"%s\") for child %i", param, child->pid);
+}
+
+static void magic_handle_net_allow(context_t *ctx G_GNUC_UNUSED, struct tchild *child,
+        const char *param G_GNUC_UNUSED)
+{
+    child->sandbox->network_mode = SYDBOX_NETWORK_ALLOW;
+    g_info("approved net.allow() for child %i", child->pid);
+}
+
+static void magic_handle_net_deny(context_t *ctx G_GNUC_UNUSED, struct tchild *child,
+        const char *param G_GNUC_UNUSED)
+{
+    child->sandbox->network_mode = SYDBOX_NETWORK_DENY;
+    g_info("approved net.deny() for child %i", child->pid);
+}
+
+static void magic_handle_net_local(context_t *ctx G_GNUC_UNUSED, struct tchild *child,
+        const char *param G_GNUC_UNUSED)
+{
+    child->sandbox->network_mode = SYDBOX_NETWORK_LOCAL;
+    g_info("approved net.local() for child %i", child->pid);
+}
+
+static void magic_handle_net_restrict_connect(context_t *ctx G_GNUC_UNUSED, struct tchild *child,
+        const char *param G_GNUC_UNUSED)
+{
+    child->sandbox->network_restrict_connect = true;
+    g_info("approved net.restrict.connect() for child %i", child->pid);
+}
+
+static void magic_handle_net_unrestrict_connect(context_t *ctx G_GNUC_UNUSED, struct tchild *child,
+        const char *param G_GNUC_UNUSED)
+{
+    child->sandbox->network_restrict_connect = false;
+    g_info("approved net.unrestrict.connect() for child %i", child->pid);
+}
+
+static void magic_handle_net_whitelist(context_t *ctx G_GNUC_UNUSED, struct tchild *child G_GNUC_UNUSED,
+        const char *param)
+{
+    GSList *whitelist;
+
+    whitelist = sydbox_config_get_network_whitelist();
+    if (0 > netlist_new_from_string(&whitelist, param, true))
+        g_warning("malformed whitelist address `%s'", param);
+    else
+        sydbox_config_set_network_whitelist(whitelist);
+}
+
+/* Handlers of magic commands which change the state of sydbox, indexed by
+ * the command path_magic_lookup() returns.  New commands need an entry here
+ * and one in the command table of path.c.
+ */
+static void (* const magic_handlers[MAGIC_CMD_MAX])(context_t *, struct tchild *, const char *) = {
+    [MAGIC_CMD_ON]                      = magic_handle_on,
+    [MAGIC_CMD_OFF]                     = magic_handle_off,
+    [MAGIC_CMD_TOGGLE]                  = magic_handle_toggle,
+    [MAGIC_CMD_LOCK]                    = magic_handle_lock,
+    [MAGIC_CMD_EXEC_LOCK]               = magic_handle_exec_lock,
+    [MAGIC_CMD_WAIT_ALL]                = magic_handle_wait_all,
+    [MAGIC_CMD_WAIT_ELDEST]             = magic_handle_wait_eldest,
+    [MAGIC_CMD_WRAP_LSTAT]              = magic_handle_wrap_lstat,
+    [MAGIC_CMD_NOWRAP_LSTAT]            = magic_handle_nowrap_lstat,
+    [MAGIC_CMD_WRITE]                   = magic_handle_write,
+    [MAGIC_CMD_RMWRITE]                 = magic_handle_rmwrite,
+    [MAGIC_CMD_SANDBOX_EXEC]            = magic_handle_sandbox_exec,
+    [MAGIC_CMD_SANDUNBOX_EXEC]          = magic_handle_sandunbox_exec,
+    [MAGIC_CMD_ADDEXEC]                 = magic_handle_addexec,
+    [MAGIC_CMD_RMEXEC]                  = magic_handle_rmexec,
+    [MAGIC_CMD_SANDBOX_NET]             = magic_handle_sandbox_net,
+    [MAGIC_CMD_SANDUNBOX_NET]           = magic_handle_sandunbox_net,
+    [MAGIC_CMD_ADDFILTER]               = magic_handle_addfilter,
+    [MAGIC_CMD_RMFILTER]                = magic_handle_rmfilter,
+    [MAGIC_CMD_NET_ALLOW]               = magic_handle_net_allow,
+    [MAGIC_CMD_NET_DENY]                = magic_handle_net_deny,
+    [MAGIC_CMD_NET_LOCAL]               = magic_handle_net_local,
+    [MAGIC_CMD_NET_RESTRICT_CONNECT]    = magic_handle_net_restrict_connect,
+    [MAGIC_CMD_NET_UNRESTRICT_CONNECT]  = magic_handle_net_unrestrict_connect,
+    [MAGIC_CMD_NET_WHITELIST]           = magic_handle_net_whitelist,
+};
+
+/* Applies the ;-delimited list of magic commands @list for @child, each
+ * command given relative to /dev/sydbox/.  The list is applied as a whole:
+ * if a command is unknown, is a query, is a batch itself or has a malformed
+ * argument none of them is applied.  Empty commands are skipped.
+ * Returns true if the commands were applied, false otherwise.
+ */
+static bool systemcall_magic_batch(context_t *ctx, struct tchild *child, const char *list)
+{
+    bool valid = true;
+    char **split;
+    const char *param;
+    gchar *command;
+    enum magic_command cmd;
+    GSList *commands = NULL, *walk, *netlist = NULL;
+
+    split = g_strsplit(list, CMD_BATCH_SEP, -1);
+    for (unsigned int i = 0; NULL != split[i]; i++) {
+        if ('\0' == split[i][0])
+            continue;
+        command = g_strconcat(CMD_PATH, split[i], NULL);
+        commands = g_slist_prepend(commands, command);
+        cmd = path_magic_lookup(command, &param);
+        if (NULL == magic_handlers[cmd]) {
+            g_info("unknown magic command `%s' in batch for child %i", command, child->pid);
+            valid = false;
+            break;
+        }
+        else if (MAGIC_CMD_NET_WHITELIST == cmd && 0 > netlist_new_from_string(&netlist, param, false)) {
+            g_info("malformed whitelist address `%s' in batch for child %i", param, child->pid);
+            valid = false;
+            break;
+        }
+    }
+    g_strfreev(split);
+    netlist_free(&netlist);
+
+    commands = g_slist_reverse(commands);
+    if (valid) {
+        for (walk = commands; NULL != walk; walk = g_slist_next(walk)) {
+            cmd = path_magic_lookup(walk->data, &param);
+            magic_handlers[cmd](ctx, child, param);
+        }
+    }
+    g_slist_foreach(commands, (GFunc) g_free, NULL);
+    g_slist_free(commands);
+    return valid;
+}
+
+bool syscall_magic_apply(context_t *ctx, struct tchild *child, const char *path)
+{
+    const char *param;
+    enum magic_command command;
+
+    command = path_magic_lookup(path, &param);
+    if (MAGIC_CMD_BATCH == command)
+        return systemcall_magic_batch(ctx, child, param);
+    else if (NULL == magic_handlers[command])
+        return false;
+    magic_handlers[command](ctx, child, param);
+    return true;
+}
+
 /* Checks for magic stat() calls.
  * If the stat() call is magic, this function calls trace_fake_stat() to fake
  * the stat buffer and sets data->result to RS_DENY and child->retval to 0.
  * If trace_fake_stat() fails it sets data->result to RS_ERROR and
  * data->save_errno to errno.
+ * If the stat() call is a batch of magic commands which is rejected, it sets
+ * data->result to RS_DENY and child->retval to -EINVAL.
  * If the stat() call isn't magic, this function does nothing.
  */
-static void systemcall_magic_stat(struct tchild *child, struct checkdata *data)
+static void systemcall_magic_stat(context_t *ctx, struct tchild *child, struct checkdata *data)
 {
     char *path = data->pathlist[0];
-    const char *rpath;
-    char *rpath_sanitized;
-    GSList *whitelist;
+    enum magic_command command;
 
     g_debug("checking if stat(\"%s\") is magic", path);
     if (G_LIKELY(!path_magic_dir(path))) {
@@ -348,148 +664,15 @@ static void systemcall_magic_stat(struct tchild *child, struct checkdata *data)
         return;
     }
 
-    if (path_magic_on(path)) {
-        data->result = RS_MAGIC;
-        child->sandbox->path = true;
-        g_info("path sandboxing is now enabled for child %i", child->pid);
-    }
-    else if (path_magic_off(path)) {
-        data->result = RS_MAGIC;
-        child->sandbox->path = false;
-        g_info("path sandboxing is now disabled for child %i", child->pid);
-    }
-    else if (path_magic_toggle(path)) {
-        data->result = RS_MAGIC;
-        child->sandbox->path = !(child->sandbox->path);
-        g_info("path sandboxing is now %sabled for child %i", child->sandbox->path ? "en" : "dis", child->pid);
-    }
-    else if (path_magic_lock(path)) {
-        data->result = RS_MAGIC;
-        child->sandbox->lock = LOCK_SET;
-        g_info("access to magic commands is now denied for child %i", child->pid);
-    }
-    else if (path_magic_exec_lock(path)) {
-        data->result = RS_MAGIC;
-        child->sandbox->lock = LOCK_PENDING;
-        g_info("access to magic commands will be denied on execve() for child %i", child->pid);
-    }
-    else if (path_magic_wait_all(path)) {
+    command = path_magic_lookup(path, NULL);
+    if (syscall_magic_apply(ctx, child, path))
         data->result = RS_MAGIC;
-        sydbox_config_set_wait_all(true);
-        g_info("tracing will be finished when all children exit");
-    }
-    else if (path_magic_wait_eldest(path)) {
-        data->result = RS_MAGIC;
-        sydbox_config_set_wait_all(false);
-        g_info("tracing will be finished when the eldest child exits");
-    }
-    else if (path_magic_wrap_lstat(path)) {
-        data->result = RS_MAGIC;
-        sydbox_config_set_wrap_lstat(true);
-        g_info("lstat() calls will now be wrapped");
-    }
-    else if (path_magic_nowrap_lstat(path)) {
-        data->result = RS_MAGIC;
-        sydbox_config_set_wrap_lstat(false);
-        g_info("lstat() calls will now not be wrapped");
-    }
-    else if (path_magic_write(path)) {
-        data->result = RS_MAGIC;
-        rpath = path + CMD_WRITE_LEN;
-        pathnode_new(&(child->sandbox->write_prefixes), rpath, 1);
-        g_info("approved addwrite(\"%s\") for child %i", rpath, child->pid);
-    }
-    else if (path_magic_rmwrite(path)) {
-        data->result = RS_MAGIC;
-        rpath = path + CMD_RMWRITE_LEN;
-        rpath_sanitized = sydbox_compress_path(rpath);
-        if (NULL != child->sandbox->write_prefixes)
-            pathnode_delete(&(child->sandbox->write_prefixes), rpath_sanitized);
-        g_info("approved rmwrite(\"%s\") for child %i", rpath_sanitized, child->pid);
-        g_free(rpath_sanitized);
-    }
-    else if (path_magic_sandbox_exec(path)) {
-        data->result = RS_MAGIC;
-        child->sandbox->exec = true;
-        g_info("execve(2) sandboxing is now enabled for child %i", child->pid);
-    }
-    else if (path_magic_sandunbox_exec(path)) {
-        data->result = RS_MAGIC;
-        child->sandbox->exec = false;
-        g_info("execve(2) sandboxing is now disabled for child %i", child->pid);
-    }
-    else if (path_magic_addexec(path)) {
-        data->result = RS_MAGIC;
-        rpath = path + CMD_ADDEXEC_LEN;
-        pathnode_new(&(child->sandbox->exec_prefixes), rpath, 1);
-        g_info("approved addexec(\"%s\") for child %i", rpath, child->pid);
-    }
-    else if (path_magic_rmexec(path)) {
-        data->result = RS_MAGIC;
-        rpath = path + CMD_RMEXEC_LEN;
-        rpath_sanitized = sydbox_compress_path(rpath);
-        if (NULL != child->sandbox->exec_prefixes)
-            pathnode_delete(&(child->sandbox->exec_prefixes), rpath_sanitized);
-        g_info("approved rmexec(\"%s\") for child %i", rpath_sanitized, child->pid);
-        g_free(rpath_sanitized);
-    }
-    else if (path_magic_sandbox_net(path)) {
-        data->result = RS_MAGIC;
-        child->sandbox->network = true;
-        g_info("network sandboxing is now enabled for child %i", child->pid);
-    }
-    else if (path_magic_sandunbox_net(path)) {
-        data->result = RS_MAGIC;
-        child->sandbox->network = false;
-        g_info("network sandboxing is now disabled for child %i", child->pid);
-    }
-    else if (path_magic_addfilter(path)) {
-        data->result = RS_MAGIC;
-        rpath = path + CMD_ADDFILTER_LEN;
-        sydbox_config_addfilter(rpath);
-        g_info("approved addfilter(\"%s\") for child %i", rpath, child->pid);
-    }
-    else if (path_magic_rmfilter(path)) {
-        data->result = RS_MAGIC;
-        rpath = path + CMD_RMFILTER_LEN;
-        sydbox_config_rmfilter(rpath);
-        g_info("approved rmfilter(\"%s\") for child %i", rpath, child->pid);
-    }
-    else if (path_magic_net_allow(path)) {
-        data->result = RS_MAGIC;
-        child->sandbox->network_mode = SYDBOX_NETWORK_ALLOW;
-        g_info("approved net.allow() for child %i", child->pid);
-    }
-    else if (path_magic_net_deny(path)) {
-        data->result = RS_MAGIC;
-        child->sandbox->network_mode = SYDBOX_NETWORK_DENY;
-        g_info("approved net.deny() for child %i", child->pid);
-    }
-    else if (path_magic_net_local(path)) {
-        data->result = RS_MAGIC;
-        child->sandbox->network_mode = SYDBOX_NETWORK_LOCAL;
-        g_info("approved net.local() for child %i", child->pid);
-    }
-    else if (path_magic_net_restrict_connect(path)) {
-        data->result = RS_MAGIC;
-        child->sandbox->network_restrict_connect = true;
-        g_info("approved net.restrict.connect() for child %i", child->pid);
-    }
-    else if (path_magic_net_unrestrict_connect(path)) {
-        data->result = RS_MAGIC;
-        child->sandbox->network_restrict_connect = false;
-        g_info("approved net.unrestrict.connect() for child %i", child->pid);
-    }
-    else if (path_magic_net_whitelist(path)) {
-        data->result = RS_MAGIC;
-        whitelist = sydbox_config_get_network_whitelist();
-        rpath = path + CMD_NET_WHITELIST_LEN;
-        if (0 > netlist_new_from_string(&whitelist, rpath, true))
-            g_warning("malformed whitelist address `%s'", rpath);
-        else
-            sydbox_config_set_network_whitelist(whitelist);
+    else if (MAGIC_CMD_BATCH == command) {
+        data->result = RS_DENY;
+        child->retval = -EINVAL;
+        return;
     }
-    else if (child->sandbox->path || !path_magic_enabled(path))
+    else if (child->sandbox->path || MAGIC_CMD_ENABLED != command)
         data->result = RS_MAGIC;
 
     if (data->result == RS_MAGIC) {
@@ -521,9 +704,10 @@ static void systemcall_magic_stat(struct tchild *child, struct checkdata *data)
  * If the system call isn't stat(), it does nothing and simply returns.
  * Otherwise it calls systemcall_magic_stat()
  */
-static void systemcall_magic(SystemCall *self, gpointer ctx_ptr G_GNUC_UNUSED,
+static void systemcall_magic(SystemCall *self, gpointer ctx_ptr,
                              gpointer child_ptr, gpointer data_ptr)
 {
+    context_t *ctx = (context_t *) ctx_ptr;
     struct tchild *child = (struct tchild *) child_ptr;
     struct checkdata *data = (struct checkdata *) data_ptr;
 
@@ -536,7 +720,7 @@ static void systemcall_magic(SystemCall *self, gpointer ctx_ptr G_GNUC_UNUSED,
     else if (!(self->flags & MAGIC_STAT))
         return;
 
-    systemcall_magic_stat(child, data);
+    systemcall_magic_stat(ctx, child, data);
 }
 
 /* Fourth callback for systemcall handler.
@@ -613,17 +797,41 @@ static void systemcall_resolve(SystemCall *self, gpointer ctx_ptr G_GNUC_UNUSED,
             data->resolve ? "" : "not ", self->no, sname, child->pid);
 }
 
+/* Checks path for write access.
+ * Threads share the write prefixes of their thread group, which only hold the
+ * /proc/PID entry of the group leader, so /proc/TID of the calling thread is
+ * allowed here.
+ */
+static bool systemcall_check_write(struct tchild *child, const char *path)
+{
+    int len;
+    char proc_pid[32];
+
+    if (pathlist_check(child->sandbox->write_prefixes, path))
+        return true;
+    if (child->pid == child->tgid || !sydbox_config_get_allow_proc_pid())
+        return false;
+    len = snprintf(proc_pid, sizeof(proc_pid), "/proc/%i", child->pid);
+    return 0 == strncmp(path, proc_pid, len) && ('\0' == path[len] || '/' == path[len]);
+}
+
 /* Resolves path for system calls
  * This function calls canonicalize_filename_mode() after sanitizing path
+ * If verdicts isn't NULL, the decision for the path is looked up there first
+ * and added if it isn't found; it's stored in data->verdicts.  Paths of
+ * execve(2) are decided against the exec prefixes, others against the write
+ * prefixes.
  * On success it returns resolved path.
  * On failure it sets data->result to RS_DENY and child->retval to -errno.
  */
-static gchar *systemcall_resolvepath(SystemCall *self,
+static gchar *systemcall_resolvepath(SystemCall *self, verdict_cache_t *verdicts,
                                  struct tchild *child,
                                  int narg, bool isat, struct checkdata *data)
 {
-    bool maycreat;
-    int mode;
+    bool allow, exec, maycreat;
+    int mode, op;
+    struct stat buf;
+    const struct verdict *verdict;
     if (data->open_flags & O_CREAT)
         maycreat = true;
     else if (0 == narg && self->flags & (CAN_CREAT | MUST_CREAT))
@@ -641,51 +849,102 @@ static gchar *systemcall_resolvepath(SystemCall *self,
     mode = maycreat ? CAN_ALL_BUT_LAST : CAN_EXISTING;
 
     char *path = data->pathlist[narg];
-    char *path_sanitized;
+    char sanitized[PATH_MAX];
+    char *path_sanitized = sanitized;
     char *resolved_path;
+    const char *absdir = NULL;
+    pid_t self_pid = 0;
 
     if (!g_path_is_absolute(path)) {
-        char *absdir, *abspath;
         if (isat && NULL != data->dirfdlist[narg - 1]) {
             absdir = data->dirfdlist[narg - 1];
             g_debug("adding dirfd `%s' to `%s' to make it an absolute path", absdir, path);
         }
         else {
-            absdir = child->cwd;
+            absdir = systemcall_get_cwd(child);
+            if (NULL == absdir) {
+                data->result = RS_DENY;
+                child->retval = -errno;
+                g_debug("pgetcwd() failed: %s", g_strerror(errno));
+                return NULL;
+            }
             g_debug("adding current working directory `%s' to `%s' to make it an absolute path", absdir, path);
         }
+    }
 
-        abspath = g_build_path(G_DIR_SEPARATOR_S, absdir, path, NULL);
-        path_sanitized = sydbox_compress_path(abspath);
-        g_free(abspath);
+    exec = (self->flags & EXEC_CALL) ? true : false;
+    op = (mode << 1) | (data->resolve ? 1 : 0);
+    if (NULL != verdicts && !exec) {
+        verdict = verdict_cache_lookup(verdicts, child->sandbox->policy, absdir, path, op);
+        profile_note_cache(PROFILE_CACHE_PATH, NULL != verdict);
+        if (NULL != verdict) {
+            g_debug("`%s' was decided before, it resolves to `%s'", path, verdict->rpath);
+            data->verdicts[narg] = verdict->allow ? VERDICT_ALLOW : VERDICT_DENY;
+            return g_strdup(verdict->rpath);
+        }
     }
-    else
-        path_sanitized = sydbox_compress_path (path);
 
 #ifdef HAVE_PROC_SELF
     /* Special case for /proc/self.
-     * This symbolic link resolves to /proc/PID, if we let
+     * This symbolic link resolves to /proc/TGID, if we let
      * canonicalize_filename_mode() resolve this, we'll get a different result.
      */
-    if (0 == strncmp(path_sanitized, "/proc/self", 10)) {
-        g_debug("substituting /proc/self with /proc/%i", child->pid);
-        char *tmp = g_malloc(strlen(path_sanitized) + 32);
-        snprintf(tmp, strlen(path_sanitized) + 32, "/proc/%i/%s", child->pid, path_sanitized + 10);
-        g_free(path_sanitized);
-        path_sanitized = sydbox_compress_path(tmp);
-        g_free(tmp);
-    }
+    self_pid = child->tgid;
 #endif
 
+    if (0 > sydbox_normalize_path(sanitized, sizeof(sanitized), absdir, path, self_pid)) {
+        /* The normalized path is never longer than its parts together,
+         * apart from the digits of the process id.
+         */
+        gsize size = strlen(path) + (NULL != absdir ? strlen(absdir) : 0) + 32;
+        path_sanitized = g_malloc(size);
+        sydbox_normalize_path(path_sanitized, size, absdir, path, self_pid);
+    }
+
+    /* execve(2) follows symbolic links, so does stat(), which identifies the
+     * file an exec decision was made for without walking the path.
+     */
+    if (NULL != verdicts && exec && 0 == stat(path_sanitized, &buf)) {
+        verdict = verdict_cache_lookup_exec(verdicts, child->sandbox->exec_policy, absdir, path, &buf);
+        profile_note_cache(PROFILE_CACHE_EXEC, NULL != verdict);
+        if (NULL != verdict) {
+            g_debug("`%s' was decided before, it resolves to `%s'", path, verdict->rpath);
+            data->verdicts[narg] = verdict->allow ? VERDICT_ALLOW : VERDICT_DENY;
+            if (sanitized != path_sanitized)
+                g_free(path_sanitized);
+            return g_strdup(verdict->rpath);
+        }
+    }
+
     g_debug("mode is %s resolve is %s", maycreat ? "CAN_ALL_BUT_LAST" : "CAN_EXISTING",
                                         data->resolve ? "TRUE" : "FALSE");
-    resolved_path = canonicalize_filename_mode(path_sanitized, mode, data->resolve);
+    SYDBOX_PROBE2(canonicalize__start, child->pid, path_sanitized);
+    profile_canonicalize_begin();
+    resolved_path = canonicalize_filename_mode(path_sanitized, mode, data->resolve, &data->records[narg]);
+    profile_canonicalize_end();
+    SYDBOX_PROBE2(canonicalize__done, child->pid, resolved_path);
     if (NULL == resolved_path) {
         data->result = RS_DENY;
         child->retval = -errno;
         g_debug("canonicalize_filename_mode() failed for `%s': %s", path, g_strerror(errno));
     }
-    g_free(path_sanitized);
+    else {
+        data->recorded[narg] = true;
+        if (NULL != verdicts && exec) {
+            allow = pathlist_check(child->sandbox->exec_prefixes, resolved_path);
+            data->verdicts[narg] = allow ? VERDICT_ALLOW : VERDICT_DENY;
+            if (data->records[narg].exists)
+                verdict_cache_insert_exec(verdicts, child->sandbox->exec_policy, absdir, path,
+                        &data->records[narg].st, resolved_path, allow);
+        }
+        else if (NULL != verdicts) {
+            allow = systemcall_check_write(child, resolved_path);
+            data->verdicts[narg] = allow ? VERDICT_ALLOW : VERDICT_DENY;
+            verdict_cache_insert(verdicts, child->sandbox->policy, absdir, path, op, resolved_path, allow);
+        }
+    }
+    if (sanitized != path_sanitized)
+        g_free(path_sanitized);
     return resolved_path;
 }
 
@@ -709,7 +968,7 @@ static void systemcall_canonicalize(SystemCall *self, gpointer ctx_ptr,
     if (!ctx->before_initial_execve && child->sandbox->exec && self->flags & EXEC_CALL) {
         g_debug("canonicalizing `%s' for system call %d(%s), child %i", data->pathlist[0],
                 self->no, sname, child->pid);
-        data->rpathlist[0] = systemcall_resolvepath(self, child, 0, TRUE, data);
+        data->rpathlist[0] = systemcall_resolvepath(self, ctx->verdicts, child, 0, FALSE, data);
         if (NULL == data->rpathlist[0])
             return;
         else
@@ -721,7 +980,7 @@ static void systemcall_canonicalize(SystemCall *self, gpointer ctx_ptr,
     if (self->flags & CHECK_PATH) {
         g_debug("canonicalizing `%s' for system call %d(%s), child %i", data->pathlist[0],
                 self->no, sname, child->pid);
-        data->rpathlist[0] = systemcall_resolvepath(self, child, 0, FALSE, data);
+        data->rpathlist[0] = systemcall_resolvepath(self, ctx->verdicts, child, 0, FALSE, data);
         if (NULL == data->rpathlist[0])
             return;
         else
@@ -730,7 +989,7 @@ static void systemcall_canonicalize(SystemCall *self, gpointer ctx_ptr,
     if (self->flags & CHECK_PATH2) {
         g_debug("canonicalizing `%s' for system call %d(%s), child %i", data->pathlist[1],
                 self->no, sname, child->pid);
-        data->rpathlist[1] = systemcall_resolvepath(self, child, 1, FALSE, data);
+        data->rpathlist[1] = systemcall_resolvepath(self, ctx->verdicts, child, 1, FALSE, data);
         if (NULL == data->rpathlist[1])
             return;
         else
@@ -739,7 +998,7 @@ static void systemcall_canonicalize(SystemCall *self, gpointer ctx_ptr,
     if (self->flags & CHECK_PATH_AT) {
         g_debug("canonicalizing `%s' for system call %d(%s), child %i", data->pathlist[1],
                 self->no, sname, child->pid);
-        data->rpathlist[1] = systemcall_resolvepath(self, child, 1, TRUE, data);
+        data->rpathlist[1] = systemcall_resolvepath(self, ctx->verdicts, child, 1, TRUE, data);
         if (NULL == data->rpathlist[1])
             return;
         else
@@ -748,7 +1007,7 @@ static void systemcall_canonicalize(SystemCall *self, gpointer ctx_ptr,
     if (self->flags & CHECK_PATH_AT1) {
         g_debug("canonicalizing `%s' for system call %d(%s), child %i", data->pathlist[2],
                 self->no, sname, child->pid);
-        data->rpathlist[2] = systemcall_resolvepath(self, child, 2, TRUE, data);
+        data->rpathlist[2] = systemcall_resolvepath(self, ctx->verdicts, child, 2, TRUE, data);
         if (NULL == data->rpathlist[2])
             return;
         else
@@ -757,7 +1016,7 @@ static void systemcall_canonicalize(SystemCall *self, gpointer ctx_ptr,
     if (self->flags & CHECK_PATH_AT2) {
         g_debug("canonicalizing `%s' for system call %d(%s), child %i", data->pathlist[3],
                 self->no, sname, child->pid);
-        data->rpathlist[3] = systemcall_resolvepath(self, child, 3, TRUE, data);
+        data->rpathlist[3] = systemcall_resolvepath(self, ctx->verdicts, child, 3, TRUE, data);
         if (NULL == data->rpathlist[3])
             return;
         else
@@ -769,6 +1028,7 @@ static int systemcall_check_create(SystemCall *self,
                                    struct tchild *child,
                                    int narg, struct checkdata *data)
 {
+    bool exists;
     char *path;
     struct stat buf;
 
@@ -778,7 +1038,14 @@ static int systemcall_check_create(SystemCall *self,
             (narg == 3 && self->flags & MUST_CREAT_AT2)) {
         g_debug("system call %d(%s) has one of MUST_CREAT* flags set, checking if `%s' exists",
                 self->no, sname, path);
-        if (0 == stat(path, &buf)) {
+        /* Canonicalizing the path found out already, unless its decision
+         * was taken from the verdict cache.
+         */
+        if (data->recorded[narg])
+            exists = data->records[narg].exists;
+        else
+            exists = (0 == stat(path, &buf));
+        if (exists) {
             /* The system call _has_ to create the path but it exists.
              * Deny the system call and set errno to EEXIST but don't throw
              * an access violation.
@@ -799,9 +1066,14 @@ static void systemcall_check_path(SystemCall *self,
                                   int narg, struct checkdata *data)
 {
     char *path = data->rpathlist[narg];
+    int allow_write;
 
-    g_debug("checking `%s' for write access", path);
-    int allow_write = pathlist_check(child->sandbox->write_prefixes, path);
+    if (VERDICT_UNKNOWN != data->verdicts[narg])
+        allow_write = (VERDICT_ALLOW == data->verdicts[narg]);
+    else {
+        g_debug("checking `%s' for write access", path);
+        allow_write = systemcall_check_write(child, path);
+    }
 
     if (G_UNLIKELY(!allow_write)) {
         if (systemcall_check_create(self, child, narg, data))
@@ -819,19 +1091,19 @@ static void systemcall_check_path(SystemCall *self,
 
         switch (narg) {
             case 0:
-                sydbox_access_violation(child->pid, path, "%s(\"%s\", %s)",
+                sydbox_access_violation(child->pid, sname, path, "%s(\"%s\", %s)",
                                         sname, path, MODE_STRING(self->flags));
                 break;
             case 1:
-                sydbox_access_violation(child->pid, path, "%s(?, \"%s\", %s)",
+                sydbox_access_violation(child->pid, sname, path, "%s(?, \"%s\", %s)",
                                         sname, path, MODE_STRING(self->flags));
                 break;
             case 2:
-                sydbox_access_violation(child->pid, path, "%s(?, ?, \"%s\", %s)",
+                sydbox_access_violation(child->pid, sname, path, "%s(?, ?, \"%s\", %s)",
                                         sname, path, MODE_STRING(self->flags));
                 break;
             case 3:
-                sydbox_access_violation(child->pid, path, "%s(?, ?, ?, \"%s\", %s)",
+                sydbox_access_violation(child->pid, sname, path, "%s(?, ?, ?, \"%s\", %s)",
                                         sname, path, MODE_STRING(self->flags));
                 break;
             default:
@@ -842,23 +1114,29 @@ static void systemcall_check_path(SystemCall *self,
     }
 }
 
-static bool systemcall_check_network_whitelist(struct checkdata *data)
+bool syscall_network_sandboxed(const struct tdata *sandbox, guint flags, int family)
 {
-    GSList *walk;
-    struct sydbox_addr *addr;
-
-    walk = sydbox_config_get_network_whitelist();
-    while (NULL != walk) {
-        addr = (struct sydbox_addr *) walk->data;
-        g_debug("Checking whitelisted address {family=%d addr=%s port=%d} for equality",
-                addr->family, addr->addr, addr->port);
-        if (data->family == addr->family && data->port == addr->port &&
-                0 == strncmp(data->addr, addr->addr, strlen(addr->addr) + 1)) {
-            g_debug("Whitelisted connection {family:%d addr:%s port:%d}", addr->family, addr->addr, addr->port);
-            return true;
+    return sandbox->network && sandbox->network_mode != SYDBOX_NETWORK_ALLOW &&
+        IS_NET_CALL(flags) && IS_SUPPORTED_FAMILY(family);
+}
+
+bool syscall_network_violation(const struct tdata *sandbox, guint flags, int subcall,
+        int family, int port, const char *addr)
+{
+    if (sandbox->network_mode == SYDBOX_NETWORK_DENY) {
+        g_debug("net.default is deny, checking if the connection is whitelisted");
+        return !netlist_check(sydbox_config_get_network_whitelist(), family, port, addr);
+    }
+    else if (sandbox->network_mode == SYDBOX_NETWORK_LOCAL) {
+        if (sandbox->network_restrict_connect &&
+                (NET_RESTRICTED_CALL(flags) ||
+                 (flags & DECODE_SOCKETCALL && NET_RESTRICTED_SUBCALL(subcall)))) {
+            g_debug("net.restrict_connect is set, checking if connect/sendto call is whitelisted");
+            return !netlist_check(sydbox_config_get_network_whitelist(), family, port, addr);
         }
-        walk = g_slist_next(walk);
+        return family != AF_UNIX && !net_localhost(addr);
     }
+    g_assert_not_reached();
     return false;
 }
 
@@ -873,40 +1151,19 @@ static void systemcall_check(SystemCall *self, gpointer ctx_ptr,
     if (G_UNLIKELY(RS_ALLOW != data->result))
         return;
 
-    if (child->sandbox->network &&
-            child->sandbox->network_mode != SYDBOX_NETWORK_ALLOW &&
-            IS_NET_CALL(self->flags) && IS_SUPPORTED_FAMILY(data->family)) {
-        bool violation;
-
-        violation = false;
-        if (child->sandbox->network_mode == SYDBOX_NETWORK_DENY) {
-            g_debug("net.default is deny, checking if the connection is whitelisted");
-            violation = !systemcall_check_network_whitelist(data);
-        }
-        else if (child->sandbox->network_mode == SYDBOX_NETWORK_LOCAL) {
-            if (child->sandbox->network_restrict_connect &&
-                    (NET_RESTRICTED_CALL(self->flags) ||
-                     (self->flags & DECODE_SOCKETCALL && NET_RESTRICTED_SUBCALL(data->socket_subcall)))) {
-                g_debug("net.restrict_connect is set, checking if connect/sendto call is whitelisted");
-                violation = !systemcall_check_network_whitelist(data);
-            }
-            else if (data->family != AF_UNIX && !net_localhost(data->addr))
-                violation = true;
-        }
-        else
-            g_assert_not_reached();
-
-        if (violation) {
+    if (syscall_network_sandboxed(child->sandbox, self->flags, data->family)) {
+        if (syscall_network_violation(child->sandbox, self->flags, data->socket_subcall,
+                    data->family, data->port, data->addr)) {
             switch (data->family) {
                 case AF_UNIX:
-                    sydbox_access_violation(child->pid, NULL, "%s{family=AF_UNIX path=%s}", sname, data->addr);
+                    sydbox_access_violation(child->pid, sname, NULL, "%s{family=AF_UNIX path=%s}", sname, data->addr);
                     break;
                 case AF_INET:
-                    sydbox_access_violation(child->pid, NULL, "%s{family=AF_INET addr=%s port=%d}",
+                    sydbox_access_violation(child->pid, sname, NULL, "%s{family=AF_INET addr=%s port=%d}",
                             sname, data->addr, data->port);
                     break;
                 case AF_INET6:
-                    sydbox_access_violation(child->pid, NULL, "%s{family=AF_INET6 addr=%s port=%d}",
+                    sydbox_access_violation(child->pid, sname, NULL, "%s{family=AF_INET6 addr=%s port=%d}",
                             sname, data->addr, data->port);
                     break;
                 default:
@@ -919,10 +1176,15 @@ static void systemcall_check(SystemCall *self, gpointer ctx_ptr,
     }
 
     if (!ctx->before_initial_execve && child->sandbox->exec && self->flags & EXEC_CALL) {
-        g_debug("checking `%s' for exec access", data->rpathlist[0]);
-        int allow_exec = pathlist_check(child->sandbox->exec_prefixes, data->rpathlist[0]);
+        int allow_exec;
+        if (VERDICT_UNKNOWN != data->verdicts[0])
+            allow_exec = (VERDICT_ALLOW == data->verdicts[0]);
+        else {
+            g_debug("checking `%s' for exec access", data->rpathlist[0]);
+            allow_exec = pathlist_check(child->sandbox->exec_prefixes, data->rpathlist[0]);
+        }
         if (!allow_exec) {
-            sydbox_access_violation(child->pid, data->rpathlist[0],
+            sydbox_access_violation(child->pid, sname, data->rpathlist[0],
                     "execve(\"%s\", argv[], envp[])", data->rpathlist[0]);
             data->result = RS_DENY;
             child->retval = -EACCES;
@@ -973,6 +1235,20 @@ static void systemcall_end_check(SystemCall *self, gpointer ctx_ptr,
         ctx->before_initial_execve = false;
     }
 
+    if (eventlog_enabled()) {
+        int err = 0;
+        gchar *paths[4];
+
+        if (RS_ERROR == data->result)
+            err = data->save_errno;
+        else if (RS_DENY == data->result)
+            err = -child->retval;
+        for (unsigned int i = 0; i < 4; i++)
+            paths[i] = (NULL != data->rpathlist[i]) ? data->rpathlist[i] : data->pathlist[i];
+        eventlog_syscall(child->pid, child->personality, self->no, data->result, err, paths,
+                (NULL != data->addr) ? data->family : -1, data->port, data->addr);
+    }
+
     for (unsigned int i = 0; i < 2; i++)
         g_free(data->dirfdlist[i]);
     for (unsigned int i = 0; i < 4; i++) {
@@ -1045,9 +1321,10 @@ static void systemcall_class_init(SystemCallClass *cls)
 
 GType systemcall_get_type(void)
 {
-    static GType systemcall_type = 0;
+    /* Sessions may start in several threads at once. */
+    static gsize systemcall_type = 0;
 
-    if (0 == systemcall_type) {
+    if (g_once_init_enter(&systemcall_type)) {
         static const GTypeInfo systemcall_info = {
             sizeof(SystemCallClass),
             NULL,
@@ -1061,19 +1338,18 @@ GType systemcall_get_type(void)
             NULL
         };
 
-        systemcall_type = g_type_register_static(
+        g_once_init_leave(&systemcall_type, g_type_register_static(
                 G_TYPE_OBJECT,
                 "SystemCall",
                 &systemcall_info,
-                0);
+                0));
     }
     return systemcall_type;
 }
 
 void syscall_init(void)
 {
-    static bool initialized = false;
-    if (initialized)
+    if (NULL != SystemCallHandler)
         return;
 
     g_type_init();
@@ -1088,14 +1364,14 @@ void syscall_init(void)
     g_signal_connect(SystemCallHandler, "check", (GCallback) systemcall_canonicalize, NULL);
     g_signal_connect(SystemCallHandler, "check", (GCallback) systemcall_check, NULL);
     g_signal_connect(SystemCallHandler, "check", (GCallback) systemcall_end_check, NULL);
-
-    initialized = true;
 }
 
 void syscall_free(void)
 {
-    g_object_unref(SystemCallHandler);
-    SystemCallHandler = NULL;
+    if (NULL != SystemCallHandler) {
+        g_object_unref(SystemCallHandler);
+        SystemCallHandler = NULL;
+    }
 }
 
 /* Lookup a handler for the system call.
@@ -1149,6 +1425,54 @@ static int syscall_handle_badcall(struct tchild *child)
     return 0;
 }
 
+/* Checks a system call left to Landlock once it has failed, reporting the
+ * access violation and failing it with the errno the tracer would have used.
+ * Calls Landlock allowed, or denied for other reasons, are left alone.
+ */
+static int syscall_handle_landlock(context_t *ctx, struct tchild *child)
+{
+    long ret;
+    struct checkdata data;
+    SystemCall *handler;
+
+    if (0 > trace_get_return(child->pid, &ret)) {
+        if (G_UNLIKELY(ESRCH != errno)) {
+            g_critical("failed to get return code: %s", g_strerror(errno));
+            g_printerr("failed to get return code: %s", g_strerror(errno));
+            exit(-1);
+        }
+        // Child is dead.
+        return -1;
+    }
+    /* Renaming or linking to another write prefix fails with EXDEV. */
+    if (-EACCES != ret && -EXDEV != ret)
+        return 0;
+
+    g_debug("checking system call %lu(%s) denied by Landlock", child->sno, sname);
+    handler = syscall_get_handler(child->personality, child->sno);
+    memset(&data, 0, sizeof(struct checkdata));
+    g_signal_emit_by_name(handler, "check", ctx, child, &data);
+    profile_note_check();
+    ctx->stats.checks++;
+
+    if (RS_ERROR == data.result && ESRCH == errno)
+        return -1;
+    else if (RS_DENY == data.result) {
+        profile_note_deny();
+        ctx->stats.denied++;
+        if (0 > trace_set_return(child->pid, child->retval)) {
+            if (G_UNLIKELY(ESRCH != errno)) {
+                g_critical("failed to set return code: %s", g_strerror(errno));
+                g_printerr("failed to set return code: %s", g_strerror(errno));
+                exit(-1);
+            }
+            // Child is dead.
+            return -1;
+        }
+    }
+    return 0;
+}
+
 /* chdir(2) handler for system calls.
  * This is only called when child is exiting chdir() or fchdir() system calls.
  * Returns nonzero if child is dead, zero otherwise.
@@ -1200,10 +1524,8 @@ static int syscall_handle_chdir(struct tchild *child)
             /* Successfully determined the new current working
              * directory of child. Update context.
              */
-            if (NULL != child->cwd)
-                g_free(child->cwd);
-            child->cwd = newcwd;
-            g_info("child %i has changed directory to '%s'", child->pid, child->cwd);
+            tchild_take_cwd(child, newcwd);
+            g_info("child %i has changed directory to '%s'", child->pid, child->fs->cwd);
         }
     }
     else {
@@ -1320,12 +1642,12 @@ static int syscall_handle_clone(context_t *ctx, struct tchild *child)
     newchild = tchild_find(ctx->children, retval);
     if (NULL != newchild) {
         if (newchild->flags & TCHILD_NEEDINHERIT)
-            tchild_inherit(newchild, child);
+            tchild_inherit(newchild, child, 0);
     }
     else {
         tchild_new(ctx->children, retval);
         newchild = tchild_find(ctx->children, retval);
-        tchild_inherit(newchild, child);
+        tchild_inherit(newchild, child, 0);
     }
 
     if (0 > trace_syscall(newchild->pid, 0)) {
@@ -1340,12 +1662,10 @@ static int syscall_handle_clone(context_t *ctx, struct tchild *child)
 }
 #endif // defined(POWERPC)
 
-/* Main syscall handler
- */
-int syscall_handle(context_t *ctx, struct tchild *child)
+static int syscall_handle_stop(context_t *ctx, struct tchild *child)
 {
     bool entering;
-    int flags;
+    int flags, result;
     long sno;
     struct checkdata data;
     SystemCall *handler;
@@ -1370,9 +1690,14 @@ int syscall_handle(context_t *ctx, struct tchild *child)
         }
         child->sno = sno;
         sname = dispatch_name(child->personality, child->sno);
+        ctx->stats.syscalls++;
     }
     else
         sno = child->sno;
+    profile_note_syscall(sno);
+    SYDBOX_PROBE3(syscall__entry, child->pid, sno, entering);
+
+    result = RS_ALLOW;
 
     if (entering) {
         g_debug_trace("child %i is entering system call %lu(%s)", child->pid, sno, sname);
@@ -1380,18 +1705,31 @@ int syscall_handle(context_t *ctx, struct tchild *child)
         /* Get handler for the system call
          */
         handler = syscall_get_handler(child->personality, sno);
+        if (NULL != handler && handler->flags & RESOLV_CHANGE)
+            child->flags |= TCHILD_RESOLV;
         if (NULL == handler) {
             /* There's no handler for this system call.
              * Safe system call, allow access.
              */
             g_debug_trace("allowing access to system call %lu(%s)", sno, sname);
         }
+        else if (landlock_enabled && handler->flags & LANDLOCK_CALL) {
+            /* Landlock denies writes outside the write prefixes, the system
+             * call needs to be checked only if it fails.
+             */
+            g_debug_trace("leaving system call %lu(%s) to Landlock", sno, sname);
+            child->flags |= TCHILD_LANDLOCK;
+        }
         else {
             /* There's a handler for this system call,
              * call the handler.
              */
             memset(&data, 0, sizeof(struct checkdata));
             g_signal_emit_by_name(handler, "check", ctx, child, &data);
+            profile_note_check();
+            ctx->stats.checks++;
+            latency_note_result(data.result);
+            result = data.result;
 
             /* Check result */
             switch(data.result) {
@@ -1408,6 +1746,8 @@ int syscall_handle(context_t *ctx, struct tchild *child)
                     /* fall through */
                 case RS_DENY:
                     g_debug("denying access to system call %lu(%s)", sno, sname);
+                    profile_note_deny();
+                    ctx->stats.denied++;
                     child->flags |= TCHILD_DENYSYSCALL;
                     if (0 > trace_set_syscall(child->pid, BAD_SYSCALL)) {
                         if (G_UNLIKELY(ESRCH != errno)) {
@@ -1432,6 +1772,15 @@ int syscall_handle(context_t *ctx, struct tchild *child)
     else {
         g_debug_trace("child %i is exiting system call %lu(%s)", child->pid, sno, sname);
 
+        if (child->flags & TCHILD_RESOLV) {
+            /* Symbolic links or mount points may have changed, so may the
+             * paths decided before resolve to.
+             */
+            child->flags &= ~TCHILD_RESOLV;
+            if (!(child->flags & TCHILD_DENYSYSCALL))
+                verdict_cache_invalidate(ctx->verdicts);
+        }
+
         if (child->flags & TCHILD_DENYSYSCALL) {
             /* Child is exiting a denied system call.
              */
@@ -1439,11 +1788,20 @@ int syscall_handle(context_t *ctx, struct tchild *child)
                 return context_remove_child(ctx, child->pid);
             child->flags &= ~TCHILD_DENYSYSCALL;
         }
+        else if (child->flags & TCHILD_LANDLOCK) {
+            child->flags &= ~TCHILD_LANDLOCK;
+            sname = dispatch_name(child->personality, sno);
+            if (0 > syscall_handle_landlock(ctx, child))
+                return context_remove_child(ctx, child->pid);
+        }
         else if (dispatch_chdir(child->personality, sno)) {
             /* Child is exiting a system call that may have changed its current
-             * working directory. Update current working directory.
+             * working directory. Update current working directory, or with
+             * lazy_cwd note that it needs to be read when it's used next.
              */
-            if (0 > syscall_handle_chdir(child))
+            if (sydbox_config_get_lazy_cwd())
+                tchild_cwd_changed(child);
+            else if (0 > syscall_handle_chdir(child))
                 return context_remove_child(ctx, child->pid);
         }
         else if (child->sandbox->network && child->sandbox->network_restrict_connect &&
@@ -1460,6 +1818,23 @@ int syscall_handle(context_t *ctx, struct tchild *child)
 #endif // defined(POWERPC)
     }
     child->flags ^= TCHILD_INSYSCALL;
+    SYDBOX_PROBE3(syscall__return, child->pid, sno, result);
     return 0;
 }
 
+/* Main syscall handler
+ */
+int syscall_handle(context_t *ctx, struct tchild *child)
+{
+    int ret, personality;
+
+    if (G_LIKELY(PROFILE_OFF == profile_mode))
+        return syscall_handle_stop(ctx, child);
+
+    /* The child may be removed while handling the stop. */
+    personality = child->personality;
+    profile_begin();
+    ret = syscall_handle_stop(ctx, child);
+    profile_end(personality);
+    return ret;
+}
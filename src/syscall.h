@@ -27,6 +27,7 @@
 
 #include "children.h"
 #include "context.h"
+#include "wrappers.h"
 
 enum {
     RS_ALLOW,
@@ -36,6 +37,13 @@ enum {
     RS_ERROR = EX_SOFTWARE
 };
 
+/* Decisions of path arguments taken from or added to the verdict cache */
+enum {
+    VERDICT_UNKNOWN = 0,
+    VERDICT_ALLOW,
+    VERDICT_DENY,
+};
+
 struct checkdata {
     gint result;            // Check result
     gint save_errno;        // errno when the result is RS_ERROR
@@ -46,6 +54,9 @@ struct checkdata {
     gchar *dirfdlist[2];    // dirfd arguments (resolved)
     gchar *pathlist[4];     // Path arguments
     gchar *rpathlist[4];    // Path arguments (canonicalized)
+    gint verdicts[4];       // Path arguments (decided), one of VERDICT_*
+    bool recorded[4];       // Whether the path arguments were canonicalized, not taken from the cache
+    struct canonicalize_record records[4]; // What canonicalizing the path arguments found out
 
     int socket_subcall;     // Socketcall() subcall
     int family;             // Family of destination address (AF_UNIX, AF_INET etc.)
@@ -86,5 +97,51 @@ void syscall_free(void);
 SystemCall *syscall_get_handler(int personality, int no);
 int syscall_handle(context_t *ctx, struct tchild *child);
 
+/**
+ * syscall_magic_apply:
+ * @ctx: the context
+ * @child: the child issuing the command
+ * @path: the path stat'ed by @child
+ *
+ * Applies the magic command @path for @child, like a stat() of @path does
+ * unless magic commands are locked.
+ *
+ * Returns: true if @path is a magic command which changes state and was
+ * applied, false if it's not or if it's a batch which was rejected
+ *
+ * Since: 0.2_alpha4
+ **/
+bool syscall_magic_apply(context_t *ctx, struct tchild *child, const char *path);
+
+/**
+ * syscall_network_sandboxed:
+ * @sandbox: the sandbox data of the child
+ * @flags: dispatch flags of the system call
+ * @family: family of the destination address
+ *
+ * Returns: true if the destination address of the system call is checked
+ *
+ * Since: 0.2_alpha4
+ **/
+bool syscall_network_sandboxed(const struct tdata *sandbox, guint flags, int family);
+
+/**
+ * syscall_network_violation:
+ * @sandbox: the sandbox data of the child
+ * @flags: dispatch flags of the system call
+ * @subcall: the socketcall() subcall, if @flags has %DECODE_SOCKETCALL
+ * @family: family of the destination address
+ * @port: port of the destination address
+ * @addr: the destination address
+ *
+ * Decides a system call for which syscall_network_sandboxed() is true.
+ *
+ * Returns: true if connecting to the destination address is denied
+ *
+ * Since: 0.2_alpha4
+ **/
+bool syscall_network_violation(const struct tdata *sandbox, guint flags, int subcall,
+        int family, int port, const char *addr);
+
 #endif // SYDBOX_GUARD_SYSCALL_H
 
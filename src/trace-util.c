@@ -48,6 +48,7 @@
 #include <glib.h>
 
 #include "sydbox-log.h"
+#include "trace.h"
 #include "trace-util.h"
 
 int upeek(pid_t pid, long off, long *res)
@@ -55,7 +56,7 @@ int upeek(pid_t pid, long off, long *res)
     long val;
 
     errno = 0;
-    val = ptrace(PTRACE_PEEKUSER, pid, off, NULL);
+    val = trace_ptrace(PTRACE_PEEKUSER, pid, off, NULL);
     if (G_UNLIKELY(-1 == val && 0 != errno)) {
         int save_errno = errno;
         g_info("ptrace(PTRACE_PEEKUSER,%d,%lu,NULL) failed: %s", pid, off, g_strerror(errno));
@@ -82,7 +83,7 @@ int umoven(pid_t pid, long addr, char *dest, size_t len)
         n = addr - (addr & -sizeof(long)); // residue
         addr &= -sizeof(long); // residue
         errno = 0;
-        u.val = ptrace(PTRACE_PEEKDATA, pid, (char *) addr, NULL);
+        u.val = trace_ptrace(PTRACE_PEEKDATA, pid, (char *) addr, NULL);
         if (G_UNLIKELY(0 != errno)) {
             if (G_LIKELY(started && (EPERM == errno || EIO == errno))) {
                 // Ran into end of memory - stupid "printpath"
@@ -102,7 +103,7 @@ int umoven(pid_t pid, long addr, char *dest, size_t len)
     }
     while (len > 0) {
         errno = 0;
-        u.val = ptrace(PTRACE_PEEKDATA, pid, (char *) addr, NULL);
+        u.val = trace_ptrace(PTRACE_PEEKDATA, pid, (char *) addr, NULL);
         if (G_UNLIKELY(0 != errno)) {
             if (G_LIKELY(started && (EPERM == errno || EIO == errno))) {
                 // Ran into end of memory - stupid "printpath"
@@ -137,7 +138,7 @@ int umovestr(pid_t pid, long addr, char *dest, size_t len)
         n = addr - (addr & -sizeof(long)); // residue
         addr &= -sizeof(long); // residue
         errno = 0;
-        u.val = ptrace(PTRACE_PEEKDATA, pid, (char *) addr, NULL);
+        u.val = trace_ptrace(PTRACE_PEEKDATA, pid, (char *) addr, NULL);
         if (G_UNLIKELY(0 != errno)) {
             if (G_LIKELY(started && (EPERM == errno || EIO == errno))) {
                 // Ran into end of memory - stupid "printpath"
@@ -160,7 +161,7 @@ int umovestr(pid_t pid, long addr, char *dest, size_t len)
     }
     while (len > 0) {
         errno = 0;
-        u.val = ptrace(PTRACE_PEEKDATA, pid, (char *) addr, NULL);
+        u.val = trace_ptrace(PTRACE_PEEKDATA, pid, (char *) addr, NULL);
         if (G_UNLIKELY(0 != errno)) {
             if (G_LIKELY(started && (EPERM == errno || EIO == errno))) {
                 // Ran into end of memory - stupid "printpath"
@@ -59,7 +59,7 @@ int trace_set_syscall(pid_t pid, long scno)
 {
     int save_errno;
 
-    if (G_UNLIKELY(0 > ptrace(PTRACE_POKEUSER, pid, ORIG_ACCUM, scno))) {
+    if (G_UNLIKELY(0 > trace_ptrace(PTRACE_POKEUSER, pid, ORIG_ACCUM, scno))) {
         save_errno = errno;
         g_info("failed to set syscall number to %ld for child %i: %s", scno, pid, g_strerror(errno));
         errno = save_errno;
@@ -87,7 +87,7 @@ int trace_set_return(pid_t pid, long val)
 {
     int save_errno;
 
-    if (G_UNLIKELY(0 != ptrace(PTRACE_POKEUSER, pid, ACCUM, val))) {
+    if (G_UNLIKELY(0 != trace_ptrace(PTRACE_POKEUSER, pid, ACCUM, val))) {
         save_errno = errno;
         g_info("ptrace(PTRACE_POKEUSER,%i,ACCUM,%ld) failed: %s", pid, val, g_strerror(errno));
         errno = save_errno;
@@ -171,7 +171,7 @@ int trace_fake_stat(pid_t pid, int personality)
     m = sizeof(struct stat) / sizeof(long);
     while (n < m) {
         memcpy(u.x, fakeptr, sizeof(long));
-        if (0 > ptrace(PTRACE_POKEDATA, pid, addr + n * ADDR_MUL, u.val)) {
+        if (0 > trace_ptrace(PTRACE_POKEDATA, pid, addr + n * ADDR_MUL, u.val)) {
             save_errno = errno;
             g_info("failed to set argument 1 to %p for child %i: %s", (void *) fakeptr, pid, g_strerror(errno));
             errno = save_errno;
@@ -184,7 +184,7 @@ int trace_fake_stat(pid_t pid, int personality)
     m = sizeof(struct stat) % sizeof(long);
     if (0 != m) {
         memcpy(u.x, fakeptr, m);
-        if (G_UNLIKELY(0 > ptrace(PTRACE_POKEDATA, pid, addr + n * ADDR_MUL, u.val))) {
+        if (G_UNLIKELY(0 > trace_ptrace(PTRACE_POKEDATA, pid, addr + n * ADDR_MUL, u.val))) {
             save_errno = errno;
             g_info("failed to set argument 1 to %p for child %i: %s", (void *) fakeptr, pid, g_strerror(errno));
             errno = save_errno;
@@ -19,6 +19,8 @@
 
 #include "trace.h"
 
+__thread unsigned long trace_ptrace_calls;
+
 /* Common functions are defined here for convenience.
  */
 
@@ -60,7 +62,7 @@ int trace_me(void)
 {
     int save_errno;
 
-    if (G_UNLIKELY(0 > ptrace(PTRACE_TRACEME, 0, NULL, NULL))) {
+    if (G_UNLIKELY(0 > trace_ptrace(PTRACE_TRACEME, 0, NULL, NULL))) {
         save_errno = errno;
         g_info("failed to set tracing: %s", g_strerror(errno));
         errno = save_errno;
@@ -74,7 +76,7 @@ int trace_setup(pid_t pid)
     int save_errno;
 
     g_debug("setting tracing options for child %i", pid);
-    if (G_UNLIKELY(0 > ptrace(PTRACE_SETOPTIONS, pid, NULL,
+    if (G_UNLIKELY(0 > trace_ptrace(PTRACE_SETOPTIONS, pid, NULL,
                     PTRACE_O_TRACESYSGOOD
                     | PTRACE_O_TRACECLONE
                     | PTRACE_O_TRACEFORK
@@ -92,7 +94,7 @@ int trace_cont(pid_t pid)
 {
     int save_errno;
 
-    if (G_UNLIKELY(0 > ptrace(PTRACE_CONT, pid, NULL, NULL))) {
+    if (G_UNLIKELY(0 > trace_ptrace(PTRACE_CONT, pid, NULL, NULL))) {
         save_errno = errno;
         g_info("failed to continue child %i: %s", pid, g_strerror(errno));
         errno = save_errno;
@@ -105,7 +107,7 @@ int trace_kill(pid_t pid)
 {
     int save_errno;
 
-    if (G_UNLIKELY(0 > ptrace(PTRACE_KILL, pid, NULL, NULL) && ESRCH != errno)) {
+    if (G_UNLIKELY(0 > trace_ptrace(PTRACE_KILL, pid, NULL, NULL) && ESRCH != errno)) {
         save_errno = errno;
         g_info("failed to kill child %i: %s", pid, g_strerror(errno));
         errno = save_errno;
@@ -118,7 +120,7 @@ int trace_syscall(pid_t pid, int data)
 {
     int save_errno;
 
-    if (G_UNLIKELY(0 > ptrace(PTRACE_SYSCALL, pid, NULL, data))) {
+    if (G_UNLIKELY(0 > trace_ptrace(PTRACE_SYSCALL, pid, NULL, data))) {
         save_errno = errno;
         g_info("failed to resume child %i: %s", pid, g_strerror(errno));
         errno = save_errno;
@@ -132,7 +134,7 @@ int trace_geteventmsg(pid_t pid, void *data)
 {
     int save_errno;
 
-    if (G_UNLIKELY(0 > ptrace(PTRACE_GETEVENTMSG, pid, NULL, data))) {
+    if (G_UNLIKELY(0 > trace_ptrace(PTRACE_GETEVENTMSG, pid, NULL, data))) {
         save_errno = errno;
         g_info("failed to get event message of child %i: %s", pid, g_strerror(errno));
         errno = save_errno;
@@ -56,6 +56,21 @@
 #define ADDR_MUL        ((64 == __WORDSIZE) ? 8 : 4)
 #define MAX_ARGS        6
 
+/* Number of ptrace() requests the calling thread issued through
+ * trace_ptrace(), used for profiling.  Each session runs in its own thread.
+ */
+extern __thread unsigned long trace_ptrace_calls;
+
+/**
+ * trace_ptrace:
+ *
+ * Calls ptrace() with the given arguments and counts the request.
+ *
+ * Since: 0.2_alpha4
+ **/
+#define trace_ptrace(request, pid, addr, data)   \
+    (++trace_ptrace_calls, ptrace((request), (pid), (addr), (data)))
+
 /**
  * Events
  */
@@ -0,0 +1,213 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <stdbool.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+
+#include "verdict.h"
+
+/* The cache is emptied when it grows past this many decisions */
+#define VERDICT_CACHE_MAX 4096
+
+/* Operation of exec decisions, path decisions use non-negative ones */
+#define VERDICT_OP_EXEC -1
+
+struct verdict_key
+{
+    guint hash;
+    guint policy;
+    int op;
+    const char *dir;        // NULL for absolute paths
+    const char *path;
+    char strings[];         // dir and path of keys in the table
+};
+
+struct verdict_cache
+{
+    GHashTable *table;
+    guint generation;
+    guint policies;         // Last policy allocated.
+    guint64 hits;
+    guint64 misses;
+    guint64 exec_hits;
+    guint64 exec_misses;
+};
+
+static guint verdict_key_hash(gconstpointer key)
+{
+    return ((const struct verdict_key *) key)->hash;
+}
+
+static gboolean verdict_key_equal(gconstpointer a, gconstpointer b)
+{
+    const struct verdict_key *ka = (const struct verdict_key *) a;
+    const struct verdict_key *kb = (const struct verdict_key *) b;
+
+    if (ka->hash != kb->hash || ka->policy != kb->policy || ka->op != kb->op)
+        return FALSE;
+    if (0 != strcmp(ka->path, kb->path))
+        return FALSE;
+    if (NULL == ka->dir || NULL == kb->dir)
+        return ka->dir == kb->dir;
+    return 0 == strcmp(ka->dir, kb->dir);
+}
+
+static void verdict_key_init(struct verdict_key *key, guint policy,
+        const char *dir, const char *path, int op)
+{
+    key->hash = g_str_hash(path) ^ (policy * 31 + op);
+    if (NULL != dir)
+        key->hash ^= g_str_hash(dir) * 33;
+    key->policy = policy;
+    key->op = op;
+    key->dir = dir;
+    key->path = path;
+}
+
+verdict_cache_t *verdict_cache_new(void)
+{
+    verdict_cache_t *cache = g_new0(verdict_cache_t, 1);
+
+    cache->table = g_hash_table_new_full(verdict_key_hash, verdict_key_equal, g_free, g_free);
+    return cache;
+}
+
+void verdict_cache_free(verdict_cache_t *cache)
+{
+    g_hash_table_destroy(cache->table);
+    g_free(cache);
+}
+
+guint verdict_cache_policy_new(verdict_cache_t *cache)
+{
+    return ++cache->policies;
+}
+
+void verdict_cache_invalidate(verdict_cache_t *cache)
+{
+    ++cache->generation;
+}
+
+const struct verdict *verdict_cache_lookup(verdict_cache_t *cache, guint policy,
+        const char *dir, const char *path, int op)
+{
+    struct verdict_key key;
+    const struct verdict *verdict;
+
+    verdict_key_init(&key, policy, dir, path, op);
+    verdict = g_hash_table_lookup(cache->table, &key);
+    if (NULL == verdict || verdict->generation != cache->generation) {
+        ++cache->misses;
+        return NULL;
+    }
+    ++cache->hits;
+    return verdict;
+}
+
+static struct verdict *verdict_cache_add(verdict_cache_t *cache, guint policy,
+        const char *dir, const char *path, int op,
+        const char *rpath, bool allow)
+{
+    gsize dirlen, pathlen, rpathlen;
+    struct verdict_key *key;
+    struct verdict *verdict;
+
+    if (g_hash_table_size(cache->table) >= VERDICT_CACHE_MAX) {
+        g_debug("verdict cache is full, emptying it");
+        g_hash_table_remove_all(cache->table);
+    }
+
+    dirlen = (NULL != dir) ? strlen(dir) + 1 : 0;
+    pathlen = strlen(path) + 1;
+    key = g_malloc(sizeof(struct verdict_key) + dirlen + pathlen);
+    memcpy(key->strings, path, pathlen);
+    if (NULL != dir)
+        memcpy(key->strings + pathlen, dir, dirlen);
+    verdict_key_init(key, policy, (NULL != dir) ? key->strings + pathlen : NULL, key->strings, op);
+
+    rpathlen = strlen(rpath) + 1;
+    verdict = g_malloc0(sizeof(struct verdict) + rpathlen);
+    verdict->generation = cache->generation;
+    verdict->allow = allow;
+    memcpy(verdict->rpath, rpath, rpathlen);
+
+    g_hash_table_replace(cache->table, key, verdict);
+    return verdict;
+}
+
+void verdict_cache_insert(verdict_cache_t *cache, guint policy,
+        const char *dir, const char *path, int op,
+        const char *rpath, bool allow)
+{
+    /* /proc/PID differs from child to child, see verdict.h */
+    if (0 == strncmp(rpath, "/proc", 5) && ('/' == rpath[5] || '\0' == rpath[5]))
+        return;
+
+    verdict_cache_add(cache, policy, dir, path, op, rpath, allow);
+}
+
+const struct verdict *verdict_cache_lookup_exec(verdict_cache_t *cache, guint policy,
+        const char *dir, const char *path, const struct stat *buf)
+{
+    struct verdict_key key;
+    const struct verdict *verdict;
+
+    verdict_key_init(&key, policy, dir, path, VERDICT_OP_EXEC);
+    verdict = g_hash_table_lookup(cache->table, &key);
+    if (NULL == verdict || verdict->dev != buf->st_dev || verdict->ino != buf->st_ino ||
+            verdict->nlink != buf->st_nlink || verdict->size != buf->st_size ||
+            verdict->mtime.tv_sec != buf->st_mtim.tv_sec || verdict->mtime.tv_nsec != buf->st_mtim.tv_nsec ||
+            verdict->ctime.tv_sec != buf->st_ctim.tv_sec || verdict->ctime.tv_nsec != buf->st_ctim.tv_nsec) {
+        ++cache->exec_misses;
+        return NULL;
+    }
+    ++cache->exec_hits;
+    return verdict;
+}
+
+void verdict_cache_insert_exec(verdict_cache_t *cache, guint policy,
+        const char *dir, const char *path, const struct stat *buf,
+        const char *rpath, bool allow)
+{
+    struct verdict *verdict;
+
+    verdict = verdict_cache_add(cache, policy, dir, path, VERDICT_OP_EXEC, rpath, allow);
+    verdict->dev = buf->st_dev;
+    verdict->ino = buf->st_ino;
+    verdict->nlink = buf->st_nlink;
+    verdict->size = buf->st_size;
+    verdict->mtime = buf->st_mtim;
+    verdict->ctime = buf->st_ctim;
+}
+
+void verdict_cache_get_stats(verdict_cache_t *cache, struct verdict_cache_stats *stats)
+{
+    stats->hits = cache->hits;
+    stats->misses = cache->misses;
+    stats->exec_hits = cache->exec_hits;
+    stats->exec_misses = cache->exec_misses;
+    stats->entries = g_hash_table_size(cache->table);
+}
@@ -0,0 +1,188 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SYDBOX_GUARD_VERDICT_H
+#define SYDBOX_GUARD_VERDICT_H 1
+
+#include <stdbool.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <glib.h>
+
+/* Decisions of path checks, so a path argument seen before is decided
+ * without canonicalizing it and walking the write prefixes again.  Decisions
+ * are keyed on the policy the child is checked against, the directory a
+ * relative path is looked up in, the path argument as the child passed it and
+ * how it is resolved.  A policy identifies a list of write prefixes; children
+ * whose prefixes differ in no more than their /proc/PID entries share one, so
+ * paths resolving beneath /proc are never cached.  Decisions are dropped when
+ * the generation is bumped, which happens when symbolic links or mount points
+ * may have changed.
+ *
+ * Decisions of execve(2) checks are kept apart, keyed on the exec prefixes
+ * instead.  They don't go stale with the generation but record the identity
+ * of the file the path resolved to, which a single stat() revalidates.  The
+ * identity is the inode, so a hard link to a file decided before shares its
+ * decision; creating a link changes the link count of the file and drops it.
+ * Link count and size are part of the identity as timestamps are coarse.
+ */
+typedef struct verdict_cache verdict_cache_t;
+
+struct verdict
+{
+    guint generation;       // Generation the decision was made in.
+    bool allow;             // Whether the path is beneath a write or exec prefix.
+    dev_t dev;              // Identity of the file, for exec decisions.
+    ino_t ino;
+    nlink_t nlink;
+    off_t size;
+    struct timespec mtime;
+    struct timespec ctime;
+    char rpath[];           // The canonicalized path.
+};
+
+struct verdict_cache_stats
+{
+    guint64 hits;           // Lookups answered from the cache.
+    guint64 misses;         // Lookups which weren't.
+    guint64 exec_hits;      // Likewise, for exec decisions.
+    guint64 exec_misses;
+    guint entries;          // Decisions in the cache, stale ones included.
+};
+
+/**
+ * verdict_cache_new:
+ *
+ * Returns: a new empty cache, policy 0 is the policy of the eldest child
+ *
+ * Since: 0.2_alpha4
+ **/
+verdict_cache_t *verdict_cache_new(void);
+
+/**
+ * verdict_cache_free:
+ * @cache: the cache
+ *
+ * Since: 0.2_alpha4
+ **/
+void verdict_cache_free(verdict_cache_t *cache);
+
+/**
+ * verdict_cache_policy_new:
+ * @cache: the cache
+ *
+ * Allocates an identifier for a list of write or exec prefixes which was
+ * changed.  Decisions made under other policies don't apply to it.
+ *
+ * Returns: the new policy
+ *
+ * Since: 0.2_alpha4
+ **/
+guint verdict_cache_policy_new(verdict_cache_t *cache);
+
+/**
+ * verdict_cache_invalidate:
+ * @cache: the cache
+ *
+ * Bumps the generation, so all decisions made up to now are stale.
+ *
+ * Since: 0.2_alpha4
+ **/
+void verdict_cache_invalidate(verdict_cache_t *cache);
+
+/**
+ * verdict_cache_lookup:
+ * @cache: the cache
+ * @policy: the policy of the child
+ * @dir: the directory @path is relative to, or %NULL if it's absolute
+ * @path: the path argument
+ * @op: how @path is resolved, see verdict_cache_insert()
+ *
+ * Returns: the decision, or %NULL if there's none in the current generation
+ *
+ * Since: 0.2_alpha4
+ **/
+const struct verdict *verdict_cache_lookup(verdict_cache_t *cache, guint policy,
+        const char *dir, const char *path, int op);
+
+/**
+ * verdict_cache_insert:
+ * @cache: the cache
+ * @policy: the policy of the child
+ * @dir: the directory @path is relative to, or %NULL if it's absolute
+ * @path: the path argument
+ * @op: how @path is resolved; the mode of canonicalize_filename_mode(), and
+ * whether symbolic links are resolved
+ * @rpath: the canonicalized path
+ * @allow: whether @rpath is beneath a write prefix
+ *
+ * Adds a decision, replacing a stale one with the same key.  Paths resolving
+ * beneath /proc aren't added.
+ *
+ * Since: 0.2_alpha4
+ **/
+void verdict_cache_insert(verdict_cache_t *cache, guint policy,
+        const char *dir, const char *path, int op,
+        const char *rpath, bool allow);
+
+/**
+ * verdict_cache_lookup_exec:
+ * @cache: the cache
+ * @policy: the exec policy of the child
+ * @dir: the directory @path is relative to, or %NULL if it's absolute
+ * @path: the path argument of execve(2)
+ * @buf: the result of stat() on @path
+ *
+ * Returns: the decision, or %NULL if there's none for the file described by
+ * @buf
+ *
+ * Since: 0.2_alpha4
+ **/
+const struct verdict *verdict_cache_lookup_exec(verdict_cache_t *cache, guint policy,
+        const char *dir, const char *path, const struct stat *buf);
+
+/**
+ * verdict_cache_insert_exec:
+ * @cache: the cache
+ * @policy: the exec policy of the child
+ * @dir: the directory @path is relative to, or %NULL if it's absolute
+ * @path: the path argument of execve(2)
+ * @buf: the result of stat() on @rpath
+ * @rpath: the canonicalized path
+ * @allow: whether @rpath is beneath an exec prefix
+ *
+ * Adds an exec decision, replacing the one with the same key.
+ *
+ * Since: 0.2_alpha4
+ **/
+void verdict_cache_insert_exec(verdict_cache_t *cache, guint policy,
+        const char *dir, const char *path, const struct stat *buf,
+        const char *rpath, bool allow);
+
+/**
+ * verdict_cache_get_stats:
+ * @cache: the cache
+ * @stats: location to store the counters of @cache
+ *
+ * Since: 0.2_alpha4
+ **/
+void verdict_cache_get_stats(verdict_cache_t *cache, struct verdict_cache_stats *stats);
+
+#endif // SYDBOX_GUARD_VERDICT_H
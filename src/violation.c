@@ -0,0 +1,325 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include "sydbox-utils.h"
+#include "violation.h"
+
+#define VIOLATION_BUFSIZ    65536
+
+struct violation
+{
+    guint hash;
+    pid_t pid;
+    const gchar *sname;
+    const gchar *path;      // NULL for violations without a path
+    const gchar *reason;    // Reason of the first occurrence
+    bool written;           // Whether it was written, the rate limit may delay it
+    guint64 total;
+    guint64 pending;        // Repeats in the current window
+    gchar strings[];        // sname, path and reason of violations in the table
+};
+
+struct violation_child
+{
+    guint written;          // Violations written in the current window
+    guint64 dropped;        // Violations dropped in the current window
+};
+
+static int violationfd = -1;
+static GString *buf;
+static GHashTable *violations;      // Distinct violations
+static GPtrArray *seen;             // Distinct violations in the order they were seen
+static GPtrArray *pending;          // Violations repeated in the current window
+static GHashTable *children;        // Children which wrote violations in the current window
+static time_t window;               // Start of the current window
+static guint64 total;
+static guint64 dropped;
+
+static guint violation_hash(gconstpointer key)
+{
+    return ((const struct violation *) key)->hash;
+}
+
+static gboolean violation_equal(gconstpointer a, gconstpointer b)
+{
+    const struct violation *va = (const struct violation *) a;
+    const struct violation *vb = (const struct violation *) b;
+
+    if (va->hash != vb->hash || va->pid != vb->pid || 0 != strcmp(va->sname, vb->sname))
+        return FALSE;
+    if (NULL == va->path || NULL == vb->path)
+        return va->path == vb->path && 0 == strcmp(va->reason, vb->reason);
+    return 0 == strcmp(va->path, vb->path);
+}
+
+static void violation_key_init(struct violation *v, pid_t pid, const gchar *sname,
+        const gchar *path, const gchar *reason)
+{
+    v->pid = pid;
+    v->sname = sname;
+    v->path = path;
+    v->reason = reason;
+    v->hash = g_str_hash(sname) ^ (pid * 31) ^ (g_str_hash((NULL != path) ? path : reason) * 33);
+}
+
+static void violation_write(const gchar *data, gsize len)
+{
+    while (0 < len) {
+        ssize_t n = write(violationfd, data, len);
+        if (0 > n) {
+            if (EINTR == errno)
+                continue;
+            g_warning("failed to write violations: %s", g_strerror(errno));
+            return;
+        }
+        data += n;
+        len -= n;
+    }
+}
+
+void violation_flush(void)
+{
+    if (0 > violationfd || 0 == buf->len)
+        return;
+    violation_write(buf->str, buf->len);
+    g_string_truncate(buf, 0);
+}
+
+/* Appends the string as a JSON string.  Paths needn't be UTF-8, bytes of
+ * strings which aren't are escaped one by one.
+ */
+static void violation_put_string(const gchar *str)
+{
+    bool utf8;
+
+    if (NULL == str) {
+        g_string_append(buf, "null");
+        return;
+    }
+
+    utf8 = g_utf8_validate(str, -1, NULL);
+    g_string_append_c(buf, '"');
+    for (const guchar *p = (const guchar *) str; '\0' != *p; p++) {
+        if ('"' == *p || '\\' == *p) {
+            g_string_append_c(buf, '\\');
+            g_string_append_c(buf, *p);
+        }
+        else if (0x20 > *p || (!utf8 && 0x80 <= *p))
+            g_string_append_printf(buf, "\\u%04x", *p);
+        else
+            g_string_append_c(buf, *p);
+    }
+    g_string_append_c(buf, '"');
+}
+
+/* Appends the fields identifying the violation */
+static void violation_put(const char *type, time_t now, const struct violation *v)
+{
+    g_string_append_printf(buf, "{\"type\":\"%s\",", type);
+    if (0 != now)
+        g_string_append_printf(buf, "\"time\":%lu,", (unsigned long) now);
+    g_string_append_printf(buf, "\"pid\":%i,\"syscall\":", v->pid);
+    violation_put_string(v->sname);
+    g_string_append(buf, ",\"path\":");
+    violation_put_string(v->path);
+}
+
+static inline void violation_end(void)
+{
+    g_string_append(buf, "}\n");
+    if (G_UNLIKELY(VIOLATION_BUFSIZ <= buf->len))
+        violation_flush();
+}
+
+static void violation_put_dropped(gpointer pid, gpointer child_ptr, gpointer now_ptr)
+{
+    const struct violation_child *child = (const struct violation_child *) child_ptr;
+
+    if (0 == child->dropped)
+        return;
+    g_string_append_printf(buf, "{\"type\":\"dropped\",\"time\":%lu,\"pid\":%i,\"count\":%" G_GUINT64_FORMAT,
+            (unsigned long) *(const time_t *) now_ptr, GPOINTER_TO_INT(pid), child->dropped);
+    violation_end();
+}
+
+/* Writes the counts of the window which is over and starts a new one */
+static void violation_window_close(time_t now)
+{
+    for (unsigned int i = 0; i < pending->len; i++) {
+        struct violation *v = g_ptr_array_index(pending, i);
+
+        violation_put("repeat", now, v);
+        g_string_append_printf(buf, ",\"count\":%" G_GUINT64_FORMAT, v->pending);
+        violation_end();
+        v->pending = 0;
+    }
+    g_ptr_array_set_size(pending, 0);
+
+    g_hash_table_foreach(children, violation_put_dropped, &now);
+    g_hash_table_remove_all(children);
+    window = now;
+}
+
+bool violation_open(const gchar *path)
+{
+    g_assert(0 > violationfd);
+
+    violationfd = sydbox_open_output(path);
+    if (0 > violationfd)
+        return false;
+
+    buf = g_string_sized_new(VIOLATION_BUFSIZ);
+    violations = g_hash_table_new_full(violation_hash, violation_equal, NULL, g_free);
+    seen = g_ptr_array_new();
+    pending = g_ptr_array_new();
+    children = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+    window = time(NULL);
+    total = dropped = 0;
+    return true;
+}
+
+void violation_close(void)
+{
+    time_t now;
+
+    if (0 > violationfd)
+        return;
+
+    now = time(NULL);
+    violation_window_close(now);
+    for (unsigned int i = 0; i < seen->len; i++) {
+        const struct violation *v = g_ptr_array_index(seen, i);
+
+        violation_put("total", 0, v);
+        g_string_append(buf, ",\"reason\":");
+        violation_put_string(v->reason);
+        g_string_append_printf(buf, ",\"count\":%" G_GUINT64_FORMAT, v->total);
+        violation_end();
+    }
+    g_string_append_printf(buf, "{\"type\":\"summary\",\"time\":%lu,\"violations\":%" G_GUINT64_FORMAT
+            ",\"distinct\":%u,\"dropped\":%" G_GUINT64_FORMAT "}\n",
+            (unsigned long) now, total, seen->len, dropped);
+    violation_flush();
+    close(violationfd);
+    violationfd = -1;
+
+    g_hash_table_destroy(children);
+    g_ptr_array_free(pending, TRUE);
+    g_ptr_array_free(seen, TRUE);
+    g_hash_table_destroy(violations);
+    g_string_free(buf, TRUE);
+}
+
+bool violation_enabled(void)
+{
+    return 0 <= violationfd;
+}
+
+bool violation_pending(void)
+{
+    if (0 > violationfd)
+        return false;
+    if (0 != buf->len)
+        return true;
+    return (0 != pending->len || 0 != g_hash_table_size(children)) && time(NULL) >= window + VIOLATION_WINDOW;
+}
+
+void violation_idle(void)
+{
+    time_t now;
+
+    if (0 > violationfd)
+        return;
+
+    now = time(NULL);
+    if (now >= window + VIOLATION_WINDOW)
+        violation_window_close(now);
+    violation_flush();
+}
+
+void violation_report(pid_t pid, const gchar *sname, const gchar *path, const gchar *reason)
+{
+    gsize snamelen, pathlen, reasonlen;
+    time_t now;
+    struct violation key, *v;
+    struct violation_child *child;
+
+    if (0 > violationfd)
+        return;
+
+    now = time(NULL);
+    if (now >= window + VIOLATION_WINDOW)
+        violation_window_close(now);
+    ++total;
+
+    violation_key_init(&key, pid, sname, path, reason);
+    v = g_hash_table_lookup(violations, &key);
+    if (NULL == v) {
+        snamelen = strlen(sname) + 1;
+        pathlen = (NULL != path) ? strlen(path) + 1 : 0;
+        reasonlen = strlen(reason) + 1;
+        v = g_malloc0(sizeof(struct violation) + snamelen + pathlen + reasonlen);
+        memcpy(v->strings, sname, snamelen);
+        memcpy(v->strings + snamelen + pathlen, reason, reasonlen);
+        if (NULL != path)
+            memcpy(v->strings + snamelen, path, pathlen);
+        violation_key_init(v, pid, v->strings, (NULL != path) ? v->strings + snamelen : NULL,
+                v->strings + snamelen + pathlen);
+        g_hash_table_insert(violations, v, v);
+        g_ptr_array_add(seen, v);
+    }
+    ++v->total;
+
+    /* Repeats are counted until the window is over. */
+    if (v->written) {
+        if (0 == v->pending++)
+            g_ptr_array_add(pending, v);
+        return;
+    }
+
+    child = g_hash_table_lookup(children, GINT_TO_POINTER(pid));
+    if (NULL == child) {
+        child = g_new0(struct violation_child, 1);
+        g_hash_table_insert(children, GINT_TO_POINTER(pid), child);
+    }
+    if (VIOLATION_RATE <= child->written) {
+        ++child->dropped;
+        ++dropped;
+        return;
+    }
+    ++child->written;
+    v->written = true;
+
+    violation_put("violation", now, v);
+    g_string_append(buf, ",\"reason\":");
+    violation_put_string(v->reason);
+    violation_end();
+}
@@ -0,0 +1,121 @@
+/* vim: set sw=4 sts=4 et foldmethod=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SYDBOX_GUARD_VIOLATION_H
+#define SYDBOX_GUARD_VIOLATION_H 1
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include <glib.h>
+
+/* Access violations are written to the violation file as JSON lines instead
+ * of to standard error, through a buffer.  Each distinct violation, one per
+ * child, system call and path, or per child and reason for violations without
+ * a path, is written once:
+ *   {"type":"violation","time":T,"pid":P,"syscall":S,"path":F,"reason":R}
+ * Repeats are counted and written once a window of VIOLATION_WINDOW seconds
+ * is over:
+ *   {"type":"repeat","time":T,"pid":P,"syscall":S,"path":F,"count":N}
+ * A child writes at most VIOLATION_RATE violations in a window, further new
+ * ones are counted and written when the window is over:
+ *   {"type":"dropped","time":T,"pid":P,"count":N}
+ * When the file is closed each distinct violation is written with its total
+ * count, followed by the summary:
+ *   {"type":"total","pid":P,"syscall":S,"path":F,"reason":R,"count":N}
+ *   {"type":"summary","time":T,"violations":N,"distinct":N,"dropped":N}
+ * path is null for violations without one.
+ */
+#define VIOLATION_WINDOW    1
+#define VIOLATION_RATE      64
+
+/**
+ * violation_open:
+ * @path: path of the violation file
+ *
+ * Opens the violation file for writing, see sydbox_open_output().
+ *
+ * Returns: true on success, false on failure and sets errno accordingly
+ *
+ * Since: 0.2_alpha4
+ **/
+bool violation_open(const gchar *path);
+
+/**
+ * violation_close:
+ *
+ * Writes the counts which are left, the totals and the summary and closes the
+ * violation file.
+ *
+ * Since: 0.2_alpha4
+ **/
+void violation_close(void);
+
+/**
+ * violation_enabled:
+ *
+ * Returns: true if a violation file is open
+ *
+ * Since: 0.2_alpha4
+ **/
+bool violation_enabled(void);
+
+/**
+ * violation_flush:
+ *
+ * Writes out the buffered records.
+ *
+ * Since: 0.2_alpha4
+ **/
+void violation_flush(void);
+
+/**
+ * violation_pending:
+ *
+ * Returns: true if there are lines waiting to be written, buffered or counted
+ * in a window which is over
+ *
+ * Since: 0.2_alpha4
+ **/
+bool violation_pending(void);
+
+/**
+ * violation_idle:
+ *
+ * Writes the counts of the window if it's over and the buffered lines.  Call
+ * this at idle points, so that the file can be followed while sydbox runs.
+ *
+ * Since: 0.2_alpha4
+ **/
+void violation_idle(void);
+
+/**
+ * violation_report:
+ * @pid: process id of the child
+ * @sname: name of the system call
+ * @path: path that caused the access violation, may be %NULL
+ * @reason: description of the access violation
+ *
+ * Records an access violation.
+ *
+ * Since: 0.2_alpha4
+ **/
+void violation_report(pid_t pid, const gchar *sname, const gchar *path, const gchar *reason);
+
+#endif // SYDBOX_GUARD_VIOLATION_H
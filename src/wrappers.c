@@ -319,14 +319,20 @@ static int elstat(const char *path, struct stat *buf)
 /* Return the canonical absolute name of file NAME.  A canonical name
    does not contain any `.', `..' components nor any repeated file name
    separators ('/') or symlinks.  Whether components must exist
-   or not depends on canonicalize mode.  The result is malloc'd.  */
+   or not depends on canonicalize mode.  The result is malloc'd.
+   If RECORD isn't NULL, it's filled in with what was found out about
+   the canonical name, so callers needn't stat() it again.  */
 
 gchar *
 canonicalize_filename_mode (const gchar *name,
                             canonicalize_mode_t can_mode,
-                            bool resolve)
+                            bool resolve,
+                            struct canonicalize_record *record)
 {
     int readlinks = 0;
+    bool followed = false;
+    bool last_known = false;    /* whether st describes rname */
+    struct stat st;
     char *rname, *dest, *extra_buf = NULL;
     char const *start;
     char const *end;
@@ -380,10 +386,9 @@ canonicalize_filename_mode (const gchar *name,
             /* Back up to previous component, ignore if at root already.  */
             if (dest > rname + 1)
                 while ((--dest)[-1] != '/');
+            last_known = false;
         }
         else {
-            struct stat st;
-
             if (dest[-1] != '/')
                 *dest++ = '/';
 
@@ -412,6 +417,7 @@ canonicalize_filename_mode (const gchar *name,
                     goto error;
                 st.st_mode = 0;
             }
+            last_known = true;
 
             if (S_ISLNK (st.st_mode)) {
                 char *buf;
@@ -419,6 +425,8 @@ canonicalize_filename_mode (const gchar *name,
 
                 if (!resolve)
                     continue;
+                followed = true;
+                last_known = false;
 
                 /* Protect against infinite loops */
                 if (readlinks++ > MAXSYMLINKS) {
@@ -468,6 +476,15 @@ canonicalize_filename_mode (const gchar *name,
         --dest;
     *dest = '\0';
 
+    if (record != NULL) {
+        /* The name ended in `..' or a symlink to the root directory */
+        if (!last_known && elstat (rname, &st) != 0)
+            st.st_mode = 0;
+        record->exists = (st.st_mode != 0);
+        record->symlinks = followed;
+        record->st = st;
+    }
+
     g_free (extra_buf);
     return rname;
 
@@ -22,6 +22,7 @@
 #define SYDBOX_GUARD_WRAPPERS_H 1
 
 #include <stdbool.h>
+#include <sys/stat.h>
 
 #include <glib.h>
 
@@ -41,7 +42,16 @@ gchar *egetcwd(void);
 
 int echdir(gchar *dir);
 
-gchar *canonicalize_filename_mode(const gchar *name, canonicalize_mode_t can_mode, bool resolve);
+/* What canonicalize_filename_mode() found out on the way */
+struct canonicalize_record
+{
+    bool exists;        // Whether the canonical path exists.
+    bool symlinks;      // Whether a symbolic link was followed.
+    struct stat st;     // lstat() of the canonical path, its type, device and inode, if it exists.
+};
+
+gchar *canonicalize_filename_mode(const gchar *name, canonicalize_mode_t can_mode, bool resolve,
+        struct canonicalize_record *record);
 
 #endif // SYDBOX_GUARD_WRAPPERS_H
 
@@ -0,0 +1,179 @@
+/* vim: set et ts=4 sts=4 sw=4 fdm=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <errno.h>
+#include <ftw.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+
+#include <wrappers.h>
+
+#include "bench.h"
+
+#define DEEP_DEPTH      32
+#define CHAIN_LENGTH    16
+#define HOPS            8
+
+struct canonicalize_case {
+    gchar *path;
+    canonicalize_mode_t mode;
+};
+
+static void
+bench_canonicalize_filename_mode (gpointer data)
+{
+    const struct canonicalize_case *c = data;
+    gchar *resolved = canonicalize_filename_mode (c->path, c->mode, true, NULL);
+
+    bench_use (resolved);
+    g_free (resolved);
+}
+
+static void
+xmkdir (const gchar *path)
+{
+    if (0 > mkdir (path, 0700)) {
+        g_printerr ("failed to create directory `%s': %s\n", path, g_strerror (errno));
+        exit (EXIT_FAILURE);
+    }
+}
+
+static void
+xsymlink (const gchar *target, const gchar *path)
+{
+    if (0 > symlink (target, path)) {
+        g_printerr ("failed to create symlink `%s': %s\n", path, g_strerror (errno));
+        exit (EXIT_FAILURE);
+    }
+}
+
+static void
+xtouch (const gchar *path)
+{
+    if (!g_file_set_contents (path, "", 0, NULL)) {
+        g_printerr ("failed to create file `%s'\n", path);
+        exit (EXIT_FAILURE);
+    }
+}
+
+static int
+remove_one (const char *path, const struct stat *st G_GNUC_UNUSED,
+            int flag G_GNUC_UNUSED, struct FTW *ftw G_GNUC_UNUSED)
+{
+    return remove (path);
+}
+
+static void
+run (const gchar *name, gchar *path, canonicalize_mode_t mode)
+{
+    struct canonicalize_case c = { path, mode };
+    gchar *check = canonicalize_filename_mode (path, mode, true, NULL);
+
+    if (NULL == check) {
+        g_printerr ("failed to resolve `%s': %s\n", path, g_strerror (errno));
+        exit (EXIT_FAILURE);
+    }
+    g_free (check);
+
+    bench_run (name, bench_canonicalize_filename_mode, &c);
+    g_free (path);
+}
+
+void
+bench_canonicalize (void)
+{
+    gchar *tmpdir, *dir, *path;
+    GString *deep, *hops;
+
+    tmpdir = g_build_filename (g_get_tmp_dir (), "sydbox-bench-XXXXXX", NULL);
+    if (NULL == mkdtemp (tmpdir)) {
+        g_printerr ("failed to create temporary directory: %s\n", g_strerror (errno));
+        exit (EXIT_FAILURE);
+    }
+
+    /* deep/d00/d01/.../d31/file */
+    deep = g_string_new (tmpdir);
+    g_string_append (deep, "/deep");
+    xmkdir (deep->str);
+    for (guint i = 0; i < DEEP_DEPTH; i++) {
+        g_string_append_printf (deep, "/d%02u", i);
+        xmkdir (deep->str);
+    }
+    path = g_strconcat (deep->str, "/file", NULL);
+    xtouch (path);
+    run ("canonicalize/deep-32/existing", path, CAN_EXISTING);
+    run ("canonicalize/deep-32/all-but-last", g_strconcat (deep->str, "/newfile", NULL), CAN_ALL_BUT_LAST);
+    g_string_free (deep, TRUE);
+
+    /* chain/l15 -> l14 -> ... -> l00 -> file */
+    dir = g_build_filename (tmpdir, "chain", NULL);
+    xmkdir (dir);
+    path = g_build_filename (dir, "file", NULL);
+    xtouch (path);
+    g_free (path);
+    for (guint i = 0; i < CHAIN_LENGTH; i++) {
+        gchar *target = (0 == i) ? g_strdup ("file") : g_strdup_printf ("l%02u", i - 1);
+        gchar *link = g_strdup_printf ("%s/l%02u", dir, i);
+        xsymlink (target, link);
+        g_free (target);
+        g_free (link);
+    }
+    run ("canonicalize/symlink-chain-16", g_strdup_printf ("%s/l%02u", dir, CHAIN_LENGTH - 1), CAN_EXISTING);
+    g_free (dir);
+
+    /* hop/r0/next/next/.../file, every next is a symlink to ../rN+1 */
+    dir = g_build_filename (tmpdir, "hop", NULL);
+    xmkdir (dir);
+    hops = g_string_new (dir);
+    g_string_append (hops, "/r0");
+    for (guint i = 0; i <= HOPS; i++) {
+        gchar *rdir = g_strdup_printf ("%s/r%u", dir, i);
+        xmkdir (rdir);
+        if (i < HOPS) {
+            gchar *target = g_strdup_printf ("../r%u", i + 1);
+            gchar *link = g_strconcat (rdir, "/next", NULL);
+            xsymlink (target, link);
+            g_free (target);
+            g_free (link);
+            g_string_append (hops, "/next");
+        }
+        else {
+            path = g_strconcat (rdir, "/file", NULL);
+            xtouch (path);
+            g_free (path);
+        }
+        g_free (rdir);
+    }
+    g_string_append (hops, "/file");
+    run ("canonicalize/symlink-dirs-8", g_string_free (hops, FALSE), CAN_EXISTING);
+    g_free (dir);
+
+    nftw (tmpdir, remove_one, 16, FTW_DEPTH | FTW_PHYS);
+    g_free (tmpdir);
+}
@@ -0,0 +1,80 @@
+/* vim: set et ts=4 sts=4 sw=4 fdm=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <glib.h>
+
+#include <dispatch.h>
+
+#include "bench.h"
+
+#if defined(X86_64)
+#define PERSONALITIES   2
+#else
+#define PERSONALITIES   1
+#endif
+
+/* A mix of checked, unchecked and unknown system call numbers */
+static const int snos[] = { 0, 1, 2, 3, 4, 5, 20, 39, 83, 90, 257, 9999 };
+
+struct dispatch_case {
+    int personality;
+    guint next;
+};
+
+static void
+bench_dispatch_lookup (gpointer data)
+{
+    struct dispatch_case *c = data;
+    int sno = snos[c->next++ % G_N_ELEMENTS (snos)];
+
+    bench_use (GINT_TO_POINTER (dispatch_lookup (c->personality, sno)));
+}
+
+static void
+bench_dispatch_name (gpointer data)
+{
+    struct dispatch_case *c = data;
+    int sno = snos[c->next++ % G_N_ELEMENTS (snos)];
+
+    bench_use (dispatch_name (c->personality, sno));
+}
+
+void
+bench_dispatch (void)
+{
+    gchar *name;
+
+    dispatch_init ();
+    for (int personality = 0; personality < PERSONALITIES; personality++) {
+        struct dispatch_case c = { personality, 0 };
+
+        name = g_strdup_printf ("dispatch_lookup/personality-%d", personality);
+        bench_run (name, bench_dispatch_lookup, &c);
+        g_free (name);
+
+        name = g_strdup_printf ("dispatch_name/personality-%d", personality);
+        bench_run (name, bench_dispatch_name, &c);
+        g_free (name);
+    }
+    dispatch_free ();
+}
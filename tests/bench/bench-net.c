@@ -0,0 +1,77 @@
+/* vim: set et ts=4 sts=4 sw=4 fdm=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdbool.h>
+#include <sys/socket.h>
+
+#include <glib.h>
+
+#include <net.h>
+
+#include "bench.h"
+
+struct net_case {
+    GSList *netlist;
+    int family;
+    int port;
+    const char *addr;
+};
+
+static void
+bench_netlist_check (gpointer data)
+{
+    const struct net_case *c = data;
+    bench_use (GINT_TO_POINTER (netlist_check (c->netlist, c->family, c->port, c->addr)));
+}
+
+void
+bench_net (void)
+{
+    static const guint sizes[] = { 1, 10, 100 };
+    gchar *name;
+
+    for (guint i = 0; i < G_N_ELEMENTS (sizes); i++) {
+        struct net_case c = { NULL, AF_INET, 0, NULL };
+
+        /* Added first, so it's the last one to be looked at */
+        netlist_new_from_string (&c.netlist, "inet://127.0.0.1:3306", false);
+        for (guint j = 1; j < sizes[i]; j++) {
+            gchar *addr = (j % 2)
+                ? g_strdup_printf ("unix:///var/run/service-%u.sock", j)
+                : g_strdup_printf ("inet://10.0.%u.%u:%u", j / 256, j % 256, 1024 + j);
+            netlist_new_from_string (&c.netlist, addr, false);
+            g_free (addr);
+        }
+
+        c.port = 3306;
+        c.addr = "127.0.0.1";
+        name = g_strdup_printf ("netlist_check/%u/hit-last", sizes[i]);
+        bench_run (name, bench_netlist_check, &c);
+        g_free (name);
+
+        c.family = AF_UNIX;
+        c.port = -1;
+        c.addr = "/tmp/.X11-unix/X0";
+        name = g_strdup_printf ("netlist_check/%u/miss", sizes[i]);
+        bench_run (name, bench_netlist_check, &c);
+        g_free (name);
+
+        netlist_free (&c.netlist);
+    }
+}
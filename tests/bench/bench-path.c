@@ -0,0 +1,160 @@
+/* vim: set et ts=4 sts=4 sw=4 fdm=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <limits.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include <path.h>
+#include <sydbox-utils.h>
+
+#include "bench.h"
+
+struct pathlist_case {
+    GSList *pathlist;
+    const gchar *path;
+};
+
+static void
+bench_pathlist_check (gpointer data)
+{
+    const struct pathlist_case *c = data;
+    bench_use (GINT_TO_POINTER (pathlist_check (c->pathlist, c->path)));
+}
+
+static void
+bench_normalize_path (gpointer data)
+{
+    gchar buf[PATH_MAX];
+    bench_use (GINT_TO_POINTER (sydbox_normalize_path (buf, sizeof (buf),
+                    "/var/tmp/paludis/build/sys-apps/sydbox-0.2/work/sydbox-0.2", data, 42)));
+}
+
+static void
+bench_compress_path (gpointer data)
+{
+    gchar *compressed = sydbox_compress_path (data);
+    bench_use (compressed);
+    g_free (compressed);
+}
+
+/* The predicates in the order systemcall_magic_stat() tries them */
+static bool (* const magic_chain[]) (const char *) = {
+    path_magic_on,
+    path_magic_off,
+    path_magic_toggle,
+    path_magic_lock,
+    path_magic_exec_lock,
+    path_magic_wait_all,
+    path_magic_wait_eldest,
+    path_magic_wrap_lstat,
+    path_magic_nowrap_lstat,
+    path_magic_write,
+    path_magic_rmwrite,
+    path_magic_sandbox_exec,
+    path_magic_sandunbox_exec,
+    path_magic_addexec,
+    path_magic_rmexec,
+    path_magic_sandbox_net,
+    path_magic_sandunbox_net,
+    path_magic_addfilter,
+    path_magic_rmfilter,
+    path_magic_net_allow,
+    path_magic_net_deny,
+    path_magic_net_local,
+    path_magic_net_restrict_connect,
+    path_magic_net_unrestrict_connect,
+    path_magic_net_whitelist,
+    path_magic_enabled,
+};
+
+static void
+bench_magic_chain (gpointer data)
+{
+    const char *path = data;
+    unsigned int i;
+
+    if (!path_magic_dir (path)) {
+        bench_use (NULL);
+        return;
+    }
+    for (i = 0; i < G_N_ELEMENTS (magic_chain); i++) {
+        if (magic_chain[i] (path))
+            break;
+    }
+    bench_use (GUINT_TO_POINTER (i));
+}
+
+void
+bench_path (void)
+{
+    static const guint sizes[] = { 1, 10, 100, 1000 };
+    gchar *name, *pathological;
+    GString *slashes;
+
+    for (guint i = 0; i < G_N_ELEMENTS (sizes); i++) {
+        struct pathlist_case c = { NULL, NULL };
+
+        /* The matching prefix is added first so that it's the last one
+         * pathlist_check() looks at.
+         */
+        pathnode_new (&c.pathlist, "/var/tmp/paludis", 0);
+        for (guint j = 1; j < sizes[i]; j++) {
+            gchar *prefix = g_strdup_printf ("/var/tmp/prefix-%04u", j);
+            pathnode_new (&c.pathlist, prefix, 0);
+            g_free (prefix);
+        }
+
+        c.path = "/var/tmp/paludis/build/sys-apps/sydbox-0.2/work/src/main.o";
+        name = g_strdup_printf ("pathlist_check/%u/hit-last", sizes[i]);
+        bench_run (name, bench_pathlist_check, &c);
+        g_free (name);
+
+        c.path = "/usr/lib/libc.so.6";
+        name = g_strdup_printf ("pathlist_check/%u/miss", sizes[i]);
+        bench_run (name, bench_pathlist_check, &c);
+        g_free (name);
+
+        pathnode_free (&c.pathlist);
+    }
+
+    bench_run ("sydbox_compress_path/typical", bench_compress_path,
+            "/var/tmp/paludis/build/sys-apps/sydbox-0.2/work/sydbox-0.2/src/main.c");
+    bench_run ("sydbox_compress_path/double-slashes", bench_compress_path,
+            "//var//tmp//paludis//build//sys-apps//sydbox-0.2//work//src//main.c");
+    slashes = g_string_new ("");
+    for (guint i = 0; i < 256; i++)
+        g_string_append (slashes, "////////////////a");
+    pathological = g_string_free (slashes, FALSE);
+    bench_run ("sydbox_compress_path/4k-slashes", bench_compress_path, pathological);
+    g_free (pathological);
+
+    bench_run ("sydbox_normalize_path/relative", bench_normalize_path, "src/main.c");
+    bench_run ("sydbox_normalize_path/absolute", bench_normalize_path,
+            "/var/tmp/paludis/build/sys-apps/sydbox-0.2/work/sydbox-0.2/src/main.c");
+    bench_run ("sydbox_normalize_path/proc-self", bench_normalize_path, "/proc/self/fd/3");
+
+    bench_run ("path_magic/not-magic", bench_magic_chain, "/usr/lib/libc.so.6");
+    bench_run ("path_magic/first", bench_magic_chain, CMD_ON);
+    bench_run ("path_magic/whitelist", bench_magic_chain, CMD_NET_WHITELIST "unix:///tmp/socket");
+    bench_run ("path_magic/enabled", bench_magic_chain, CMD_ENABLED);
+    bench_run ("path_magic/unknown", bench_magic_chain, CMD_PATH "nosuchcommand");
+}
@@ -0,0 +1,167 @@
+/* vim: set et ts=4 sts=4 sw=4 fdm=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <glib.h>
+
+#include <sydbox-config.h>
+#include <sydbox-log.h>
+
+#include "bench.h"
+
+static gchar *filter;
+static gint runs = 5;
+static gint msecs = 200;
+
+static GOptionEntry entries[] = {
+    { "filter", 'f', 0, G_OPTION_ARG_STRING, &filter,
+        "Only run benchmarks whose name contains FILTER", "FILTER" },
+    { "runs",   'r', 0, G_OPTION_ARG_INT,    &runs,
+        "Number of timed runs per benchmark (default: 5)", "N" },
+    { "time",   't', 0, G_OPTION_ARG_INT,    &msecs,
+        "Duration of a timed run in milliseconds (default: 200)", "MSECS" },
+    { NULL, 0, 0, 0, NULL, NULL, NULL },
+};
+
+/* Allocations are counted by interposing the allocator, glib allocates
+ * with malloc() as well.
+ */
+static guint64 allocs;
+
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t nmemb, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+
+void *
+malloc (size_t size)
+{
+    ++allocs;
+    return __libc_malloc (size);
+}
+
+void *
+calloc (size_t nmemb, size_t size)
+{
+    ++allocs;
+    return __libc_calloc (nmemb, size);
+}
+
+void *
+realloc (void *ptr, size_t size)
+{
+    ++allocs;
+    return __libc_realloc (ptr, size);
+}
+
+static guint64
+bench_now (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (guint64) ts.tv_sec * G_GUINT64_CONSTANT (1000000000) + ts.tv_nsec;
+}
+
+static guint64
+bench_time (bench_func_t func, gpointer data, guint64 n)
+{
+    guint64 start = bench_now ();
+
+    for (guint64 i = 0; i < n; i++)
+        func (data);
+    return bench_now () - start;
+}
+
+static gint
+bench_compare (gconstpointer a, gconstpointer b)
+{
+    const double da = *(const double *) a, db = *(const double *) b;
+    return (da > db) - (da < db);
+}
+
+void
+bench_run (const gchar *name, bench_func_t func, gpointer data)
+{
+    guint64 n, elapsed, start_allocs;
+    guint64 target = (guint64) msecs * 1000000;
+    double *samples;
+
+    if (NULL != filter && NULL == strstr (name, filter))
+        return;
+
+    /* Find out how many operations fill a timed run. */
+    func (data);
+    for (n = 1; n < G_GUINT64_CONSTANT (1) << 32; n *= 2) {
+        elapsed = bench_time (func, data, n);
+        if (elapsed >= target / 10)
+            break;
+    }
+    n = MAX (1, (guint64) ((double) n * target / MAX (elapsed, 1)));
+
+    samples = g_new (double, runs);
+    start_allocs = allocs;
+    for (gint i = 0; i < runs; i++)
+        samples[i] = (double) bench_time (func, data, n) / n;
+    qsort (samples, runs, sizeof (double), bench_compare);
+
+    printf ("%-48s %12.1f ns/op (min %10.1f) %10.2f allocs/op %12" G_GUINT64_FORMAT " ops\n",
+            name, samples[runs / 2], samples[0],
+            (double) (allocs - start_allocs) / ((double) n * runs), n);
+    fflush (stdout);
+    g_free (samples);
+}
+
+int
+main (int argc, char **argv)
+{
+    GError *parse_error = NULL;
+    GOptionContext *context;
+
+    context = g_option_context_new ("");
+    g_option_context_add_main_entries (context, entries, NULL);
+    g_option_context_set_summary (context, "Microbenchmarks for the sydbox check pipeline");
+    if (!g_option_context_parse (context, &argc, &argv, &parse_error)) {
+        g_printerr ("fatal: option parsing failed: %s\n", parse_error->message);
+        g_option_context_free (context);
+        g_error_free (parse_error);
+        return EXIT_FAILURE;
+    }
+    g_option_context_free (context);
+    if (runs < 1 || msecs < 1) {
+        g_printerr ("fatal: runs and time must be positive\n");
+        return EXIT_FAILURE;
+    }
+
+    /* Default configuration and log level, as sydbox runs without options */
+    g_setenv (ENV_NO_CONFIG, "1", 1);
+    sydbox_config_load (NULL, NULL);
+    sydbox_log_init ();
+
+    bench_path ();
+    bench_canonicalize ();
+    bench_dispatch ();
+    bench_net ();
+
+    sydbox_log_fini ();
+    return EXIT_SUCCESS;
+}
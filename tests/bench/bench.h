@@ -0,0 +1,46 @@
+/* vim: set et ts=4 sts=4 sw=4 fdm=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SYDBOX_GUARD_BENCH_H
+#define SYDBOX_GUARD_BENCH_H 1
+
+#include <glib.h>
+
+/* Runs one operation of a benchmark. */
+typedef void (*bench_func_t) (gpointer data);
+
+/* Runs func until the timing is stable and prints ns/op and allocations/op.
+ * The benchmark is skipped unless its name matches the filter given on the
+ * command line.
+ */
+void bench_run (const gchar *name, bench_func_t func, gpointer data);
+
+/* Keeps the compiler from optimizing away a result. */
+static inline void
+bench_use (gconstpointer ptr)
+{
+    __asm__ __volatile__ ("" : : "g" (ptr) : "memory");
+}
+
+void bench_path (void);
+void bench_canonicalize (void);
+void bench_dispatch (void);
+void bench_net (void);
+
+#endif // SYDBOX_GUARD_BENCH_H
@@ -0,0 +1,305 @@
+#!/usr/bin/env bash
+# vim: set sw=4 et sts=4 tw=80 :
+# Copyright 2009 Ali Polatel <polatel@gmail.com>
+# Distributed under the terms of the GNU General Public License v2
+#
+# End to end sandbox overhead benchmark.
+#
+# Runs a set of workloads natively and under sydbox in several sandbox
+# configurations and reports the median wall time of each, the CPU time
+# sydbox itself used (not counting its children) and the overhead ratio.
+# All input is generated locally, nothing touches the network.
+#
+# Workloads:
+#   untar       extract a synthetic tree of small files
+#   configure   thousands of stat/open/access calls from a shell loop
+#   make        make -jN of generated C files (skipped without cc/make)
+#   forkexec    fork and exec /bin/true over and over
+#   findrm      find over a tree and rm -r it (openat/unlinkat heavy)
+#
+# Configurations:
+#   path        path sandboxing only, the default
+#   exec        path and execve(2) sandboxing
+#   net         path and network sandboxing in deny mode
+#   magic       path sandboxing, and the workload issues magic commands
+
+if test -z "${BASH_VERSION}"; then
+    echo "This is not bash!"
+    exit 127
+fi
+
+# Reset environment
+export LANG=C
+export LC_ALL=C
+export TZ=UTC
+export PATH=/usr/local/bin:/usr/bin:/bin:/usr/sbin:/sbin
+
+unset CDPATH
+unset SYDBOX_WRITE
+unset SYDBOX_EXEC_ALLOW
+unset SYDBOX_EXEC
+unset SYDBOX_NET
+unset SYDBOX_NET_MODE
+unset SYDBOX_CONFIG
+unset SYDBOX_LOG
+unset SYDBOX_LOCK
+
+usage() {
+    cat <<EOF
+usage: $0 [options]
+  -s SYDBOX     path to the sydbox binary (default: \$SYDBOX or src/sydbox)
+  -n RUNS       runs per measurement, the median is reported (default: 3)
+  -j JOBS       parallel jobs for the make workload (default: nproc)
+  -x SCALE      multiply the size of the workloads (default: 1)
+  -w LIST       comma separated workloads (default: all)
+  -c LIST       comma separated configurations (default: all)
+  -k            keep the work directory
+EOF
+    exit 1
+}
+
+here="$(cd "$(dirname "$0")" && pwd)"
+sydbox="${SYDBOX:-${here}/../../src/sydbox}"
+runs=3
+jobs=$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)
+scale=1
+workloads="untar,configure,make,forkexec,findrm"
+configs="path,exec,net,magic"
+keep=false
+
+while getopts "s:n:j:x:w:c:kh" opt; do
+    case "$opt" in
+        s) sydbox="$OPTARG";;
+        n) runs="$OPTARG";;
+        j) jobs="$OPTARG";;
+        x) scale="$OPTARG";;
+        w) workloads="$OPTARG";;
+        c) configs="$OPTARG";;
+        k) keep=true;;
+        *) usage;;
+    esac
+done
+
+if [[ ! -x "$sydbox" ]]; then
+    echo "sydbox not found at \`$sydbox', use -s" >&2
+    exit 1
+fi
+sydbox="$(cd "$(dirname "$sydbox")" && pwd)/$(basename "$sydbox")"
+
+work="$(mktemp -d "${TMPDIR:-/tmp}/sydbox-overhead-XXXXXX")" || exit 1
+data="$work/data"
+run="$work/run"
+log="$work/sydbox.log"
+hz=$(getconf CLK_TCK)
+cleanup() {
+    if $keep; then
+        echo "work directory kept in $work" >&2
+    else
+        rm -fr "$work"
+    fi
+}
+trap 'cleanup' EXIT
+
+now() {
+    date +%s%N
+}
+
+median() {
+    sort -n | awk '{ v[NR] = $1 } END { print v[int((NR + 1) / 2)] }'
+}
+
+# Input data {{{
+mkdir -p "$data" "$run"
+
+echo "generating input data in $work" >&2
+ndirs=$((40 * scale))
+for ((d = 0; d < ndirs; d++)); do
+    dir="$data/tree/dir$d"
+    mkdir -p "$dir/sub"
+    for ((f = 0; f < 25; f++)); do
+        printf 'int f%d_%d(void) { return %d; }\n' $d $f $f > "$dir/file$f.c"
+        printf '%s\n' "file $f of directory $d" > "$dir/sub/note$f.txt"
+    done
+done
+tar cf "$data/tree.tar" -C "$data" tree
+
+mkdir -p "$data/make"
+for ((f = 0; f < 100 * scale; f++)); do
+    {
+        printf '#include <string.h>\n'
+        for ((i = 0; i < 20; i++)); do
+            printf 'int unit%d_fn%d(const char *s) { return (int) strlen(s) + %d; }\n' $f $i $i
+        done
+    } > "$data/make/unit$f.c"
+done
+{
+    printf 'SRCS := $(wildcard *.c)\n'
+    printf 'OBJS := $(SRCS:.c=.o)\n'
+    printf 'all: libbench.a\n'
+    printf 'libbench.a: $(OBJS)\n\t$(AR) rcs $@ $^\n'
+    printf '%%.o: %%.c\n\t$(CC) -O0 -c $< -o $@\n'
+} > "$data/make/Makefile"
+
+# The sandboxed workload, runs as the eldest child of sydbox. Its last step
+# saves /proc/PPID/stat, which is sydbox's own CPU time so far.
+cat > "$work/workload.bash" <<'EOF'
+workload="$1"
+magic="$2"
+cpu_out="$3"
+
+if [[ 1 == "$magic" ]]; then
+    for ((i = 0; i < 1000; i++)); do
+        [[ -e /dev/sydbox/enabled ]]
+        [[ -e /dev/sydbox/write/${RUN}/magic ]]
+        [[ -e /dev/sydbox/unwrite/${RUN}/magic ]]
+    done
+fi
+
+case "$workload" in
+    untar)
+        tar xf "$DATA/tree.tar" -C "$RUN/untar" || exit 1
+        ;;
+    configure)
+        cd "$RUN/configure" || exit 1
+        for ((i = 0; i < 2000 * SCALE; i++)); do
+            [[ -f /usr/include/stdio.h ]]
+            [[ -d /usr/lib ]]
+            [[ -x /bin/sh ]]
+            [[ -e conftest.missing ]]
+            : > conftest.$i
+            [[ -r conftest.$i ]]
+            exec 3< conftest.$i
+            exec 3<&-
+        done
+        ;;
+    make)
+        make -s -C "$RUN/make" -j"$JOBS" >"$RUN/make.out" 2>&1 || exit 1
+        ;;
+    forkexec)
+        for ((i = 0; i < 500 * SCALE; i++)); do
+            /bin/true || exit 1
+        done
+        ;;
+    findrm)
+        find "$RUN/findrm" -type f -name '*.c' > "$RUN/find.out" || exit 1
+        rm -r "$RUN/findrm" || exit 1
+        ;;
+esac
+
+if [[ -n "$cpu_out" ]]; then
+    read -r stat < /proc/$PPID/stat
+    echo "$stat" > "$cpu_out"
+fi
+exit 0
+EOF
+# }}}
+
+prepare() {
+    rm -fr "$run"
+    mkdir -p "$run"
+    case "$1" in
+        untar) mkdir "$run/untar";;
+        configure) mkdir "$run/configure";;
+        make) cp -r "$data/make" "$run/make";;
+        findrm) cp -r "$data/tree" "$run/findrm";;
+    esac
+}
+
+available() {
+    case "$1" in
+        make) type -P make >/dev/null && type -P cc >/dev/null;;
+        untar|configure|forkexec|findrm) return 0;;
+        *) echo "unknown workload \`$1'" >&2; exit 1;;
+    esac
+}
+
+# sandbox <config> <command...>
+sandbox() {
+    local config="$1"
+    shift
+
+    case "$config" in
+        path|magic)
+            "$sydbox" -C -- "$@";;
+        exec)
+            SYDBOX_EXEC_ALLOW="/usr:/bin:/sbin:/lib:/lib64" \
+                "$sydbox" -C --sandbox-exec -- "$@";;
+        net)
+            "$sydbox" -C --sandbox-network --network-mode=deny -- "$@";;
+        *)
+            echo "unknown configuration \`$config'" >&2; exit 1;;
+    esac
+}
+
+# measure <native|config> <workload> <magic>, prints wall and tracer CPU ns
+measure() {
+    local config="$1" workload="$2" magic="$3" start end ret cpu="-"
+
+    prepare "$workload"
+    rm -f "$work/cpu"
+    start=$(now)
+    if [[ native == "$config" ]]; then
+        bash "$work/workload.bash" "$workload" "$magic" "" >>"$log" 2>&1
+        ret=$?
+    else
+        sandbox "$config" bash "$work/workload.bash" "$workload" "$magic" "$work/cpu" >>"$log" 2>&1
+        ret=$?
+    fi
+    end=$(now)
+    [[ 0 != $ret ]] && return 1
+
+    if [[ -f "$work/cpu" ]]; then
+        # utime and stime are fields 14 and 15, after the command name
+        cpu=$(sed -e 's/^.*) //' "$work/cpu" | awk -v hz=$hz '{ printf "%d", ($12 + $13) * 1e9 / hz }')
+    fi
+    echo "$((end - start)) $cpu"
+}
+
+export DATA="$data" RUN="$run" JOBS="$jobs" SCALE="$scale"
+export SYDBOX_NO_CONFIG=1
+export SYDBOX_WRITE="$work:/dev/null:/dev/tty"
+
+status=0
+printf '%-10s %-7s %12s %12s %8s %12s %8s\n' \
+    workload config native-s sydbox-s ratio tracer-cpu-s cpu/wall
+for workload in ${workloads//,/ }; do
+    if ! available "$workload"; then
+        printf '%-10s %-7s %s\n' "$workload" - "skipped, make or cc not found"
+        continue
+    fi
+    declare -A native=()
+    for config in ${configs//,/ }; do
+        magic=0
+        [[ magic == "$config" ]] && magic=1
+
+        # The magic workload is measured natively too, where the magic
+        # paths don't exist.
+        if [[ -z "${native[$magic]}" ]]; then
+            for ((r = 0; r < runs; r++)); do
+                measure native "$workload" "$magic" || { native[$magic]=fail; break; }
+            done > "$work/native"
+            [[ fail != "${native[$magic]}" ]] && native[$magic]=$(cut -d' ' -f1 "$work/native" | median)
+        fi
+
+        for ((r = 0; r < runs; r++)); do
+            if ! measure "$config" "$workload" "$magic"; then
+                echo fail
+                break
+            fi
+        done > "$work/sandboxed"
+        if grep -q fail "$work/sandboxed" || [[ fail == "${native[$magic]}" ]]; then
+            printf '%-10s %-7s %s (see %s)\n' "$workload" "$config" "FAILED" "$log"
+            keep=true
+            status=1
+            continue
+        fi
+
+        wall=$(cut -d' ' -f1 "$work/sandboxed" | median)
+        cpu=$(cut -d' ' -f2 "$work/sandboxed" | median)
+        awk -v w="$workload" -v c="$config" -v n="${native[$magic]}" -v s="$wall" -v t="$cpu" \
+            'BEGIN { printf "%-10s %-7s %12.3f %12.3f %8.2f %12.3f %7.1f%%\n",
+                     w, c, n / 1e9, s / 1e9, s / n, t / 1e9, 100 * t / s }'
+    done
+    unset native
+done
+exit $status
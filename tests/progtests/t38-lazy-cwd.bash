@@ -0,0 +1,28 @@
+#!/usr/bin/env bash
+# vim: set sw=4 et sts=4 tw=80 :
+# Copyright 2009 Ali Polatel <polatel@gmail.com>
+# Distributed under the terms of the GNU General Public License v2
+
+. test-lib.bash
+
+start_test "t38-lazy-cwd-allow"
+SYDBOX_WRITE="${cwd}/see.emily.play" sydbox --lazy-cwd -- bash <<EOF
+cd see.emily.play && echo Oh Arnold Layne, its not the same > gnome
+EOF
+if [[ 0 != $? ]]; then
+    die "failed to write a file relative to the new working directory"
+elif [[ -z "$(< see.emily.play/gnome)" ]]; then
+    die "file empty, failed to write a file relative to the new working directory"
+fi
+end_test
+
+start_test "t38-lazy-cwd-deny"
+SYDBOX_WRITE="${cwd}/see.emily.play" sydbox --lazy-cwd -- bash <<EOF
+cd see.emily.play && cd .. && echo Oh Arnold Layne, its not the same > arnold.layne
+EOF
+if [[ 0 == $? ]]; then
+    die "wrote a file relative to a stale working directory"
+elif [[ -n "$(< arnold.layne)" ]]; then
+    die "file not empty, wrote a file relative to a stale working directory"
+fi
+end_test
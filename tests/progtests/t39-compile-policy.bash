@@ -0,0 +1,83 @@
+#!/usr/bin/env bash
+# vim: set sw=4 et sts=4 tw=80 :
+# Copyright 2009 Ali Polatel <polatel@gmail.com>
+# Distributed under the terms of the GNU General Public License v2
+
+. test-lib.bash
+
+clean_files+=( "policy.conf" "policy.bin" )
+cat > policy.conf <<EOF
+[prefix]
+write = ${cwd}/see.emily.play
+EOF
+
+start_test "t39-compile-policy"
+sydbox_config -c policy.conf --compile-policy policy.bin
+if [[ 0 != $? ]]; then
+    die "failed to compile policy"
+elif [[ ! -s policy.bin ]]; then
+    die "compiled policy empty"
+fi
+end_test
+
+start_test "t39-compile-policy-allow"
+sydbox --policy policy.bin -- bash -c 'echo Oh Arnold Layne > see.emily.play/gnome'
+if [[ 0 != $? ]]; then
+    die "failed to write a file allowed by the compiled policy"
+elif [[ -z "$(< see.emily.play/gnome)" ]]; then
+    die "file empty, failed to write a file allowed by the compiled policy"
+fi
+end_test
+
+start_test "t39-compile-policy-deny"
+sydbox --policy policy.bin -- bash -c 'echo Oh Arnold Layne > arnold.layne'
+if [[ 0 == $? ]]; then
+    die "wrote a file not allowed by the compiled policy"
+elif [[ -n "$(< arnold.layne)" ]]; then
+    die "file not empty, wrote a file not allowed by the compiled policy"
+fi
+end_test
+
+start_test "t39-compile-policy-stale"
+cat > policy.conf <<EOF
+[prefix]
+write = ${cwd}/see.emily.play;${cwd}/arnold.layne
+EOF
+sydbox_config --policy policy.bin -- bash -c 'echo Oh Arnold Layne > arnold.layne'
+if [[ 0 != $? ]]; then
+    die "failed to fall back to the changed configuration file"
+elif [[ -z "$(< arnold.layne)" ]]; then
+    die "file empty, failed to fall back to the changed configuration file"
+fi
+end_test
+
+cat > policy.conf <<EOF
+[prefix]
+write = ${cwd}/\${T39_FILE}
+EOF
+
+start_test "t39-compile-policy-environment"
+T39_FILE=see.emily.play sydbox_config -c policy.conf --compile-policy policy.bin
+if [[ 0 != $? ]]; then
+    die "failed to compile policy"
+fi
+:>arnold.layne
+T39_FILE=arnold.layne sydbox_config --policy policy.bin -- bash -c 'echo Oh Arnold Layne > arnold.layne'
+if [[ 0 != $? ]]; then
+    die "failed to fall back to the configuration file in a changed environment"
+elif [[ -z "$(< arnold.layne)" ]]; then
+    die "file empty, failed to fall back to the configuration file in a changed environment"
+fi
+end_test
+
+cat > policy.conf <<EOF
+[prefix]
+write = ${cwd}/\$(echo see.emily.play)
+EOF
+
+start_test "t39-compile-policy-substitution"
+sydbox_config -c policy.conf --compile-policy policy.bin
+if [[ 0 == $? ]]; then
+    die "compiled a prefix with a command substitution"
+fi
+end_test
@@ -0,0 +1,31 @@
+#!/usr/bin/env bash
+# vim: set sw=4 et sts=4 tw=80 :
+# Copyright 2009 Ali Polatel <polatel@gmail.com>
+# Distributed under the terms of the GNU General Public License v2
+
+. test-lib.bash
+
+# Without Landlock support sydbox falls back to ptrace, the results are the
+# same either way.
+
+start_test "t40-landlock-allow"
+SYDBOX_WRITE="${cwd}/see.emily.play" sydbox --lock --landlock -- bash <<EOF
+echo Oh Arnold Layne, its not the same > see.emily.play/gnome
+EOF
+if [[ 0 != $? ]]; then
+    die "failed to write a file beneath a write prefix"
+elif [[ -z "$(< see.emily.play/gnome)" ]]; then
+    die "file empty, failed to write a file beneath a write prefix"
+fi
+end_test
+
+start_test "t40-landlock-deny"
+SYDBOX_WRITE="${cwd}/see.emily.play" sydbox --lock --landlock -- bash <<EOF
+echo Oh Arnold Layne, its not the same > arnold.layne
+EOF
+if [[ 0 == $? ]]; then
+    die "wrote a file outside write prefixes"
+elif [[ -n "$(< arnold.layne)" ]]; then
+    die "file not empty, wrote a file outside write prefixes"
+fi
+end_test
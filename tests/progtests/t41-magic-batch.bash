@@ -0,0 +1,40 @@
+#!/usr/bin/env bash
+# vim: set sw=4 et sts=4 tw=80 :
+# Copyright 2009 Ali Polatel <polatel@gmail.com>
+# Distributed under the terms of the GNU General Public License v2
+
+. test-lib.bash
+
+start_test "t41-magic-batch-locked"
+sydbox --lock -- bash <<EOF
+[[ -e "/dev/sydbox/batch/write/${cwd}" ]]
+EOF
+if [[ 0 == $? ]]; then
+    die "/dev/sydbox/batch exists"
+fi
+end_test
+
+start_test "t41-magic-batch-apply"
+sydbox -- bash <<EOF
+[[ -e "/dev/sydbox/batch/unwrite/${cwd};write/${cwd};;sandbox/exec;sandunbox/exec" ]]
+echo Oh Arnold Layne, its not the same > arnold.layne
+EOF
+if [[ 0 != $? ]]; then
+    die "failed to add prefix using /dev/sydbox/batch"
+elif [[ -z "$(< arnold.layne)" ]]; then
+    die "file empty, failed to add prefix using /dev/sydbox/batch"
+fi
+end_test
+
+start_test "t41-magic-batch-reject"
+: > arnold.layne
+sydbox -- bash <<EOF
+[[ -e "/dev/sydbox/batch/write/${cwd};nosuchcommand" ]] && exit 0
+echo Oh Arnold Layne, its not the same > arnold.layne
+EOF
+if [[ 0 == $? ]]; then
+    die "batch with an unknown command was applied"
+elif [[ -n "$(< arnold.layne)" ]]; then
+    die "file not empty, batch with an unknown command was applied"
+fi
+end_test
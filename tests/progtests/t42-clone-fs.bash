@@ -0,0 +1,26 @@
+#!/usr/bin/env bash
+# vim: set sw=4 et sts=4 tw=80 :
+# Copyright 2009 Ali Polatel <polatel@gmail.com>
+# Distributed under the terms of the GNU General Public License v2
+
+. test-lib.bash
+
+start_test "t42-clone-fs-allow"
+SYDBOX_WRITE="${cwd}/see.emily.play" sydbox -- ./t42_clone_fs see.emily.play gnome
+if [[ 0 != $? ]]; then
+    die "failed to write a file relative to the working directory a CLONE_FS child changed"
+elif [[ -z "$(< see.emily.play/gnome)" ]]; then
+    die "file empty, failed to write a file relative to the working directory a CLONE_FS child changed"
+fi
+end_test
+
+:>see.emily.play/gnome
+
+start_test "t42-clone-fs-deny"
+SYDBOX_WRITE="${cwd}/gnome" sydbox -- ./t42_clone_fs see.emily.play gnome
+if [[ 0 == $? ]]; then
+    die "wrote a file relative to a stale working directory"
+elif [[ -n "$(< see.emily.play/gnome)" ]]; then
+    die "file not empty, wrote a file relative to a stale working directory"
+fi
+end_test
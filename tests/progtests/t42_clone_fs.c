@@ -0,0 +1,42 @@
+/* Check program for t42-clone-fs.bash
+ * vim: set et ts=4 sts=4 sw=4 fdm=syntax :
+ * Copyright 2009 Ali Polatel <polatel@gmail.com>
+ * Distributed under the terms of the GNU General Public License v2
+ */
+
+#define _GNU_SOURCE
+#include <sched.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+static char stack[65536];
+
+static int child(void *dir) {
+    return (0 > chdir((const char *) dir)) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv) {
+    int fd, status;
+    pid_t pid;
+
+    /* Sharing the working directory with SIGCHLD as the exit signal is
+     * reported as a fork, not as a clone.
+     */
+    pid = clone(child, stack + sizeof(stack), CLONE_FS | SIGCHLD, argv[1]);
+    if (0 > pid)
+        return EXIT_FAILURE;
+    if (0 > waitpid(pid, &status, 0) || !WIFEXITED(status) || EXIT_SUCCESS != WEXITSTATUS(status))
+        return EXIT_FAILURE;
+
+    fd = open(argv[2], O_WRONLY);
+    if (0 > fd)
+        return EXIT_FAILURE;
+    write(fd, "why can't you see?", 18);
+    close(fd);
+    return EXIT_SUCCESS;
+}
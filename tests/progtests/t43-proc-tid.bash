@@ -0,0 +1,13 @@
+#!/usr/bin/env bash
+# vim: set sw=4 et sts=4 tw=80 :
+# Copyright 2009 Ali Polatel <polatel@gmail.com>
+# Distributed under the terms of the GNU General Public License v2
+
+. test-lib.bash
+
+start_test "t43-proc-tid"
+sydbox -- ./t43_proc_tid
+if [[ 0 != $? ]]; then
+    die "failed to write to /proc/TID of a thread"
+fi
+end_test
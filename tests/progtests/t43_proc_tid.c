@@ -0,0 +1,45 @@
+/* Check program for t43-proc-tid.bash
+ * vim: set et ts=4 sts=4 sw=4 fdm=syntax :
+ * Copyright 2009 Ali Polatel <polatel@gmail.com>
+ * Distributed under the terms of the GNU General Public License v2
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+static void *thread(void *arg) {
+    int fd;
+    char path[64];
+
+    (void) arg;
+    /* A thread which isn't the thread group leader writes to its own
+     * /proc/TID directly, not through /proc/self/task/TID.
+     */
+    snprintf(path, sizeof(path), "/proc/%ld/comm", (long) syscall(SYS_gettid));
+    fd = open(path, O_WRONLY);
+    if (0 > fd)
+        return (void *) 1;
+    if (5 != write(fd, "gnome", 5)) {
+        close(fd);
+        return (void *) 1;
+    }
+    close(fd);
+    return NULL;
+}
+
+int main(void) {
+    void *ret;
+    pthread_t t;
+
+    if (0 != pthread_create(&t, NULL, thread, NULL))
+        return EXIT_FAILURE;
+    if (0 != pthread_join(t, &ret))
+        return EXIT_FAILURE;
+    return (NULL == ret) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
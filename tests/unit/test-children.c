@@ -18,6 +18,11 @@
  * Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <sched.h>
 #include <stdlib.h>
 #include <glib.h>
 #include <children.h>
@@ -25,7 +30,7 @@
 
 static void test1(void)
 {
-    GHashTable *children = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, tchild_free_one);
+    tchild_table_t *children = tchild_table_new();
     struct tchild *child;
 
     tchild_new(children, 666);
@@ -38,12 +43,12 @@ static void test1(void)
     g_assert_cmpint(child->sno, ==, 0xbadca11);
     g_assert_cmpint(child->retval, ==, -1);
 
-    g_hash_table_destroy(children);
+    tchild_table_free(children);
 }
 
 static void test2(void)
 {
-    GHashTable *children = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, tchild_free_one);
+    tchild_table_t *children = tchild_table_new();
 
     tchild_new(children, 666);
     tchild_new(children, 667);
@@ -53,7 +58,216 @@ static void test2(void)
 
     g_assert(NULL == tchild_find(children, 666));
 
-    g_hash_table_destroy(children);
+    tchild_table_free(children);
+}
+
+static void test3(void)
+{
+    tchild_table_t *children = tchild_table_new();
+    struct tchild *child;
+    struct tchild_pool_stats before, stats;
+
+    tchild_pool_stats(TCHILD_POOL_CHILD, &before);
+
+    tchild_new(children, 666);
+    child = tchild_find(children, 666);
+    tchild_delete(children, 666);
+
+    /* The freed entry is reused for the next child. */
+    tchild_new(children, 667);
+    g_assert(child == tchild_find(children, 667));
+    g_assert(NULL == child->fs->cwd);
+
+    tchild_pool_stats(TCHILD_POOL_CHILD, &stats);
+    g_assert_cmpint(stats.in_use, ==, before.in_use + 1);
+    g_assert_cmpint(stats.allocs, ==, before.allocs + 2);
+    g_assert_cmpint(stats.peak, >=, 1);
+    g_assert_cmpint(stats.slabs, >=, 1);
+
+    for (pid_t pid = 1000; pid < 1200; pid++)
+        tchild_new(children, pid);
+    tchild_pool_stats(TCHILD_POOL_CHILD, &stats);
+    g_assert_cmpint(stats.in_use, ==, before.in_use + 201);
+    g_assert_cmpint(stats.peak, >=, 201);
+    g_assert_cmpint(stats.slabs * 64, ==, stats.in_use + stats.free);
+
+    tchild_table_free(children);
+    tchild_pool_stats(TCHILD_POOL_CHILD, &stats);
+    g_assert_cmpint(stats.in_use, ==, before.in_use);
+
+    tchild_pool_free();
+    tchild_pool_stats(TCHILD_POOL_CHILD, &stats);
+    g_assert_cmpint(stats.slabs, ==, 0);
+    g_assert_cmpint(stats.free, ==, 0);
+}
+
+static void test4(void)
+{
+    tchild_table_t *children = tchild_table_new();
+    struct tchild *parent, *child;
+    char *longcwd;
+
+    tchild_new(children, 666);
+    parent = tchild_find(children, 666);
+    tchild_set_cwd(parent, "/var/tmp");
+    g_assert(parent->fs->cwd == parent->fs->cwd_inline);
+    g_assert_cmpstr(parent->fs->cwd, ==, "/var/tmp");
+
+    longcwd = g_strnfill(TCHILD_CWD_INLINE + 10, 'x');
+    longcwd[0] = '/';
+    tchild_take_cwd(parent, g_strdup(longcwd));
+    g_assert(parent->fs->cwd != parent->fs->cwd_inline);
+    g_assert_cmpstr(parent->fs->cwd, ==, longcwd);
+
+    tchild_new(children, 667);
+    child = tchild_find(children, 667);
+    tchild_inherit(child, parent, 0);
+    g_assert(child->fs != parent->fs);
+    g_assert(child->fs->cwd != parent->fs->cwd);
+    g_assert_cmpstr(child->fs->cwd, ==, longcwd);
+
+    tchild_take_cwd(child, g_strdup("/"));
+    g_assert(child->fs->cwd == child->fs->cwd_inline);
+    g_assert_cmpstr(child->fs->cwd, ==, "/");
+    g_assert_cmpstr(parent->fs->cwd, ==, longcwd);
+
+    g_free(longcwd);
+    tchild_table_free(children);
+}
+
+static void test6(void)
+{
+    tchild_table_t *children = tchild_table_new();
+    struct tchild *leader, *thread, *proc;
+    struct tchild_pool_stats before, stats;
+
+    tchild_pool_stats(TCHILD_POOL_SANDBOX, &before);
+
+    tchild_new(children, 666);
+    leader = tchild_find(children, 666);
+    leader->flags &= ~TCHILD_NEEDINHERIT;
+    tchild_set_cwd(leader, "/tmp");
+    leader->sandbox->exec = true;
+
+    /* A thread shares everything with the thread group. */
+    tchild_new(children, 667);
+    thread = tchild_find(children, 667);
+    tchild_inherit(thread, leader, CLONE_VM | CLONE_FS | CLONE_FILES | CLONE_SIGHAND | CLONE_THREAD);
+    g_assert(thread->fs == leader->fs);
+    g_assert(thread->sandbox == leader->sandbox);
+    g_assert_cmpint(thread->tgid, ==, 666);
+    g_assert_cmpint(leader->fs->refs, ==, 2);
+    g_assert_cmpint(leader->sandbox->refs, ==, 2);
+
+    tchild_pool_stats(TCHILD_POOL_SANDBOX, &stats);
+    g_assert_cmpint(stats.in_use, ==, before.in_use + 1);
+
+    /* A chdir in one thread is seen by the other */
+    tchild_set_cwd(thread, "/usr");
+    g_assert_cmpstr(leader->fs->cwd, ==, "/usr");
+
+    /* A process created by a thread gets copies. */
+    tchild_new(children, 668);
+    proc = tchild_find(children, 668);
+    tchild_inherit(proc, thread, 0);
+    g_assert(proc->fs != thread->fs);
+    g_assert(proc->sandbox != thread->sandbox);
+    g_assert_cmpint(proc->tgid, ==, 668);
+    g_assert_cmpstr(proc->fs->cwd, ==, "/usr");
+    g_assert(proc->sandbox->exec);
+
+    /* The shared state outlives the leader. */
+    tchild_delete(children, 666);
+    g_assert_cmpint(thread->fs->refs, ==, 1);
+    g_assert_cmpint(thread->sandbox->refs, ==, 1);
+    g_assert_cmpstr(thread->fs->cwd, ==, "/usr");
+
+    tchild_table_free(children);
+    tchild_pool_stats(TCHILD_POOL_SANDBOX, &stats);
+    g_assert_cmpint(stats.in_use, ==, before.in_use);
+}
+
+static void test7(void)
+{
+    tchild_table_t *children = tchild_table_new();
+    struct tchild *parent, *thread, *child;
+
+    tchild_new(children, 666);
+    parent = tchild_find(children, 666);
+    parent->flags &= ~TCHILD_NEEDINHERIT;
+    tchild_set_cwd(parent, "/tmp");
+    g_assert(!tchild_cwd_stale(parent));
+
+    /* A thread sharing the working directory sees the change. */
+    tchild_new(children, 667);
+    thread = tchild_find(children, 667);
+    tchild_inherit(thread, parent, CLONE_FS);
+    tchild_cwd_changed(parent);
+    g_assert(tchild_cwd_stale(parent));
+    g_assert(tchild_cwd_stale(thread));
+
+    /* A copy of a stale working directory is stale as well. */
+    tchild_new(children, 668);
+    child = tchild_find(children, 668);
+    tchild_inherit(child, parent, 0);
+    g_assert(tchild_cwd_stale(child));
+
+    /* Reading the working directory makes it fresh again. */
+    tchild_set_cwd(thread, "/usr");
+    g_assert(!tchild_cwd_stale(parent));
+    g_assert_cmpstr(parent->fs->cwd, ==, "/usr");
+    g_assert(tchild_cwd_stale(child));
+
+    tchild_table_free(children);
+}
+
+static tchild_table_t *children_under_test;
+
+static void count_one(struct tchild *child, void *userdata)
+{
+    guint *count = userdata;
+
+    g_assert(child == tchild_find(children_under_test, child->pid));
+    ++*count;
+}
+
+static void test5(void)
+{
+    tchild_table_t *children = tchild_table_new();
+    guint count = 0;
+
+    children_under_test = children;
+
+    /* Enough children to grow the table a few times, with sparse and
+     * consecutive process IDs.
+     */
+    for (pid_t pid = 1; pid <= 1000; pid++)
+        tchild_new(children, pid);
+    for (pid_t pid = 1 << 15; pid < (1 << 22); pid += 1 << 15)
+        tchild_new(children, pid);
+    g_assert_cmpint(tchild_table_size(children), ==, 1000 + 127);
+
+    tchild_table_foreach(children, count_one, &count);
+    g_assert_cmpint(count, ==, 1000 + 127);
+
+    /* Removing entries must keep the others reachable. */
+    for (pid_t pid = 1; pid <= 1000; pid += 3)
+        tchild_delete(children, pid);
+    tchild_delete(children, 424242);
+    for (pid_t pid = 1; pid <= 1000; pid++) {
+        struct tchild *child = tchild_find(children, pid);
+        if (1 == pid % 3)
+            g_assert(NULL == child);
+        else {
+            g_assert(NULL != child);
+            g_assert_cmpint(child->pid, ==, pid);
+        }
+    }
+    for (pid_t pid = 1 << 15; pid < (1 << 22); pid += 1 << 15)
+        g_assert_cmpint(tchild_find(children, pid)->pid, ==, pid);
+    g_assert_cmpint(tchild_table_size(children), ==, 1000 - 334 + 127);
+
+    tchild_table_free(children);
 }
 
 static void no_log (const gchar *log_domain, GLogLevelFlags log_level, const gchar *message, gpointer user_data)
@@ -71,6 +285,11 @@ int main(int argc, char **argv)
 
     g_test_add_func ("/children/new", test1);
     g_test_add_func ("/children/delete", test2);
+    g_test_add_func ("/children/pool", test3);
+    g_test_add_func ("/children/cwd", test4);
+    g_test_add_func ("/children/table", test5);
+    g_test_add_func ("/children/threads", test6);
+    g_test_add_func ("/children/lazy-cwd", test7);
 
     return g_test_run ();
 }
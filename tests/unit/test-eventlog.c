@@ -0,0 +1,102 @@
+/* vim: set et ts=4 sts=4 sw=4 fdm=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <eventlog.h>
+
+#define TRACE_FILE "test-eventlog.trace"
+
+static guint32
+read_u32 (const gchar **p)
+{
+    guint32 val;
+    memcpy (&val, *p, sizeof (val));
+    *p += sizeof (val);
+    return val;
+}
+
+static void
+test1 (void)
+{
+    gchar *contents;
+    gsize len;
+    const gchar *p, *end;
+    gchar *paths[4] = { NULL, "/dev/null", NULL, NULL };
+    guint nstrings = 0, nsyscalls = 0, nevents = 0;
+
+    g_assert (eventlog_open (TRACE_FILE));
+    g_assert (eventlog_enabled ());
+    eventlog_syscall (1, 1, 257, 0, 0, paths, -1, 0, NULL);
+    eventlog_syscall (1, 1, 257, 3, 1, paths, -1, 0, NULL);
+    eventlog_event (1, 7, 0);
+    eventlog_close ();
+    g_assert (!eventlog_enabled ());
+
+    g_assert (g_file_get_contents (TRACE_FILE, &contents, &len, NULL));
+    g_assert_cmpuint (len, >, EVENTLOG_MAGIC_LEN + 8);
+    g_assert (0 == memcmp (contents, EVENTLOG_MAGIC, EVENTLOG_MAGIC_LEN));
+
+    p = contents + EVENTLOG_MAGIC_LEN;
+    end = contents + len;
+    g_assert_cmpuint (read_u32 (&p), ==, EVENTLOG_VERSION);
+    g_assert_cmpuint (read_u32 (&p), ==, EVENTLOG_BYTEORDER);
+    while (p < end) {
+        guint32 reclen = read_u32 (&p);
+        g_assert_cmpuint (reclen, <=, (gsize) (end - p));
+        switch (p[0]) {
+            case EVENTLOG_RECORD_STRING:
+                g_assert_cmpuint (reclen, ==, 5 + strlen ("/dev/null"));
+                g_assert (0 == memcmp (p + 5, "/dev/null", reclen - 5));
+                ++nstrings;
+                break;
+            case EVENTLOG_RECORD_SYSCALL:
+                ++nsyscalls;
+                break;
+            case EVENTLOG_RECORD_EVENT:
+                ++nevents;
+                break;
+            default:
+                g_assert_not_reached ();
+        }
+        p += reclen;
+    }
+    g_assert (p == end);
+
+    /* The path is interned once and referred to by both records. */
+    g_assert_cmpuint (nstrings, ==, 1);
+    g_assert_cmpuint (nsyscalls, ==, 2);
+    g_assert_cmpuint (nevents, ==, 1);
+
+    g_free (contents);
+    g_unlink (TRACE_FILE);
+}
+
+int
+main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/eventlog/roundtrip", test1);
+
+    return g_test_run ();
+}
@@ -0,0 +1,162 @@
+/* vim: set et ts=4 sts=4 sw=4 fdm=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <fnmatch.h>
+
+#include <glib.h>
+#include <globset.h>
+
+static const char *patterns[] = {
+    "/dev/null",
+    "/tmp/*",
+    "/var/tmp/*",
+    "*.o",
+    "*",
+    "/home/*/.ccache/*",
+    "/proc/[0-9]*/fd/*",
+    "/dev/tty[!0-9]",
+    "/dev/pts/?",
+    "/usr/lib*/*.so",
+    "/etc/[[:alpha:]]*.conf",
+    "/a\\*b",
+    "/x/[a-",
+    "/y/[]]z",
+    "/y/[a-",
+    "/y/[[:foo:]]",
+    "/y/[![:digit:]x]",
+    "/y/[z-a]",
+    "/y/\\",
+    "/**/deep",
+    "",
+    NULL,
+};
+
+static const char *paths[] = {
+    "/dev/null", "/dev/null2", "/dev/nul",
+    "/tmp/foo", "/tmp/", "/tmp/foo/bar", "/tmpfoo",
+    "/var/tmp/x", "/var/tmp/x/y",
+    "foo.o", "/foo.o", "dir/foo.o", ".o",
+    "foo", "foo/bar", "/",
+    "/home/alip/.ccache/abc", "/home/alip/.ccache/a/b", "/home/a/b/.ccache/c",
+    "/proc/123/fd/4", "/proc/self/fd/4", "/proc/1x/fd/9", "/proc//fd/1",
+    "/dev/ttyS", "/dev/tty1", "/dev/tty/", "/dev/tty",
+    "/dev/pts/1", "/dev/pts/12", "/dev/pts//",
+    "/usr/lib/libc.so", "/usr/lib64/libc.so", "/usr/lib/x/libc.so", "/usr/libexec/a.so",
+    "/etc/foo.conf", "/etc/1foo.conf", "/etc/foo/bar.conf",
+    "/a*b", "/axb",
+    "/x/[a-", "/x/a",
+    "/y/]z", "/y/az", "/y/[a-", "/y/[[:foo:]]", "/y/f", "/y/1", "/y/x", "/y/q",
+    "/y/\\",
+    "/a/deep", "/a/b/deep", "//deep",
+    "",
+    NULL,
+};
+
+static void
+test_single (void)
+{
+    for (unsigned int i = 0; NULL != patterns[i]; i++) {
+        GSList *list = g_slist_append (NULL, (gpointer) patterns[i]);
+        struct globset *gs = globset_new (list);
+
+        g_assert_cmpuint (globset_size (gs), ==, 1);
+        for (unsigned int j = 0; NULL != paths[j]; j++) {
+            gboolean expected = (0 == fnmatch (patterns[i], paths[j], FNM_PATHNAME));
+            if (expected != globset_match (gs, paths[j]))
+                g_error ("pattern `%s' path `%s' expected %d", patterns[i], paths[j], expected);
+        }
+
+        globset_free (gs);
+        g_slist_free (list);
+    }
+}
+
+static void
+test_combined (void)
+{
+    GSList *list = NULL;
+
+    /* Skip the catch-all patterns so that the set doesn't match everything. */
+    for (unsigned int i = 0; NULL != patterns[i]; i++) {
+        if (0 != g_strcmp0 (patterns[i], "*") && 0 != g_strcmp0 (patterns[i], "*.o"))
+            list = g_slist_append (list, (gpointer) patterns[i]);
+    }
+
+    struct globset *gs = globset_new (list);
+    for (unsigned int j = 0; NULL != paths[j]; j++) {
+        gboolean expected = FALSE;
+        for (GSList *walk = list; NULL != walk; walk = g_slist_next (walk)) {
+            if (0 == fnmatch (walk->data, paths[j], FNM_PATHNAME)) {
+                expected = TRUE;
+                break;
+            }
+        }
+        if (expected != globset_match (gs, paths[j]))
+            g_error ("path `%s' expected %d", paths[j], expected);
+    }
+
+    globset_free (gs);
+    g_slist_free (list);
+}
+
+static void
+test_many (void)
+{
+    GSList *list = NULL;
+
+    /* Enough patterns to make the automaton span several words. */
+    for (unsigned int i = 0; i < 200; i++)
+        list = g_slist_prepend (list, g_strdup_printf ("/src/?%u/[a-c]*.c", i));
+
+    struct globset *gs = globset_new (list);
+    g_assert_cmpuint (globset_size (gs), ==, 200);
+    g_assert (globset_match (gs, "/src/x0/a.c"));
+    g_assert (globset_match (gs, "/src/y199/cfoo.c"));
+    g_assert (!globset_match (gs, "/src/y200/a.c"));
+    g_assert (!globset_match (gs, "/src/x0/d.c"));
+    g_assert (!globset_match (gs, "/src/x0/a/b.c"));
+
+    globset_free (gs);
+    g_slist_foreach (list, (GFunc) g_free, NULL);
+    g_slist_free (list);
+}
+
+static void
+test_empty (void)
+{
+    struct globset *gs = globset_new (NULL);
+
+    g_assert_cmpuint (globset_size (gs), ==, 0);
+    g_assert (!globset_match (gs, "/dev/null"));
+    g_assert (!globset_match (NULL, "/dev/null"));
+    globset_free (gs);
+}
+
+int
+main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/globset/single", test_single);
+    g_test_add_func ("/globset/combined", test_combined);
+    g_test_add_func ("/globset/many", test_many);
+    g_test_add_func ("/globset/empty", test_empty);
+
+    return g_test_run ();
+}
@@ -0,0 +1,200 @@
+/* vim: set et ts=4 sts=4 sw=4 fdm=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <glib.h>
+
+#include <landlock.h>
+#include <sydbox-config.h>
+
+static gchar *dir, *allowed, *file;
+
+/* Returns -1 if the kernel lacks Landlock, so the test is skipped. */
+static int ruleset_new(GSList *prefixes, bool proc, bool *exact)
+{
+    int fd;
+
+    fd = landlock_ruleset_new(prefixes, proc, exact);
+    if (0 > fd) {
+        g_assert(ENOSYS == errno || EOPNOTSUPP == errno);
+        g_test_message("Landlock isn't supported, skipping");
+    }
+    return fd;
+}
+
+static int create(const gchar *name)
+{
+    int fd;
+    gchar *path;
+
+    path = g_build_filename(dir, name, NULL);
+    fd = open(path, O_WRONLY | O_CREAT, 0600);
+    g_free(path);
+    if (0 > fd)
+        return errno;
+    close(fd);
+    return 0;
+}
+
+static void test1(void)
+{
+    int fd, status;
+    bool exact;
+    pid_t pid;
+    GSList *prefixes = NULL;
+
+    prefixes = g_slist_append(prefixes, allowed);
+    fd = ruleset_new(prefixes, false, &exact);
+    g_slist_free(prefixes);
+    if (0 > fd)
+        return;
+    g_assert(exact);
+
+    pid = fork();
+    g_assert_cmpint(pid, >=, 0);
+    if (0 == pid) {
+        if (0 > landlock_restrict(fd))
+            _exit(1);
+        if (0 != create("allowed/file"))
+            _exit(2);
+        if (EACCES != create("denied"))
+            _exit(3);
+        /* Existing files outside may neither be written nor removed. */
+        if (EACCES != create("file"))
+            _exit(4);
+        if (0 == unlink(file) || EACCES != errno)
+            _exit(5);
+        _exit(0);
+    }
+    close(fd);
+    g_assert_cmpint(waitpid(pid, &status, 0), ==, pid);
+    g_assert(WIFEXITED(status));
+    g_assert_cmpint(WEXITSTATUS(status), ==, 0);
+}
+
+static void test2(void)
+{
+    int fd;
+    bool exact;
+    GSList *prefixes = NULL;
+    gchar *missing;
+
+    /* Files, missing paths and /proc are granted more than they allow. */
+    prefixes = g_slist_append(prefixes, file);
+    fd = ruleset_new(prefixes, false, &exact);
+    g_slist_free(prefixes);
+    if (0 > fd)
+        return;
+    close(fd);
+    g_assert(!exact);
+
+    missing = g_build_filename(allowed, "does", "not", "exist", NULL);
+    prefixes = g_slist_append(NULL, missing);
+    fd = ruleset_new(prefixes, false, &exact);
+    g_slist_free(prefixes);
+    g_free(missing);
+    g_assert_cmpint(fd, >=, 0);
+    close(fd);
+    g_assert(!exact);
+
+    prefixes = g_slist_append(NULL, allowed);
+    fd = ruleset_new(prefixes, true, &exact);
+    g_slist_free(prefixes);
+    g_assert_cmpint(fd, >=, 0);
+    close(fd);
+    g_assert(!exact);
+}
+
+static void test3(void)
+{
+    int fd;
+    bool exact;
+    GSList *prefixes = NULL;
+    gchar *link;
+
+    /* A prefix linking to another directory grants that directory. */
+    link = g_build_filename(dir, "link", NULL);
+    g_assert_cmpint(symlink(allowed, link), ==, 0);
+    prefixes = g_slist_append(prefixes, link);
+    fd = ruleset_new(prefixes, false, &exact);
+    g_slist_free(prefixes);
+    unlink(link);
+    g_free(link);
+    if (0 > fd)
+        return;
+    close(fd);
+    g_assert(!exact);
+
+    /* A trailing slash doesn't make a prefix inexact. */
+    link = g_strconcat(allowed, "/", NULL);
+    prefixes = g_slist_append(NULL, link);
+    fd = ruleset_new(prefixes, false, &exact);
+    g_slist_free(prefixes);
+    g_free(link);
+    g_assert_cmpint(fd, >=, 0);
+    close(fd);
+    g_assert(exact);
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+    gchar *tmp;
+
+    g_setenv(ENV_NO_CONFIG, "1", 1);
+    sydbox_config_load(NULL, NULL);
+
+    tmp = g_build_filename(g_get_tmp_dir(), "sydbox-landlock-XXXXXX", NULL);
+    g_assert(NULL != mkdtemp(tmp));
+    /* Prefixes are canonical, see test3 */
+    dir = realpath(tmp, NULL);
+    g_assert(NULL != dir);
+    g_free(tmp);
+    allowed = g_build_filename(dir, "allowed", NULL);
+    g_assert_cmpint(mkdir(allowed, 0700), ==, 0);
+    file = g_build_filename(dir, "file", NULL);
+    g_assert_cmpint(create("file"), ==, 0);
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/landlock/restrict", test1);
+    g_test_add_func("/landlock/exact", test2);
+    g_test_add_func("/landlock/symlink", test3);
+
+    ret = g_test_run();
+
+    gchar *path = g_build_filename(allowed, "file", NULL);
+    unlink(path);
+    g_free(path);
+    unlink(file);
+    rmdir(allowed);
+    rmdir(dir);
+    return ret;
+}
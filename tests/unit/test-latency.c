@@ -0,0 +1,90 @@
+/* vim: set et ts=4 sts=4 sw=4 fdm=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <glib.h>
+#include <latency.h>
+#include <syscall.h>
+
+static void
+test1 (void)
+{
+    guint prev = 0;
+
+    /* Buckets are ordered and every value stays below the last bucket. */
+    for (guint64 v = 1; v < G_GUINT64_CONSTANT (1) << 40; v += v / 7 + 1) {
+        guint b = latency_bucket (v);
+        g_assert_cmpuint (b, >=, prev);
+        g_assert_cmpuint (b, <, LATENCY_BUCKETS);
+        prev = b;
+    }
+    g_assert_cmpuint (latency_bucket (G_MAXUINT64), ==, LATENCY_BUCKETS - 1);
+}
+
+static void
+test2 (void)
+{
+    guint64 p50, p99, p999;
+
+    latency_init ();
+    /* 1000 values 1us ... 1ms */
+    for (guint64 i = 1; i <= 1000; i++)
+        latency_add (LATENCY_EXEC, i * 1000);
+    g_assert_cmpuint (latency_count (LATENCY_EXEC), ==, 1000);
+    g_assert_cmpuint (latency_count (LATENCY_FORK), ==, 0);
+
+    /* Within 1/16th of the exact value */
+    p50 = latency_percentile (LATENCY_EXEC, 50);
+    p99 = latency_percentile (LATENCY_EXEC, 99);
+    p999 = latency_percentile (LATENCY_EXEC, 99.9);
+    g_assert_cmpuint (p50, >=, 500000);
+    g_assert_cmpuint (p50, <=, 500000 + 500000 / 16);
+    g_assert_cmpuint (p99, >=, 990000);
+    g_assert_cmpuint (p99, <=, 1000000);
+    g_assert_cmpuint (p999, ==, 1000000);
+    g_assert_cmpuint (latency_percentile (LATENCY_EXEC, 0), >=, 1000);
+    g_assert_cmpuint (latency_percentile (LATENCY_EXEC, 0), <=, 1000 + 1000 / 16);
+    latency_reset ();
+    g_assert_cmpuint (latency_count (LATENCY_EXEC), ==, 0);
+}
+
+static void
+test3 (void)
+{
+    latency_init ();
+    latency_note_result (RS_DENY);
+    latency_add_syscall (true, 100);
+    latency_add_syscall (false, 200);
+    g_assert_cmpuint (latency_count (LATENCY_SYSCALL_ENTER), ==, 1);
+    g_assert_cmpuint (latency_count (LATENCY_SYSCALL_EXIT), ==, 1);
+    g_assert_cmpuint (latency_count (LATENCY_DENY), ==, 1);
+    g_assert_cmpuint (latency_percentile (LATENCY_DENY, 50), ==, 100);
+    latency_reset ();
+}
+
+int
+main (int argc, char **argv)
+{
+    g_test_init (&argc, &argv, NULL);
+
+    g_test_add_func ("/latency/bucket", test1);
+    g_test_add_func ("/latency/percentile", test2);
+    g_test_add_func ("/latency/syscall", test3);
+
+    return g_test_run ();
+}
@@ -0,0 +1,165 @@
+/* vim: set et ts=4 sts=4 sw=4 fdm=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+
+#include <context.h>
+#include <monitor.h>
+#include <sydbox-config.h>
+
+static gchar *path;
+
+static struct monitor_segment *map_segment(void)
+{
+    int fd;
+    void *map;
+
+    fd = open(path, O_RDONLY);
+    g_assert_cmpint(fd, >=, 0);
+    map = mmap(NULL, sizeof(struct monitor_segment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    g_assert(MAP_FAILED != map);
+    return map;
+}
+
+static void test1(void)
+{
+    context_t *ctx;
+    struct monitor_segment *segment;
+    struct monitor_counters counters;
+
+    g_assert(monitor_open(path));
+    g_assert(monitor_enabled);
+    segment = map_segment();
+    g_assert(0 == memcmp(segment->magic, MONITOR_MAGIC, MONITOR_MAGIC_LEN));
+    g_assert_cmpuint(segment->version, ==, MONITOR_VERSION);
+    g_assert_cmpuint(segment->size, ==, sizeof(struct monitor_segment));
+    g_assert_cmpint(segment->pid, ==, getpid());
+    g_assert_cmpuint(segment->running, ==, 1);
+
+    /* Counters of the context are published, */
+    ctx = context_new();
+    ctx->stats.events = 7;
+    ctx->stats.stops[E_SYSCALL] = 5;
+    ctx->stats.stops[E_EXEC] = 2;
+    ctx->stats.syscalls = 3;
+    ctx->stats.checks = 2;
+    ctx->stats.denied = 1;
+    tchild_new(ctx->children, 4242);
+    monitor_update(ctx);
+
+    g_assert(monitor_read(segment, &counters));
+    g_assert_cmpuint(segment->sequence % 2, ==, 0);
+    g_assert_cmpuint(counters.children, ==, 1);
+    g_assert_cmpuint(counters.events, ==, 7);
+    g_assert_cmpuint(counters.stops[E_SYSCALL], ==, 5);
+    g_assert_cmpuint(counters.stops[E_EXEC], ==, 2);
+    g_assert_cmpuint(counters.syscalls, ==, 3);
+    g_assert_cmpuint(counters.checks, ==, 2);
+    g_assert_cmpuint(counters.denied, ==, 1);
+    g_assert_cmpuint(counters.cpu_ns, >, 0);
+
+    tchild_delete(ctx->children, 4242);
+    monitor_update(ctx);
+    g_assert(monitor_read(segment, &counters));
+    g_assert_cmpuint(counters.children, ==, 0);
+    context_free(ctx);
+
+    /* and the file is gone after closing, the mapping stays. */
+    monitor_close();
+    g_assert(!monitor_enabled);
+    g_assert_cmpuint(segment->running, ==, 0);
+    g_assert(g_file_test(path, G_FILE_TEST_EXISTS) == FALSE);
+    munmap(segment, sizeof(struct monitor_segment));
+}
+
+static void test2(void)
+{
+    struct monitor_segment segment;
+    struct monitor_counters counters;
+
+    /* Counters which are being written aren't read. */
+    memset(&segment, 0, sizeof(segment));
+    segment.sequence = 1;
+    g_assert(!monitor_read(&segment, &counters));
+    segment.sequence = 2;
+    segment.counters.checks = 9;
+    g_assert(monitor_read(&segment, &counters));
+    g_assert_cmpuint(counters.checks, ==, 9);
+}
+
+static void test3(void)
+{
+    gchar *target, *contents;
+    struct stat buf;
+
+    /* A symbolic link at the path is replaced, its target isn't touched. */
+    target = g_strdup_printf("%s.target", path);
+    g_assert(g_file_set_contents(target, "keep", -1, NULL));
+    g_assert_cmpint(symlink(target, path), ==, 0);
+
+    g_assert(monitor_open(path));
+    g_assert_cmpint(lstat(path, &buf), ==, 0);
+    g_assert(S_ISREG(buf.st_mode));
+    g_assert(g_file_get_contents(target, &contents, NULL, NULL));
+    g_assert_cmpstr(contents, ==, "keep");
+    g_free(contents);
+
+    /* and so is a file left over by an earlier run. */
+    monitor_close();
+    g_assert(g_file_set_contents(path, "stale", -1, NULL));
+    g_assert(monitor_open(path));
+    g_assert_cmpint(stat(path, &buf), ==, 0);
+    g_assert_cmpint(buf.st_size, ==, sizeof(struct monitor_segment));
+    monitor_close();
+
+    unlink(target);
+    g_free(target);
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    g_setenv(ENV_NO_CONFIG, "1", 1);
+    sydbox_config_load(NULL, NULL);
+
+    path = g_strdup_printf("%s/sydbox-monitor-%i", g_get_tmp_dir(), getpid());
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/monitor/publish", test1);
+    g_test_add_func("/monitor/read", test2);
+    g_test_add_func("/monitor/symlink", test3);
+
+    ret = g_test_run();
+
+    unlink(path);
+    g_free(path);
+    return ret;
+}
@@ -186,6 +186,84 @@ test11 (void)
     pathnode_free (&pathlist);
 }
 
+static void
+test12 (void)
+{
+    g_assert (path_magic_batch ("/dev/sydbox/batch/write/tmp;on"));
+    g_assert (path_magic_batch ("/dev/sydbox/batch/"));
+    g_assert (! path_magic_batch ("/dev/sydbox/batch"));
+    g_assert (! path_magic_batch ("/dev/sydbox/write/dev/sydbox/batch/"));
+}
+
+static void
+test13 (void)
+{
+    g_assert (path_magic_command ("/dev/sydbox/on"));
+    g_assert (path_magic_command ("/dev/sydbox/write/tmp"));
+    g_assert (path_magic_command ("/dev/sydbox/addexec/usr/bin"));
+    g_assert (path_magic_command ("/dev/sydbox/net/whitelist/unix:///tmp/socket"));
+
+    g_assert (! path_magic_command ("/dev/sydbox/onion"));
+    g_assert (! path_magic_command ("/dev/sydbox/enabled"));
+    g_assert (! path_magic_command ("/dev/sydbox/batch/on"));
+    g_assert (! path_magic_command ("/dev/sydbox/"));
+}
+
+static void
+test14 (void)
+{
+    const gchar *param;
+
+    g_assert_cmpint (path_magic_lookup ("/dev/sydbox/on", &param), ==, MAGIC_CMD_ON);
+    g_assert_cmpstr (param, ==, "");
+    g_assert_cmpint (path_magic_lookup ("/dev/sydbox/wait/eldest", NULL), ==, MAGIC_CMD_WAIT_ELDEST);
+
+    g_assert_cmpint (path_magic_lookup ("/dev/sydbox/write/tmp", &param), ==, MAGIC_CMD_WRITE);
+    g_assert_cmpstr (param, ==, "tmp");
+    g_assert_cmpint (path_magic_lookup ("/dev/sydbox/unwrite//var/tmp", &param), ==, MAGIC_CMD_RMWRITE);
+    g_assert_cmpstr (param, ==, "/var/tmp");
+    g_assert_cmpint (path_magic_lookup ("/dev/sydbox/net/whitelist/inet://127.0.0.1@80", &param),
+                     ==, MAGIC_CMD_NET_WHITELIST);
+    g_assert_cmpstr (param, ==, "inet://127.0.0.1@80");
+
+    /* Commands without a parameter match the whole path, */
+    g_assert_cmpint (path_magic_lookup ("/dev/sydbox/on/", NULL), ==, MAGIC_CMD_NONE);
+    g_assert_cmpint (path_magic_lookup ("/dev/sydbox/o", NULL), ==, MAGIC_CMD_NONE);
+    g_assert_cmpint (path_magic_lookup ("/dev/sydbox/wait/", NULL), ==, MAGIC_CMD_NONE);
+    /* the others need theirs to be separated by a slash. */
+    g_assert_cmpint (path_magic_lookup ("/dev/sydbox/write", NULL), ==, MAGIC_CMD_NONE);
+    g_assert_cmpint (path_magic_lookup ("/dev/sydbox/", NULL), ==, MAGIC_CMD_NONE);
+    g_assert_cmpint (path_magic_lookup ("/dev/sydboxon", NULL), ==, MAGIC_CMD_NONE);
+    g_assert_cmpint (path_magic_lookup ("/dev/null", NULL), ==, MAGIC_CMD_NONE);
+}
+
+static void
+test15 (void)
+{
+    GSList *names = NULL;
+
+    /* Variables are listed once, a tilde starting a word stands for HOME, */
+    g_assert (pathnode_expand_inputs ("/tmp/${USER}/$USER/x$TMP_DIR2", &names));
+    g_assert (pathnode_expand_inputs ("~/.cache", &names));
+    g_assert (pathnode_expand_inputs ("/a~b/$/c", &names));
+    g_assert_cmpuint (g_slist_length (names), ==, 3);
+    g_assert_cmpstr (g_slist_nth_data (names, 0), ==, "USER");
+    g_assert_cmpstr (g_slist_nth_data (names, 1), ==, "TMP_DIR2");
+    g_assert_cmpstr (g_slist_nth_data (names, 2), ==, "HOME");
+
+    /* expansions depending on anything else are refused. */
+    g_assert (! pathnode_expand_inputs ("/tmp/`id -u`", &names));
+    g_assert (! pathnode_expand_inputs ("/tmp/$(id -u)", &names));
+    g_assert (! pathnode_expand_inputs ("/tmp/$$", &names));
+    g_assert (! pathnode_expand_inputs ("/tmp/${USER:-nobody}", &names));
+    g_assert (! pathnode_expand_inputs ("~nobody/tmp", &names));
+    g_assert (! pathnode_expand_inputs ("/tmp/*", &names));
+    g_assert_cmpuint (g_slist_length (names), ==, 3);
+
+    g_slist_foreach (names, (GFunc) g_free, NULL);
+    g_slist_free (names);
+}
+
 static void
 no_log (const gchar *log_domain, GLogLevelFlags log_level, const gchar *message, gpointer user_data)
 {
@@ -202,6 +280,7 @@ main (int argc, char **argv)
     g_test_add_func ("/path/path-node/new/expand-env", test2);
     g_test_add_func ("/path/path-node/new/expand-subshell", test3);
     g_test_add_func ("/path/path-node/free", test4);
+    g_test_add_func ("/path/path-node/expand-inputs", test15);
 
     g_test_add_func ("/path/path-list/init", test5);
     g_test_add_func ("/path/path-list/init/unset", test6);
@@ -213,6 +292,10 @@ main (int argc, char **argv)
     g_test_add_func ("/path/path-list/check/path", test10);
     g_test_add_func ("/path/path-list/check/root", test11);
 
+    g_test_add_func ("/path/magic/batch", test12);
+    g_test_add_func ("/path/magic/command", test13);
+    g_test_add_func ("/path/magic/lookup", test14);
+
     return g_test_run ();
 }
 
@@ -0,0 +1,152 @@
+/* vim: set et ts=4 sts=4 sw=4 fdm=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include <dispatch.h>
+#include <profile.h>
+#include <sydbox-config.h>
+#include <trace.h>
+
+#define PERSONALITY 0
+#define SNO 5
+
+static gchar *path;
+
+/* Returns what profile_report() printed to standard error */
+static gchar *report(void)
+{
+    int fd, saved;
+    gchar *contents;
+
+    fflush(stderr);
+    saved = dup(STDERR_FILENO);
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    g_assert_cmpint(fd, >=, 0);
+    dup2(fd, STDERR_FILENO);
+    close(fd);
+
+    profile_report();
+
+    fflush(stderr);
+    dup2(saved, STDERR_FILENO);
+    close(saved);
+    g_assert(g_file_get_contents(path, &contents, NULL, NULL));
+    return contents;
+}
+
+static void sample(bool checked, bool denied, unsigned long ptrace_calls)
+{
+    profile_begin();
+    profile_note_syscall(SNO);
+    if (checked)
+        profile_note_check();
+    if (denied)
+        profile_note_deny();
+    trace_ptrace_calls += ptrace_calls;
+    profile_end(PERSONALITY);
+}
+
+static void test1(void)
+{
+    gchar *contents, *name;
+
+    profile_init(PROFILE_JSON);
+
+    sample(true, true, 3);
+    sample(true, false, 2);
+    sample(false, false, 1);
+
+    /* Stops without a system call noted aren't accounted. */
+    profile_begin();
+    trace_ptrace_calls += 10;
+    profile_end(PERSONALITY);
+
+    profile_note_cache(PROFILE_CACHE_PATH, true);
+    profile_note_cache(PROFILE_CACHE_PATH, false);
+
+    contents = report();
+    name = g_strdup_printf("\"sno\":%d,\"name\":\"%s\",\"stops\":3,\"checks\":2,\"denials\":1,",
+            SNO, dispatch_name(PERSONALITY, SNO));
+    g_assert(NULL != strstr(contents, name));
+    g_assert(NULL != strstr(contents, "\"ptrace_calls\":6}"));
+    g_assert(NULL != strstr(contents, "\"total\":{\"stops\":3,\"checks\":2,\"denials\":1,"));
+    g_assert(NULL != strstr(contents, "\"verdict-cache\":{\"hits\":1,\"misses\":1}"));
+    g_assert(NULL != strstr(contents, "\"exec-cache\":{\"hits\":0,\"misses\":0}"));
+    g_free(name);
+    g_free(contents);
+
+    profile_free();
+}
+
+static void test2(void)
+{
+    gchar *contents, *line, *total;
+
+    profile_init(PROFILE_TEXT);
+    sample(true, true, 4);
+    profile_note_cache(PROFILE_CACHE_EXEC, true);
+
+    contents = report();
+    g_assert(g_str_has_prefix(contents, "% time"));
+    line = strstr(contents, dispatch_name(PERSONALITY, SNO));
+    total = strstr(contents, "total\n");
+    g_assert(NULL != line);
+    g_assert(NULL != total);
+    g_assert(line < total);
+    g_assert(NULL != strstr(contents, "exec-cache: 1 hits, 0 misses, 100.00% hit rate\n"));
+    g_free(contents);
+
+    /* Nothing is reported once profiling is off. */
+    profile_free();
+    contents = report();
+    g_assert_cmpstr(contents, ==, "");
+    g_free(contents);
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    path = g_strdup_printf("%s/sydbox-profile-%i", g_get_tmp_dir(), getpid());
+
+    g_setenv(ENV_NO_CONFIG, "1", 1);
+    sydbox_config_load(NULL, NULL);
+    dispatch_init();
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/profile/accounting", test1);
+    g_test_add_func("/profile/text", test2);
+
+    ret = g_test_run();
+
+    unlink(path);
+    g_free(path);
+    return ret;
+}
@@ -0,0 +1,181 @@
+/* vim: set et ts=4 sts=4 sw=4 fdm=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <asm/unistd.h>
+
+#include <glib.h>
+
+#include <eventlog.h>
+#include <replay.h>
+#include <syscall.h>
+#include <trace.h>
+#include <sydbox-config.h>
+
+/* Personality of the native system calls */
+#if defined(X86_64)
+#define REPLAY_PERSONALITY 1
+#else
+#define REPLAY_PERSONALITY 0
+#endif
+
+static gchar *trace_path;
+
+static void record_syscall(pid_t pid, long sno, int result, int err, const gchar *path)
+{
+    gchar *paths[4] = { (gchar *) path, NULL, NULL, NULL };
+
+    eventlog_syscall(pid, REPLAY_PERSONALITY, sno, result, err, paths, -1, 0, NULL);
+}
+
+static void test1(void)
+{
+    struct replay_stats stats;
+
+    g_assert(eventlog_open(trace_path));
+    record_syscall(100, __NR_execve, RS_ALLOW, 0, "/bin/true");
+    /* Writes allowed when recorded are denied without a write prefix, */
+    record_syscall(100, __NR_open, RS_ALLOW, 0, "/tmp/x");
+    record_syscall(100, __NR_open, RS_ALLOW, 0, "/tmp/x");
+    /* errors which aren't up to the policy are skipped, */
+    record_syscall(100, __NR_mkdir, RS_DENY, EEXIST, "/tmp/y");
+    record_syscall(100, __NR_open, RS_NOWRITE, 0, "/etc/passwd");
+    /* and denied writes are kept quiet by filters. */
+    record_syscall(100, __NR_open, RS_DENY, EPERM, "/var/x");
+    eventlog_close();
+
+    g_assert(replay_run(trace_path, NULL, &stats));
+    g_assert_cmpuint(stats.syscalls, ==, 6);
+    g_assert_cmpuint(stats.unchanged, ==, 2);
+    g_assert_cmpuint(stats.denied, ==, 2);
+    g_assert_cmpuint(stats.allowed, ==, 0);
+    g_assert_cmpuint(stats.filtered, ==, 1);
+    g_assert_cmpuint(stats.skipped, ==, 1);
+}
+
+static void test2(void)
+{
+    struct replay_stats stats;
+
+    /* Magic commands apply to the child which issued them and its children
+     * forked afterwards. */
+    g_assert(eventlog_open(trace_path));
+    eventlog_event(100, E_FORK, 101);
+    record_syscall(101, __NR_stat, RS_MAGIC, 0, "/dev/sydbox/write//tmp");
+    eventlog_event(101, E_FORK, 102);
+    record_syscall(102, __NR_open, RS_DENY, EPERM, "/tmp/z");
+    record_syscall(100, __NR_open, RS_DENY, EPERM, "/tmp/z");
+    eventlog_event(102, E_EXIT, 0);
+    /* A pid seen again after its exit starts anew. */
+    record_syscall(102, __NR_open, RS_DENY, EPERM, "/tmp/z");
+    eventlog_close();
+
+    g_assert(replay_run(trace_path, NULL, &stats));
+    g_assert_cmpuint(stats.syscalls, ==, 4);
+    g_assert_cmpuint(stats.skipped, ==, 1);
+    g_assert_cmpuint(stats.allowed, ==, 1);
+    g_assert_cmpuint(stats.unchanged, ==, 2);
+    g_assert_cmpuint(stats.denied, ==, 0);
+}
+
+static void test3(void)
+{
+    FILE *fp;
+    struct replay_stats stats;
+    gchar *path;
+
+    path = g_strdup_printf("%s.missing", trace_path);
+    g_assert(!replay_run(path, NULL, &stats));
+    fp = fopen(path, "w");
+    g_assert(NULL != fp);
+    fputs("SYDTRACX", fp);
+    fclose(fp);
+    g_assert(!replay_run(path, NULL, &stats));
+    unlink(path);
+    g_free(path);
+}
+
+static void test4(void)
+{
+    FILE *fp;
+    long size;
+    guint32 len, id;
+    guint8 type = EVENTLOG_RECORD_STRING;
+    struct replay_stats stats;
+
+    /* A truncated trace is replayed up to the damage, but fails, */
+    g_assert(eventlog_open(trace_path));
+    record_syscall(100, __NR_open, RS_ALLOW, 0, "/tmp/x");
+    record_syscall(100, __NR_open, RS_ALLOW, 0, "/tmp/y");
+    eventlog_close();
+
+    fp = fopen(trace_path, "r");
+    g_assert(NULL != fp);
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fclose(fp);
+    g_assert_cmpint(truncate(trace_path, size - 3), ==, 0);
+    g_assert(!replay_run(trace_path, NULL, &stats));
+    g_assert_cmpuint(stats.syscalls, ==, 1);
+
+    /* as does a string id the trace can't hold. */
+    g_assert(eventlog_open(trace_path));
+    eventlog_close();
+    fp = fopen(trace_path, "a");
+    g_assert(NULL != fp);
+    len = 1 + sizeof(id) + 1;
+    id = G_MAXUINT32 - 1;
+    fwrite(&len, sizeof(len), 1, fp);
+    fwrite(&type, sizeof(type), 1, fp);
+    fwrite(&id, sizeof(id), 1, fp);
+    fputc('x', fp);
+    fclose(fp);
+    g_assert(!replay_run(trace_path, NULL, &stats));
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    g_setenv(ENV_NO_CONFIG, "1", 1);
+    sydbox_config_load(NULL, NULL);
+    sydbox_config_addfilter("/var/*");
+
+    trace_path = g_strdup_printf("%s/sydbox-replay-%i", g_get_tmp_dir(), getpid());
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/replay/decide", test1);
+    g_test_add_func("/replay/children", test2);
+    g_test_add_func("/replay/invalid", test3);
+    g_test_add_func("/replay/damaged", test4);
+
+    ret = g_test_run();
+
+    unlink(trace_path);
+    g_free(trace_path);
+    return ret;
+}
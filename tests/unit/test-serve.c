@@ -0,0 +1,155 @@
+/* vim: set et ts=4 sts=4 sw=4 fdm=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+
+#include <serve.h>
+#include <sydbox-config.h>
+
+static void test1(void)
+{
+    char *argv[] = { "make", "-j4", "", "line\nbreak", NULL };
+    char *envp[] = { "PATH=/usr/bin:/bin", "SYDBOX_WRITE=/var/tmp", NULL };
+    struct serve_job job;
+    struct stat in, out;
+    int sv[2];
+
+    g_assert_cmpint(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), ==, 0);
+    g_assert(serve_job_send(sv[0], argv, envp, "/var/tmp/build"));
+    g_assert(serve_job_receive(sv[1], &job));
+
+    g_assert_cmpint(job.argc, ==, 4);
+    for (unsigned int i = 0; i < 4; i++)
+        g_assert_cmpstr(job.argv[i], ==, argv[i]);
+    g_assert(NULL == job.argv[4]);
+    g_assert_cmpstr(job.envp[0], ==, envp[0]);
+    g_assert_cmpstr(job.envp[1], ==, envp[1]);
+    g_assert(NULL == job.envp[2]);
+    g_assert_cmpstr(job.cwd, ==, "/var/tmp/build");
+
+    /* The descriptors are the standard ones of the client. */
+    for (int i = 0; i < 3; i++) {
+        g_assert_cmpint(job.fds[i], >, 2);
+        g_assert_cmpint(fstat(job.fds[i], &out), ==, 0);
+        g_assert_cmpint(fstat(i, &in), ==, 0);
+        g_assert_cmpint(in.st_ino, ==, out.st_ino);
+    }
+
+    serve_job_free(&job);
+    g_assert_cmpint(job.fds[0], ==, -1);
+    close(sv[0]);
+    close(sv[1]);
+}
+
+static void test2(void)
+{
+    int sv[2], status = 0;
+
+    g_assert_cmpint(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), ==, 0);
+    g_assert(serve_status_send(sv[1], 42));
+    g_assert(serve_status_receive(sv[0], &status));
+    g_assert_cmpint(status, ==, 42);
+
+    /* A server that goes away reports no status. */
+    close(sv[1]);
+    g_assert(!serve_status_receive(sv[0], &status));
+    close(sv[0]);
+}
+
+static void test3(void)
+{
+    struct serve_job job;
+    int sv[2];
+
+    /* A request without a command is refused. */
+    g_assert_cmpint(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), ==, 0);
+    g_assert_cmpint(write(sv[0], "v" SERVE_VERSION "\0c/\0", 6), ==, 6);
+    g_assert_cmpint(write(sv[0], "", 1), ==, 1);
+    g_assert(!serve_job_receive(sv[1], &job));
+    g_assert_cmpint(errno, ==, EPROTO);
+    close(sv[0]);
+    close(sv[1]);
+
+    /* So is one cut short. */
+    g_assert_cmpint(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), ==, 0);
+    g_assert_cmpint(write(sv[0], "v" SERVE_VERSION "\0", 3), ==, 3);
+    close(sv[0]);
+    g_assert(!serve_job_receive(sv[1], &job));
+    g_assert_cmpint(errno, ==, EPROTO);
+    close(sv[1]);
+}
+
+static void test4(void)
+{
+    gchar *dir, *path;
+    int lfd, fd, second;
+
+    dir = g_build_filename(g_get_tmp_dir(), "sydbox-serve-XXXXXX", NULL);
+    g_assert(NULL != mkdtemp(dir));
+    path = g_build_filename(dir, "socket", NULL);
+
+    lfd = serve_listen(path);
+    g_assert_cmpint(lfd, >=, 0);
+
+    /* A running server keeps its socket. */
+    second = serve_listen(path);
+    g_assert_cmpint(second, ==, -1);
+    g_assert_cmpint(errno, ==, EADDRINUSE);
+
+    fd = serve_connect(path);
+    g_assert_cmpint(fd, >=, 0);
+    close(fd);
+
+    /* A stale socket is replaced. */
+    close(lfd);
+    lfd = serve_listen(path);
+    g_assert_cmpint(lfd, >=, 0);
+    close(lfd);
+
+    unlink(path);
+    rmdir(dir);
+    g_free(path);
+    g_free(dir);
+}
+
+int main(int argc, char **argv)
+{
+    g_setenv(ENV_NO_CONFIG, "1", 1);
+    sydbox_config_load(NULL, NULL);
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/serve/job", test1);
+    g_test_add_func("/serve/status", test2);
+    g_test_add_func("/serve/malformed", test3);
+    g_test_add_func("/serve/listen", test4);
+
+    return g_test_run();
+}
@@ -0,0 +1,244 @@
+/* vim: set et ts=4 sts=4 sw=4 fdm=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+
+#include <session.h>
+#include <sydbox-config.h>
+#include <sydbox-log.h>
+#include <violation.h>
+
+#define SESSION_THREADS 4
+
+static gchar *dir;
+static sydbox_config_t *writable;
+static pthread_barrier_t test4_barrier;
+
+static void test1(void)
+{
+    char *argv[] = { "sh", "-c", "exit 3", NULL };
+    sydbox_session_t *session;
+    struct sydbox_session_stats stats;
+
+    session = sydbox_session_new(NULL);
+    g_assert(sydbox_session_spawn(session, argv, NULL, dir));
+    g_assert_cmpint(sydbox_session_run(session), ==, 3);
+    g_assert_cmpint(sydbox_session_get_exit_code(session), ==, 3);
+
+    sydbox_session_get_stats(session, &stats);
+    g_assert_cmpuint(stats.events, >, 0);
+    g_assert_cmpuint(stats.syscalls, >, 0);
+    g_assert_cmpuint(stats.denied, ==, 0);
+    g_assert_cmpuint(stats.children, ==, 0);
+    sydbox_session_free(session);
+}
+
+static void test2(void)
+{
+    char *argv[] = { "sh", "-c", "echo see emily play > gnome", NULL };
+    sydbox_session_t *session;
+    struct sydbox_session_stats stats;
+    struct stat buf;
+    gchar *path;
+
+    /* Writes are denied without a write prefix, */
+    path = g_build_filename(dir, "gnome", NULL);
+    session = sydbox_session_new(NULL);
+    g_assert(sydbox_session_spawn(session, argv, NULL, dir));
+    g_assert_cmpint(sydbox_session_run(session), !=, 0);
+    sydbox_session_get_stats(session, &stats);
+    g_assert_cmpuint(stats.checks, >, 0);
+    g_assert_cmpuint(stats.denied, >, 0);
+    g_assert_cmpint(stat(path, &buf), ==, -1);
+    sydbox_session_free(session);
+
+    /* and allowed by the configuration the session is created with. */
+    session = sydbox_session_new(writable);
+    g_assert(sydbox_session_spawn(session, argv, NULL, dir));
+    g_assert_cmpint(sydbox_session_run(session), ==, 0);
+    sydbox_session_get_stats(session, &stats);
+    g_assert_cmpuint(stats.denied, ==, 0);
+    g_assert_cmpint(stat(path, &buf), ==, 0);
+    sydbox_session_free(session);
+
+    unlink(path);
+    g_free(path);
+}
+
+static void test3(void)
+{
+    char *argv[] = { "sh", "-c", "exit 7", NULL };
+    char *envp[] = { "PATH=/bin:/usr/bin", NULL };
+    sydbox_session_t *session, *second;
+
+    session = sydbox_session_new(NULL);
+    g_assert(sydbox_session_spawn(session, argv, envp, NULL));
+
+    /* A thread traces the children of one session at a time. */
+    second = sydbox_session_new(NULL);
+    g_assert(!sydbox_session_spawn(second, argv, envp, NULL));
+    g_assert_cmpint(errno, ==, EBUSY);
+
+    while (sydbox_session_step(session, false))
+        ;
+    g_assert(!sydbox_session_step(session, false));
+    g_assert_cmpint(sydbox_session_get_exit_code(session), ==, 7);
+    sydbox_session_free(session);
+
+    /* Relative working directories are refused. */
+    g_assert(!sydbox_session_spawn(second, argv, envp, "tmp"));
+    g_assert_cmpint(errno, ==, EINVAL);
+    sydbox_session_free(second);
+}
+
+static void *test4_thread(void *data)
+{
+    int *retval = data;
+    gchar *code;
+    char *argv[] = { "sh", "-c", NULL, NULL };
+    sydbox_session_t *session;
+
+    code = g_strdup_printf("echo %d > thread-%d; exit %d", *retval, *retval, *retval);
+    argv[2] = code;
+    session = sydbox_session_new(writable);
+    pthread_barrier_wait(&test4_barrier);
+    if (sydbox_session_spawn(session, argv, NULL, dir))
+        *retval = sydbox_session_run(session);
+    else
+        *retval = -1;
+    sydbox_session_free(session);
+    g_free(code);
+    return NULL;
+}
+
+static void test4(void)
+{
+    int retval[SESSION_THREADS];
+    pthread_t threads[SESSION_THREADS];
+    gchar *path;
+
+    /* Sessions in different threads start and run side by side. */
+    g_assert_cmpint(pthread_barrier_init(&test4_barrier, NULL, SESSION_THREADS), ==, 0);
+    for (int i = 0; i < SESSION_THREADS; i++) {
+        retval[i] = i + 1;
+        g_assert_cmpint(pthread_create(&threads[i], NULL, test4_thread, &retval[i]), ==, 0);
+    }
+    for (int i = 0; i < SESSION_THREADS; i++) {
+        g_assert_cmpint(pthread_join(threads[i], NULL), ==, 0);
+        g_assert_cmpint(retval[i], ==, i + 1);
+
+        path = g_strdup_printf("%s/thread-%d", dir, i + 1);
+        g_assert_cmpint(unlink(path), ==, 0);
+        g_free(path);
+    }
+    pthread_barrier_destroy(&test4_barrier);
+}
+
+static void *test5_thread(void *data)
+{
+    int *save_errno = data;
+    char *argv[] = { "true", NULL };
+    sydbox_session_t *session;
+
+    session = sydbox_session_new(writable);
+    if (sydbox_session_spawn(session, argv, NULL, dir)) {
+        sydbox_session_run(session);
+        *save_errno = 0;
+    }
+    else
+        *save_errno = errno;
+    sydbox_session_free(session);
+    return NULL;
+}
+
+static void test5(void)
+{
+    int save_errno;
+    char *argv[] = { "true", NULL };
+    gchar *path;
+    pthread_t thread;
+    sydbox_session_t *session;
+
+    /* Sessions don't share the violation file with each other, */
+    path = g_build_filename(dir, "violations", NULL);
+    g_assert(violation_open(path));
+    session = sydbox_session_new(NULL);
+    g_assert(sydbox_session_spawn(session, argv, NULL, dir));
+    g_assert_cmpint(pthread_create(&thread, NULL, test5_thread, &save_errno), ==, 0);
+    g_assert_cmpint(pthread_join(thread, NULL), ==, 0);
+    g_assert_cmpint(save_errno, ==, EBUSY);
+
+    /* one runs once the other has finished. */
+    g_assert_cmpint(sydbox_session_run(session), ==, 0);
+    g_assert_cmpint(pthread_create(&thread, NULL, test5_thread, &save_errno), ==, 0);
+    g_assert_cmpint(pthread_join(thread, NULL), ==, 0);
+    g_assert_cmpint(save_errno, ==, 0);
+    sydbox_session_free(session);
+
+    violation_close();
+    unlink(path);
+    g_free(path);
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+    sydbox_config_t *previous;
+
+    g_setenv(ENV_NO_CONFIG, "1", 1);
+    sydbox_config_load(NULL, NULL);
+    sydbox_log_init();
+
+    dir = g_build_filename(g_get_tmp_dir(), "sydbox-session-XXXXXX", NULL);
+    g_assert(NULL != mkdtemp(dir));
+
+    writable = sydbox_config_copy();
+    previous = sydbox_config_use(writable);
+    g_setenv(ENV_WRITE, dir, 1);
+    sydbox_config_update_from_environment();
+    g_unsetenv(ENV_WRITE);
+    sydbox_config_use(previous);
+
+    g_test_init(&argc, &argv, NULL);
+
+    /* The first sessions starting at once register the system call type. */
+    g_test_add_func("/session/threads", test4);
+    g_test_add_func("/session/run", test1);
+    g_test_add_func("/session/config", test2);
+    g_test_add_func("/session/step", test3);
+    g_test_add_func("/session/shared", test5);
+
+    ret = g_test_run();
+
+    sydbox_log_fini();
+    sydbox_config_free(writable);
+    rmdir(dir);
+    g_free(dir);
+    return ret;
+}
@@ -0,0 +1,181 @@
+/* vim: set et ts=4 sts=4 sw=4 fdm=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <glib.h>
+
+#include <sydbox-config.h>
+#include <sydbox-log.h>
+
+static gchar *path;
+static int evaluated;
+
+static gchar *read_log(void)
+{
+    gchar *contents;
+
+    g_assert(g_file_get_contents(path, &contents, NULL, NULL));
+    return contents;
+}
+
+static const gchar *count(const gchar *str)
+{
+    ++evaluated;
+    return str;
+}
+
+static void test1(void)
+{
+    gchar *contents;
+
+    g_assert_cmpint(truncate(path, 0), ==, 0);
+
+    /* Disabled levels don't evaluate their arguments, */
+    evaluated = 0;
+    g_debug("%s", count("hidden"));
+    g_debug_trace("%s", count("hidden"));
+    g_assert_cmpint(evaluated, ==, 0);
+    g_assert(!sydbox_log_pending());
+
+    /* enabled ones are buffered until flushed. */
+    g_message("%s", count("shown"));
+    g_assert_cmpint(evaluated, ==, 1);
+    g_assert(sydbox_log_pending());
+    contents = read_log();
+    g_assert_cmpstr(contents, ==, "");
+    g_free(contents);
+
+    sydbox_log_flush();
+    g_assert(!sydbox_log_pending());
+    contents = read_log();
+    g_assert(NULL != strstr(contents, "Message: shown\n"));
+    g_assert(NULL == strstr(contents, "hidden"));
+    g_free(contents);
+}
+
+static void test2(void)
+{
+    gchar *contents, *first, *long_line, *last;
+    gchar *filler;
+
+    g_assert_cmpint(truncate(path, 0), ==, 0);
+
+    /* A record too long for the ring is written in order. */
+    filler = g_strnfill(2000, 'x');
+    g_message("first");
+    g_message("%s", filler);
+    g_message("last");
+    sydbox_log_flush();
+
+    contents = read_log();
+    first = strstr(contents, "Message: first\n");
+    long_line = strstr(contents, filler);
+    last = strstr(contents, "Message: last\n");
+    g_assert(NULL != first);
+    g_assert(NULL != long_line);
+    g_assert(NULL != last);
+    g_assert(first < long_line);
+    g_assert(long_line < last);
+    g_assert(long_line[2000] == '\n');
+    g_free(contents);
+    g_free(filler);
+}
+
+static void test3(void)
+{
+    gchar *contents, *message, *critical;
+
+    g_assert_cmpint(truncate(path, 0), ==, 0);
+
+    /* Critical messages flush the records before them. */
+    g_message("before");
+    g_critical("important");
+    g_assert(!sydbox_log_pending());
+
+    contents = read_log();
+    message = strstr(contents, "Message: before\n");
+    critical = strstr(contents, "CRITICAL: important\n");
+    g_assert(NULL != message);
+    g_assert(NULL != critical);
+    g_assert(message < critical);
+    g_free(contents);
+}
+
+static void test4(void)
+{
+    int status;
+    pid_t pid;
+    gchar *contents, *expected;
+
+    g_assert_cmpint(truncate(path, 0), ==, 0);
+
+    /* Records carry the process ID of the process logging them. */
+    pid = fork();
+    g_assert_cmpint(pid, >=, 0);
+    if (0 == pid) {
+        g_message("child");
+        sydbox_log_flush();
+        _exit(EXIT_SUCCESS);
+    }
+    g_assert_cmpint(waitpid(pid, &status, 0), ==, pid);
+
+    contents = read_log();
+    expected = g_strdup_printf("(%i@", pid);
+    g_assert(NULL != strstr(contents, expected));
+    g_free(expected);
+    g_free(contents);
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    path = g_strdup_printf("%s/sydbox-log-%i", g_get_tmp_dir(), getpid());
+
+    g_setenv(ENV_NO_CONFIG, "1", 1);
+    sydbox_config_load(NULL, NULL);
+    sydbox_config_set_log_file(path);
+    sydbox_config_set_verbosity(1);
+
+    g_test_init(&argc, &argv, NULL);
+    sydbox_log_init();
+    /* g_test_init() makes criticals fatal */
+    g_log_set_always_fatal(G_LOG_FATAL_MASK);
+
+    g_test_add_func("/log/mask", test1);
+    g_test_add_func("/log/long", test2);
+    g_test_add_func("/log/critical", test3);
+    g_test_add_func("/log/pid", test4);
+
+    ret = g_test_run();
+
+    sydbox_log_fini();
+    unlink(path);
+    g_free(path);
+    return ret;
+}
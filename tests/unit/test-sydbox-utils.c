@@ -17,6 +17,13 @@
  * Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
 #include <glib.h>
 #include <sydbox-utils.h>
 
@@ -68,6 +75,115 @@ test6 (void)
     g_free (path);
 }
 
+static void
+check_normalize (const gchar *dir, const gchar *path, pid_t pid, const gchar *expected)
+{
+    gchar buf[64];
+
+    g_assert_cmpint (sydbox_normalize_path (buf, sizeof (buf), dir, path, pid), ==, strlen (expected));
+    g_assert_cmpstr (buf, ==, expected);
+}
+
+static void
+test7 (void)
+{
+    check_normalize ("/home/user", "src//main.c", 0, "/home/user/src/main.c");
+    check_normalize ("/home/user/", "src/", 0, "/home/user/src");
+    check_normalize ("/home/user", "//etc///passwd", 0, "/etc/passwd");
+    check_normalize ("/home/user", "", 0, "/home/user");
+    check_normalize ("/", "", 0, "/");
+}
+
+static void
+test8 (void)
+{
+    check_normalize ("/home/user", "./src/./main.c", 0, "/home/user/src/main.c");
+    check_normalize ("/home/user", "src/.", 0, "/home/user/src/.");
+    check_normalize ("/home/user", "src/.//", 0, "/home/user/src/.");
+    check_normalize ("/", ".", 0, "/");
+    check_normalize (NULL, "/../../etc/../etc", 0, "/etc/../etc");
+    check_normalize (NULL, "/..", 0, "/");
+}
+
+static void
+test9 (void)
+{
+    check_normalize (NULL, "/proc/self", 42, "/proc/42");
+    check_normalize (NULL, "//proc//self//fd/", 42, "/proc/42/fd");
+    check_normalize ("/proc", "self/cwd", 42, "/proc/42/cwd");
+    check_normalize (NULL, "/proc/self/cwd", 0, "/proc/self/cwd");
+    check_normalize (NULL, "/proc/selfish", 42, "/proc/selfish");
+    check_normalize (NULL, "/tmp/proc/self", 42, "/tmp/proc/self");
+}
+
+static void
+test10 (void)
+{
+    gchar buf[8];
+
+    errno = 0;
+    g_assert_cmpint (sydbox_normalize_path (buf, sizeof (buf), "/home", "user", 0), ==, -1);
+    g_assert_cmpint (errno, ==, ENAMETOOLONG);
+    g_assert_cmpint (sydbox_normalize_path (buf, sizeof (buf), "/home", "u", 0), ==, 7);
+    g_assert_cmpint (sydbox_normalize_path (buf, sizeof (buf), NULL, "/proc/self", 123456789), ==, -1);
+}
+
+static void
+test11 (void)
+{
+    int fd, out;
+    gchar *dir, *target, *link, *path, *contents;
+    struct stat a, b;
+
+    dir = g_build_filename (g_get_tmp_dir (), "sydbox-utils-XXXXXX", NULL);
+    g_assert (NULL != mkdtemp (dir));
+    target = g_build_filename (dir, "target", NULL);
+    link = g_build_filename (dir, "link", NULL);
+    g_assert (g_file_set_contents (target, "keep", -1, NULL));
+    g_assert_cmpint (symlink (target, link), ==, 0);
+
+    /* Symbolic links aren't followed, */
+    errno = 0;
+    g_assert_cmpint (sydbox_open_output (link), ==, -1);
+    g_assert_cmpint (errno, ==, ELOOP);
+    g_assert (g_file_get_contents (target, &contents, NULL, NULL));
+    g_assert_cmpstr (contents, ==, "keep");
+    g_free (contents);
+
+    /* regular files are truncated, */
+    fd = sydbox_open_output (target);
+    g_assert_cmpint (fd, >=, 0);
+    g_assert (FD_CLOEXEC & fcntl (fd, F_GETFD));
+    close (fd);
+    g_assert (g_file_get_contents (target, &contents, NULL, NULL));
+    g_assert_cmpstr (contents, ==, "");
+    g_free (contents);
+
+    /* and inherited file descriptors are duplicated. */
+    fd = open (target, O_WRONLY);
+    g_assert_cmpint (fd, >=, 0);
+    path = g_strdup_printf ("/dev/fd/%d", fd);
+    out = sydbox_open_output (path);
+    g_assert_cmpint (out, >=, 0);
+    g_assert_cmpint (out, !=, fd);
+    g_assert_cmpint (fstat (fd, &a), ==, 0);
+    g_assert_cmpint (fstat (out, &b), ==, 0);
+    g_assert (a.st_ino == b.st_ino);
+    close (out);
+    close (fd);
+    errno = 0;
+    g_assert_cmpint (sydbox_open_output (path), ==, -1);
+    g_assert_cmpint (errno, ==, EBADF);
+    g_free (path);
+
+    unlink (link);
+    unlink (target);
+    rmdir (dir);
+    g_free (link);
+    g_free (target);
+    g_free (dir);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -81,6 +197,13 @@ main (int argc, char **argv)
     g_test_add_func ("/utils/compress-path/only-slashes", test5);
     g_test_add_func ("/utils/compress-path/empty-string", test6);
 
+    g_test_add_func ("/utils/normalize-path/join", test7);
+    g_test_add_func ("/utils/normalize-path/dots", test8);
+    g_test_add_func ("/utils/normalize-path/proc-self", test9);
+    g_test_add_func ("/utils/normalize-path/too-long", test10);
+
+    g_test_add_func ("/utils/open-output", test11);
+
     return g_test_run ();
 }
 
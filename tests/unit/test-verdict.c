@@ -0,0 +1,199 @@
+/* vim: set et ts=4 sts=4 sw=4 fdm=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+
+#include <verdict.h>
+
+static void test1(void)
+{
+    verdict_cache_t *cache;
+    const struct verdict *verdict;
+    struct verdict_cache_stats stats;
+
+    cache = verdict_cache_new();
+    g_assert(NULL == verdict_cache_lookup(cache, 0, "/home/syd", "foo", 0));
+
+    verdict_cache_insert(cache, 0, "/home/syd", "foo", 0, "/home/syd/foo", true);
+    verdict = verdict_cache_lookup(cache, 0, "/home/syd", "foo", 0);
+    g_assert(NULL != verdict);
+    g_assert(verdict->allow);
+    g_assert_cmpstr(verdict->rpath, ==, "/home/syd/foo");
+
+    verdict_cache_insert(cache, 0, NULL, "/etc/passwd", 0, "/etc/passwd", false);
+    verdict = verdict_cache_lookup(cache, 0, NULL, "/etc/passwd", 0);
+    g_assert(NULL != verdict);
+    g_assert(!verdict->allow);
+
+    verdict_cache_get_stats(cache, &stats);
+    g_assert_cmpuint(stats.hits, ==, 2);
+    g_assert_cmpuint(stats.misses, ==, 1);
+    g_assert_cmpuint(stats.entries, ==, 2);
+    verdict_cache_free(cache);
+}
+
+static void test2(void)
+{
+    guint policy;
+    verdict_cache_t *cache;
+
+    cache = verdict_cache_new();
+    verdict_cache_insert(cache, 0, "/home/syd", "foo", 0, "/home/syd/foo", true);
+
+    /* Every part of the key counts. */
+    g_assert(NULL == verdict_cache_lookup(cache, 0, "/home/syd", "foo", 1));
+    g_assert(NULL == verdict_cache_lookup(cache, 0, "/tmp", "foo", 0));
+    g_assert(NULL == verdict_cache_lookup(cache, 0, NULL, "foo", 0));
+    g_assert(NULL == verdict_cache_lookup(cache, 0, "/home/syd", "bar", 0));
+
+    policy = verdict_cache_policy_new(cache);
+    g_assert_cmpuint(policy, !=, 0);
+    g_assert_cmpuint(verdict_cache_policy_new(cache), !=, policy);
+    g_assert(NULL == verdict_cache_lookup(cache, policy, "/home/syd", "foo", 0));
+    g_assert(NULL != verdict_cache_lookup(cache, 0, "/home/syd", "foo", 0));
+    verdict_cache_free(cache);
+}
+
+static void test3(void)
+{
+    verdict_cache_t *cache;
+    const struct verdict *verdict;
+    struct verdict_cache_stats stats;
+
+    cache = verdict_cache_new();
+    verdict_cache_insert(cache, 0, "/home/syd", "link", 0, "/home/syd/target", true);
+
+    /* A new generation drops what was decided, */
+    verdict_cache_invalidate(cache);
+    g_assert(NULL == verdict_cache_lookup(cache, 0, "/home/syd", "link", 0));
+
+    /* and the stale decision is replaced. */
+    verdict_cache_insert(cache, 0, "/home/syd", "link", 0, "/etc/shadow", false);
+    verdict = verdict_cache_lookup(cache, 0, "/home/syd", "link", 0);
+    g_assert(NULL != verdict);
+    g_assert(!verdict->allow);
+    g_assert_cmpstr(verdict->rpath, ==, "/etc/shadow");
+
+    verdict_cache_get_stats(cache, &stats);
+    g_assert_cmpuint(stats.entries, ==, 1);
+    verdict_cache_free(cache);
+}
+
+static void test4(void)
+{
+    verdict_cache_t *cache;
+    struct verdict_cache_stats stats;
+
+    /* /proc/PID is allowed for some children only. */
+    cache = verdict_cache_new();
+    verdict_cache_insert(cache, 0, NULL, "/proc/self/attr/current", 0, "/proc/1/attr/current", true);
+    verdict_cache_insert(cache, 0, "/proc", "1", 0, "/proc", false);
+    g_assert(NULL == verdict_cache_lookup(cache, 0, NULL, "/proc/self/attr/current", 0));
+    g_assert(NULL == verdict_cache_lookup(cache, 0, "/proc", "1", 0));
+
+    verdict_cache_insert(cache, 0, NULL, "/procfs", 0, "/procfs", true);
+    g_assert(NULL != verdict_cache_lookup(cache, 0, NULL, "/procfs", 0));
+
+    verdict_cache_get_stats(cache, &stats);
+    g_assert_cmpuint(stats.entries, ==, 1);
+    verdict_cache_free(cache);
+}
+
+static void test5(void)
+{
+    int fd;
+    gchar *path, *linkpath;
+    struct stat buf;
+    struct timespec times[2];
+    verdict_cache_t *cache;
+    const struct verdict *verdict;
+    struct verdict_cache_stats stats;
+
+    path = g_build_filename(g_get_tmp_dir(), "sydbox-verdict-XXXXXX", NULL);
+    fd = mkstemp(path);
+    g_assert_cmpint(fd, >=, 0);
+    close(fd);
+
+    cache = verdict_cache_new();
+    g_assert_cmpint(stat(path, &buf), ==, 0);
+    verdict_cache_insert_exec(cache, 0, NULL, "cc", &buf, path, true);
+
+    /* Exec decisions hold as long as the file is the same, */
+    verdict_cache_invalidate(cache);
+    verdict = verdict_cache_lookup_exec(cache, 0, NULL, "cc", &buf);
+    g_assert(NULL != verdict);
+    g_assert(verdict->allow);
+    g_assert_cmpstr(verdict->rpath, ==, path);
+    g_assert(NULL == verdict_cache_lookup(cache, 0, NULL, "cc", 0));
+    g_assert(NULL == verdict_cache_lookup_exec(cache, 1, NULL, "cc", &buf));
+
+    /* and are dropped when it's modified */
+    times[0].tv_sec = times[1].tv_sec = 42;
+    times[0].tv_nsec = times[1].tv_nsec = 0;
+    g_assert_cmpint(utimensat(AT_FDCWD, path, times, 0), ==, 0);
+    g_assert_cmpint(stat(path, &buf), ==, 0);
+    g_assert(NULL == verdict_cache_lookup_exec(cache, 0, NULL, "cc", &buf));
+    verdict_cache_insert_exec(cache, 0, NULL, "cc", &buf, path, true);
+    g_assert(NULL != verdict_cache_lookup_exec(cache, 0, NULL, "cc", &buf));
+
+    /* or linked to. */
+    linkpath = g_strdup_printf("%s-link", path);
+    g_assert_cmpint(symlink(path, linkpath), ==, 0);
+    g_assert_cmpint(stat(linkpath, &buf), ==, 0);
+    g_assert(NULL != verdict_cache_lookup_exec(cache, 0, NULL, "cc", &buf));
+    unlink(linkpath);
+    g_assert_cmpint(link(path, linkpath), ==, 0);
+    g_assert_cmpint(stat(path, &buf), ==, 0);
+    g_assert(NULL == verdict_cache_lookup_exec(cache, 0, NULL, "cc", &buf));
+
+    verdict_cache_get_stats(cache, &stats);
+    g_assert_cmpuint(stats.exec_hits, ==, 3);
+    g_assert_cmpuint(stats.exec_misses, ==, 3);
+    g_assert_cmpuint(stats.hits, ==, 0);
+    g_assert_cmpuint(stats.misses, ==, 1);
+    verdict_cache_free(cache);
+
+    unlink(linkpath);
+    unlink(path);
+    g_free(linkpath);
+    g_free(path);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/verdict/lookup", test1);
+    g_test_add_func("/verdict/key", test2);
+    g_test_add_func("/verdict/invalidate", test3);
+    g_test_add_func("/verdict/proc", test4);
+    g_test_add_func("/verdict/exec", test5);
+
+    return g_test_run();
+}
@@ -0,0 +1,197 @@
+/* vim: set et ts=4 sts=4 sw=4 fdm=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include <violation.h>
+
+static gchar *path;
+
+/* Returns the lines written to the violation file */
+static gchar **read_lines(void)
+{
+    gchar *contents, **lines;
+
+    g_assert(g_file_get_contents(path, &contents, NULL, NULL));
+    lines = g_strsplit(contents, "\n", 0);
+    g_free(contents);
+    return lines;
+}
+
+static guint count_type(gchar **lines, const char *type)
+{
+    guint n = 0;
+    gchar *prefix = g_strdup_printf("{\"type\":\"%s\"", type);
+
+    for (unsigned int i = 0; NULL != lines[i]; i++) {
+        if (g_str_has_prefix(lines[i], prefix))
+            ++n;
+    }
+    g_free(prefix);
+    return n;
+}
+
+static void test1(void)
+{
+    gchar **lines;
+
+    /* Identical violations are written once and counted, */
+    g_assert(violation_open(path));
+    g_assert(violation_enabled());
+    for (unsigned int i = 0; i < 10; i++)
+        violation_report(100, "open", "/etc/passwd", "open(\"/etc/passwd\", O_WRONLY/O_RDWR)");
+    violation_report(101, "open", "/etc/passwd", "open(\"/etc/passwd\", O_WRONLY/O_RDWR)");
+    /* violations without a path are told apart by their reason. */
+    violation_report(100, "connect", NULL, "connect{family=AF_INET addr=1.2.3.4 port=80}");
+    violation_report(100, "connect", NULL, "connect{family=AF_INET addr=1.2.3.5 port=80}");
+    violation_close();
+    g_assert(!violation_enabled());
+
+    lines = read_lines();
+    g_assert_cmpuint(count_type(lines, "violation"), ==, 4);
+    g_assert_cmpuint(count_type(lines, "repeat"), ==, 1);
+    g_assert_cmpuint(count_type(lines, "total"), ==, 4);
+    g_assert_cmpuint(count_type(lines, "summary"), ==, 1);
+    g_assert(g_str_has_prefix(lines[0], "{\"type\":\"violation\",\"time\":"));
+    g_assert(NULL != strstr(lines[0], "\"pid\":100,\"syscall\":\"open\",\"path\":\"/etc/passwd\","
+                "\"reason\":\"open(\\\"/etc/passwd\\\", O_WRONLY/O_RDWR)\"}"));
+    g_assert(NULL != strstr(lines[2], "\"path\":null,"));
+    g_assert(NULL != strstr(lines[4], "\"pid\":100,\"syscall\":\"open\",\"path\":\"/etc/passwd\",\"count\":9}"));
+    g_assert(NULL != strstr(lines[5], "\"count\":10}"));
+    g_assert(NULL != strstr(lines[9], "\"violations\":13,\"distinct\":4,\"dropped\":0}"));
+    g_assert(NULL == lines[10] || '\0' == lines[10][0]);
+    g_strfreev(lines);
+}
+
+static void test2(void)
+{
+    gchar *file, **lines;
+
+    /* A child writes a limited number of violations in a window. */
+    g_assert(violation_open(path));
+    for (unsigned int i = 0; i < VIOLATION_RATE + 5; i++) {
+        file = g_strdup_printf("/tmp/%u", i);
+        violation_report(100, "open", file, file);
+        g_free(file);
+    }
+    violation_report(101, "open", "/tmp/0", "/tmp/0");
+    violation_close();
+
+    lines = read_lines();
+    g_assert_cmpuint(count_type(lines, "violation"), ==, VIOLATION_RATE + 1);
+    g_assert_cmpuint(count_type(lines, "dropped"), ==, 1);
+    g_assert_cmpuint(count_type(lines, "total"), ==, VIOLATION_RATE + 6);
+    g_assert(NULL != strstr(lines[VIOLATION_RATE + 1], "\"pid\":100,\"count\":5}"));
+    g_strfreev(lines);
+}
+
+static void test3(void)
+{
+    gchar **lines;
+
+    /* Strings are escaped, bytes of those which aren't UTF-8 one by one. */
+    g_assert(violation_open(path));
+    violation_report(100, "open", "/tmp/a\"b\\c\n", "reason");
+    violation_report(100, "open", "/tmp/\xff", "reason");
+    violation_close();
+
+    lines = read_lines();
+    g_assert(NULL != strstr(lines[0], "\"path\":\"/tmp/a\\\"b\\\\c\\u000a\""));
+    g_assert(NULL != strstr(lines[1], "\"path\":\"/tmp/\\u00ff\""));
+    g_strfreev(lines);
+}
+
+static void test4(void)
+{
+    gchar **lines;
+
+    /* Lines are written at idle points, not only when sydbox exits, */
+    g_assert(violation_open(path));
+    g_assert(!violation_pending());
+    violation_report(100, "open", "/etc/passwd", "reason");
+    violation_report(100, "open", "/etc/passwd", "reason");
+    g_assert(violation_pending());
+    violation_idle();
+    g_assert(!violation_pending());
+    lines = read_lines();
+    g_assert_cmpuint(count_type(lines, "violation"), ==, 1);
+    g_assert_cmpuint(count_type(lines, "repeat"), ==, 0);
+    g_strfreev(lines);
+
+    /* repeats once their window is over. */
+    sleep(VIOLATION_WINDOW);
+    g_assert(violation_pending());
+    violation_idle();
+    lines = read_lines();
+    g_assert_cmpuint(count_type(lines, "repeat"), ==, 1);
+    g_assert(NULL != strstr(lines[1], "\"count\":1}"));
+    g_assert_cmpuint(count_type(lines, "summary"), ==, 0);
+    g_strfreev(lines);
+    violation_close();
+}
+
+static void test5(void)
+{
+    gchar *target, *contents;
+
+    /* A symbolic link planted at the path isn't followed. */
+    target = g_strdup_printf("%s.target", path);
+    g_assert(g_file_set_contents(target, "untouched", -1, NULL));
+    unlink(path);
+    g_assert(0 == symlink(target, path));
+    g_assert(!violation_open(path));
+    g_assert_cmpint(errno, ==, ELOOP);
+    g_assert(!violation_enabled());
+    unlink(path);
+
+    g_assert(g_file_get_contents(target, &contents, NULL, NULL));
+    g_assert_cmpstr(contents, ==, "untouched");
+    g_free(contents);
+    unlink(target);
+    g_free(target);
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    path = g_strdup_printf("%s/sydbox-violation-%i", g_get_tmp_dir(), getpid());
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/violation/aggregate", test1);
+    g_test_add_func("/violation/rate", test2);
+    g_test_add_func("/violation/escape", test3);
+    g_test_add_func("/violation/idle", test4);
+    g_test_add_func("/violation/symlink", test5);
+
+    ret = g_test_run();
+
+    unlink(path);
+    g_free(path);
+    return ret;
+}
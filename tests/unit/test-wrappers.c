@@ -0,0 +1,144 @@
+/* vim: set et ts=4 sts=4 sw=4 fdm=syntax : */
+
+/*
+ * Copyright (c) 2009 Ali Polatel <polatel@gmail.com>
+ *
+ * This file is part of the sydbox sandbox tool. sydbox is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU General
+ * Public License version 2, as published by the Free Software Foundation.
+ *
+ * sydbox is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif // HAVE_CONFIG_H
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+
+#include <wrappers.h>
+
+static gchar *dir, *file, *link_path, *missing;
+
+static void test1(void)
+{
+    gchar *rpath;
+    struct stat buf;
+    struct canonicalize_record record;
+
+    rpath = canonicalize_filename_mode(file, CAN_EXISTING, true, &record);
+    g_assert_cmpstr(rpath, ==, file);
+    g_assert(record.exists);
+    g_assert(!record.symlinks);
+    g_assert(S_ISREG(record.st.st_mode));
+    g_assert_cmpint(stat(file, &buf), ==, 0);
+    g_assert_cmpuint(record.st.st_dev, ==, buf.st_dev);
+    g_assert_cmpuint(record.st.st_ino, ==, buf.st_ino);
+    g_free(rpath);
+
+    rpath = canonicalize_filename_mode(missing, CAN_ALL_BUT_LAST, true, &record);
+    g_assert_cmpstr(rpath, ==, missing);
+    g_assert(!record.exists);
+    g_free(rpath);
+
+    g_assert(NULL == canonicalize_filename_mode(missing, CAN_EXISTING, true, &record));
+}
+
+static void test2(void)
+{
+    gchar *rpath;
+    struct stat buf;
+    struct canonicalize_record record;
+
+    /* Resolving a symbolic link records the file it points to, */
+    rpath = canonicalize_filename_mode(link_path, CAN_EXISTING, true, &record);
+    g_assert_cmpstr(rpath, ==, file);
+    g_assert(record.exists);
+    g_assert(record.symlinks);
+    g_assert(S_ISREG(record.st.st_mode));
+    g_free(rpath);
+
+    /* not resolving it records the link. */
+    rpath = canonicalize_filename_mode(link_path, CAN_ALL_BUT_LAST, false, &record);
+    g_assert_cmpstr(rpath, ==, link_path);
+    g_assert(record.exists);
+    g_assert(!record.symlinks);
+    g_assert(S_ISLNK(record.st.st_mode));
+    g_assert_cmpint(lstat(link_path, &buf), ==, 0);
+    g_assert_cmpuint(record.st.st_ino, ==, buf.st_ino);
+    g_free(rpath);
+}
+
+static void test3(void)
+{
+    gchar *path, *rpath;
+    struct stat buf;
+    struct canonicalize_record record;
+
+    /* The record describes the canonical path, not the last component. */
+    path = g_strdup_printf("%s/sub/..", dir);
+    rpath = canonicalize_filename_mode(path, CAN_EXISTING, true, &record);
+    g_assert_cmpstr(rpath, ==, dir);
+    g_assert(record.exists);
+    g_assert(S_ISDIR(record.st.st_mode));
+    g_assert_cmpint(stat(dir, &buf), ==, 0);
+    g_assert_cmpuint(record.st.st_ino, ==, buf.st_ino);
+    g_free(rpath);
+    g_free(path);
+
+    rpath = canonicalize_filename_mode("/", CAN_EXISTING, true, &record);
+    g_assert_cmpstr(rpath, ==, "/");
+    g_assert(record.exists);
+    g_assert(S_ISDIR(record.st.st_mode));
+    g_free(rpath);
+}
+
+int main(int argc, char **argv)
+{
+    int fd, ret;
+    gchar *sub;
+
+    dir = g_build_filename(g_get_tmp_dir(), "sydbox-wrappers-XXXXXX", NULL);
+    g_assert(NULL != mkdtemp(dir));
+    file = g_build_filename(dir, "file", NULL);
+    link_path = g_build_filename(dir, "link", NULL);
+    missing = g_build_filename(dir, "missing", NULL);
+    sub = g_build_filename(dir, "sub", NULL);
+
+    fd = open(file, O_WRONLY | O_CREAT, 0600);
+    g_assert_cmpint(fd, >=, 0);
+    close(fd);
+    g_assert_cmpint(symlink("file", link_path), ==, 0);
+    g_assert_cmpint(mkdir(sub, 0700), ==, 0);
+
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/wrappers/canonicalize/record", test1);
+    g_test_add_func("/wrappers/canonicalize/symlink", test2);
+    g_test_add_func("/wrappers/canonicalize/dotdot", test3);
+
+    ret = g_test_run();
+
+    rmdir(sub);
+    unlink(link_path);
+    unlink(file);
+    rmdir(dir);
+    g_free(sub);
+    g_free(missing);
+    g_free(link_path);
+    g_free(file);
+    g_free(dir);
+    return ret;
+}